@@ -0,0 +1,38 @@
+############################################################################
+# Check if zlib and zstd are installed, both are optional
+#
+# This cmake file will define the following variables
+#    Compression_LIBRARIES, the list of compression libraries found
+#    PHYDB_USE_ZLIB, whether .gz files can be read and written
+#    PHYDB_USE_ZSTD, whether .zst files can be read and written
+############################################################################
+message(STATUS "Detecting compression libraries...")
+set(Compression_LIBRARIES "")
+
+find_package(ZLIB)
+if(ZLIB_FOUND)
+    set(PHYDB_USE_ZLIB 1)
+    set(Compression_LIBRARIES ${Compression_LIBRARIES} ${ZLIB_LIBRARIES})
+    include_directories(${ZLIB_INCLUDE_DIRS})
+    message(STATUS "Found zlib: " ${ZLIB_LIBRARIES})
+else()
+    set(PHYDB_USE_ZLIB 0)
+    message(STATUS "Cannot find zlib, .gz files are not supported")
+endif()
+
+find_path(ZSTD_INCLUDE_DIR NAMES zstd.h)
+find_library(ZSTD_LIBRARY NAMES zstd)
+if(ZSTD_INCLUDE_DIR AND ZSTD_LIBRARY)
+    set(PHYDB_USE_ZSTD 1)
+    set(Compression_LIBRARIES ${Compression_LIBRARIES} ${ZSTD_LIBRARY})
+    include_directories(${ZSTD_INCLUDE_DIR})
+    message(STATUS "Found zstd: " ${ZSTD_LIBRARY})
+else()
+    set(PHYDB_USE_ZSTD 0)
+    message(STATUS "Cannot find zstd, .zst files are not supported")
+endif()
+
+configure_file(
+    ${CMAKE_CURRENT_SOURCE_DIR}/phydb/common/config.h.in
+    ${CMAKE_CURRENT_SOURCE_DIR}/phydb/common/config.h
+)
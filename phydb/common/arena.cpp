@@ -0,0 +1,105 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include "arena.h"
+
+#include <cstdint>
+#include <cstdlib>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#include "logging.h"
+
+namespace phydb {
+
+Arena::Arena(size_t block_size, bool use_huge_pages) :
+    block_size_(block_size),
+    use_huge_pages_(use_huge_pages),
+    cursor_(nullptr),
+    limit_(nullptr),
+    num_allocations_(0),
+    bytes_allocated_(0),
+    bytes_reserved_(0) {
+  if (use_huge_pages_) {
+    // whole huge pages, so every block can be backed by them
+    block_size_ = (block_size_ + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+  }
+}
+
+Arena::~Arena() {
+  Release();
+}
+
+void *Arena::Allocate(size_t size, size_t alignment) {
+  uintptr_t aligned = (reinterpret_cast<uintptr_t>(cursor_) + alignment - 1) & ~(alignment - 1);
+  if (cursor_ == nullptr || aligned + size > reinterpret_cast<uintptr_t>(limit_)) {
+    NewBlock(size + alignment);
+    aligned = (reinterpret_cast<uintptr_t>(cursor_) + alignment - 1) & ~(alignment - 1);
+  }
+  cursor_ = reinterpret_cast<char *>(aligned + size);
+  num_allocations_++;
+  bytes_allocated_ += size;
+  return reinterpret_cast<void *>(aligned);
+}
+
+void Arena::NewBlock(size_t min_size) {
+  size_t size = block_size_;
+  while (size < min_size) {
+    size += block_size_;
+  }
+
+  char *block = nullptr;
+  if (use_huge_pages_) {
+    block = static_cast<char *>(std::aligned_alloc(kHugePageSize, size));
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    // a hint only, the kernel falls back to normal pages when transparent huge pages are off
+    if (block != nullptr) madvise(block, size, MADV_HUGEPAGE);
+#endif
+  } else {
+    block = static_cast<char *>(std::malloc(size));
+  }
+  PhyDBExpects(block != nullptr, "Arena cannot allocate a block of " + std::to_string(size) + " bytes");
+
+  blocks_.emplace_back(block, size);
+  cursor_ = block;
+  limit_ = block + size;
+  bytes_reserved_ += size;
+}
+
+/****
+ * @brief Frees every block at once. Objects allocated from this arena must
+ * already be destroyed, pointers into it are dangling afterwards.
+ */
+void Arena::Release() {
+  for (std::pair<char *, size_t> &block: blocks_) {
+    std::free(block.first);
+  }
+  blocks_.clear();
+  cursor_ = nullptr;
+  limit_ = nullptr;
+  num_allocations_ = 0;
+  bytes_allocated_ = 0;
+  bytes_reserved_ = 0;
+}
+
+}
@@ -0,0 +1,102 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+#ifndef PHYDB_COMMON_ARENA_H_
+#define PHYDB_COMMON_ARENA_H_
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace phydb {
+
+/****
+ * A bump allocator handing out memory from large blocks. Objects never move
+ * once allocated, and every block is freed at once by Release() or by the
+ * destructor. The arena does not run destructors, callers destroy objects
+ * first (ArenaPtr does this). Not thread safe, use one arena per thread.
+ */
+class Arena {
+ public:
+  static const size_t kDefaultBlockSize = 1 << 20;
+  static const size_t kHugePageSize = 2 << 20;
+
+  explicit Arena(size_t block_size = kDefaultBlockSize, bool use_huge_pages = false);
+  ~Arena();
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  void *Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+  template<typename T, typename... Args>
+  T *New(Args &&... args) {
+    return new(Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+  }
+
+  void Release();
+
+  size_t NumAllocations() const { return num_allocations_; }
+  size_t BytesAllocated() const { return bytes_allocated_; }
+  size_t BytesReserved() const { return bytes_reserved_; }
+  size_t NumBlocks() const { return blocks_.size(); }
+
+ private:
+  size_t block_size_;
+  bool use_huge_pages_;
+  std::vector<std::pair<char *, size_t>> blocks_;
+  char *cursor_;
+  char *limit_;
+  size_t num_allocations_;
+  size_t bytes_allocated_;
+  size_t bytes_reserved_;
+
+  void NewBlock(size_t min_size);
+};
+
+// destroys the object, and frees it only if it did not come from an arena
+template<typename T>
+struct ArenaDeleter {
+  bool in_arena = false;
+  void operator()(T *ptr) const {
+    if (in_arena) {
+      ptr->~T();
+    } else {
+      delete ptr;
+    }
+  }
+};
+
+template<typename T>
+using ArenaPtr = std::unique_ptr<T, ArenaDeleter<T>>;
+
+// allocates from the arena when one is given, from the heap otherwise
+template<typename T, typename... Args>
+ArenaPtr<T> MakeArenaPtr(Arena *arena, Args &&... args) {
+  if (arena == nullptr) {
+    return ArenaPtr<T>(new T(std::forward<Args>(args)...));
+  }
+  return ArenaPtr<T>(arena->New<T>(std::forward<Args>(args)...), ArenaDeleter<T>{true});
+}
+
+}
+
+#endif //PHYDB_COMMON_ARENA_H_
@@ -0,0 +1,463 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+#include "compressedfile.h"
+
+#include <cstring>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "config.h"
+#if PHYDB_USE_ZLIB
+#include <zlib.h>
+#endif
+#if PHYDB_USE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "logging.h"
+
+namespace phydb {
+
+namespace {
+
+// decompressed blocks handed to the reader, and uncompressed gzip blocks compressed concurrently
+const size_t kBlockBytes = 1 << 20;
+// decompressed blocks the read-ahead thread keeps ready
+const size_t kReadAheadBlocks = 4;
+// buffer of the FILEs returned by OpenInputFile() and OpenOutputFile()
+const size_t kFileBufferBytes = 1 << 16;
+
+bool EndsWith(std::string const &s, std::string const &suffix) {
+  return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+std::string LibraryName(Compression compression) {
+  return compression == Compression::GZIP ? "zlib" : "zstd";
+}
+
+/****
+ * The cookie of a FILE returned by OpenInputFile() for a compressed file. A
+ * thread of its own decompresses the file into a queue of at most
+ * kReadAheadBlocks blocks, and Read() takes the text from the queue.
+ */
+class Decompressor {
+ public:
+  Decompressor(FILE *file, Compression compression) : file_(file), compression_(compression) {
+    thread_ = std::thread(&Decompressor::ReadAhead, this);
+  }
+
+  ~Decompressor() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopped_ = true;
+    }
+    space_.notify_all();
+    thread_.join();
+    fclose(file_);
+  }
+
+  ssize_t Read(char *buf, size_t size) {
+    if (pos_ == block_.size()) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      ready_.wait(lock, [this] { return !blocks_.empty() || done_; });
+      if (blocks_.empty()) return failed_ ? -1 : 0;
+      block_ = std::move(blocks_.front());
+      blocks_.pop_front();
+      pos_ = 0;
+      lock.unlock();
+      space_.notify_one();
+    }
+    size_t count = std::min(size, block_.size() - pos_);
+    memcpy(buf, block_.data() + pos_, count);
+    pos_ += count;
+    return (ssize_t) count;
+  }
+
+ private:
+  FILE *file_;
+  Compression compression_;
+  std::thread thread_;
+
+  std::mutex mutex_;
+  std::condition_variable ready_; // a block was queued, or decompression ended
+  std::condition_variable space_; // a block was taken, or the FILE was closed
+  std::deque<std::string> blocks_;
+  bool done_ = false;
+  bool failed_ = false;
+  bool stopped_ = false;
+
+  // used by the reader only
+  std::string block_;
+  size_t pos_ = 0;
+
+  void ReadAhead() {
+    bool success = (compression_ == Compression::GZIP) ? InflateGzip() : DecompressZstd();
+    PhyDBWarns(!success && !IsStopped(), "Corrupted or truncated compressed file");
+    std::lock_guard<std::mutex> lock(mutex_);
+    done_ = true;
+    failed_ = !success;
+    ready_.notify_all();
+  }
+
+  bool IsStopped() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stopped_;
+  }
+
+  // queues a full block, false once the FILE is closed
+  bool Push(std::string &block, size_t used) {
+    block.resize(used);
+    std::unique_lock<std::mutex> lock(mutex_);
+    space_.wait(lock, [this] { return blocks_.size() < kReadAheadBlocks || stopped_; });
+    if (stopped_) return false;
+    blocks_.push_back(std::move(block));
+    ready_.notify_one();
+    block.assign(kBlockBytes, '\0');
+    return true;
+  }
+
+  // concatenated gzip members, as written by OpenOutputFile(), are read as one stream
+  bool InflateGzip() {
+#if PHYDB_USE_ZLIB
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, 15 + 32) != Z_OK) return false;
+    std::vector<unsigned char> in(kBlockBytes);
+    std::string block(kBlockBytes, '\0');
+    size_t used = 0;
+    bool success = true;
+    bool member_end = false;
+    bool output_pending = false;
+    while (true) {
+      // more input only once the inflater has no more output pending
+      if (zs.avail_in == 0 && !output_pending) {
+        size_t count = fread(in.data(), 1, in.size(), file_);
+        if (count == 0) {
+          success = member_end && ferror(file_) == 0;
+          break;
+        }
+        zs.next_in = in.data();
+        zs.avail_in = (uInt) count;
+      }
+      zs.next_out = reinterpret_cast<Bytef *>(&block[used]);
+      zs.avail_out = (uInt) (kBlockBytes - used);
+      int res = inflate(&zs, Z_NO_FLUSH);
+      used = kBlockBytes - zs.avail_out;
+      output_pending = zs.avail_out == 0;
+      if (res == Z_STREAM_END) {
+        member_end = true;
+        inflateReset(&zs);
+      } else if (res == Z_OK || res == Z_BUF_ERROR) {
+        member_end = member_end && zs.avail_in == 0 && res == Z_BUF_ERROR;
+      } else {
+        success = false;
+        break;
+      }
+      if (used == kBlockBytes) {
+        if (!Push(block, used)) break;
+        used = 0;
+      }
+    }
+    inflateEnd(&zs);
+    if (success && used > 0) Push(block, used);
+    return success;
+#else
+    return false;
+#endif
+  }
+
+  bool DecompressZstd() {
+#if PHYDB_USE_ZSTD
+    ZSTD_DStream *ds = ZSTD_createDStream();
+    if (ds == nullptr) return false;
+    ZSTD_initDStream(ds);
+    std::vector<char> in(ZSTD_DStreamInSize());
+    ZSTD_inBuffer input = {in.data(), 0, 0};
+    std::string block(kBlockBytes, '\0');
+    size_t used = 0;
+    size_t frame_remaining = 0;
+    bool success = true;
+    bool output_pending = false;
+    while (true) {
+      // more input only once the decoder has no more output pending
+      if (input.pos == input.size && !output_pending) {
+        size_t count = fread(in.data(), 1, in.size(), file_);
+        if (count == 0) {
+          success = frame_remaining == 0 && ferror(file_) == 0;
+          break;
+        }
+        input = {in.data(), count, 0};
+      }
+      ZSTD_outBuffer output = {&block[0], kBlockBytes, used};
+      frame_remaining = ZSTD_decompressStream(ds, &output, &input);
+      if (ZSTD_isError(frame_remaining)) {
+        success = false;
+        break;
+      }
+      used = output.pos;
+      output_pending = used == kBlockBytes;
+      if (used == kBlockBytes) {
+        if (!Push(block, used)) break;
+        used = 0;
+      }
+    }
+    ZSTD_freeDStream(ds);
+    if (success && used > 0) Push(block, used);
+    return success;
+#else
+    return false;
+#endif
+  }
+};
+
+/****
+ * The cookie of a FILE returned by OpenOutputFile() for a compressed file.
+ * gzip: the text is cut into kBlockBytes blocks, each compressed into a gzip
+ * member by a task of its own, at most num_threads at a time; members are
+ * written in order. zstd: one stream with num_threads library workers.
+ */
+class Compressor {
+ public:
+  Compressor(FILE *file, Compression compression, int num_threads) :
+      file_(file), compression_(compression), num_threads_(num_threads) {
+#if PHYDB_USE_ZSTD
+    if (compression_ == Compression::ZSTD) {
+      cctx_ = ZSTD_createCCtx();
+      // fails, and compression stays on this thread, if libzstd is built without threads
+      ZSTD_CCtx_setParameter(cctx_, ZSTD_c_nbWorkers, num_threads_);
+      out_.resize(ZSTD_CStreamOutSize());
+    }
+#endif
+  }
+
+  ~Compressor() {
+#if PHYDB_USE_ZSTD
+    ZSTD_freeCCtx(cctx_);
+#endif
+  }
+
+  ssize_t Write(const char *buf, size_t size) {
+    if (compression_ == Compression::GZIP) {
+      block_.append(buf, size);
+      if (block_.size() >= kBlockBytes && !SubmitGzipBlock()) return 0;
+      return (ssize_t) size;
+    }
+    return CompressZstd(buf, size, false) ? (ssize_t) size : 0;
+  }
+
+  // compresses what is left and closes the file, 0 on success
+  int Close() {
+    bool success = true;
+    if (compression_ == Compression::GZIP) {
+      // an empty text still gets a member, so that the file is valid gzip
+      if (!block_.empty() || num_blocks_ == 0) success = SubmitGzipBlock();
+      while (success && !pending_.empty()) success = WriteFirstPending();
+    } else {
+      success = CompressZstd(nullptr, 0, true);
+    }
+    success = (fclose(file_) == 0) && success;
+    return success ? 0 : -1;
+  }
+
+ private:
+  FILE *file_;
+  Compression compression_;
+  int num_threads_;
+
+  std::string block_;
+  size_t num_blocks_ = 0;
+  std::deque<std::future<std::string>> pending_;
+
+#if PHYDB_USE_ZSTD
+  ZSTD_CCtx *cctx_ = nullptr;
+#endif
+  std::string out_;
+
+  static std::string GzipBlock(std::string const &text) {
+    std::string member;
+#if PHYDB_USE_ZLIB
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+      return member;
+    }
+    member.resize(deflateBound(&zs, (uLong) text.size()));
+    zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(text.data()));
+    zs.avail_in = (uInt) text.size();
+    zs.next_out = reinterpret_cast<Bytef *>(&member[0]);
+    zs.avail_out = (uInt) member.size();
+    int res = deflate(&zs, Z_FINISH);
+    member.resize(res == Z_STREAM_END ? zs.total_out : 0);
+    deflateEnd(&zs);
+#else
+    (void) text;
+#endif
+    return member;
+  }
+
+  bool SubmitGzipBlock() {
+    pending_.push_back(std::async(std::launch::async, GzipBlock, std::move(block_)));
+    block_.clear();
+    ++num_blocks_;
+    while (pending_.size() > (size_t) num_threads_) {
+      if (!WriteFirstPending()) return false;
+    }
+    return true;
+  }
+
+  bool WriteFirstPending() {
+    std::string member = pending_.front().get();
+    pending_.pop_front();
+    return !member.empty() && fwrite(member.data(), 1, member.size(), file_) == member.size();
+  }
+
+  bool CompressZstd(const char *buf, size_t size, bool end) {
+#if PHYDB_USE_ZSTD
+    ZSTD_inBuffer input = {buf, size, 0};
+    while (true) {
+      ZSTD_outBuffer output = {&out_[0], out_.size(), 0};
+      size_t remaining = ZSTD_compressStream2(cctx_, &output, &input, end ? ZSTD_e_end : ZSTD_e_continue);
+      if (ZSTD_isError(remaining)) return false;
+      if (fwrite(out_.data(), 1, output.pos, file_) != output.pos) return false;
+      if (end ? remaining == 0 : input.pos == input.size) return true;
+    }
+#else
+    (void) buf;
+    (void) size;
+    (void) end;
+    return false;
+#endif
+  }
+};
+
+ssize_t ReadDecompressed(void *cookie, char *buf, size_t size) {
+  return static_cast<Decompressor *>(cookie)->Read(buf, size);
+}
+
+int CloseDecompressed(void *cookie) {
+  delete static_cast<Decompressor *>(cookie);
+  return 0;
+}
+
+ssize_t WriteCompressed(void *cookie, const char *buf, size_t size) {
+  return static_cast<Compressor *>(cookie)->Write(buf, size);
+}
+
+int CloseCompressed(void *cookie) {
+  auto *compressor = static_cast<Compressor *>(cookie);
+  int res = compressor->Close();
+  delete compressor;
+  return res;
+}
+
+}
+
+Compression CompressionOf(std::string const &file_name) {
+  if (EndsWith(file_name, ".gz")) return Compression::GZIP;
+  if (EndsWith(file_name, ".zst")) return Compression::ZSTD;
+  return Compression::NONE;
+}
+
+bool IsCompressionSupported(Compression compression) {
+  switch (compression) {
+    case Compression::GZIP: return PHYDB_USE_ZLIB;
+    case Compression::ZSTD: return PHYDB_USE_ZSTD;
+    default: return true;
+  }
+}
+
+FILE *OpenInputFile(std::string const &file_name) {
+  Compression compression = CompressionOf(file_name);
+  PhyDBExpects(
+      IsCompressionSupported(compression),
+      "PhyDB is built without " << LibraryName(compression) << ", cannot read " << file_name
+  );
+  FILE *file = fopen(file_name.c_str(), "r");
+  if (file == nullptr || compression == Compression::NONE) return file;
+  cookie_io_functions_t functions = {ReadDecompressed, nullptr, nullptr, CloseDecompressed};
+  auto *decompressor = new Decompressor(file, compression);
+  FILE *decompressed = fopencookie(decompressor, "r", functions);
+  if (decompressed == nullptr) {
+    delete decompressor; // stops the read-ahead thread and closes file
+    return nullptr;
+  }
+  setvbuf(decompressed, nullptr, _IOFBF, kFileBufferBytes);
+  return decompressed;
+}
+
+FILE *OpenOutputFile(std::string const &file_name, int num_threads) {
+  Compression compression = CompressionOf(file_name);
+  PhyDBExpects(
+      IsCompressionSupported(compression),
+      "PhyDB is built without " << LibraryName(compression) << ", cannot write " << file_name
+  );
+  FILE *file = fopen(file_name.c_str(), "w");
+  if (file == nullptr || compression == Compression::NONE) return file;
+  if (num_threads <= 0) {
+    num_threads = std::max(1, (int) std::thread::hardware_concurrency());
+  }
+  cookie_io_functions_t functions = {nullptr, WriteCompressed, nullptr, CloseCompressed};
+  auto *compressor = new Compressor(file, compression, num_threads);
+  FILE *compressed = fopencookie(compressor, "w", functions);
+  if (compressed == nullptr) {
+    delete compressor;
+    fclose(file);
+    return nullptr;
+  }
+  setvbuf(compressed, nullptr, _IOFBF, kFileBufferBytes);
+  return compressed;
+}
+
+bool ReadWholeFile(std::string const &file_name, std::string &text) {
+  FILE *file = OpenInputFile(file_name);
+  if (file == nullptr) return false;
+  text.clear();
+  std::vector<char> buf(kFileBufferBytes);
+  size_t count;
+  while ((count = fread(buf.data(), 1, buf.size(), file)) > 0) {
+    text.append(buf.data(), count);
+  }
+  bool success = ferror(file) == 0;
+  fclose(file);
+  return success;
+}
+
+FileStreamBuf::int_type FileStreamBuf::overflow(int_type c) {
+  if (traits_type::eq_int_type(c, traits_type::eof())) return traits_type::not_eof(c);
+  return fputc(c, file_) == EOF ? traits_type::eof() : c;
+}
+
+std::streamsize FileStreamBuf::xsputn(const char *s, std::streamsize n) {
+  return (std::streamsize) fwrite(s, 1, n, file_);
+}
+
+// std::endl does not flush the FILE, which is buffered and flushed by fclose()
+int FileStreamBuf::sync() {
+  return 0;
+}
+
+}
@@ -0,0 +1,79 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+#ifndef PHYDB_COMMON_COMPRESSEDFILE_H_
+#define PHYDB_COMMON_COMPRESSEDFILE_H_
+
+#include <cstdio>
+#include <streambuf>
+#include <string>
+
+namespace phydb {
+
+enum class Compression { NONE = 0, GZIP = 1, ZSTD = 2 };
+
+// GZIP for a ".gz" file name, ZSTD for ".zst", NONE otherwise
+Compression CompressionOf(std::string const &file_name);
+// whether PhyDB was built with the library handling this compression
+bool IsCompressionSupported(Compression compression);
+
+/****
+ * Opens a file for reading. A ".gz" or ".zst" file is decompressed on a
+ * read-ahead thread which stays a few blocks ahead of the reader, and the
+ * returned FILE reads the decompressed text through a read callback, so the
+ * Si2 parsers read it as they read a plain file. Returns nullptr if the file
+ * cannot be opened; close the FILE with fclose().
+ */
+FILE *OpenInputFile(std::string const &file_name);
+
+/****
+ * Opens a file for writing, compressing what is written to a ".gz" or ".zst"
+ * file on num_threads threads, or on as many threads as the machine has when
+ * num_threads is not positive. gzip output is cut into blocks compressed
+ * concurrently, each one a gzip member of its own, which gzip and zlib read
+ * back as a single stream; zstd output uses the library's own workers.
+ * Returns nullptr if the file cannot be opened; fclose() flushes the last
+ * block and waits for the compression threads.
+ */
+FILE *OpenOutputFile(std::string const &file_name, int num_threads = 0);
+
+// reads the whole (decompressed) text of a file, false if it cannot be read
+bool ReadWholeFile(std::string const &file_name, std::string &text);
+
+/****
+ * A std::streambuf writing to a FILE, so that std::ostream code can write
+ * through OpenOutputFile(). The FILE is not closed by this class.
+ */
+class FileStreamBuf : public std::streambuf {
+ public:
+  explicit FileStreamBuf(FILE *file) : file_(file) {}
+
+ protected:
+  int_type overflow(int_type c) override;
+  std::streamsize xsputn(const char *s, std::streamsize n) override;
+  int sync() override;
+
+ private:
+  FILE *file_;
+};
+
+}
+
+#endif //PHYDB_COMMON_COMPRESSEDFILE_H_
@@ -0,0 +1,107 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+#ifndef PHYDB_COMMON_LEFDEFTOKENIZER_H_
+#define PHYDB_COMMON_LEFDEFTOKENIZER_H_
+
+#include <cstddef>
+#include <string_view>
+
+namespace phydb {
+
+/****
+ * Splits a range of a LEF or DEF text into tokens: whitespace separated
+ * words, double-quoted strings kept whole, and '#' comments skipped up to
+ * the end of the line. An empty view marks the end of the range.
+ */
+class LefDefTokenizer {
+ public:
+  LefDefTokenizer(const char *base, const char *begin, const char *end) : base_(base), cur_(begin), end_(end) {}
+
+  std::string_view Next() {
+    SkipBlanks();
+    const char *start = cur_;
+    if (cur_ == end_) {
+      last_ = std::string_view(start, 0);
+      return last_;
+    }
+    if (*cur_ == '"') {
+      ++cur_;
+      while (cur_ != end_ && *cur_ != '"') ++cur_;
+      if (cur_ != end_) ++cur_;
+    } else {
+      while (cur_ != end_ && !IsBlank(*cur_)) ++cur_;
+    }
+    last_ = std::string_view(start, cur_ - start);
+    return last_;
+  }
+
+  std::string_view Peek() {
+    const char *saved = cur_;
+    std::string_view saved_last = last_;
+    std::string_view token = Next();
+    cur_ = saved;
+    last_ = saved_last;
+    return token;
+  }
+
+  // skips the arguments of an option the reader does not need, up to the next '+' or ';'
+  void SkipOption() {
+    for (std::string_view token = Peek(); !token.empty() && token != "+" && token != ";"; token = Peek()) {
+      Next();
+    }
+  }
+
+  // offset of the last token returned by Next(), or of the end of the range
+  size_t LastOffset() const { return last_.data() - base_; }
+  size_t Offset() const { return cur_ - base_; }
+  // offset of the token Next() would return
+  size_t PeekOffset() {
+    SkipBlanks();
+    return cur_ - base_;
+  }
+  void Seek(size_t offset) { cur_ = base_ + offset; }
+
+  static bool IsBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+  }
+
+ private:
+  const char *base_;
+  const char *cur_;
+  const char *end_;
+  std::string_view last_;
+
+  void SkipBlanks() {
+    while (cur_ != end_) {
+      if (IsBlank(*cur_)) {
+        ++cur_;
+      } else if (*cur_ == '#') {
+        while (cur_ != end_ && *cur_ != '\n') ++cur_;
+      } else {
+        break;
+      }
+    }
+  }
+};
+
+}
+
+#endif //PHYDB_COMMON_LEFDEFTOKENIZER_H_
@@ -280,6 +280,17 @@ class Range {
   }
 };
 
+/****
+ * A via's shapes in DBU relative to the via origin, bottom to top. Built once
+ * per LefVia/DefVia by PhyDB the first time the via is placed, so every
+ * instance only adds its location. layer_id is the Geometry layer id.
+ */
+struct ViaShape {
+  int layer_id;
+  Rect2D<double> rect;
+  Point2D<double> center;
+};
+
 class LayerRect {
  public:
   std::string layer_name_;
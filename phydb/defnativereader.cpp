@@ -0,0 +1,767 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+#include "defnativereader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "netroutingbuilder.h"
+#include "phydb.h"
+#include "phydb/common/compressedfile.h"
+#include "phydb/common/lefdeftokenizer.h"
+#include "phydb/common/logging.h"
+
+namespace phydb {
+
+namespace {
+
+const char *kSectionNames[] = {"COMPONENTS", "PINS", "NETS"};
+
+// sections smaller than two chunks are parsed on the calling thread
+const size_t kMinChunkBytes = 1 << 20;
+
+// sections closed by "END <name>" which the native reader leaves to Si2
+bool IsOtherBlockSection(std::string_view token) {
+  static const char *names[] = {
+      "VIAS", "SPECIALNETS", "BLOCKAGES", "REGIONS", "GROUPS", "FILLS",
+      "NONDEFAULTRULES", "STYLES", "SCANCHAINS", "PINPROPERTIES", "SLOTS",
+      "PROPERTYDEFINITIONS"
+  };
+  for (auto name : names) {
+    if (token == name) return true;
+  }
+  return false;
+}
+
+bool IsOrient(std::string_view token) {
+  return token == "N" || token == "S" || token == "E" || token == "W"
+      || token == "FN" || token == "FS" || token == "FE" || token == "FW";
+}
+
+bool ParseInt(std::string_view token, int &value) {
+  if (token.empty()) return false;
+  const char *first = token.data();
+  if (*first == '+') ++first;
+  auto res = std::from_chars(first, token.data() + token.size(), value);
+  return res.ec == std::errc() && res.ptr == token.data() + token.size();
+}
+
+// "( x y )", where '*' repeats the previous coordinate
+bool ParsePoint(std::string_view open, std::string_view x, std::string_view y, std::string_view close, int &px, int &py) {
+  if (open != "(" || close != ")") return false;
+  if (x != "*" && !ParseInt(x, px)) return false;
+  if (y != "*" && !ParseInt(y, py)) return false;
+  return true;
+}
+
+/****
+ * The offset of the first "- " that follows a " ; " at or after from, which
+ * is where a record starts unless the ';' sits in a string or in a comment
+ * that did not start on its line. Chunks cut at such a false start do not
+ * parse back to back and are rejected, see ParseSectionInChunks().
+ */
+size_t NextRecordStart(std::string_view text, size_t from, size_t end) {
+  for (size_t pos = text.find(';', from); pos != std::string_view::npos && pos < end; pos = text.find(';', pos + 1)) {
+    if (pos == 0 || !LefDefTokenizer::IsBlank(text[pos - 1])) continue;
+    size_t line_begin = text.rfind('\n', pos);
+    line_begin = line_begin == std::string_view::npos ? 0 : line_begin + 1;
+    if (text.substr(line_begin, pos - line_begin).find('#') != std::string_view::npos) continue;
+    size_t next = pos + 1;
+    while (next < end && LefDefTokenizer::IsBlank(text[next])) ++next;
+    if (next == pos + 1 || next + 1 >= end) continue;
+    if (text[next] == '-' && LefDefTokenizer::IsBlank(text[next + 1])) return next;
+  }
+  return end;
+}
+
+std::string Unsupported(std::string_view what, std::string_view token) {
+  return std::string(what) + " " + std::string(token) + " is not supported";
+}
+
+}
+
+DefNativeReader::~DefNativeReader() {
+  Unmap();
+}
+
+bool DefNativeReader::Map(std::string const &def_file_name) {
+  int fd = open(def_file_name.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return false;
+  }
+  void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) return false;
+  madvise(data, st.st_size, MADV_SEQUENTIAL);
+  data_ = static_cast<const char *>(data);
+  size_ = st.st_size;
+  return true;
+}
+
+void DefNativeReader::Unmap() {
+  if (data_ != nullptr && data_ != text_.data()) {
+    munmap(const_cast<char *>(data_), size_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+  std::string().swap(text_);
+}
+
+/**
+ * @brief Map a DEF file and parse its COMPONENTS, PINS and NETS sections.
+ *
+ * @param def_file_name: the DEF file
+ * @param num_threads: threads parsing chunks of the COMPONENTS and NETS sections
+ * @param keep_routing: false to check the routing of nets but not store it,
+ * when no net geometry is loaded
+ * @return true if all three sections (those present) were parsed, false if the
+ * file cannot be mapped or uses a construct this reader does not handle
+ */
+bool DefNativeReader::Read(std::string const &def_file_name, int num_threads, bool keep_routing) {
+  Unmap();
+  keep_routing_ = keep_routing;
+  for (auto &section : sections_) section = SectionRange();
+  records_.clear();
+  records_.emplace_back();
+
+  if (CompressionOf(def_file_name) != Compression::NONE) {
+    // a compressed file cannot be mapped, its text is decompressed into memory instead
+    if (!ReadWholeFile(def_file_name, text_) || text_.empty()) return false;
+    data_ = text_.data();
+    size_ = text_.size();
+  } else if (!Map(def_file_name)) {
+    return false;
+  }
+
+  LefDefTokenizer tok(data_, data_, data_ + size_);
+  std::string error;
+  if (!ReadSections(tok, num_threads, error)) {
+    size_t line = 1 + std::count(data_, data_ + std::min(tok.LastOffset(), size_), '\n');
+    PhyDBWarns(
+        true,
+        "Native DEF reader: " << error << " (" << def_file_name << ":" << line
+                              << "), reading the file with the Si2 parser instead"
+    );
+    records_.clear();
+    Unmap();
+    return false;
+  }
+  return true;
+}
+
+/****
+ * Walks the top-level statements of the file. Blocks closed by "END <name>"
+ * and BEGINEXT/ENDEXT are skipped whole, anything else up to its ';', so
+ * words inside other statements are never mistaken for section headers.
+ */
+bool DefNativeReader::ReadSections(LefDefTokenizer &tok, int num_threads, std::string &error) {
+  for (std::string_view token = tok.Next(); !token.empty(); token = tok.Next()) {
+    if (token == "END") {
+      if (tok.Next() == "DESIGN") return true;
+      error = "unexpected END";
+      return false;
+    }
+    auto section = std::find(std::begin(kSectionNames), std::end(kSectionNames), token);
+    if (section != std::end(kSectionNames)) {
+      Section s = static_cast<Section>(section - std::begin(kSectionNames));
+      if (!ReadSectionHeader(tok, s, error)) return false;
+      if (!ReadSectionBody(tok, s, num_threads, error)) return false;
+    } else if (token == "BEGINEXT") {
+      for (token = tok.Next(); !token.empty() && token != "ENDEXT"; token = tok.Next()) {}
+    } else if (IsOtherBlockSection(token)) {
+      std::string_view name = token;
+      for (token = tok.Next(); !token.empty(); token = tok.Next()) {
+        if (token == "END" && tok.Peek() == name) {
+          tok.Next();
+          break;
+        }
+      }
+    } else {
+      for (token = tok.Next(); !token.empty() && token != ";"; token = tok.Next()) {}
+    }
+    if (token.empty()) break;
+  }
+  error = "missing END DESIGN";
+  return false;
+}
+
+bool DefNativeReader::ReadSectionHeader(LefDefTokenizer &tok, Section section, std::string &error) {
+  SectionRange &range = sections_[section];
+  if (range.found) {
+    error = std::string("a second ") + kSectionNames[section] + " section";
+    return false;
+  }
+  std::string_view count = tok.Next();
+  if (!ParseInt(count, range.count) || tok.Next() != ";") {
+    error = std::string("malformed ") + kSectionNames[section] + " header";
+    return false;
+  }
+  range.found = true;
+  range.count_begin = count.data() - data_;
+  range.count_end = range.count_begin + count.size();
+  range.body_begin = tok.Offset();
+  return true;
+}
+
+bool DefNativeReader::ReadSectionBody(LefDefTokenizer &tok, Section section, int num_threads, std::string &error) {
+  bool chunked = num_threads > 1 && section != PINS && ParseSectionInChunks(tok, section, num_threads);
+  if (!chunked && !ParseSection(tok, section, std::string::npos, records_.back(), error)) return false;
+  std::string_view token = tok.Next();
+  sections_[section].body_end = tok.LastOffset();
+  if (token != "END" || tok.Next() != kSectionNames[section]) {
+    error = std::string(kSectionNames[section]) + " section not closed";
+    return false;
+  }
+  return true;
+}
+
+// parses records into out until END, or until the record starting at offset stop
+bool DefNativeReader::ParseSection(LefDefTokenizer &tok, Section section, size_t stop, Records &out, std::string &error) const {
+  switch (section) {
+    case COMPONENTS: return ParseComponents(tok, stop, out, error);
+    case PINS: return ParseIoPins(tok, stop, out, error);
+    default: return ParseNets(tok, stop, out, error);
+  }
+}
+
+/****
+ * Cuts the section body at record starts into a few chunks per thread and
+ * parses them concurrently. Each chunk must end exactly where the next one
+ * starts, which holds only if every cut is a real record start, so a cut
+ * inside a comment or a string is caught. Returns false, with the tokenizer
+ * and the records untouched, if the section is small, cannot be cut, or a
+ * chunk fails; the caller then parses the section serially, which also
+ * reports any error at its exact position.
+ */
+bool DefNativeReader::ParseSectionInChunks(LefDefTokenizer &tok, Section section, int num_threads) {
+  std::string_view text(data_, size_);
+  size_t begin = tok.Offset();
+  std::string end_marker = std::string("END ") + kSectionNames[section];
+  size_t end = text.find(end_marker, begin);
+  while (end != std::string_view::npos) {
+    size_t after = end + end_marker.size();
+    if (LefDefTokenizer::IsBlank(text[end - 1]) && (after == size_ || LefDefTokenizer::IsBlank(text[after]))) break;
+    end = text.find(end_marker, end + 1);
+  }
+  if (end == std::string_view::npos) return false;
+
+  size_t num_chunks = std::min((end - begin) / kMinChunkBytes, static_cast<size_t>(num_threads) * 4);
+  if (num_chunks < 2) return false;
+  std::vector<size_t> bounds{begin};
+  for (size_t k = 1; k < num_chunks; ++k) {
+    size_t start = NextRecordStart(text, begin + (end - begin) * k / num_chunks, end);
+    if (start > bounds.back() && start < end) bounds.push_back(start);
+  }
+  bounds.push_back(end);
+  num_chunks = bounds.size() - 1;
+  if (num_chunks < 2) return false;
+
+  std::vector<Records> chunks(num_chunks);
+  std::vector<char> parsed(num_chunks, 0);
+  std::atomic<size_t> next(0);
+  auto work = [&]() {
+    std::string error;
+    for (size_t k = next++; k < num_chunks; k = next++) {
+      LefDefTokenizer chunk_tok(data_, data_ + bounds[k], data_ + size_);
+      parsed[k] = ParseSection(chunk_tok, section, bounds[k + 1], chunks[k], error)
+          && chunk_tok.PeekOffset() == bounds[k + 1];
+    }
+  };
+  std::vector<std::thread> workers;
+  for (size_t worker = 0; worker < std::min(num_chunks, static_cast<size_t>(num_threads)); ++worker) {
+    workers.emplace_back(work);
+  }
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+  if (std::count(parsed.begin(), parsed.end(), 0) > 0) return false;
+
+  for (Records &chunk : chunks) {
+    records_.push_back(std::move(chunk));
+  }
+  records_.emplace_back();
+  tok.Seek(end);
+  return true;
+}
+
+/****
+ * - compName modelName [+ SOURCE src] [+ PLACED|FIXED|COVER ( x y ) orient | + UNPLACED] ... ;
+ * The other component options are not used by PhyDB and are skipped.
+ */
+bool DefNativeReader::ParseComponents(LefDefTokenizer &tok, size_t stop, Records &out, std::string &error) const {
+  while (true) {
+    size_t offset = tok.PeekOffset();
+    if (offset >= stop) return offset == stop;
+    std::string_view token = tok.Next();
+    if (token.empty() || token == "END") {
+      tok.Seek(offset);
+      return true;
+    }
+    if (token != "-") {
+      error = "expected '-' in COMPONENTS, found " + std::string(token);
+      return false;
+    }
+    ComponentRecord &comp = out.components.emplace_back();
+    comp.name = tok.Next();
+    comp.macro_name = tok.Next();
+    for (token = tok.Next(); token != ";"; token = tok.Next()) {
+      if (token != "+") {
+        error = "unexpected " + std::string(token) + " in component " + std::string(comp.name);
+        return false;
+      }
+      std::string_view option = tok.Next();
+      if (option == "PLACED" || option == "FIXED" || option == "COVER") {
+        comp.place_status = option == "PLACED" ? PlaceStatus::PLACED :
+                            option == "FIXED" ? PlaceStatus::FIXED : PlaceStatus::COVER;
+        std::string_view open = tok.Next(), x = tok.Next(), y = tok.Next(), close = tok.Next();
+        if (x == "*" || y == "*" || !ParsePoint(open, x, y, close, comp.llx, comp.lly)) {
+          error = "malformed placement of component " + std::string(comp.name);
+          return false;
+        }
+        comp.orient = tok.Next();
+        if (!IsOrient(comp.orient)) {
+          error = "malformed orientation of component " + std::string(comp.name);
+          return false;
+        }
+      } else if (option == "UNPLACED") {
+        comp.place_status = PlaceStatus::UNPLACED;
+        comp.llx = 0;
+        comp.lly = 0;
+      } else if (option == "SOURCE") {
+        comp.source = tok.Next();
+      } else if (option == "EEQMASTER" || option == "WEIGHT" || option == "REGION"
+          || option == "HALO" || option == "ROUTEHALO" || option == "PROPERTY"
+          || option == "MASKSHIFT" || option == "GENERATE" || option == "FOREIGN") {
+        tok.SkipOption();
+      } else {
+        error = Unsupported("component option", option);
+        return false;
+      }
+    }
+  }
+}
+
+/****
+ * - pinName + NET netName [+ DIRECTION dir] [+ USE use]
+ *   [+ LAYER layer [MASK n] [SPACING d | DESIGNRULEWIDTH w] ( x1 y1 ) ( x2 y2 )]...
+ *   [+ PLACED|FIXED|COVER ( x y ) orient | + UNPLACED] ... ;
+ * Pins with PORT statements are left to Si2, which rejects them.
+ */
+bool DefNativeReader::ParseIoPins(LefDefTokenizer &tok, size_t stop, Records &out, std::string &error) const {
+  while (true) {
+    size_t offset = tok.PeekOffset();
+    if (offset >= stop) return offset == stop;
+    std::string_view token = tok.Next();
+    if (token.empty() || token == "END") {
+      tok.Seek(offset);
+      return true;
+    }
+    if (token != "-") {
+      error = "expected '-' in PINS, found " + std::string(token);
+      return false;
+    }
+    IoPinRecord &pin = out.iopins.emplace_back();
+    pin.name = tok.Next();
+    pin.signal_use = "SIGNAL";
+    pin.shape_begin = out.pin_shapes.size();
+    for (token = tok.Next(); token != ";"; token = tok.Next()) {
+      if (token != "+") {
+        error = "unexpected " + std::string(token) + " in pin " + std::string(pin.name);
+        return false;
+      }
+      std::string_view option = tok.Next();
+      if (option == "DIRECTION") {
+        pin.signal_direction = std::string(tok.Next());
+        if (pin.signal_direction == "OUTPUT" && tok.Peek() == "TRISTATE") {
+          tok.Next();
+          pin.signal_direction = "OUTPUT TRISTATE";
+        }
+      } else if (option == "USE") {
+        pin.signal_use = tok.Next();
+      } else if (option == "LAYER") {
+        PinShapeRecord &shape = out.pin_shapes.emplace_back();
+        shape.layer_name = tok.Next();
+        for (token = tok.Peek(); token == "MASK" || token == "SPACING" || token == "DESIGNRULEWIDTH"; token = tok.Peek()) {
+          tok.Next();
+          tok.Next();
+        }
+        int x1 = 0, y1 = 0, x2 = 0, y2 = 0;
+        std::string_view o1 = tok.Next(), a1 = tok.Next(), b1 = tok.Next(), c1 = tok.Next();
+        std::string_view o2 = tok.Next(), a2 = tok.Next(), b2 = tok.Next(), c2 = tok.Next();
+        if (a1 == "*" || b1 == "*" || a2 == "*" || b2 == "*"
+            || !ParsePoint(o1, a1, b1, c1, x1, y1) || !ParsePoint(o2, a2, b2, c2, x2, y2)) {
+          error = "malformed LAYER shape of pin " + std::string(pin.name);
+          return false;
+        }
+        shape.lx = std::min(x1, x2);
+        shape.ly = std::min(y1, y2);
+        shape.ux = std::max(x1, x2);
+        shape.uy = std::max(y1, y2);
+      } else if (option == "PLACED" || option == "FIXED" || option == "COVER") {
+        pin.place_status = option == "PLACED" ? PlaceStatus::PLACED :
+                           option == "FIXED" ? PlaceStatus::FIXED : PlaceStatus::COVER;
+        std::string_view open = tok.Next(), x = tok.Next(), y = tok.Next(), close = tok.Next();
+        if (x == "*" || y == "*" || !ParsePoint(open, x, y, close, pin.x, pin.y)) {
+          error = "malformed placement of pin " + std::string(pin.name);
+          return false;
+        }
+        pin.orient = tok.Next();
+        if (!IsOrient(pin.orient)) {
+          error = "malformed orientation of pin " + std::string(pin.name);
+          return false;
+        }
+      } else if (option == "UNPLACED") {
+        pin.place_status = PlaceStatus::UNPLACED;
+        pin.x = 0;
+        pin.y = 0;
+      } else if (option == "NET" || option == "SPECIAL" || option == "NETEXPR"
+          || option == "SUPPLYSENSITIVITY" || option == "GROUNDSENSITIVITY"
+          || option == "POLYGON" || option == "VIA" || option.rfind("ANTENNA", 0) == 0) {
+        tok.SkipOption();
+      } else {
+        error = Unsupported("pin option", option);
+        return false;
+      }
+    }
+    pin.shape_end = out.pin_shapes.size();
+  }
+}
+
+/****
+ * - netName ( compName pinName [+ SYNTHESIZED] )... [+ ROUTED|FIXED|COVER routing]... ;
+ * where compName is PIN for IO pins. Options that do not affect connectivity or
+ * wiring are skipped; shielding, virtual pins, subnets and MUSTJOIN nets are
+ * left to Si2.
+ */
+bool DefNativeReader::ParseNets(LefDefTokenizer &tok, size_t stop, Records &out, std::string &error) const {
+  while (true) {
+    size_t offset = tok.PeekOffset();
+    if (offset >= stop) return offset == stop;
+    std::string_view token = tok.Next();
+    if (token.empty() || token == "END") {
+      tok.Seek(offset);
+      return true;
+    }
+    if (token != "-") {
+      error = "expected '-' in NETS, found " + std::string(token);
+      return false;
+    }
+    NetRecord &net = out.nets.emplace_back();
+    net.name = tok.Next();
+    if (net.name == "MUSTJOIN") {
+      error = Unsupported("net", net.name);
+      return false;
+    }
+    net.connection_begin = out.connections.size();
+    while (tok.Peek() == "(") {
+      tok.Next();
+      ConnectionRecord &conn = out.connections.emplace_back();
+      conn.instance = tok.Next();
+      conn.pin_name = tok.Next();
+      token = tok.Next();
+      if (token == "+" && tok.Next() == "SYNTHESIZED") token = tok.Next();
+      if (token != ")" || conn.instance == "*") {
+        error = "unsupported connection in net " + std::string(net.name);
+        return false;
+      }
+    }
+    net.connection_end = out.connections.size();
+    net.path_begin = out.path_elements.size();
+    for (token = tok.Next(); token != ";"; token = tok.Next()) {
+      if (token != "+") {
+        error = "unexpected " + std::string(token) + " in net " + std::string(net.name);
+        return false;
+      }
+      std::string_view option = tok.Next();
+      if (option == "ROUTED" || option == "FIXED" || option == "COVER") {
+        if (!ParseRouting(tok, out, error)) {
+          error += " in net " + std::string(net.name);
+          return false;
+        }
+      } else if (option == "USE" || option == "SOURCE" || option == "WEIGHT"
+          || option == "PATTERN" || option == "ESTCAP" || option == "ORIGINAL"
+          || option == "NONDEFAULTRULE" || option == "FIXEDBUMP"
+          || option == "FREQUENCY" || option == "XTALK" || option == "PROPERTY") {
+        tok.SkipOption();
+      } else {
+        error = Unsupported("net option", option);
+        return false;
+      }
+    }
+    if (!keep_routing_) out.path_elements.resize(net.path_begin);
+    net.path_end = out.path_elements.size();
+  }
+}
+
+/****
+ * One routing statement, flattened into the element sequence the Si2 parser
+ * reports for it: each path starts with its layer and ends at NEW or at the
+ * next option. Taper, style and mask settings, via orientations and virtual
+ * points are accepted and dropped, as getDefNets ignores them.
+ */
+bool DefNativeReader::ParseRouting(LefDefTokenizer &tok, Records &out, std::string &error) const {
+  int x = 0, y = 0;
+  out.path_elements.push_back({PathElementType::LAYER, tok.Next()});
+  for (std::string_view token = tok.Peek(); token != ";" && token != "+"; token = tok.Peek()) {
+    tok.Next();
+    if (token.empty()) {
+      error = "unterminated routing";
+      return false;
+    } else if (token == "NEW") {
+      out.path_elements.push_back({PathElementType::PATH_END});
+      out.path_elements.push_back({PathElementType::LAYER, tok.Next()});
+    } else if (token == "(") {
+      std::string_view sx = tok.Next(), sy = tok.Next(), close = tok.Next();
+      PathElement point{PathElementType::POINT};
+      bool valid = true;
+      if (close != ")") {
+        point.type = PathElementType::FLUSHPOINT;
+        valid = ParseInt(close, point.ext);
+        close = tok.Next();
+      }
+      if (!valid || !ParsePoint(token, sx, sy, close, x, y)) {
+        error = "malformed routing point";
+        return false;
+      }
+      point.x = x;
+      point.y = y;
+      out.path_elements.push_back(point);
+    } else if (token == "RECT") {
+      PathElement rect{PathElementType::RECT};
+      std::string_view open = tok.Next(), dx1 = tok.Next(), dy1 = tok.Next();
+      std::string_view dx2 = tok.Next(), dy2 = tok.Next(), close = tok.Next();
+      if (open != "(" || close != ")" || !ParseInt(dx1, rect.x) || !ParseInt(dy1, rect.y)
+          || !ParseInt(dx2, rect.x2) || !ParseInt(dy2, rect.y2)) {
+        error = "malformed RECT";
+        return false;
+      }
+      out.path_elements.push_back(rect);
+    } else if (token == "VIRTUAL") {
+      std::string_view open = tok.Next(), sx = tok.Next(), sy = tok.Next(), close = tok.Next();
+      if (!ParsePoint(open, sx, sy, close, x, y)) {
+        error = "malformed VIRTUAL point";
+        return false;
+      }
+    } else if (token == "TAPER") {
+    } else if (token == "TAPERRULE" || token == "STYLE" || token == "MASK") {
+      tok.Next();
+    } else {
+      int unused;
+      if (token == ")" || ParseInt(token, unused)) {
+        error = Unsupported("routing element", token);
+        return false;
+      }
+      out.path_elements.push_back({PathElementType::VIA, token});
+      if (IsOrient(tok.Peek())) tok.Next();
+      if (tok.Peek() == "DO") {
+        error = Unsupported("via array", token);
+        return false;
+      }
+    }
+  }
+  out.path_elements.push_back({PathElementType::PATH_END});
+  return true;
+}
+
+/**
+ * @brief The file with the bodies of the natively parsed sections removed.
+ * Each of those sections keeps its header, with a count of 0, and its END
+ * statement, so the Si2 section start callbacks still fire in file order.
+ * Line numbers in Si2 messages refer to this text, not to the file.
+ */
+std::string DefNativeReader::RemainderText() const {
+  std::vector<const SectionRange *> found;
+  size_t body_size = 0;
+  for (auto &section : sections_) {
+    if (!section.found) continue;
+    found.push_back(&section);
+    body_size += section.body_end - section.body_begin;
+  }
+  std::sort(
+      found.begin(), found.end(),
+      [](const SectionRange *a, const SectionRange *b) { return a->count_begin < b->count_begin; }
+  );
+
+  std::string text;
+  text.reserve(size_ - body_size + 8 * found.size());
+  size_t pos = 0;
+  for (auto *section : found) {
+    text.append(data_ + pos, section->count_begin - pos);
+    text.append("0");
+    text.append(data_ + section->count_end, section->body_begin - section->count_end);
+    text.append("\n");
+    pos = section->body_end;
+  }
+  text.append(data_ + pos, size_ - pos);
+  return text;
+}
+
+/**
+ * @brief Add the parsed components, as getDefComponents does for each Si2 component.
+ */
+void DefNativeReader::ApplyComponents(PhyDB *phy_db_ptr) const {
+  std::string macro_name;
+  for (Records const &records : records_) {
+    for (auto &comp : records.components) {
+      macro_name.assign(comp.macro_name);
+      Macro *macro_ptr = phy_db_ptr->GetMacroPtr(macro_name);
+      PhyDBExpects(macro_ptr != nullptr,
+                   "Cannot find " + macro_name + " in PhyDB");
+
+      CompOrient orient = CompOrient::N;
+      if (comp.place_status != PlaceStatus::UNPLACED) {
+        orient = StrToCompOrient(std::string(comp.orient));
+      }
+      CompSource source = CompSource::NETLIST;
+      if (!comp.source.empty()) {
+        source = StrToCompSource(std::string(comp.source));
+      }
+
+      phy_db_ptr->AddComponent(
+          std::string(comp.name),
+          macro_ptr,
+          comp.place_status,
+          comp.llx, comp.lly,
+          orient,
+          source
+      );
+    }
+  }
+}
+
+/**
+ * @brief Add the parsed IO pins, as getDefIOPins does for each Si2 pin.
+ */
+void DefNativeReader::ApplyIoPins(PhyDB *phy_db_ptr) const {
+  for (Records const &records : records_) {
+    for (auto &pin : records.iopins) {
+      IOPin *io_pin_ptr = phy_db_ptr->AddIoPin(
+          std::string(pin.name),
+          StrToSignalDirection(pin.signal_direction),
+          StrToSignalUse(std::string(pin.signal_use))
+      );
+
+      CompOrient orient = CompOrient::N;
+      if (pin.place_status != PlaceStatus::UNPLACED) {
+        orient = StrToCompOrient(std::string(pin.orient));
+      }
+      io_pin_ptr->SetPlacement(pin.place_status, pin.x, pin.y, orient);
+
+      for (size_t i = pin.shape_begin; i < pin.shape_end; ++i) {
+        const PinShapeRecord &shape = records.pin_shapes[i];
+        io_pin_ptr->SetShape(std::string(shape.layer_name), shape.lx, shape.ly, shape.ux, shape.uy);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Add the parsed nets, as getDefNets does for each Si2 net. The net id
+ * is known once the net is added, and each connection costs one component
+ * lookup and one macro pin lookup instead of going through AddCompPinToNet().
+ */
+void DefNativeReader::ApplyNets(PhyDB *phy_db_ptr) const {
+  Design &design = phy_db_ptr->design();
+  std::vector<Component> &components = design.GetComponentsRef();
+  std::string instance, pin_name;
+  for (Records const &records : records_) {
+    for (auto &net : records.nets) {
+      std::string net_name(net.name);
+      phy_db_ptr->AddNet(net_name);
+      int net_id = static_cast<int>(design.GetNetsRef().size()) - 1;
+
+      for (size_t i = net.connection_begin; i < net.connection_end; ++i) {
+        const ConnectionRecord &conn = records.connections[i];
+        pin_name.assign(conn.pin_name);
+        if (conn.instance == "PIN") {
+          design.AddIoPinToNet(design.GetIoPinId(pin_name), net_id);
+        } else {
+          instance.assign(conn.instance);
+          int comp_id = design.GetComponentId(instance);
+          Macro *macro_ptr = components[comp_id].GetMacro();
+          int pin_id = macro_ptr->GetPinId(pin_name);
+          PhyDBExpects(
+              pin_id >= 0,
+              "Macro " << macro_ptr->GetName() << " does not contain a pin with name "
+                       << pin_name
+          );
+          design.AddCompPinToNet(comp_id, pin_id, net_id);
+        }
+      }
+
+      if (phy_db_ptr->IsNetGeometryLoaded(net_name)) {
+        ApplyRouting(phy_db_ptr, records, net, net_name);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Add the wires, vias and via rectangles of a net through the
+ * NetRoutingBuilder the Si2 callbacks use.
+ */
+void DefNativeReader::ApplyRouting(PhyDB *phy_db_ptr, Records const &records, NetRecord const &net, std::string const &net_name) const {
+  NetRoutingBuilder builder(phy_db_ptr, net_name, false);
+  std::string name;
+  for (size_t i = net.path_begin; i < net.path_end; ++i) {
+    const PathElement &element = records.path_elements[i];
+    switch (element.type) {
+      case PathElementType::LAYER: {
+        name.assign(element.name);
+        builder.Layer(name);
+        break;
+      }
+      case PathElementType::VIA: {
+        name.assign(element.name);
+        builder.Via(name);
+        break;
+      }
+      case PathElementType::POINT: {
+        builder.Point(element.x, element.y);
+        break;
+      }
+      case PathElementType::FLUSHPOINT: {
+        builder.FlushPoint(element.x, element.y, element.ext);
+        break;
+      }
+      case PathElementType::RECT: {
+        builder.ViaRect(element.x, element.y, element.x2, element.y2);
+        break;
+      }
+      case PathElementType::PATH_END: {
+        builder.EndPath();
+        break;
+      }
+    }
+  }
+}
+
+}
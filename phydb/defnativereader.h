@@ -0,0 +1,160 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+#ifndef PHYDB_DEFNATIVEREADER_H_
+#define PHYDB_DEFNATIVEREADER_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "enumtypes.h"
+
+namespace phydb {
+
+class LefDefTokenizer;
+class PhyDB;
+
+/****
+ * A fast path for the COMPONENTS, PINS and NETS sections of a DEF file, which
+ * make up nearly all of a routed design. Read() memory-maps the file (or
+ * decompresses a .gz or .zst file into memory), walks its top-level
+ * statements and tokenizes those three sections in place with
+ * std::from_chars. Every record is parsed before anything is added to PhyDB,
+ * so when a section uses a construct this reader does not model, Read()
+ * returns false with the database untouched and the caller parses the whole
+ * file with Si2 instead.
+ *
+ * After a successful Read(), RemainderText() is the file with the bodies of
+ * the three sections removed and their counts set to 0. The Si2 parser reads
+ * that text, and its section start callbacks call the Apply functions, so
+ * components, IO pins and nets are added in file order, exactly as the Si2
+ * callbacks would add them.
+ *
+ * With more than one thread, the COMPONENTS and NETS bodies are cut at record
+ * starts ("- name ... ;") into chunks that are parsed concurrently into
+ * per-chunk record buffers. The buffers are kept in file order and applied one
+ * after another, so ids handed out by the Apply functions match those of a
+ * serial load.
+ */
+class DefNativeReader {
+ public:
+  enum Section { COMPONENTS = 0, PINS = 1, NETS = 2, NUM_SECTIONS = 3 };
+
+  DefNativeReader() = default;
+  ~DefNativeReader();
+  DefNativeReader(const DefNativeReader &) = delete;
+  DefNativeReader &operator=(const DefNativeReader &) = delete;
+
+  bool Read(std::string const &def_file_name, int num_threads = 1, bool keep_routing = true);
+  std::string RemainderText() const;
+
+  // the count in the section header, 0 if the file has no such section
+  int DeclaredCount(Section section) const { return sections_[section].count; }
+  void ApplyComponents(PhyDB *phy_db_ptr) const;
+  void ApplyIoPins(PhyDB *phy_db_ptr) const;
+  void ApplyNets(PhyDB *phy_db_ptr) const;
+
+ private:
+  struct SectionRange {
+    bool found = false;
+    int count = 0;
+    size_t count_begin = 0, count_end = 0; // the count token
+    size_t body_begin = 0, body_end = 0; // from after the header to END
+  };
+
+  struct ComponentRecord {
+    std::string_view name;
+    std::string_view macro_name;
+    PlaceStatus place_status = PlaceStatus::UNPLACED;
+    int llx = 0, lly = 0;
+    std::string_view orient;
+    std::string_view source;
+  };
+
+  struct PinShapeRecord {
+    std::string_view layer_name;
+    int lx, ly, ux, uy;
+  };
+
+  struct IoPinRecord {
+    std::string_view name;
+    std::string signal_direction;
+    std::string_view signal_use;
+    PlaceStatus place_status = PlaceStatus::UNPLACED;
+    int x = 0, y = 0;
+    std::string_view orient;
+    size_t shape_begin = 0, shape_end = 0;
+  };
+
+  // one routing statement flattened, mirrors the element types of defiPath
+  enum class PathElementType { LAYER, VIA, POINT, FLUSHPOINT, RECT, PATH_END };
+  struct PathElement {
+    PathElementType type;
+    std::string_view name = std::string_view(); // LAYER and VIA
+    int x = 0, y = 0, ext = 0; // POINT and FLUSHPOINT, dx1 and dy1 of a RECT
+    int x2 = 0, y2 = 0; // dx2 and dy2 of a RECT
+  };
+
+  struct ConnectionRecord {
+    std::string_view instance;
+    std::string_view pin_name;
+  };
+
+  struct NetRecord {
+    std::string_view name;
+    size_t connection_begin = 0, connection_end = 0;
+    size_t path_begin = 0, path_end = 0;
+  };
+
+  // records parsed serially, or of one chunk of a section; indices are local to it
+  struct Records {
+    std::vector<ComponentRecord> components;
+    std::vector<IoPinRecord> iopins;
+    std::vector<PinShapeRecord> pin_shapes;
+    std::vector<NetRecord> nets;
+    std::vector<ConnectionRecord> connections;
+    std::vector<PathElement> path_elements;
+  };
+
+  const char *data_ = nullptr; // the mapped file, or text_ for a compressed one
+  size_t size_ = 0;
+  std::string text_;
+  SectionRange sections_[NUM_SECTIONS];
+  bool keep_routing_ = true;
+  std::vector<Records> records_; // in file order, serial parsing appends to the last one
+
+  bool ReadSections(LefDefTokenizer &tok, int num_threads, std::string &error);
+  bool ReadSectionHeader(LefDefTokenizer &tok, Section section, std::string &error);
+  bool ReadSectionBody(LefDefTokenizer &tok, Section section, int num_threads, std::string &error);
+  bool ParseSection(LefDefTokenizer &tok, Section section, size_t stop, Records &out, std::string &error) const;
+  bool ParseSectionInChunks(LefDefTokenizer &tok, Section section, int num_threads);
+  bool ParseComponents(LefDefTokenizer &tok, size_t stop, Records &out, std::string &error) const;
+  bool ParseIoPins(LefDefTokenizer &tok, size_t stop, Records &out, std::string &error) const;
+  bool ParseNets(LefDefTokenizer &tok, size_t stop, Records &out, std::string &error) const;
+  bool ParseRouting(LefDefTokenizer &tok, Records &out, std::string &error) const;
+  void ApplyRouting(PhyDB *phy_db_ptr, Records const &records, NetRecord const &net, std::string const &net_name) const;
+  bool Map(std::string const &def_file_name);
+  void Unmap();
+};
+
+}
+
+#endif //PHYDB_DEFNATIVEREADER_H_
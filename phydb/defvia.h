@@ -44,6 +44,7 @@ class DefVia {
 
   std::vector<Rect2DLayer < int>> rect2d_layers;
   std::string pattern_;
+  std::vector<ViaShape> geometry_template_; // empty until the via is first placed
  
   DefVia() {}
   DefVia(std::string const &name) : name_(name) {}
@@ -63,6 +64,7 @@ class DefVia {
     origin_.Clear();
     bot_offset_.Clear();
     top_offset_.Clear();
+    geometry_template_.clear();
   }
 
   void Report() {
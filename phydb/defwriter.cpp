@@ -29,6 +29,7 @@
 #include <lef/lefwWriter.hpp>
 #include <lef/lefwWriterCalls.hpp>
 
+#include "phydb/common/compressedfile.h"
 #include "phydb/common/logging.h"
 
 void CheckStatus(int status) {
@@ -531,7 +532,7 @@ std::string GetCurrentDateTime() {
 }
 
 void Si2WriteDef(PhyDB *phy_db_ptr, std::string const &defFileName) {
-  FILE *f = fopen(defFileName.c_str(), "w");
+  FILE *f = OpenOutputFile(defFileName);
   PhyDBExpects(f != nullptr, "Couldn't open Write def file");
   std::cout << "Writing def to " << defFileName << std::endl;
 
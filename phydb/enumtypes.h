@@ -79,6 +79,13 @@ enum class PlaceStatus {
 PlaceStatus StrToPlaceStatus(std::string const &str_place_status);
 std::string PlaceStatusStr(PlaceStatus place_status);
 
+// what ReadDef() loads besides components, IO pins and net connectivity
+enum class DefLoadMode {
+  CONNECTIVITY = 0, // neither SPECIALNETS nor routing geometry, but for the nets given geometry
+  CONNECTIVITY_AND_SNETS = 1, // SPECIALNETS, but no routing geometry
+  FULL_GEOMETRY = 2 // SPECIALNETS, and wire segments for every net
+};
+
 enum class SignalDirection {
   INPUT = 0,
   OUTPUT = 1,
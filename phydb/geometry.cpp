@@ -19,9 +19,17 @@
  *
  ******************************************************************************/
 
-#include <set>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <tuple>
+#include <unordered_set>
 
 #include "geometry.h"
+#include "rccache.h"
+#include "phydb/timing/capacitanceengine.h"
 
 namespace phydb {
 
@@ -29,35 +37,52 @@ namespace phydb {
         return p.x >= r.ll.x && p.x <= r.ur.x && p.y >= r.ll.y && p.y <= r.ur.y;
     }
 
+    int NameTable::intern(const std::string &name) {
+        std::unordered_map<std::string, int>::iterator it = _name_to_id.find(name);
+        if (it == _name_to_id.end()) {
+            it = _name_to_id.emplace(name, static_cast<int>(_names.size())).first;
+            _names.push_back(name);
+        }
+        return it->second;
+    }
+
+    int NameTable::find(const std::string &name) const {
+        std::unordered_map<std::string, int>::const_iterator it = _name_to_id.find(name);
+        return it == _name_to_id.end() ? -1 : it->second;
+    }
+
     std::string Resistor::getNetName() { return _owner_segment->getNetName(); }
 
-    Resistor::Resistor(std::string node_id1, std::string node_id2, std::string material, double length, double width, double area, Point2D<double> p1, Point2D<double> p2, WireSegment *owner_segment) :
+    Resistor::Resistor(unsigned net_id, NodeId node_id1, NodeId node_id2, int layer_id, double length, double width, double area, Point2D<double> p1, Point2D<double> p2, WireSegment *owner_segment) :
+                _net_id(net_id),
                 _node_id1(node_id1),
                 _node_id2(node_id2),
-                _material(material),
+                _layer_id(layer_id),
                 _length(length),
                 _width(width),
                 _area(area),
+                _ground_capacitance(-1),
                 _p1(p1),
                 _p2(p2),
-                _owner_segment(owner_segment) {
+                _owner_segment(owner_segment),
+                _owner_slot(0) {
         if (_owner_segment) {
             _owner_segment->addResistor(this);
         }
     }
 
-    void Resistor::print(std::ostream &s) {
+    void Resistor::print(std::ostream &s, const Geometry &geometry) {
         if (_area == -1) {
             s << "Resistor<node1='"
-              << _node_id1 
+              << geometry.getNodeName(_net_id, _node_id1)
               << "', node2='"
-              << _node_id2
+              << geometry.getNodeName(_net_id, _node_id2)
               << "', length="
               << _length
               << ", width="
               << _width
               << ", layer="
-              << _material
+              << geometry.getLayerName(_layer_id)
               << ", segment-id='"
               << _owner_segment->getNetName()
               << ":"
@@ -74,13 +99,13 @@ namespace phydb {
               << std::endl;
         } else {
             s << "VerticalResistor<lower-node='"
-              << _node_id1 
+              << geometry.getNodeName(_net_id, _node_id1)
               << "', upper-node='"
-              << _node_id2
+              << geometry.getNodeName(_net_id, _node_id2)
               << "', cross-sectional-area="
               << _area
               << ", layer="
-              << _material
+              << geometry.getLayerName(_layer_id)
               << ", segment-id='"
               << _owner_segment->getNetName()
               << ":"
@@ -94,28 +119,43 @@ namespace phydb {
         }
     }
 
+    void Resistor::setP1(Point2D<double> pt) {
+        if (_owner_segment) _owner_segment->_moveResistorEndpoint(this, _p1, pt);
+        _p1 = pt;
+    }
+
+    void Resistor::setP2(Point2D<double> pt) {
+        if (_owner_segment) _owner_segment->_moveResistorEndpoint(this, _p2, pt);
+        _p2 = pt;
+    }
+
+    Rect2D<double> Resistor::getFootprint() const {
+        // zero-length resistors have a degenerate footprint, which Rect2D's constructors refuse
+        double half_width = _width / 2;
+        Rect2D<double> footprint;
+        if (_p1.x == _p2.x && _p1.y != _p2.y) {
+            footprint.ll = Point2D<double>(_p1.x - half_width, std::min(_p1.y, _p2.y));
+            footprint.ur = Point2D<double>(_p1.x + half_width, std::max(_p1.y, _p2.y));
+        } else {
+            footprint.ll = Point2D<double>(std::min(_p1.x, _p2.x), _p1.y - half_width);
+            footprint.ur = Point2D<double>(std::max(_p1.x, _p2.x), _p1.y + half_width);
+        }
+        return footprint;
+    }
+
     void Resistor::setOwnerSegment(WireSegment *seg) {
         if (_owner_segment) {
-            unsigned long i = 0;
-            std::vector<Resistor *> &resistors = _owner_segment->getResistors();
-            for (Resistor *res_ptr : resistors) {
-                if (res_ptr == this) {
-                    resistors.erase(resistors.begin() + i);
-                    break;
-                }
-                i++;
-            }
-
+            _owner_segment->removeResistor(this);
             _owner_segment = seg;
             _owner_segment->addResistor(this);
         }
     }
 
-    void Capacitor::print(std::ostream &s) {
+    void Capacitor::print(std::ostream &s, const Geometry &geometry) {
         s << "Capacitor<node1='"
-          << _node_id1
+          << geometry.getNodeName(_net_id1, _node_id1)
           << "', node2='"
-          << _node_id2
+          << geometry.getNodeName(_net_id2, _node_id2)
           << "', overlap-length="
           << _overlap_length
           << ", distance="
@@ -124,7 +164,84 @@ namespace phydb {
           << std::endl;
     }
 
+    const std::string &WireSegment::getNetName() const {
+        PhyDBExpects(_geometry, "segment " + std::to_string(_seg_num) + " has not been added to a Geometry");
+        return _geometry->getNetName(_net_id);
+    }
+
+    const std::string &WireSegment::getLayerName() const {
+        PhyDBExpects(_geometry, "segment " + std::to_string(_seg_num) + " has not been added to a Geometry");
+        return _geometry->getLayerName(_layer_id);
+    }
+
+    size_t WireSegment::EndpointHash::operator()(const std::pair<double, double> &pt) const {
+        // + 0.0 folds -0.0 into 0.0, they compare equal so they have to hash the same
+        size_t h = std::hash<double>()(pt.first + 0.0);
+        return h ^ (std::hash<double>()(pt.second + 0.0) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2));
+    }
+
+    void WireSegment::addResistor(Resistor *res) {
+        res->_owner_slot = static_cast<uint32_t>(_resistors.size());
+        _resistors.emplace_back(res);
+        if (_resistor_index) _indexResistor(res);
+    }
+
+    void WireSegment::removeResistor(Resistor *res) {
+        PhyDBExpects(res->_owner_slot < _resistors.size() && _resistors[res->_owner_slot] == res, "resistor is not owned by segment " + std::to_string(_seg_num));
+        if (_resistor_index) _unindexResistor(res);
+        Resistor *last = _resistors.back();
+        _resistors[res->_owner_slot] = last;
+        last->_owner_slot = res->_owner_slot;
+        _resistors.pop_back();
+    }
+
+    void WireSegment::clearResistors() {
+        _resistors.clear();
+        _resistor_index.reset();
+    }
+
+    void WireSegment::_indexResistor(Resistor *res) {
+        _resistor_index->emplace(std::make_pair(res->_p1.x, res->_p1.y), res);
+        if (res->_p2.x != res->_p1.x || res->_p2.y != res->_p1.y) _resistor_index->emplace(std::make_pair(res->_p2.x, res->_p2.y), res);
+    }
+
+    void WireSegment::_unindexResistor(Resistor *res) {
+        for (const Point2D<double> &pt : { res->_p1, res->_p2 }) {
+            std::pair<ResistorIndex::iterator, ResistorIndex::iterator> range = _resistor_index->equal_range(std::make_pair(pt.x, pt.y));
+            for (ResistorIndex::iterator it = range.first; it != range.second; it++) {
+                if (it->second == res) {
+                    _resistor_index->erase(it);
+                    break;
+                }
+            }
+        }
+    }
+
+    void WireSegment::_moveResistorEndpoint(Resistor *res, Point2D<double> old_pt, Point2D<double> new_pt) {
+        if (!_resistor_index) return;
+        _unindexResistor(res);
+        if (res->_p1.x == old_pt.x && res->_p1.y == old_pt.y) res->_p1 = new_pt;
+        else res->_p2 = new_pt;
+        _indexResistor(res);
+    }
+
     Resistor *WireSegment::getResistorByPoints(Point2D<double> p1, Point2D<double> p2) {
+        if (!_resistor_index && _resistors.size() > kResistorIndexThreshold) {
+            _resistor_index.reset(new ResistorIndex());
+            for (Resistor *res : _resistors) _indexResistor(res);
+        }
+
+        if (_resistor_index) {
+            std::pair<ResistorIndex::iterator, ResistorIndex::iterator> range = _resistor_index->equal_range(std::make_pair(p1.x, p1.y));
+            for (ResistorIndex::iterator it = range.first; it != range.second; it++) {
+                Point2D<double> res_p1 = it->second->getP1();
+                Point2D<double> res_p2 = it->second->getP2();
+                if (res_p1.x == p1.x && res_p1.y == p1.y && res_p2.x == p2.x && res_p2.y == p2.y) return it->second;
+                if (res_p2.x == p1.x && res_p2.y == p1.y && res_p1.x == p2.x && res_p1.y == p2.y) return it->second;
+            }
+            return nullptr;
+        }
+
         for (Resistor *res : _resistors) {
             Point2D<double> res_p1 = res->getP1();
             Point2D<double> res_p2 = res->getP2();
@@ -135,41 +252,93 @@ namespace phydb {
         return nullptr;
     }
 
-    void Geometry::_populateResistorNetwork() {
-        if (_resistor_network.size() != 0) {
-            std::cout << "WEIRD: INPUT VECTOR NON EMPTY" << std::endl;
-            return;
+    void Geometry::_parallelFor(size_t count, const std::function<void(size_t, int)> &body) {
+        std::atomic<size_t> next(0);
+        const size_t chunk_size = 64;
+        auto worker = [&](int worker_id) {
+            for (size_t begin = next.fetch_add(chunk_size); begin < count; begin = next.fetch_add(chunk_size)) {
+                for (size_t i = begin; i < std::min(begin + chunk_size, count); i++) {
+                    body(i, worker_id);
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (int i = 1; i < _num_threads && static_cast<size_t>(i) * chunk_size < count; i++) {
+            threads.emplace_back(worker, i);
+        }
+        worker(0);
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+    }
+
+    std::vector<unsigned> Geometry::_netsInNameOrder() const {
+        std::vector<unsigned> nets(_net_to_segs.size());
+        for (unsigned i = 0; i < nets.size(); i++) {
+            nets[i] = i;
+        }
+        std::sort(nets.begin(), nets.end(), [this](unsigned a, unsigned b) { return _net_names.getName(a) < _net_names.getName(b); });
+        return nets;
+    }
+
+    void Geometry::_runNetStage(const std::vector<unsigned> &nets, const std::function<void(unsigned, std::vector<ArenaPtr<WireSegment>> &, std::vector<ArenaPtr<Resistor>> &, Arena *)> &stage) {
+        // each net writes into its own buffer, buffers are appended in net order so the result matches a serial run
+        std::vector<std::vector<ArenaPtr<Resistor>>> net_resistors(nets.size());
+        std::vector<Arena *> worker_arenas(_num_threads);
+        for (int i = 0; i < _num_threads; i++) {
+            worker_arenas[i] = _networkArena(i);
         }
+        _parallelFor(nets.size(), [&](size_t i, int worker) { stage(nets[i], _net_to_segs[nets[i]], net_resistors[i], worker_arenas[worker]); });
+
+        for (std::vector<ArenaPtr<Resistor>> &resistors : net_resistors) {
+            for (ArenaPtr<Resistor> &resistor : resistors) {
+                _resistor_network.emplace_back(std::move(resistor));
+            }
+        }
+    }
+
+    Arena *Geometry::_networkArena(int worker) {
+        if (!_use_arena) return nullptr;
+        while (_network_arenas.size() <= static_cast<size_t>(worker)) {
+            _network_arenas.emplace_back(new Arena(Arena::kDefaultBlockSize, _use_huge_pages));
+        }
+        return _network_arenas[worker].get();
+    }
+
+    void Geometry::_populateResistorNetwork(const std::vector<unsigned> &nets) {
+        // size every node counter (and connectivity result) up front, the stages below only touch their own net's
+        _net_num_nodes.resize(_net_names.size(), 0);
+        _net_wire_nodes.resize(_net_names.size(), 0);
+        _net_open_pieces.resize(_net_names.size());
 
         // (1) for each centerline segment generate an internal resistor
-        for (std::map<std::string, std::vector<std::unique_ptr<WireSegment>>>::iterator it = _net_to_segs.begin() ; it != _net_to_segs.end() ; it++) {
-            for (std::unique_ptr<WireSegment> &seg_ptr : it->second) {
+        _runNetStage(nets, [this](unsigned net_id, std::vector<ArenaPtr<WireSegment>> &segs, std::vector<ArenaPtr<Resistor>> &resistors, Arena *arena) {
+            for (ArenaPtr<WireSegment> &seg_ptr : segs) {
                 Point2D<double> p1 = seg_ptr->getP1();
                 Point2D<double> p2 = seg_ptr->getP2();
                 if (p1.x != p2.x || p1.y != p2.y) { // segment a non via rect
-                    double length = p1.x != p2.x ? abs(p1.x - p2.x) : abs(p1.y - p2.y);
+                    double length = p1.x != p2.x ? std::abs(p1.x - p2.x) : std::abs(p1.y - p2.y);
                     Rect2D<double> seg_rect = seg_ptr->getRect();
                     double width = p1.x != p2.x ? seg_rect.ur.y - seg_rect.ll.y : seg_rect.ur.x - seg_rect.ll.x;
-                    std::unique_ptr<Resistor> resistor(new Resistor(generateNodeID(it->first), generateNodeID(it->first), seg_ptr->getLayerName(), length, width, -1, p1, p2, seg_ptr.get()));
-                    _resistor_network.emplace_back(std::move(resistor));
+                    resistors.emplace_back(MakeArenaPtr<Resistor>(arena, net_id, generateNodeID(net_id), generateNodeID(net_id), seg_ptr->getLayerId(), length, width, -1, p1, p2, seg_ptr.get()));
                 }
             }
-        }
+        });
 
         // (2) wire up horizontal connections using "escape resistors", vertical connections by area resistors
-        for (std::map<std::string, std::vector<std::unique_ptr<WireSegment>>>::iterator it = _net_to_segs.begin() ; it != _net_to_segs.end() ; it++) {
-            for (std::unique_ptr<WireSegment> &seg_ptr : it->second) {
+        _runNetStage(nets, [this](unsigned net_id, std::vector<ArenaPtr<WireSegment>> &segs, std::vector<ArenaPtr<Resistor>> &resistors, Arena *arena) {
+            for (ArenaPtr<WireSegment> &seg_ptr : segs) {
                 std::vector<WireSegment *> &horizontal_connections = seg_ptr->getHorizontalConnections();
                 if (horizontal_connections.size() != 0) {
                     for (WireSegment *prev_seg_ptr : horizontal_connections) { // pretty sure there will only ever be 1
                         Point2D<double> p1 = prev_seg_ptr->getP2();
                         Point2D<double> p2 = seg_ptr->getP1();
 
-                        double length = p1.x != p2.x ? abs(p1.x - p2.x) : abs(p1.y - p2.y);
+                        double length = p1.x != p2.x ? std::abs(p1.x - p2.x) : std::abs(p1.y - p2.y);
                         Rect2D<double> seg_rect = seg_ptr->getRect();
                         double width = p1.x != p2.x ? seg_rect.ur.y - seg_rect.ll.y : seg_rect.ur.x - seg_rect.ll.x;
-                        std::unique_ptr<Resistor> resistor(new Resistor(generateNodeID(it->first), generateNodeID(it->first), seg_ptr->getLayerName(), length, width, -1, p1, p2, prev_seg_ptr));
-                        _resistor_network.emplace_back(std::move(resistor));
+                        resistors.emplace_back(MakeArenaPtr<Resistor>(arena, net_id, generateNodeID(net_id), generateNodeID(net_id), seg_ptr->getLayerId(), length, width, -1, p1, p2, prev_seg_ptr));
                     }
                 }
 
@@ -177,116 +346,301 @@ namespace phydb {
                 for (WireSegment *prev_seg_ptr : vertical_connections) {
                     // generate resistor for current segment if it doesn't yet exist, otherwise just get "bottom" node id
 
-                    std::vector<Resistor *> seg_resistors = seg_ptr->getResistors();
-                    std::string seg_bottom_node;
+                    const std::vector<Resistor *> &seg_resistors = seg_ptr->getResistors();
+                    NodeId seg_bottom_node;
                     if (seg_resistors.size() == 0) {
                         Rect2D<double> seg_rect = seg_ptr->getRect();
                         double area = (seg_rect.ur.x - seg_rect.ll.x) * (seg_rect.ur.y - seg_rect.ll.y);
-                        seg_bottom_node = generateNodeID(it->first);
-                        std::unique_ptr<Resistor> resistor(new Resistor(seg_bottom_node, generateNodeID(it->first), seg_ptr->getLayerName(), -1, -1, area, seg_ptr->getP1(), seg_ptr->getP2(), seg_ptr.get()));
-                        _resistor_network.emplace_back(std::move(resistor));
+                        seg_bottom_node = generateNodeID(net_id);
+                        resistors.emplace_back(MakeArenaPtr<Resistor>(arena, net_id, seg_bottom_node, generateNodeID(net_id), seg_ptr->getLayerId(), -1, -1, area, seg_ptr->getP1(), seg_ptr->getP2(), seg_ptr.get()));
                     } else {
                         seg_bottom_node = seg_resistors[0]->getNodeId1();
                     }
 
                     // generate resistor for prev segment if doesn't exist with top node = seg's bottom node, otherwise set prev's top node equal to seg's bottom
-                    std::vector<Resistor *> prev_resistors = prev_seg_ptr->getResistors();
+                    const std::vector<Resistor *> &prev_resistors = prev_seg_ptr->getResistors();
                     if (prev_resistors.size() == 0) {
                         Rect2D<double> prev_rect = prev_seg_ptr->getRect();
                         double area = (prev_rect.ur.x - prev_rect.ll.x) * (prev_rect.ur.y - prev_rect.ll.y);
-                        std::unique_ptr<Resistor> resistor(new Resistor(generateNodeID(prev_seg_ptr->getNetName()),
-                                                                        seg_bottom_node,
-                                                                        prev_seg_ptr->getLayerName(),
-                                                                        -1,
-                                                                        -1,
-                                                                        area,
-                                                                        prev_seg_ptr->getP1(),
-                                                                        prev_seg_ptr->getP2(),
-                                                                        prev_seg_ptr));
-                        _resistor_network.emplace_back(std::move(resistor));
+                        resistors.emplace_back(MakeArenaPtr<Resistor>(arena,
+                                                                      net_id,
+                                                                      generateNodeID(net_id),
+                                                                      seg_bottom_node,
+                                                                      prev_seg_ptr->getLayerId(),
+                                                                      -1,
+                                                                      -1,
+                                                                      area,
+                                                                      prev_seg_ptr->getP1(),
+                                                                      prev_seg_ptr->getP2(),
+                                                                      prev_seg_ptr));
                     } else {
                         // coalesce nodes if resistor already exists
                         prev_resistors[0]->setNodeId2(seg_bottom_node);
                     }
                 }
             }
-        }
+        });
 
         // (4) pairwise operation: handle overlapping segments from different paths by modifying boundaries and adding escape resistors
-        for (std::map<std::string, std::vector<std::unique_ptr<WireSegment>>>::iterator it = _net_to_segs.begin() ; it != _net_to_segs.end() ; it++) {
-            for (long i = 0; i < static_cast<long>(it->second.size()) - 1; i++) {
-                for (unsigned long j = i + 1; j < it->second.size(); j++) {
-                    WireSegment *seg = it->second[i].get();
-                    WireSegment *other_seg = it->second[j].get();
-
-                    if (seg->getLayerName() != other_seg->getLayerName()) continue; // only concerned with pairs that share layer
+        _runNetStage(nets, [this](unsigned net_id, std::vector<ArenaPtr<WireSegment>> &segs, std::vector<ArenaPtr<Resistor>> &resistors, Arena *arena) {
+            for (const std::pair<unsigned long, unsigned long> &pair : _findOverlappingSegPairs(segs)) {
+                WireSegment *seg = segs[pair.first].get();
+                WireSegment *other_seg = segs[pair.second].get();
 
-                    Rect2D<double> seg_rect = seg->getRect();
-                    Rect2D<double> other_seg_rect = other_seg->getRect();
+                Rect2D<double> seg_rect = seg->getRect();
+                Rect2D<double> other_seg_rect = other_seg->getRect();
 
-                    // consider each pair only once
-                    if (seg->getNetName() + std::to_string(seg->getSegmentNumber()) < other_seg->getNetName() + std::to_string(seg->getSegmentNumber())) continue;
-
-                    // for overlapping rectangles find the closest resistor point pair and coalesce/combine with escape resistors
-                    if (rectContains(seg_rect, other_seg_rect.ll) || rectContains(seg_rect, other_seg_rect.ur) || rectContains(other_seg_rect, seg_rect.ll) || rectContains(other_seg_rect, seg_rect.ur)) {
-                        _connectOverlappingPlanarSegs(seg, other_seg);
-                    }
+                // for overlapping rectangles find the closest resistor point pair and coalesce/combine with escape resistors
+                if (rectContains(seg_rect, other_seg_rect.ll) || rectContains(seg_rect, other_seg_rect.ur) || rectContains(other_seg_rect, seg_rect.ll) || rectContains(other_seg_rect, seg_rect.ur)) {
+                    _connectOverlappingPlanarSegs(seg, other_seg, resistors, arena, _net_trimmed_shapes[net_id]);
                 }
             }
-        }
+        });
 
         
         // (5) VIA pairwise operations: connect vias to layers as well as overlapping via rects
-        for (std::map<std::string, std::vector<std::unique_ptr<WireSegment>>>::iterator it = _net_to_segs.begin() ; it != _net_to_segs.end() ; it++) {
-            for (long i = 0; i < static_cast<long>(it->second.size()) - 1; i++) {
-                for (unsigned long j = i + 1; j < it->second.size(); j++) {
-                    WireSegment *seg = it->second[i].get();
-                    WireSegment *other_seg = it->second[j].get();
+        _runNetStage(nets, [this](unsigned net_id, std::vector<ArenaPtr<WireSegment>> &segs, std::vector<ArenaPtr<Resistor>> &, Arena *) {
+            std::vector<std::pair<unsigned long, unsigned long>> pairs = _findOverlappingSegPairs(segs);
+            for (const std::pair<unsigned long, unsigned long> &pair : pairs) {
+                WireSegment *seg = segs[pair.first].get();
+                WireSegment *other_seg = segs[pair.second].get();
+
+                Rect2D<double> seg_rect = seg->getRect();
+                Rect2D<double> other_seg_rect = other_seg->getRect();
+
+                // for overlapping rectangles find the closest resistor point pair and coalesce/combine with escape resistors
+                if (rectContains(seg_rect, other_seg_rect.ll) || rectContains(seg_rect, other_seg_rect.ur) || rectContains(other_seg_rect, seg_rect.ll) || rectContains(other_seg_rect, seg_rect.ur)) {
+                    _connectOverlappingViaSegments(seg, other_seg);
+                }
+            }
 
-                    if (seg->getLayerName() != other_seg->getLayerName()) continue; // only concerned with pairs that share layer
+            // the shapes are final here, the same overlapping pairs tell which of them touch
+            if (_check_connectivity) _checkConnectivity(net_id, segs, pairs);
+            _net_wire_nodes[net_id] = _net_num_nodes[net_id];
+        });
+    }
 
-                    Rect2D<double> seg_rect = seg->getRect();
-                    Rect2D<double> other_seg_rect = other_seg->getRect();
+    void Geometry::_checkConnectivity(unsigned net_id, std::vector<ArenaPtr<WireSegment>> &segs, const std::vector<std::pair<unsigned long, unsigned long>> &overlapping_pairs) {
+        std::vector<Rect2D<double>> &pieces = _net_open_pieces[net_id];
+        pieces.clear();
+        if (segs.size() < 2) return;
 
-                    if (seg->getNetName() + std::to_string(seg->getSegmentNumber()) < other_seg->getNetName() + std::to_string(seg->getSegmentNumber())) continue;
+        std::vector<unsigned long> parent(segs.size());
+        for (unsigned long i = 0; i < segs.size(); i++) {
+            parent[i] = i;
+        }
+        auto find = [&parent](unsigned long i) {
+            while (parent[i] != i) {
+                parent[i] = parent[parent[i]];
+                i = parent[i];
+            }
+            return i;
+        };
+        auto unite = [&](unsigned long a, unsigned long b) {
+            a = find(a);
+            b = find(b);
+            if (a != b) parent[std::max(a, b)] = std::min(a, b);
+        };
+
+        // connections are stored as pointers, look their indices up in an address-sorted copy of the segments
+        std::vector<std::pair<WireSegment *, unsigned long>> by_address(segs.size());
+        for (unsigned long i = 0; i < segs.size(); i++) {
+            by_address[i] = std::make_pair(segs[i].get(), i);
+        }
+        std::sort(by_address.begin(), by_address.end());
+        auto index_of = [&by_address](WireSegment *seg_ptr) {
+            std::vector<std::pair<WireSegment *, unsigned long>>::iterator it = std::lower_bound(by_address.begin(), by_address.end(), std::make_pair(seg_ptr, 0UL));
+            return it != by_address.end() && it->first == seg_ptr ? it->second : by_address.size();
+        };
+        for (unsigned long i = 0; i < segs.size(); i++) {
+            for (WireSegment *other : segs[i]->getHorizontalConnections()) {
+                unsigned long j = index_of(other);
+                if (j < segs.size()) unite(i, j);
+            }
+            for (WireSegment *other : segs[i]->getVerticalConnections()) {
+                unsigned long j = index_of(other);
+                if (j < segs.size()) unite(i, j);
+            }
+        }
+        for (const std::pair<unsigned long, unsigned long> &pair : overlapping_pairs) {
+            unite(pair.first, pair.second);
+        }
+
+        // one bounding box per piece, pieces in the order of their first segment
+        std::vector<unsigned long> root_piece(segs.size(), segs.size());
+        for (unsigned long i = 0; i < segs.size(); i++) {
+            unsigned long root = find(i);
+            Rect2D<double> rect = segs[i]->getRect();
+            if (root_piece[root] == segs.size()) {
+                root_piece[root] = pieces.size();
+                pieces.push_back(rect);
+                continue;
+            }
+            Rect2D<double> &bbox = pieces[root_piece[root]];
+            bbox.ll.x = std::min(bbox.ll.x, rect.ll.x);
+            bbox.ll.y = std::min(bbox.ll.y, rect.ll.y);
+            bbox.ur.x = std::max(bbox.ur.x, rect.ur.x);
+            bbox.ur.y = std::max(bbox.ur.y, rect.ur.y);
+        }
+        if (pieces.size() == 1) pieces.clear();
+    }
 
+    void Geometry::_reportOpenNets(const std::vector<unsigned> &nets) const {
+        const size_t max_reported = 20;
+        size_t num_open = 0;
+        for (unsigned net_id : nets) {
+            const std::vector<Rect2D<double>> &pieces = getNetPieces(net_id);
+            if (pieces.empty()) continue;
+            if (num_open++ == 0) std::cout << "Connectivity check found open nets:" << std::endl;
+            if (num_open > max_reported) continue;
+            std::cout << "  " << getNetName(net_id) << ": " << pieces.size() << " pieces";
+            for (const Rect2D<double> &bbox : pieces) {
+                std::cout << " " << bbox;
+            }
+            std::cout << std::endl;
+        }
+        if (num_open > max_reported) std::cout << "  ... " << num_open - max_reported << " more" << std::endl;
+        if (num_open > 0) std::cout << num_open << " of " << nets.size() << " extracted nets are open" << std::endl;
+    }
 
-                    // for overlapping rectangles find the closest resistor point pair and coalesce/combine with escape resistors
-                    if (rectContains(seg_rect, other_seg_rect.ll) || rectContains(seg_rect, other_seg_rect.ur) || rectContains(other_seg_rect, seg_rect.ll) || rectContains(other_seg_rect, seg_rect.ur)) {
-                        _connectOverlappingViaSegments(seg, other_seg);
+    std::vector<unsigned> Geometry::getOpenNets() const {
+        std::vector<unsigned> open_nets;
+        for (unsigned net_id = 0; net_id < _net_open_pieces.size(); net_id++) {
+            if (!_net_open_pieces[net_id].empty()) open_nets.push_back(net_id);
+        }
+        return open_nets;
+    }
+
+    const std::vector<Rect2D<double>> &Geometry::getNetPieces(unsigned net_id) const {
+        static const std::vector<Rect2D<double>> no_pieces;
+        return net_id < _net_open_pieces.size() ? _net_open_pieces[net_id] : no_pieces;
+    }
+
+    namespace {
+
+        // rects a sweep has entered and not yet left, in slots ordered on ll.y; a max tree over the slots' ur.y
+        // finds the active ones reaching up to a bottom edge without looking at the others
+        class ActiveRects {
+            public:
+                explicit ActiveRects(size_t num_slots) : _num_leaves(1) {
+                    while (_num_leaves < num_slots) _num_leaves <<= 1;
+                    _max_top.assign(2 * _num_leaves, -std::numeric_limits<double>::infinity());
+                }
+
+                void set(size_t slot, double top) {
+                    size_t node = slot + _num_leaves;
+                    _max_top[node] = top;
+                    for (node >>= 1; node > 0; node >>= 1) {
+                        _max_top[node] = std::max(_max_top[2 * node], _max_top[2 * node + 1]);
+                    }
+                }
+                void clear(size_t slot) { set(slot, -std::numeric_limits<double>::infinity()); }
+
+                // appends active slots below slot_end whose top is at least bottom
+                void collect(size_t slot_end, double bottom, std::vector<size_t> &slots) const { _collect(1, 0, _num_leaves, slot_end, bottom, slots); }
+
+            private:
+                size_t _num_leaves;
+                std::vector<double> _max_top; // heap order, leaves from _num_leaves
+
+                void _collect(size_t node, size_t lo, size_t hi, size_t slot_end, double bottom, std::vector<size_t> &slots) const {
+                    if (lo >= slot_end || _max_top[node] < bottom) return;
+                    if (hi - lo == 1) {
+                        slots.push_back(lo);
+                        return;
                     }
+                    size_t mid = (lo + hi) / 2;
+                    _collect(2 * node, lo, mid, slot_end, bottom, slots);
+                    _collect(2 * node + 1, mid, hi, slot_end, bottom, slots);
                 }
+        };
+
+    }
+
+    std::vector<std::pair<unsigned long, unsigned long>> findOverlappingRectPairs(const std::vector<Rect2D<double>> &rects, const std::vector<int> &layer_ids) {
+        // bucket rect indices by layer so the sweep never compares layers
+        std::map<int, std::vector<unsigned long>> layer_to_idxs;
+        for (unsigned long i = 0; i < rects.size(); i++) {
+            layer_to_idxs[layer_ids[i]].push_back(i);
+        }
+
+        // sweep each layer by left edge; a rect is active from its left edge until the sweep passes its right edge,
+        // closed intervals so touching rectangles are reported (rectContains is boundary inclusive)
+        std::vector<std::pair<unsigned long, unsigned long>> pairs;
+        std::vector<unsigned long> by_left, by_right, by_bottom;
+        std::vector<double> bottoms;
+        std::vector<size_t> slot_of(rects.size()), slots;
+        for (std::map<int, std::vector<unsigned long>>::iterator it = layer_to_idxs.begin(); it != layer_to_idxs.end(); it++) {
+            by_left = by_right = by_bottom = it->second;
+            std::sort(by_left.begin(), by_left.end(), [&rects](unsigned long a, unsigned long b) { return rects[a].ll.x < rects[b].ll.x; });
+            std::sort(by_right.begin(), by_right.end(), [&rects](unsigned long a, unsigned long b) { return rects[a].ur.x < rects[b].ur.x; });
+            std::sort(by_bottom.begin(), by_bottom.end(), [&rects](unsigned long a, unsigned long b) { return rects[a].ll.y < rects[b].ll.y; });
+            bottoms.resize(by_bottom.size());
+            for (size_t slot = 0; slot < by_bottom.size(); slot++) {
+                slot_of[by_bottom[slot]] = slot;
+                bottoms[slot] = rects[by_bottom[slot]].ll.y;
+            }
+
+            ActiveRects active(by_bottom.size());
+            size_t next_right = 0;
+            for (unsigned long idx : by_left) {
+                const Rect2D<double> &rect = rects[idx];
+                // rects ending left of this one were entered before it, drop them
+                while (next_right < by_right.size() && rects[by_right[next_right]].ur.x < rect.ll.x) {
+                    active.clear(slot_of[by_right[next_right++]]);
+                }
+                // active rects starting at or below this one's top and ending at or above its bottom
+                slots.clear();
+                active.collect(std::upper_bound(bottoms.begin(), bottoms.end(), rect.ur.y) - bottoms.begin(), rect.ll.y, slots);
+                for (size_t slot : slots) {
+                    unsigned long active_idx = by_bottom[slot];
+                    pairs.emplace_back(std::min(idx, active_idx), std::max(idx, active_idx));
+                }
+                active.set(slot_of[idx], rect.ur.y);
             }
         }
+
+        std::sort(pairs.begin(), pairs.end());
+        return pairs;
     }
 
-    std::string Geometry::generateNodeID(std::string net) {
-        if (_net_to_num_nodes.find(net) == _net_to_num_nodes.end()) {
-            _net_to_num_nodes[net] = 0;
+    std::vector<std::pair<unsigned long, unsigned long>> Geometry::_findOverlappingSegPairs(std::vector<ArenaPtr<WireSegment>> &segs) {
+        std::vector<Rect2D<double>> rects(segs.size());
+        std::vector<int> layer_ids(segs.size());
+        for (unsigned long i = 0; i < segs.size(); i++) {
+            rects[i] = segs[i]->getRect();
+            layer_ids[i] = segs[i]->getLayerId();
         }
+        // visited in the same (i, j) order the pairwise loops used, since connecting segments edits their rects
+        return findOverlappingRectPairs(rects, layer_ids);
+    }
 
-        unsigned long num_nodes = _net_to_num_nodes[net]++;
-        return net + "{" + std::to_string(num_nodes) + "}";
-        
+    NodeId Geometry::generateNodeID(unsigned net_id) {
+        if (net_id >= _net_num_nodes.size()) {
+            _net_num_nodes.resize(_net_names.size(), 0);
+        }
+        return _net_num_nodes[net_id]++;
     }
 
-    std::string Geometry::_splitResistorAtPt(Resistor *res, Point2D<double> sub_seg_pt) {
+    NodeId Geometry::_splitResistorAtPt(Resistor *res, Point2D<double> sub_seg_pt, std::vector<ArenaPtr<Resistor>> &resistors, Arena *arena) {
         if (res->getLength() < 0) std::cout << "SOMETHING WRONG: SPLITTING VERT RESISTOR" << std::endl;
-        std::string new_id = generateNodeID(res->getNetName());
+        NodeId new_id = generateNodeID(res->getNetId());
         Point2D<double> res_p1 = res->getP1();
         Point2D<double> res_p2 = res->getP2();
 
-        std::string old_node_id2 = res->getNodeId2();
+        NodeId old_node_id2 = res->getNodeId2();
         
         res->setNodeId2(new_id);
         res->setP2(sub_seg_pt);
-        double l = sub_seg_pt.x == res_p1.x ? abs(sub_seg_pt.y - res_p1.y) : abs(sub_seg_pt.x - res_p1.x);
+        double l = sub_seg_pt.x == res_p1.x ? std::abs(sub_seg_pt.y - res_p1.y) : std::abs(sub_seg_pt.x - res_p1.x);
         double old_l = res->getLength();
         res->setLength(l);
 
-        std::unique_ptr<Resistor> resistor(new Resistor(new_id,
+        resistors.emplace_back(MakeArenaPtr<Resistor>(arena,
+            res->getNetId(),
+            new_id,
             old_node_id2,
-            res->getMaterial(),
+            res->getLayerId(),
             old_l - l,
             res->getWidth(),
             -1,
@@ -294,7 +648,6 @@ namespace phydb {
             res_p2,
             res->getOwnerSegment()
         ));
-        _resistor_network.emplace_back(std::move(resistor));
 
         return new_id;
     }
@@ -339,7 +692,7 @@ namespace phydb {
         return false;
     }
 
-    void Geometry::_connectOverlappingPlanarSegs(WireSegment *seg1, WireSegment *seg2) {
+    void Geometry::_connectOverlappingPlanarSegs(WireSegment *seg1, WireSegment *seg2, std::vector<ArenaPtr<Resistor>> &resistors, Arena *arena, std::vector<TrimmedShape> &trimmed_shapes) {
         for (Resistor * seg1_res: seg1->getResistors()) {
             for (Resistor *seg2_res: seg2->getResistors()) {
                 if (seg1_res->isVertical() || seg2_res->isVertical()) continue;
@@ -369,7 +722,7 @@ namespace phydb {
                 bool move_ur = true; // track which corner of seg1 is getting moved
                 bool move_horiz = true;
                 Point2D<double> endpt = seg1_res_p1;
-                std::string new_endpt_id;
+                NodeId new_endpt_id = 0;
 
                 if ((seg1_res_p1.x == seg2_res_p1.x && seg1_res_p1.y == seg2_res_p1.y) || (seg1_res_p1.x == seg2_res_p2.x && seg1_res_p1.y == seg2_res_p2.y)) {
                     split_pt.x = seg1_res_p1.x;
@@ -391,7 +744,7 @@ namespace phydb {
                         move_horiz = false;
                     } else {
                         std::cout << "should never happen..." << "seg1_res_p1: (" << seg1_res_p1.x << ", " << seg1_res_p1.y << ") | seg1_res_p2: (" << seg1_res_p2.x << ", " << seg1_res_p2.y << ")" << std::endl;
-                        seg1_res->print(std::cout);
+                        seg1_res->print(std::cout, *this);
                         std::cout << "split_pt (" << split_pt.x << ", " << split_pt.y << ")" << std::endl;
                     }
                 } else if ((seg1_res_p2.x == seg2_res_p1.x && seg1_res_p2.y == seg2_res_p1.y) || (seg1_res_p2.x == seg2_res_p2.x && seg1_res_p2.y == seg2_res_p2.y)) {
@@ -429,7 +782,7 @@ namespace phydb {
                     continue;
                 }
 
-                std::string new_id = _splitResistorAtPt(seg1_res, split_pt);
+                _splitResistorAtPt(seg1_res, split_pt, resistors, arena);
                 Resistor *escape_res = seg1->getResistorByPoints(endpt, split_pt);
 
                 if (!escape_res) {
@@ -444,6 +797,7 @@ namespace phydb {
                 
 
                 Rect2D<double> seg1_rect = seg1->getRect();
+                trimmed_shapes.push_back({ seg1, seg1_rect, seg1->getP1(), seg1->getP2() });
                 seg1->setP1(split_pt);
                 if (endpt.x == seg1_res_p1.x && endpt.y == seg1_res_p1.y) {
                     seg1->setP2(seg1_res_p2);
@@ -458,7 +812,7 @@ namespace phydb {
                 } else if (move_horiz) {
                     seg1->setRectLL(Point2D<double>(split_pt.x, seg1_rect.ll.y));
                 } else {
-                    seg1->setRectLL(Point2D<double>(seg1_rect.ll.x, split_pt.x));
+                    seg1->setRectLL(Point2D<double>(seg1_rect.ll.x, split_pt.y));
                 }
                 return;
             }
@@ -812,279 +1166,954 @@ namespace phydb {
     // }
     
 
-     std::vector<std::unique_ptr<WireSegment>> &Geometry::getSegmentsOfNet(std::string net) {
-        if (_net_to_segs.find(net) == _net_to_segs.end()) {
-            _net_to_segs.emplace(net, std::vector<std::unique_ptr<WireSegment>>());
+    unsigned Geometry::internNet(const std::string &net) {
+        unsigned net_id = static_cast<unsigned>(_net_names.intern(net));
+        if (net_id == _net_to_segs.size()) {
+            _net_to_segs.emplace_back();
+            _net_trimmed_shapes.emplace_back();
+            _dirty_nets.push_back(true);
+            _reshaped_nets.push_back(false);
         }
-        return _net_to_segs.at(net);
+        return net_id;
     }
 
-    WireSegment *Geometry::addSegmentToNet(std::string net, WireSegment &seg) {
-        std::unique_ptr<WireSegment> seg_ptr(new WireSegment(seg));
-        if (_net_to_segs.find(net) == _net_to_segs.end()) {
-            _net_to_segs.emplace(net, std::vector<std::unique_ptr<WireSegment>>());
+    int Geometry::internLayer(const std::string &layer) {
+        int layer_id = _layer_names.intern(layer);
+        if (static_cast<size_t>(layer_id) == _layer_to_partitioned_segs.size()) {
+            _layer_to_partitioned_segs.emplace_back(_default_partition_size);
+            _layer_to_rtree_segs.emplace_back();
         }
-        _net_to_segs.at(net).push_back(std::move(seg_ptr));
-        return _net_to_segs.at(net).back().get();
+        return layer_id;
     }
 
-    WireSegment *Geometry::addSegmentToLayer(std::string layer, WireSegment *seg_ptr) {
-        
-        if (_layer_to_partitioned_segs.find(layer) == _layer_to_partitioned_segs.end()) {
-            _layer_to_partitioned_segs.emplace(layer, UniformPartition<WireSegment>(_default_partition_size));
-        }
+    unsigned Geometry::getNetId(const std::string &net) const {
+        int net_id = _net_names.find(net);
+        PhyDBExpects(net_id >= 0, "net " + net + " has no geometry");
+        return static_cast<unsigned>(net_id);
+    }
 
-        _layer_to_partitioned_segs.at(layer).add(seg_ptr);
+    int Geometry::getLayerId(const std::string &layer) const {
+        int layer_id = _layer_names.find(layer);
+        PhyDBExpects(layer_id >= 0, "layer " + layer + " has no geometry");
+        return layer_id;
+    }
+
+    std::string Geometry::getNodeName(unsigned net_id, NodeId node_id) const {
+        return _net_names.getName(net_id) + "{" + std::to_string(node_id) + "}";
+    }
+
+     std::vector<ArenaPtr<WireSegment>> &Geometry::getSegmentsOfNet(std::string net) {
+        return _net_to_segs[internNet(net)];
+    }
+
+    WireSegment *Geometry::addSegmentToNet(unsigned net_id, WireSegment &seg) {
+        PhyDBExpects(net_id < _net_to_segs.size() && static_cast<size_t>(seg.getLayerId()) < _layer_to_partitioned_segs.size(), "segment added with a net or layer id that was never interned");
+        if (_use_arena && !_segment_arena) _segment_arena.reset(new Arena(Arena::kDefaultBlockSize, _use_huge_pages));
+        ArenaPtr<WireSegment> seg_ptr = MakeArenaPtr<WireSegment>(_use_arena ? _segment_arena.get() : nullptr, seg);
+        seg_ptr->setGeometry(this);
+        seg_ptr->setGlobalId(_next_segment_id++);
+        _dirty_nets[net_id] = true;
+        _reshaped_nets[net_id] = true;
+        _net_to_segs[net_id].push_back(std::move(seg_ptr));
+        return _net_to_segs[net_id].back().get();
+    }
+
+    WireSegment *Geometry::addSegmentToLayer(int layer_id, WireSegment *seg_ptr) {
+        PhyDBExpects(layer_id >= 0 && static_cast<size_t>(layer_id) < _layer_to_partitioned_segs.size(), "layer id " + std::to_string(layer_id) + " was never interned");
+        _layer_to_partitioned_segs[layer_id].add(seg_ptr);
+        _layer_to_rtree_segs[layer_id].add(seg_ptr);
         return seg_ptr;
     }
 
-    void Geometry::_populateCapacitanceNetwork() {
-        if (_capacitor_network.size() > 0) {
-            std::cout << "something odd! capacitor network already populated...";
-            return;
+    void Geometry::_populateCapacitanceNetwork(const std::vector<unsigned> &nets) {
+        buildPartitions();
+        Arena *arena = _networkArena(0); // splitting below runs serially
+
+        std::vector<bool> selected(_net_to_segs.size(), false);
+        for (unsigned net_id : nets) {
+            selected[net_id] = true;
         }
 
-        for (std::map<std::string, std::vector<std::unique_ptr<WireSegment>>>::iterator it = _net_to_segs.begin() ; it != _net_to_segs.end() ; it++) {
-            std::string net = it->first;
-            for (std::unique_ptr<WireSegment> &seg : it->second) {
-                if (seg->getResistors().size() == 0) continue;
-                std::vector<WireSegment *> nbr_ptrs = getOtherNetsNearbySegments(seg.get());
-                for (WireSegment *nbr_ptr : nbr_ptrs) {
-                    if (nbr_ptr->getResistors().size() == 0) continue; // disregard pairs that share a net or have no resistors to even connect to
+        // neighbour lists of a batch land in one flat buffer per worker and are reused batch to batch, so once
+        // the buffers have grown the loop below neither allocates nor touches strings
+        struct NbrRange {
+            int worker;
+            size_t begin;
+            size_t end;
+        };
+        std::vector<std::vector<WireSegment *>> worker_nbrs(_num_threads);
+        std::vector<WireSegment *> batch_segs;
+        std::vector<NbrRange> batch_nbrs;
+
+        const size_t batch_size = 4096;
+        for (size_t batch_begin = 0; batch_begin < nets.size(); batch_begin += batch_size) {
+            batch_segs.clear();
+            for (size_t i = batch_begin; i < std::min(batch_begin + batch_size, nets.size()); i++) {
+                for (ArenaPtr<WireSegment> &seg : _net_to_segs[nets[i]]) {
+                    if (seg->getResistors().size() != 0) batch_segs.push_back(seg.get());
+                }
+            }
 
-                    Rect2D<double> seg_rect = seg->getRect();
-                    Rect2D<double> nbr_rect = nbr_ptr->getRect();
+            // neighbour lookups only read the partitions so they run in parallel ahead of the splitting below,
+            // which edits resistors of both nets and has to stay in serial order
+            for (std::vector<WireSegment *> &nbrs : worker_nbrs) nbrs.clear();
+            batch_nbrs.resize(batch_segs.size());
+            _parallelFor(batch_segs.size(), [&](size_t i, int worker) {
+                std::vector<WireSegment *> &nbrs = worker_nbrs[worker];
+                size_t begin = nbrs.size();
+                getOtherNetsNearbySegments(batch_segs[i], nbrs);
+                batch_nbrs[i] = NbrRange{ worker, begin, nbrs.size() };
+            });
+
+            for (size_t seg_idx = 0; seg_idx < batch_segs.size(); seg_idx++) {
+                WireSegment *seg = batch_segs[seg_idx];
+                const NbrRange &range = batch_nbrs[seg_idx];
+                const std::vector<WireSegment *> &nbrs = worker_nbrs[range.worker];
+                for (size_t nbr_idx = range.begin; nbr_idx < range.end; nbr_idx++) {
+                    WireSegment *nbr_ptr = nbrs[nbr_idx];
+                    if (nbr_ptr->getResistors().size() == 0) {
+                        // a dirty net outside the extraction scope has no network to split, only seg's side gets a node
+                        if (_dirty_nets[nbr_ptr->getNetId()] && !selected[nbr_ptr->getNetId()]) _coupleSegments(seg, nbr_ptr, arena, false);
+                        continue; // disregard pairs that share a net or have no resistors to even connect to
+                    }
 
-                    if (seg->getNetName() + std::to_string(nbr_ptr->getSegmentNumber()) < nbr_ptr->getNetName() + std::to_string(nbr_ptr->getSegmentNumber())) { // double counting problem
-                        continue;
+                    if (_ownsCoupling(seg, nbr_ptr)) {
+                        _coupleSegments(seg, nbr_ptr, arena);
+                    } else if (!_dirty_nets[nbr_ptr->getNetId()] && _ownsCoupling(nbr_ptr, seg)) {
+                        // the neighbour is not being re-extracted so nothing will visit the pair from its side
+                        _coupleSegments(nbr_ptr, seg, arena);
                     }
-                    
-                    double overlap_length = 0.0, distance = 0.0, overlap_center = 0.0;
+                }
+            }
+        }
+    }
 
+    bool Geometry::_ownsCoupling(WireSegment *seg, WireSegment *nbr_ptr) {
+        // each pair is seen from both sides, only one side creates the capacitor (double counting problem)
+        return seg->getGlobalId() < nbr_ptr->getGlobalId();
+    }
 
-                    // overlap in the x direction
-                    if ((seg_rect.ll.x <= nbr_rect.ur.x && seg_rect.ur.x >= nbr_rect.ll.x) || (nbr_rect.ll.x <= seg_rect.ur.x && nbr_rect.ur.x >= seg_rect.ll.x)) {
-                        overlap_length = std::min(seg_rect.ur.x, nbr_rect.ur.x) - std::max(seg_rect.ll.x, nbr_rect.ll.x);
-                        distance = std::min(std::abs(nbr_rect.ll.y - seg_rect.ur.y), std::abs(nbr_rect.ur.y - seg_rect.ll.y));
+    // where a coupling attaches to one side: the middle of the overlap when it falls inside a run of the side's planar
+    // resistors along the overlap axis, else the middle of the part of the overlap a run covers. A run is a resistor
+    // as extraction made it, before couplings split it into a chain joined at split nodes, so the point does not
+    // depend on the order couplings come in; a point on an earlier split gets a node of its own all the same, joined
+    // to that split by a zero length resistor
+    Resistor *Geometry::_findCouplingSplit(ElementSpan<Resistor> resistors, bool horizontal, double overlap_lo, double overlap_hi, Point2D<double> &split_pt) {
+        std::vector<SplitPiece> &pieces = _split_pieces;
+        pieces.clear();
+        for (Resistor *res : resistors) {
+            Point2D<double> p1 = res->getP1();
+            Point2D<double> p2 = res->getP2();
+            double across1 = horizontal ? p1.y : p1.x, across2 = horizontal ? p2.y : p2.x;
+            double along1 = horizontal ? p1.x : p1.y, along2 = horizontal ? p2.x : p2.y;
+            if (res->isVertical() || across1 != across2) continue;
+            // node ids past the net's wire nodes were made by coupling splits
+            NodeId wire_nodes = res->getNetId() < _net_wire_nodes.size() ? _net_wire_nodes[res->getNetId()] : 0;
+            NodeId lo_node = along1 <= along2 ? res->getNodeId1() : res->getNodeId2();
+            bool split_at_lo = lo_node >= wire_nodes || (along1 == along2 && std::max(res->getNodeId1(), res->getNodeId2()) >= wire_nodes);
+            pieces.push_back({ across1, std::min(along1, along2), std::max(along1, along2), split_at_lo, res });
+        }
+        std::sort(pieces.begin(), pieces.end(), [](const SplitPiece &a, const SplitPiece &b) {
+            if (a.across != b.across) return a.across < b.across;
+            return a.lo != b.lo ? a.lo < b.lo : a.hi < b.hi;
+        });
+
+        // runs are ranges [begin, end) of pieces, look for one the overlap's middle falls strictly inside first
+        double center = (overlap_lo + overlap_hi) / 2;
+        size_t run_begin = pieces.size(), run_end = pieces.size(), fallback_begin = pieces.size(), fallback_end = pieces.size();
+        double fallback_lo = 0, fallback_hi = 0;
+        for (size_t begin = 0, end = 0; begin < pieces.size(); begin = end) {
+            double lo = pieces[begin].lo, hi = pieces[begin].hi;
+            for (end = begin + 1; end < pieces.size() && pieces[end].across == pieces[begin].across && pieces[end].lo == hi && pieces[end].split_at_lo; end++) {
+                hi = std::max(hi, pieces[end].hi);
+            }
+            if (center > lo && center < hi) {
+                run_begin = begin;
+                run_end = end;
+                break;
+            }
+            if (fallback_begin == pieces.size() && ((overlap_lo > lo && overlap_lo < hi) || (overlap_hi > lo && overlap_hi < hi))) {
+                fallback_begin = begin;
+                fallback_end = end;
+                fallback_lo = lo;
+                fallback_hi = hi;
+            }
+        }
+        if (run_begin == pieces.size()) {
+            if (fallback_begin == pieces.size()) return nullptr;
+            run_begin = fallback_begin;
+            run_end = fallback_end;
+            center = (std::max(overlap_lo, fallback_lo) + std::min(overlap_hi, fallback_hi)) / 2;
+        }
 
-                        overlap_center = (std::min(seg_rect.ur.x, nbr_rect.ur.x) + std::max(seg_rect.ll.x, nbr_rect.ll.x)) / 2;
+        for (size_t i = run_begin; i < run_end; i++) {
+            if (center < pieces[i].lo || center > pieces[i].hi) continue;
+            split_pt = horizontal ? Point2D<double>(center, pieces[i].across) : Point2D<double>(pieces[i].across, center);
+            return pieces[i].res;
+        }
+        return nullptr;
+    }
 
-                        Resistor *seg_split_res = nullptr, *nbr_split_res = nullptr;
-                        Point2D<double> seg_split_pt, nbr_split_pt;
+    void Geometry::_coupleSegments(WireSegment *seg, WireSegment *nbr_ptr, Arena *arena, bool nbr_extracted) {
+        Rect2D<double> seg_rect = seg->getRect();
+        Rect2D<double> nbr_rect = nbr_ptr->getRect();
+
+        // a neighbour without a network stands in with its drawn centerline, the one resistor it would start out as,
+        // so it couples where it would once extracted (never through a via shape, whose centerline is a point)
+        Resistor nbr_centerline(nbr_ptr->getNetId(), 0, 0, nbr_ptr->getLayerId(), -1, -1, -1, nbr_ptr->getP1(), nbr_ptr->getP2());
+        Resistor *nbr_centerline_ptr = &nbr_centerline;
+        const std::vector<Resistor *> &seg_network = seg->getResistors();
+        const std::vector<Resistor *> &nbr_network = nbr_ptr->getResistors();
+        ElementSpan<Resistor> seg_resistors(seg_network.data(), seg_network.data() + seg_network.size());
+        ElementSpan<Resistor> nbr_resistors = nbr_extracted ? ElementSpan<Resistor>(nbr_network.data(), nbr_network.data() + nbr_network.size()) : ElementSpan<Resistor>(&nbr_centerline_ptr, &nbr_centerline_ptr + 1);
+
+        double overlap_length = 0.0, distance = 0.0, overlap_lo = 0.0, overlap_hi = 0.0;
+        bool horizontal = false;
+        Rect2D<double> region; // may be degenerate, wires touching or meeting at a corner
+
+        // overlap in the x direction
+        if ((seg_rect.ll.x <= nbr_rect.ur.x && seg_rect.ur.x >= nbr_rect.ll.x) || (nbr_rect.ll.x <= seg_rect.ur.x && nbr_rect.ur.x >= seg_rect.ll.x)) {
+            overlap_lo = std::max(seg_rect.ll.x, nbr_rect.ll.x);
+            overlap_hi = std::min(seg_rect.ur.x, nbr_rect.ur.x);
+            distance = std::min(std::abs(nbr_rect.ll.y - seg_rect.ur.y), std::abs(nbr_rect.ur.y - seg_rect.ll.y));
+            horizontal = true;
+            double gap_lo = std::min(seg_rect.ur.y, nbr_rect.ur.y), gap_hi = std::max(seg_rect.ll.y, nbr_rect.ll.y);
+            region.ll = Point2D<double>(overlap_lo, std::min(gap_lo, gap_hi));
+            region.ur = Point2D<double>(overlap_hi, std::max(gap_lo, gap_hi));
+        }
+        // overlap in the y direction
+        else if ((seg_rect.ll.y <= nbr_rect.ur.y && seg_rect.ur.y >= nbr_rect.ll.y) || (nbr_rect.ll.y <= seg_rect.ur.y && nbr_rect.ur.y >= seg_rect.ll.y)) {
+            overlap_lo = std::max(seg_rect.ll.y, nbr_rect.ll.y);
+            overlap_hi = std::min(seg_rect.ur.y, nbr_rect.ur.y);
+            distance = std::min(std::abs(nbr_rect.ll.x - seg_rect.ur.x), std::abs(nbr_rect.ur.x - seg_rect.ll.x));
+            double gap_lo = std::min(seg_rect.ur.x, nbr_rect.ur.x), gap_hi = std::max(seg_rect.ll.x, nbr_rect.ll.x);
+            region.ll = Point2D<double>(std::min(gap_lo, gap_hi), overlap_lo);
+            region.ur = Point2D<double>(std::max(gap_lo, gap_hi), overlap_hi);
+        } else {
+            // std::cout << "NON OVERLAPPING NBR: " << nbr_rect << std::endl;
+            return;
+        }
+        overlap_length = overlap_hi - overlap_lo;
+
+        Point2D<double> seg_split_pt, nbr_split_pt;
+        Resistor *seg_split_res = _findCouplingSplit(seg_resistors, horizontal, overlap_lo, overlap_hi, seg_split_pt);
+        Resistor *nbr_split_res = _findCouplingSplit(nbr_resistors, horizontal, overlap_lo, overlap_hi, nbr_split_pt);
+        if (!nbr_split_res || !seg_split_res) return; // not enough overlap otherwise given model
+
+        NodeId seg_split_id = _splitResistorAtPt(seg_split_res, seg_split_pt, _resistor_network, arena);
+        NodeId nbr_split_id = nbr_extracted ? _splitResistorAtPt(nbr_split_res, nbr_split_pt, _resistor_network, arena) : 0;
+        _capacitor_network.emplace_back(MakeArenaPtr<Capacitor>(arena,
+            seg_split_res->getNetId(),
+            seg_split_id,
+            nbr_ptr->getNetId(),
+            nbr_split_id,
+            seg->getLayerId(),
+            overlap_length,
+            distance,
+            seg_split_res->getWidth(),
+            region
+        ));
 
-                        for (Resistor *seg_res : seg->getResistors()) {
-                            Point2D<double> seg_res_p1 = seg_res->getP1();
-                            Point2D<double> seg_res_p2 = seg_res->getP2();
+        // std::cout << "SEGMENT #" << seg->getSegmentNumber() << " OF NET '" << seg->getNetName() << "' HAS OVERLAPPING REGION OF LENGTH " << overlap_length << " AT DISTANCE " << distance << " WITH SEGMENT #" << nbr_ptr->getSegmentNumber() << " OF NET '" << nbr_ptr->getNetName() << "'" << std::endl; 
+    }
 
-                            if (seg_res_p1.y == seg_res_p2.y && overlap_center > std::min(seg_res_p1.x, seg_res_p2.x) && overlap_center < std::max(seg_res_p1.x, seg_res_p2.x)) {
-                                seg_split_res = seg_res;
-                                seg_split_pt = Point2D<double>(overlap_center, seg_res_p1.y);
-                                break;
-                            }
-                        }
+    std::vector<WireSegment *> Geometry::getOtherNetsNearbySegments(WireSegment *seg_ptr) {
+        std::vector<WireSegment *> nbr_ptrs;
+        getOtherNetsNearbySegments(seg_ptr, nbr_ptrs);
+        return nbr_ptrs;
+    }
 
-                        if (!seg_split_res) {
-                            double overlap_left = std::max(seg_rect.ll.x, nbr_rect.ll.x);
-                            double overlap_right = std::min(seg_rect.ur.x, nbr_rect.ur.x);
-                            for (Resistor *seg_res : seg->getResistors()) {
-                                Point2D<double> seg_res_p1 = seg_res->getP1();
-                                Point2D<double> seg_res_p2 = seg_res->getP2();
-
-                                if (seg_res_p1.y == seg_res_p2.y &&
-                                    ((overlap_right > std::min(seg_res_p1.x, seg_res_p2.x) && overlap_right < std::max(seg_res_p1.x, seg_res_p2.x)) ||
-                                    (overlap_left > std::min(seg_res_p1.x, seg_res_p2.x) && overlap_left < std::max(seg_res_p1.x, seg_res_p2.x)))) {
-                                    
-                                    double sub_overlap_center = (std::max(overlap_left, std::min(seg_res_p1.x, seg_res_p2.x)) + std::min(overlap_right, std::max(seg_res_p1.x, seg_res_p2.x))) /2;
-
-                                    seg_split_res = seg_res;
-                                    seg_split_pt = Point2D<double>(sub_overlap_center, seg_res_p1.y);
-                                    break;
-                                }
-                            }
-                        }
+    void Geometry::getOtherNetsNearbySegments(WireSegment *seg_ptr, std::vector<WireSegment *> &nbr_ptrs) {
+        PhyDBExpects(
+            seg_ptr->getLayerId() >= 0 && static_cast<size_t>(seg_ptr->getLayerId()) < _layer_to_partitioned_segs.size(),
+            "segment " + std::to_string(seg_ptr->getSegmentNumber()) + " of net " + seg_ptr->getNetName() + " is on layer " + std::to_string(seg_ptr->getLayerId()) + ", which has no segments partitioned"
+        );
+
+        unsigned net_id = seg_ptr->getNetId();
+        size_t begin = nbr_ptrs.size(); // only the entries appended here are filtered and sorted
+
+        if (_spatial_index == SpatialIndexType::RTREE) {
+            PackedRTree<WireSegment> &layer_tree = _layer_to_rtree_segs[seg_ptr->getLayerId()];
+            if (!layer_tree.isBuilt()) layer_tree.build();
+            layer_tree.queryWithin(seg_ptr->getRect(), _neighbour_distance, nbr_ptrs);
+            nbr_ptrs.erase(std::remove_if(nbr_ptrs.begin() + begin, nbr_ptrs.end(), [net_id](WireSegment *other_seg_ptr) {
+                return other_seg_ptr->getNetId() == net_id;
+            }), nbr_ptrs.end());
+            return;
+        }
 
-                        for (Resistor *nbr_res : nbr_ptr->getResistors()) {
-                            Point2D<double> nbr_res_p1 = nbr_res->getP1();
-                            Point2D<double> nbr_res_p2 = nbr_res->getP2();
+        UniformPartition<WireSegment> &layer_segs = _layer_to_partitioned_segs[seg_ptr->getLayerId()];
+        if (!layer_segs.isBuilt()) layer_segs.build();
+        std::pair<int, int> ll_partition = layer_segs.getPartitionId(seg_ptr->getRect().ll);
+        std::pair<int, int> ur_partition = layer_segs.getPartitionId(seg_ptr->getRect().ur);
 
-                            if (nbr_res_p1.y == nbr_res_p2.y && overlap_center > std::min(nbr_res_p1.x, nbr_res_p2.x) && overlap_center < std::max(nbr_res_p1.x, nbr_res_p2.x)) {
-                                nbr_split_res = nbr_res;
-                                nbr_split_pt = Point2D<double>(overlap_center, nbr_res_p1.y);
-                                break;
-                            }
-                        }
+        for (int x_partition = ll_partition.first - _num_bins_neighborhood; x_partition <= ur_partition.first + _num_bins_neighborhood; x_partition++) {
+            for (int y_partition = ll_partition.second - _num_bins_neighborhood; y_partition <= ur_partition.second + _num_bins_neighborhood; y_partition++) {
+                ElementSpan<WireSegment> segments_of_partition = layer_segs.getElementsByPartition(std::pair<int, int>(x_partition, y_partition));
+                for (WireSegment *other_seg_ptr : segments_of_partition) {
+                    if (other_seg_ptr->getNetId() != net_id) {
+                        nbr_ptrs.push_back(other_seg_ptr);
+                    }
+                }
+            }
+        }
 
-                        if (!nbr_split_res) {
-                            double overlap_left = std::max(nbr_rect.ll.x, seg_rect.ll.x);
-                            double overlap_right = std::min(nbr_rect.ur.x, seg_rect.ur.x);
-                            for (Resistor *nbr_res : nbr_ptr->getResistors()) {
-                                Point2D<double> nbr_res_p1 = nbr_res->getP1();
-                                Point2D<double> nbr_res_p2 = nbr_res->getP2();
-
-                                if (nbr_res_p1.y == nbr_res_p2.y &&
-                                    ((overlap_right > std::min(nbr_res_p1.x, nbr_res_p2.x) && overlap_right < std::max(nbr_res_p1.x, nbr_res_p2.x)) ||
-                                    (overlap_left > std::min(nbr_res_p1.x, nbr_res_p2.x) && overlap_left < std::max(nbr_res_p1.x, nbr_res_p2.x)))) {
-                                    
-                                    double sub_overlap_center = (std::max(overlap_left, std::min(nbr_res_p1.x, nbr_res_p2.x)) + std::min(overlap_right, std::max(nbr_res_p1.x, nbr_res_p2.x))) /2;
-
-                                    nbr_split_res = nbr_res;
-                                    nbr_split_pt = Point2D<double>(sub_overlap_center, nbr_res_p1.y);
-                                    break;
-                                }
-                            }
-                        }
+        // segments span several bins, dedupe; ordering by global id rather than address keeps the coupling
+        // order, and so the node numbering, the same from run to run
+        std::sort(nbr_ptrs.begin() + begin, nbr_ptrs.end(), [](const WireSegment *a, const WireSegment *b) { return a->getGlobalId() < b->getGlobalId(); });
+        nbr_ptrs.erase(std::unique(nbr_ptrs.begin() + begin, nbr_ptrs.end()), nbr_ptrs.end());
+    }
 
-                        if (nbr_split_res && seg_split_res) {
-                            std::string seg_split_id = _splitResistorAtPt(seg_split_res, seg_split_pt);
-                            std::string nbr_split_id = _splitResistorAtPt(nbr_split_res, nbr_split_pt);
-                            std::unique_ptr<Capacitor> capacitor(new Capacitor(
-                                seg_split_id,
-                                nbr_split_id,
-                                seg->getLayerName(),
-                                overlap_length,
-                                distance
-                            ));
-                            _capacitor_network.emplace_back(std::move(capacitor));
-                        }
+    void Geometry::buildPartitions() {
+        if (_spatial_index == SpatialIndexType::RTREE) {
+            for (PackedRTree<WireSegment> &layer_tree : _layer_to_rtree_segs) {
+                if (!layer_tree.isBuilt()) layer_tree.build();
+            }
+            return;
+        }
+        for (UniformPartition<WireSegment> &layer_segs : _layer_to_partitioned_segs) {
+            if (!layer_segs.isBuilt()) layer_segs.build();
+        }
+    }
+
+    void Geometry::setArenaStorage(bool use_arena, bool use_huge_pages) {
+        // objects already allocated keep their storage, their deleters know where they came from
+        _use_arena = use_arena;
+        _use_huge_pages = use_huge_pages;
+    }
+
+    void Geometry::clearRCNetwork() {
+        for (unsigned net_id = 0; net_id < _net_to_segs.size(); net_id++) {
+            _resetNet(net_id);
+            _dirty_nets[net_id] = true;
+        }
+        _purgeRemovedSegments();
+
+        // destroy every element first, then hand the arena blocks back in one go
+        _resistor_network.clear();
+        _capacitor_network.clear();
+        _net_num_nodes.clear();
+        _net_wire_nodes.clear();
+        for (std::unique_ptr<Arena> &arena : _network_arenas) {
+            arena->Release();
+        }
+        _extracted = false;
+        _annotated_corner = -1;
+        _annotation_stale = false;
+        _changed_nets.clear();
+        _unannotated_nets.clear();
+        _net_pin_nodes.clear();
+        _net_open_pieces.clear();
+    }
+
+    void Geometry::removeSegmentsOfNet(const std::string &net) {
+        int net_id = _net_names.find(net);
+        if (net_id < 0) return;
+
+        // the segments may still own resistors, keep them alive until the next extraction drops those
+        for (ArenaPtr<WireSegment> &seg_ptr : _net_to_segs[net_id]) {
+            _removed_segs.push_back(std::move(seg_ptr));
+        }
+        _net_to_segs[net_id].clear();
+        _dirty_nets[net_id] = true;
+    }
+
+    void Geometry::generateRCNetwork(const ExtractionScope &scope) {
+        std::vector<unsigned> nets = _selectNets(scope);
+
+        // shapes removed or added since the last generation change the tables of wires above and below them, only
+        // worth finding while there is an annotation to keep
+        std::vector<std::pair<int, Rect2D<double>>> changed_shapes;
+        if (_annotated_corner >= 0) {
+            for (const ArenaPtr<WireSegment> &seg_ptr : _removed_segs) {
+                changed_shapes.emplace_back(seg_ptr->getLayerId(), seg_ptr->getRect());
+            }
+            for (unsigned net_id = 0; net_id < _net_to_segs.size(); net_id++) {
+                if (!_reshaped_nets[net_id]) continue;
+                for (const ArenaPtr<WireSegment> &seg_ptr : _net_to_segs[net_id]) {
+                    changed_shapes.emplace_back(seg_ptr->getLayerId(), seg_ptr->getRect());
+                }
+            }
+        }
+
+        // the selected nets are rebuilt, clean nets coupled to a dropped or a selected net have resistors rejoined or split
+        _changed_nets.assign(_net_to_segs.size(), false);
+        for (unsigned net_id : nets) {
+            _changed_nets[net_id] = true;
+        }
+        if (_extracted) {
+            // besides the selected nets, dirty nets left out of the scope lose a network built from their old shapes
+            std::vector<bool> dropped_nets(_net_to_segs.size(), false);
+            bool any_dropped = false;
+            for (unsigned net_id : nets) {
+                dropped_nets[net_id] = true;
+            }
+            for (unsigned net_id = 0; net_id < _net_to_segs.size(); net_id++) {
+                if (_dirty_nets[net_id] && (dropped_nets[net_id] || getNumNodes(net_id) > 0)) {
+                    dropped_nets[net_id] = true;
+                    _changed_nets[net_id] = true;
+                    any_dropped = true;
+                    _resetNet(net_id);
+                }
+            }
+            if (any_dropped) {
+                for (ArenaPtr<Capacitor> &cap : _capacitor_network) {
+                    if (dropped_nets[cap->getNetId1()] || dropped_nets[cap->getNetId2()]) {
+                        _changed_nets[cap->getNetId1()] = true;
+                        _changed_nets[cap->getNetId2()] = true;
                     }
-                    // overlap in the y direction
-                    else if ((seg_rect.ll.y <= nbr_rect.ur.y && seg_rect.ur.y >= nbr_rect.ll.y) || (nbr_rect.ll.y <= seg_rect.ur.y && nbr_rect.ur.y >= seg_rect.ll.y)) {
-                        overlap_length = std::min(seg_rect.ur.y, nbr_rect.ur.y) - std::max(seg_rect.ll.y, nbr_rect.ll.y);
-                        distance = std::min(std::abs(nbr_rect.ll.x - seg_rect.ur.x), std::abs(nbr_rect.ur.x - seg_rect.ll.x));
+                }
+                _dropDirtyElements(dropped_nets);
+            }
+        }
+        _purgeRemovedSegments();
+
+        _populateResistorNetwork(nets);
+        size_t first_new_cap = _capacitor_network.size();
+        _populateCapacitanceNetwork(nets);
+        for (size_t i = first_new_cap; i < _capacitor_network.size(); i++) {
+            _changed_nets[_capacitor_network[i]->getNetId1()] = true;
+            _changed_nets[_capacitor_network[i]->getNetId2()] = true;
+        }
+        if (_check_connectivity) _reportOpenNets(nets);
 
-                        overlap_center = (std::min(seg_rect.ur.y, nbr_rect.ur.y) + std::max(seg_rect.ll.y, nbr_rect.ll.y)) / 2;
+        for (unsigned net_id : nets) {
+            _dirty_nets[net_id] = false;
+        }
+        _extracted = true;
+
+        // nets left alone keep their pin nodes and capacitance values
+        _net_pin_nodes.resize(_net_names.size());
+        _unannotated_nets.resize(_net_to_segs.size(), true);
+        for (unsigned net_id = 0; net_id < _net_to_segs.size(); net_id++) {
+            if (!_changed_nets[net_id]) continue;
+            _net_pin_nodes[net_id].clear();
+            _unannotated_nets[net_id] = true;
+            _annotation_stale = true;
+        }
+        _markContextChanges(changed_shapes);
+        _reshaped_nets.assign(_net_to_segs.size(), false);
+    }
 
-                        Resistor *seg_split_res = nullptr, *nbr_split_res = nullptr;
-                        Point2D<double> seg_split_pt, nbr_split_pt;
+    std::vector<unsigned> Geometry::getExtractedNets() const {
+        std::vector<unsigned> nets;
+        if (!_extracted) return nets;
+        for (unsigned net_id = 0; net_id < _net_to_segs.size(); net_id++) {
+            if (!_dirty_nets[net_id]) nets.push_back(net_id);
+        }
+        std::sort(nets.begin(), nets.end(), [this](unsigned a, unsigned b) { return _net_names.getName(a) < _net_names.getName(b); });
+        return nets;
+    }
 
-                        for (Resistor *seg_res : seg->getResistors()) {
-                            Point2D<double> seg_res_p1 = seg_res->getP1();
-                            Point2D<double> seg_res_p2 = seg_res->getP2();
+    bool Geometry::loadRCNetwork(const RCCache &cache, const std::vector<unsigned> &nets) {
+        clearRCNetwork();
 
-                            if (seg_res_p1.x == seg_res_p2.x && overlap_center > std::min(seg_res_p1.y, seg_res_p2.y) && overlap_center < std::max(seg_res_p1.y, seg_res_p2.y)) {
-                                seg_split_res = seg_res;
-                                seg_split_pt = Point2D<double>(seg_res_p1.x, overlap_center);
-                                break;
-                            }
-                        }
+        // ids are matched by name, every cached net needs the segments it was saved with, in the same order
+        std::vector<unsigned> net_ids(cache.NumNets());
+        std::vector<int> layer_ids(cache.NumLayers());
+        for (size_t layer = 0; layer < layer_ids.size(); layer++) {
+            layer_ids[layer] = _layer_names.find(std::string(cache.LayerName(layer)));
+        }
+        for (unsigned net = 0; net < net_ids.size(); net++) {
+            int net_id = _net_names.find(std::string(cache.NetName(net)));
+            if (net_id < 0 || static_cast<size_t>(cache.NetSegmentsEnd(net) - cache.NetSegmentsBegin(net)) != _net_to_segs[net_id].size()) return false;
+            net_ids[net] = static_cast<unsigned>(net_id);
+            const CachedSegment *cached = cache.NetSegmentsBegin(net);
+            for (const ArenaPtr<WireSegment> &seg_ptr : _net_to_segs[net_id]) {
+                if (layer_ids[cached->layer_id] != seg_ptr->getLayerId() || cached->seg_num != seg_ptr->getSegmentNumber()) return false;
+                cached++;
+            }
+        }
 
-                        if (!seg_split_res) {
-                            double overlap_left = std::max(seg_rect.ll.y, nbr_rect.ll.y);
-                            double overlap_right = std::min(seg_rect.ur.y, nbr_rect.ur.y);
-                            for (Resistor *seg_res : seg->getResistors()) {
-                                Point2D<double> seg_res_p1 = seg_res->getP1();
-                                Point2D<double> seg_res_p2 = seg_res->getP2();
-
-                                if (seg_res_p1.x == seg_res_p2.x &&
-                                    ((overlap_right > std::min(seg_res_p1.y, seg_res_p2.y) && overlap_right < std::max(seg_res_p1.y, seg_res_p2.y)) ||
-                                    (overlap_left > std::min(seg_res_p1.y, seg_res_p2.y) && overlap_left < std::max(seg_res_p1.y, seg_res_p2.y)))) {
-                                    
-                                    double sub_overlap_center = (std::max(overlap_left, std::min(seg_res_p1.y, seg_res_p2.y)) + std::min(overlap_right, std::max(seg_res_p1.y, seg_res_p2.y))) /2;
-
-                                    seg_split_res = seg_res;
-                                    seg_split_pt = Point2D<double>(seg_res_p1.x, sub_overlap_center);
-                                    break;
-                                }
-                            }
-                        }
+        // segments take the shapes overlap handling trimmed them to, the drawn ones are kept for _resetNet
+        auto same_point = [](const Point2D<double> &a, const Point2D<double> &b) { return a.x == b.x && a.y == b.y; };
+        std::vector<WireSegment *> segments;
+        segments.reserve(cache.NumSegments());
+        for (unsigned net = 0; net < net_ids.size(); net++) {
+            const CachedSegment *cached = cache.NetSegmentsBegin(net);
+            for (ArenaPtr<WireSegment> &seg_ptr : _net_to_segs[net_ids[net]]) {
+                Rect2D<double> rect;
+                rect.ll = Point2D<double>(cached->llx, cached->lly);
+                rect.ur = Point2D<double>(cached->urx, cached->ury);
+                Point2D<double> p1(cached->p1x, cached->p1y), p2(cached->p2x, cached->p2y);
+                Rect2D<double> drawn = seg_ptr->getRect();
+                if (!same_point(drawn.ll, rect.ll) || !same_point(drawn.ur, rect.ur) || !same_point(seg_ptr->getP1(), p1) || !same_point(seg_ptr->getP2(), p2)) {
+                    _net_trimmed_shapes[net_ids[net]].push_back(TrimmedShape{seg_ptr.get(), drawn, seg_ptr->getP1(), seg_ptr->getP2()});
+                    seg_ptr->setShape(rect, p1, p2);
+                }
+                segments.push_back(seg_ptr.get());
+                cached++;
+            }
+        }
 
-                        for (Resistor *nbr_res : nbr_ptr->getResistors()) {
-                            Point2D<double> nbr_res_p1 = nbr_res->getP1();
-                            Point2D<double> nbr_res_p2 = nbr_res->getP2();
+        Arena *arena = _networkArena(0);
+        _resistor_network.reserve(cache.NumResistors());
+        for (const CachedResistor *cached = cache.Resistors(); cached != cache.Resistors() + cache.NumResistors(); cached++) {
+            WireSegment *owner = cached->owner_segment == ~static_cast<uint64_t>(0) ? nullptr : segments[cached->owner_segment];
+            _resistor_network.emplace_back(MakeArenaPtr<Resistor>(arena,
+                net_ids[cached->net_id], cached->node_id1, cached->node_id2, layer_ids[cached->layer_id], cached->length, cached->width, cached->area,
+                Point2D<double>(cached->p1x, cached->p1y), Point2D<double>(cached->p2x, cached->p2y), owner));
+            _resistor_network.back()->setGroundCapacitance(cached->ground_capacitance);
+        }
+        _capacitor_network.reserve(cache.NumCapacitors());
+        for (const CachedCapacitor *cached = cache.Capacitors(); cached != cache.Capacitors() + cache.NumCapacitors(); cached++) {
+            Rect2D<double> region;
+            region.ll = Point2D<double>(cached->region_llx, cached->region_lly);
+            region.ur = Point2D<double>(cached->region_urx, cached->region_ury);
+            _capacitor_network.emplace_back(MakeArenaPtr<Capacitor>(arena,
+                net_ids[cached->net_id1], cached->node_id1, net_ids[cached->net_id2], cached->node_id2, layer_ids[cached->layer_id],
+                cached->overlap_length, cached->distance, cached->width, region));
+            _capacitor_network.back()->setCapacitance(cached->capacitance);
+        }
 
-                            if (nbr_res_p1.x == nbr_res_p2.x && overlap_center > std::min(nbr_res_p1.y, nbr_res_p2.y) && overlap_center < std::max(nbr_res_p1.y, nbr_res_p2.y)) {
-                                nbr_split_res = nbr_res;
-                                nbr_split_pt = Point2D<double>(nbr_res_p1.x, overlap_center);
-                                break;
-                            }
-                        }
+        _net_num_nodes.assign(_net_to_segs.size(), 0);
+        _net_wire_nodes.assign(_net_to_segs.size(), 0);
+        for (unsigned net = 0; net < net_ids.size(); net++) {
+            _net_num_nodes[net_ids[net]] = cache.NumNodes(net);
+            _net_wire_nodes[net_ids[net]] = cache.NumWireNodes(net);
+        }
 
-                        if (!nbr_split_res) {
-                            double overlap_left = std::max(nbr_rect.ll.y, seg_rect.ll.y);
-                            double overlap_right = std::min(nbr_rect.ur.y, seg_rect.ur.y);
-                            for (Resistor *nbr_res : nbr_ptr->getResistors()) {
-                                Point2D<double> nbr_res_p1 = nbr_res->getP1();
-                                Point2D<double> nbr_res_p2 = nbr_res->getP2();
-
-                                if (nbr_res_p1.x == nbr_res_p2.x &&
-                                    ((overlap_right > std::min(nbr_res_p1.y, nbr_res_p2.y) && overlap_right < std::max(nbr_res_p1.y, nbr_res_p2.y)) ||
-                                    (overlap_left > std::min(nbr_res_p1.y, nbr_res_p2.y) && overlap_left < std::max(nbr_res_p1.y, nbr_res_p2.y)))) {
-                                    
-                                    double sub_overlap_center = (std::max(overlap_left, std::min(nbr_res_p1.y, nbr_res_p2.y)) + std::min(overlap_right, std::max(nbr_res_p1.y, nbr_res_p2.y))) /2;
-
-                                    nbr_split_res = nbr_res;
-                                    nbr_split_pt = Point2D<double>(sub_overlap_center, nbr_res_p1.x);
-                                    break;
-                                }
-                            }
-                        }
+        // as after a generation that extracted nets, so PhyDB matches their pins
+        _changed_nets.assign(_net_to_segs.size(), false);
+        for (unsigned net_id : nets) {
+            _dirty_nets[net_id] = false;
+            _changed_nets[net_id] = true;
+        }
+        _extracted = true;
+        _net_pin_nodes.resize(_net_names.size());
+        _reshaped_nets.assign(_net_to_segs.size(), false);
+        _annotated_corner = cache.AnnotatedCorner();
+        _annotation_stale = false;
+        _unannotated_nets.assign(_net_to_segs.size(), _annotated_corner < 0);
+        buildPartitions();
+        return true;
+    }
 
-                        if (nbr_split_res && seg_split_res) { // not enough overlap otherwise given model
-
-                            std::string seg_split_id = _splitResistorAtPt(seg_split_res, seg_split_pt);
-                            std::string nbr_split_id = _splitResistorAtPt(nbr_split_res, nbr_split_pt);
-                            std::unique_ptr<Capacitor> capacitor(new Capacitor(
-                                seg_split_id,
-                                nbr_split_id,
-                                seg->getLayerName(),
-                                overlap_length,
-                                distance
-                            ));
-                            _capacitor_network.emplace_back(std::move(capacitor));
-                        }
-                    } else {
-                        // std::cout << "NON OVERLAPPING NBR: " << nbr_rect << std::endl;
-                        continue;
-                    }
+    bool Geometry::findPinNode(unsigned net_id, int layer_id, const Rect2D<double> &shape, NodeId &node_id) const {
+        std::vector<WireSegment *> candidates;
+        return findPinNode(net_id, layer_id, shape, node_id, candidates);
+    }
+
+    bool Geometry::findPinNode(unsigned net_id, int layer_id, const Rect2D<double> &shape, NodeId &node_id, std::vector<WireSegment *> &candidates) const {
+        if (net_id >= _net_to_segs.size() || layer_id < 0 || static_cast<size_t>(layer_id) >= _layer_to_partitioned_segs.size()) return false;
 
-                    // std::cout << "SEGMENT #" << seg->getSegmentNumber() << " OF NET '" << seg->getNetName() << "' HAS OVERLAPPING REGION OF LENGTH " << overlap_length << " AT DISTANCE " << distance << " WITH SEGMENT #" << nbr_ptr->getSegmentNumber() << " OF NET '" << nbr_ptr->getNetName() << "'" << std::endl; 
+        // segments of the layer around the shape rather than every segment of the net, clock and power nets have
+        // many; until the partitions are built (or while removed segments linger in them) the net is walked
+        candidates.clear();
+        if (!_segmentsAround(layer_id, shape, candidates)) {
+            for (const ArenaPtr<WireSegment> &seg_ptr : _net_to_segs[net_id]) {
+                candidates.push_back(seg_ptr.get());
+            }
+        }
+        // the net's own segments in the order they were added, as a walk of the net sees them (ties go to the first)
+        candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [net_id, layer_id](const WireSegment *seg_ptr) {
+            return seg_ptr->getNetId() != net_id || seg_ptr->getLayerId() != layer_id;
+        }), candidates.end());
+        std::sort(candidates.begin(), candidates.end(), [](const WireSegment *a, const WireSegment *b) { return a->getGlobalId() < b->getGlobalId(); });
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+        Point2D<double> center((shape.ll.x + shape.ur.x) / 2, (shape.ll.y + shape.ur.y) / 2);
+        bool found = false;
+        bool found_inside = false;
+        double best_distance = std::numeric_limits<double>::max();
+        auto consider = [&](const Point2D<double> &pt, NodeId candidate) {
+            bool inside = pt.x >= shape.ll.x && pt.x <= shape.ur.x && pt.y >= shape.ll.y && pt.y <= shape.ur.y;
+            double distance = std::abs(pt.x - center.x) + std::abs(pt.y - center.y);
+            // a node on the shape beats any node off it
+            if (found_inside && !inside) return;
+            if (found && inside == found_inside && distance >= best_distance) return;
+            found = true;
+            found_inside = inside;
+            best_distance = distance;
+            node_id = candidate;
+        };
+        for (WireSegment *seg_ptr : candidates) {
+            Rect2D<double> rect = seg_ptr->getRect();
+            if (rect.ur.x < shape.ll.x || rect.ll.x > shape.ur.x || rect.ur.y < shape.ll.y || rect.ll.y > shape.ur.y) continue;
+            for (Resistor *res : seg_ptr->getResistors()) {
+                if (res->isVertical()) {
+                    // node1 is the bottom of a via shape, where it lands on the pin
+                    consider(res->getP1(), res->getNodeId1());
+                } else {
+                    consider(res->getP1(), res->getNodeId1());
+                    consider(res->getP2(), res->getNodeId2());
                 }
             }
         }
+        return found;
     }
 
-    std::vector<WireSegment *> Geometry::getOtherNetsNearbySegments(WireSegment *seg_ptr) {
-        if (_layer_to_partitioned_segs.find(seg_ptr->getLayerName()) == _layer_to_partitioned_segs.end()) {
-            std::cout << "PROBLEM PROBLEM WITH LAYER (" << seg_ptr->getLayerName() << ")" << std::endl;
-            exit(1);
+    bool Geometry::_segmentsAround(int layer_id, const Rect2D<double> &rect, std::vector<WireSegment *> &segs) const {
+        // removed segments stay in the index until the next generation purges them
+        if (layer_id < 0 || static_cast<size_t>(layer_id) >= _layer_to_partitioned_segs.size() || !_removed_segs.empty()) return false;
+        if (_spatial_index == SpatialIndexType::RTREE) {
+            const PackedRTree<WireSegment> &layer_tree = _layer_to_rtree_segs[layer_id];
+            if (!layer_tree.isBuilt()) return false;
+            layer_tree.queryWithin(rect, 0.0, segs);
+            return true;
         }
 
-        UniformPartition<WireSegment> &layer_segs = _layer_to_partitioned_segs.at(seg_ptr->getLayerName());
-        std::pair<int, int> ll_partition = layer_segs.getPartitionId(seg_ptr->getRect().ll);
-        std::pair<int, int> ur_partition = layer_segs.getPartitionId(seg_ptr->getRect().ur);
+        const UniformPartition<WireSegment> &layer_segs = _layer_to_partitioned_segs[layer_id];
+        if (!layer_segs.isBuilt()) return false;
+        std::pair<int, int> ll_partition = layer_segs.getPartitionId(rect.ll);
+        std::pair<int, int> ur_partition = layer_segs.getPartitionId(rect.ur);
+        ll_partition.first = std::max(ll_partition.first, layer_segs.getMinPartition().first);
+        ll_partition.second = std::max(ll_partition.second, layer_segs.getMinPartition().second);
+        ur_partition.first = std::min(ur_partition.first, layer_segs.getMaxPartition().first);
+        ur_partition.second = std::min(ur_partition.second, layer_segs.getMaxPartition().second);
+        for (int x_partition = ll_partition.first; x_partition <= ur_partition.first; x_partition++) {
+            for (int y_partition = ll_partition.second; y_partition <= ur_partition.second; y_partition++) {
+                for (WireSegment *seg_ptr : layer_segs.getElementsByPartition(std::pair<int, int>(x_partition, y_partition))) {
+                    segs.push_back(seg_ptr);
+                }
+            }
+        }
+        return true;
+    }
 
-        std::set<WireSegment *> nbr_ptr_set;
+    bool Geometry::_coversFootprint(int layer_id, const Rect2D<double> &footprint, std::vector<WireSegment *> &segs) const {
+        segs.clear();
+        if (!_segmentsAround(layer_id, footprint, segs)) return false;
+
+        // a side of zero length (a point of a wire) is overlapped by the shapes around it
+        auto overlaps = [](double lo, double hi, double footprint_lo, double footprint_hi) {
+            return footprint_lo == footprint_hi ? lo <= footprint_lo && footprint_lo <= hi : lo < footprint_hi && hi > footprint_lo;
+        };
+        segs.erase(std::remove_if(segs.begin(), segs.end(), [&](const WireSegment *seg_ptr) {
+            Rect2D<double> rect = seg_ptr->getRect();
+            return !overlaps(rect.ll.x, rect.ur.x, footprint.ll.x, footprint.ur.x) || !overlaps(rect.ll.y, rect.ur.y, footprint.ll.y, footprint.ur.y);
+        }), segs.end());
+        if (segs.empty()) return false;
+
+        // the shapes' extents along the footprint's longer side, merged where they overlap (segments of several
+        // bins appear more than once)
+        bool along_x = footprint.ur.x - footprint.ll.x >= footprint.ur.y - footprint.ll.y;
+        double run_lo = along_x ? footprint.ll.x : footprint.ll.y;
+        double run_hi = along_x ? footprint.ur.x : footprint.ur.y;
+        if (run_hi <= run_lo) return true;
+        auto lo_of = [along_x, run_lo](const WireSegment *seg_ptr) { return std::max(run_lo, along_x ? seg_ptr->getRect().ll.x : seg_ptr->getRect().ll.y); };
+        auto hi_of = [along_x, run_hi](const WireSegment *seg_ptr) { return std::min(run_hi, along_x ? seg_ptr->getRect().ur.x : seg_ptr->getRect().ur.y); };
+        std::sort(segs.begin(), segs.end(), [&](const WireSegment *a, const WireSegment *b) { return lo_of(a) < lo_of(b); });
+        double covered = 0, covered_hi = run_lo;
+        for (const WireSegment *seg_ptr : segs) {
+            double lo = std::max(lo_of(seg_ptr), covered_hi);
+            double hi = hi_of(seg_ptr);
+            if (hi <= lo) continue;
+            covered += hi - lo;
+            covered_hi = hi;
+        }
+        return 2 * covered >= run_hi - run_lo;
+    }
 
-        for (int x_partition = ll_partition.first - _num_bins_neighborhood; x_partition <= ur_partition.first + _num_bins_neighborhood; x_partition++) {
-            for (int y_partition = ll_partition.second - _num_bins_neighborhood; y_partition <= ur_partition.second + _num_bins_neighborhood; y_partition++) {
-                std::pair<int, int> curr_partition(x_partition, y_partition);
-                std::vector<WireSegment *> segments_of_partition = layer_segs.getElementsByPartition(curr_partition);
-                for (WireSegment *other_seg_ptr : segments_of_partition) {
-                    if (other_seg_ptr->getNetName() != seg_ptr->getNetName()) {
-                        nbr_ptr_set.insert(other_seg_ptr);
+    void Geometry::findLayerContext(const CapacitanceEngine &engine, int layer_id, const Rect2D<double> &footprint, int &under, int &over, std::vector<WireSegment *> &scratch) const {
+        // geometry layer ids are the tech's, cut layers in between have no metal index and are skipped
+        under = -1;
+        over = -1;
+        for (int other_layer = layer_id - 1; other_layer >= 0 && under < 0; other_layer--) {
+            if (engine.MetalIndex(other_layer) >= 0 && _coversFootprint(other_layer, footprint, scratch)) under = engine.MetalIndex(other_layer);
+        }
+        for (int other_layer = layer_id + 1; static_cast<size_t>(other_layer) < _layer_to_partitioned_segs.size() && over < 0; other_layer++) {
+            if (engine.MetalIndex(other_layer) >= 0 && _coversFootprint(other_layer, footprint, scratch)) over = engine.MetalIndex(other_layer);
+        }
+    }
+
+    void Geometry::_markContextChanges(const std::vector<std::pair<int, Rect2D<double>>> &changed_shapes) {
+        // a wire's table depends on the metal above and below it, a coupling's on the metal over its gap, which is
+        // within the neighbour distance of both wires
+        std::vector<WireSegment *> segs;
+        for (const std::pair<int, Rect2D<double>> &shape : changed_shapes) {
+            Rect2D<double> rect(
+                shape.second.ll.x - _neighbour_distance,
+                shape.second.ll.y - _neighbour_distance,
+                shape.second.ur.x + _neighbour_distance,
+                shape.second.ur.y + _neighbour_distance
+            );
+            for (int layer_id = 0; static_cast<size_t>(layer_id) < _layer_to_partitioned_segs.size(); layer_id++) {
+                if (layer_id == shape.first) continue;
+                segs.clear();
+                if (!_segmentsAround(layer_id, rect, segs)) continue;
+                for (WireSegment *seg_ptr : segs) {
+                    if (_unannotated_nets[seg_ptr->getNetId()]) continue;
+                    _unannotated_nets[seg_ptr->getNetId()] = true;
+                    _annotation_stale = true;
+                }
+            }
+        }
+    }
+
+    void Geometry::setPinNodes(unsigned net_id, std::vector<PinNode> pin_nodes) {
+        if (_net_pin_nodes.size() < _net_names.size()) _net_pin_nodes.resize(_net_names.size());
+        _net_pin_nodes[net_id] = std::move(pin_nodes);
+    }
+
+    const std::vector<PinNode> &Geometry::getPinNodes(unsigned net_id) const {
+        static const std::vector<PinNode> no_pin_nodes;
+        if (net_id >= _net_pin_nodes.size()) return no_pin_nodes;
+        return _net_pin_nodes[net_id];
+    }
+
+    void Geometry::annotateCapacitance(const CapacitanceEngine &engine, int corner_index, double distance_microns) {
+        // elements of nets no generation touched since the last annotation already hold this corner's values
+        bool changed_only = corner_index == _annotated_corner;
+        _unannotated_nets.resize(_net_to_segs.size(), true);
+
+        std::vector<Capacitor *> caps;
+        for (ArenaPtr<Capacitor> &cap : _capacitor_network) {
+            if (changed_only && !_unannotated_nets[cap->getNetId1()] && !_unannotated_nets[cap->getNetId2()]) continue;
+            caps.push_back(cap.get());
+        }
+        std::vector<Resistor *> planar_resistors;
+        for (ArenaPtr<Resistor> &res : _resistor_network) {
+            if (changed_only && !_unannotated_nets[res->getNetId()]) continue;
+            if (res->isVertical()) {
+                res->setGroundCapacitance(0);
+                continue;
+            }
+            planar_resistors.push_back(res.get());
+        }
+
+        // the metal below and above each coupling's gap and each wire picks its table
+        buildPartitions();
+        std::vector<std::pair<int, int>> cap_contexts(caps.size(), std::pair<int, int>(-1, -1));
+        std::vector<std::pair<int, int>> res_contexts(planar_resistors.size(), std::pair<int, int>(-1, -1));
+        std::vector<std::vector<WireSegment *>> worker_segs(_num_threads);
+        _parallelFor(caps.size(), [&](size_t i, int worker) {
+            if (engine.MetalIndex(caps[i]->getLayerId()) < 0) return;
+            findLayerContext(engine, caps[i]->getLayerId(), caps[i]->getRegion(), cap_contexts[i].first, cap_contexts[i].second, worker_segs[worker]);
+        });
+        _parallelFor(planar_resistors.size(), [&](size_t i, int worker) {
+            if (engine.MetalIndex(planar_resistors[i]->getLayerId()) < 0) return;
+            findLayerContext(engine, planar_resistors[i]->getLayerId(), planar_resistors[i]->getFootprint(), res_contexts[i].first, res_contexts[i].second, worker_segs[worker]);
+        });
+
+        // capacitors of one layer, wire width and context read the same table, each batch is sorted by distance so
+        // the engine walks the table once instead of searching it per capacitor
+        typedef std::tuple<int, double, int, int> BatchKey; // layer, width, metal below, metal above
+        std::map<BatchKey, std::vector<Capacitor *>> cap_batches;
+        for (size_t i = 0; i < caps.size(); i++) {
+            cap_batches[BatchKey(caps[i]->getLayerId(), caps[i]->getWidth(), cap_contexts[i].first, cap_contexts[i].second)].push_back(caps[i]);
+        }
+        std::vector<double> distances, coupling, fringe;
+        for (std::pair<const BatchKey, std::vector<Capacitor *>> &batch : cap_batches) {
+            std::vector<Capacitor *> &batch_caps = batch.second;
+            std::sort(batch_caps.begin(), batch_caps.end(), [](Capacitor *a, Capacitor *b) { return a->getDistance() < b->getDistance(); });
+            distances.resize(batch_caps.size());
+            coupling.resize(batch_caps.size());
+            fringe.resize(batch_caps.size());
+            for (size_t i = 0; i < batch_caps.size(); i++) {
+                distances[i] = batch_caps[i]->getDistance() / distance_microns;
+            }
+
+            int metal_index = engine.MetalIndex(std::get<0>(batch.first));
+            bool has_table = false;
+            if (metal_index >= 0) {
+                int index0 = -1, index1 = -1;
+                TableType type = engine.ContextTable(metal_index, std::get<2>(batch.first), std::get<3>(batch.first), corner_index, index0, index1);
+                has_table = engine.EvaluateBatch(type, metal_index, index0, index1, corner_index, std::get<1>(batch.first) / distance_microns, batch_caps.size(), distances.data(), coupling.data(), fringe.data());
+            }
+            for (size_t i = 0; i < batch_caps.size(); i++) {
+                batch_caps[i]->setCapacitance(has_table ? coupling[i] * batch_caps[i]->getOverlapLength() / distance_microns : 0);
+            }
+        }
+
+        // an isolated wire's fringe per micron, from the last (farthest) entry of its table
+        std::map<BatchKey, double> unit_ground_caps;
+        for (size_t i = 0; i < planar_resistors.size(); i++) {
+            Resistor *res = planar_resistors[i];
+            BatchKey key(res->getLayerId(), res->getWidth(), res_contexts[i].first, res_contexts[i].second);
+            std::map<BatchKey, double>::iterator it = unit_ground_caps.find(key);
+            if (it == unit_ground_caps.end()) {
+                double unit_coupling = 0, unit_fringe = 0;
+                int metal_index = engine.MetalIndex(res->getLayerId());
+                int index0 = -1, index1 = -1;
+                TableType type = metal_index < 0 ? CAP_OVER : engine.ContextTable(metal_index, res_contexts[i].first, res_contexts[i].second, corner_index, index0, index1);
+                if (metal_index < 0 || !engine.Evaluate(type, metal_index, index0, index1, corner_index, res->getWidth() / distance_microns, std::numeric_limits<double>::infinity(), unit_coupling, unit_fringe)) {
+                    unit_fringe = 0;
+                }
+                it = unit_ground_caps.emplace(key, unit_fringe).first;
+            }
+            res->setGroundCapacitance(it->second * res->getLength() / distance_microns);
+        }
+        _annotated_corner = corner_index;
+        _annotation_stale = false;
+        _unannotated_nets.assign(_net_to_segs.size(), false);
+    }
+
+    std::vector<unsigned> Geometry::_selectNets(const ExtractionScope &scope, bool dirty_only) {
+        auto touches_region = [&scope](const Rect2D<double> &rect) {
+            return rect.ur.x >= scope.region.ll.x && rect.ll.x <= scope.region.ur.x && rect.ur.y >= scope.region.ll.y && rect.ll.y <= scope.region.ur.y;
+        };
+
+        std::vector<unsigned> candidates;
+        bool region_checked = false;
+        if (!scope.nets.empty()) {
+            for (const std::string &net : scope.nets) {
+                int net_id = _net_names.find(net);
+                if (net_id >= 0) candidates.push_back(static_cast<unsigned>(net_id));
+            }
+        } else if (scope.use_region) {
+            // only the bins (or R-tree nodes) under the region are visited
+            buildPartitions();
+            std::vector<WireSegment *> segs;
+            for (size_t layer_id = 0; layer_id < _layer_to_partitioned_segs.size(); layer_id++) {
+                if (_spatial_index == SpatialIndexType::RTREE) {
+                    _layer_to_rtree_segs[layer_id].queryWithin(scope.region, 0.0, segs);
+                    continue;
+                }
+                UniformPartition<WireSegment> &layer_segs = _layer_to_partitioned_segs[layer_id];
+                // a region larger than the die only walks the occupied bins
+                std::pair<int, int> ll_partition = layer_segs.getPartitionId(scope.region.ll);
+                std::pair<int, int> ur_partition = layer_segs.getPartitionId(scope.region.ur);
+                ll_partition.first = std::max(ll_partition.first, layer_segs.getMinPartition().first);
+                ll_partition.second = std::max(ll_partition.second, layer_segs.getMinPartition().second);
+                ur_partition.first = std::min(ur_partition.first, layer_segs.getMaxPartition().first);
+                ur_partition.second = std::min(ur_partition.second, layer_segs.getMaxPartition().second);
+                for (int x_partition = ll_partition.first; x_partition <= ur_partition.first; x_partition++) {
+                    for (int y_partition = ll_partition.second; y_partition <= ur_partition.second; y_partition++) {
+                        for (WireSegment *seg_ptr : layer_segs.getElementsByPartition(std::pair<int, int>(x_partition, y_partition))) {
+                            if (touches_region(seg_ptr->getRect())) segs.push_back(seg_ptr);
+                        }
                     }
                 }
             }
+            for (WireSegment *seg_ptr : segs) {
+                candidates.push_back(seg_ptr->getNetId());
+            }
+            region_checked = true;
+        } else {
+            candidates.resize(_net_to_segs.size());
+            for (unsigned i = 0; i < candidates.size(); i++) {
+                candidates[i] = i;
+            }
         }
-        return std::vector<WireSegment *>(nbr_ptr_set.begin(), nbr_ptr_set.end()); // use set iterator to construct vector
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+        std::vector<unsigned> nets;
+        for (unsigned net_id : candidates) {
+            if (dirty_only && !_dirty_nets[net_id]) continue;
+            if (scope.net_filter && !scope.net_filter(_net_names.getName(net_id))) continue;
+            if (scope.use_region && !region_checked) {
+                bool touches = false;
+                for (const ArenaPtr<WireSegment> &seg_ptr : _net_to_segs[net_id]) {
+                    if (touches_region(seg_ptr->getRect())) {
+                        touches = true;
+                        break;
+                    }
+                }
+                if (!touches) continue;
+            }
+            nets.push_back(net_id);
+        }
+        std::sort(nets.begin(), nets.end(), [this](unsigned a, unsigned b) { return _net_names.getName(a) < _net_names.getName(b); });
+        return nets;
+    }
+
+    void Geometry::_dropDirtyElements(const std::vector<bool> &dropped_nets) {
+        // a coupling to a dirty net split a resistor of the clean net at the capacitor's node, find both halves
+        // (the split keeps the front half with node2 = split node, the back half starts at node1 = split node)
+        std::unordered_map<uint64_t, std::pair<Resistor *, Resistor *>> split_nodes;
+        auto node_key = [](unsigned net_id, NodeId node_id) { return (static_cast<uint64_t>(net_id) << 32) | node_id; };
+        for (ArenaPtr<Capacitor> &cap : _capacitor_network) {
+            bool dirty1 = dropped_nets[cap->getNetId1()], dirty2 = dropped_nets[cap->getNetId2()];
+            if (dirty1 && !dirty2) split_nodes.emplace(node_key(cap->getNetId2(), cap->getNodeId2()), std::pair<Resistor *, Resistor *>(nullptr, nullptr));
+            if (dirty2 && !dirty1) split_nodes.emplace(node_key(cap->getNetId1(), cap->getNodeId1()), std::pair<Resistor *, Resistor *>(nullptr, nullptr));
+        }
+        if (!split_nodes.empty()) {
+            for (ArenaPtr<Resistor> &res : _resistor_network) {
+                if (dropped_nets[res->getNetId()] || res->isVertical()) continue;
+                std::unordered_map<uint64_t, std::pair<Resistor *, Resistor *>>::iterator it = split_nodes.find(node_key(res->getNetId(), res->getNodeId2()));
+                if (it != split_nodes.end()) it->second.first = res.get();
+                it = split_nodes.find(node_key(res->getNetId(), res->getNodeId1()));
+                if (it != split_nodes.end()) it->second.second = res.get();
+            }
+        }
+
+        // join the halves back so clean nets do not collect stale series nodes across re-extractions
+        std::unordered_set<Resistor *> joined;
+        for (std::pair<const uint64_t, std::pair<Resistor *, Resistor *>> &split : split_nodes) {
+            Resistor *front = split.second.first, *back = split.second.second;
+            if (!front || !back) continue;
+            front->setNodeId2(back->getNodeId2());
+            front->setP2(back->getP2());
+            front->setLength(front->getLength() + back->getLength());
+
+            // the back half may itself be the front half of a later split
+            std::unordered_map<uint64_t, std::pair<Resistor *, Resistor *>>::iterator next = split_nodes.find(node_key(back->getNetId(), back->getNodeId2()));
+            if (next != split_nodes.end() && next->second.first == back) next->second.first = front;
+
+            back->getOwnerSegment()->removeResistor(back);
+            joined.insert(back);
+        }
+
+        _resistor_network.erase(std::remove_if(_resistor_network.begin(), _resistor_network.end(), [&](const ArenaPtr<Resistor> &res) {
+            return dropped_nets[res->getNetId()] || joined.count(res.get()) > 0;
+        }), _resistor_network.end());
+        _capacitor_network.erase(std::remove_if(_capacitor_network.begin(), _capacitor_network.end(), [&dropped_nets](const ArenaPtr<Capacitor> &cap) {
+            return dropped_nets[cap->getNetId1()] || dropped_nets[cap->getNetId2()];
+        }), _capacitor_network.end());
+    }
+
+    void Geometry::_resetNet(unsigned net_id) {
+        // undo the trimming done by overlap handling, newest first so each segment ends up with its drawn shape
+        std::vector<TrimmedShape> &trimmed_shapes = _net_trimmed_shapes[net_id];
+        for (std::vector<TrimmedShape>::reverse_iterator it = trimmed_shapes.rbegin(); it != trimmed_shapes.rend(); it++) {
+            it->seg->setShape(it->rect, it->p1, it->p2);
+        }
+        trimmed_shapes.clear();
+
+        for (ArenaPtr<WireSegment> &seg_ptr : _net_to_segs[net_id]) {
+            seg_ptr->clearResistors();
+        }
+        if (net_id < _net_num_nodes.size()) _net_num_nodes[net_id] = 0;
+        if (net_id < _net_wire_nodes.size()) _net_wire_nodes[net_id] = 0;
+    }
+
+    void Geometry::_purgeRemovedSegments() {
+        if (_removed_segs.empty()) return;
+
+        std::vector<std::vector<WireSegment *>> layer_removed_segs(_layer_to_partitioned_segs.size());
+        for (ArenaPtr<WireSegment> &seg_ptr : _removed_segs) {
+            seg_ptr->clearResistors();
+            layer_removed_segs[seg_ptr->getLayerId()].push_back(seg_ptr.get());
+        }
+        for (size_t layer_id = 0; layer_id < layer_removed_segs.size(); layer_id++) {
+            if (layer_removed_segs[layer_id].empty()) continue;
+            _layer_to_partitioned_segs[layer_id].remove(layer_removed_segs[layer_id]);
+            _layer_to_rtree_segs[layer_id].remove(layer_removed_segs[layer_id]);
+        }
+        _removed_segs.clear();
     }
 
     void Geometry::printRCNetwork(std::ostream &stream) {
-        for (std::unique_ptr<Resistor> &res : _resistor_network) {
-            res->print(stream);
+        for (ArenaPtr<Resistor> &res : _resistor_network) {
+            res->print(stream, *this);
         }
 
-        for (std::unique_ptr<Capacitor> &cap : _capacitor_network) {
-            cap->print(stream);
+        for (ArenaPtr<Capacitor> &cap : _capacitor_network) {
+            cap->print(stream, *this);
         }
     }
 
     template<typename T>
-    std::vector<T *> UniformPartition<T>::getElementsByPartition(std::pair<int, int> partition) const {
-        if (_partition_pair_to_segs.find(partition) == _partition_pair_to_segs.end()) {
-            return std::vector<T *>();
+    ElementSpan<T> UniformPartition<T>::getElementsByPartition(std::pair<int, int> partition) const {
+        PhyDBExpects(_built, "UniformPartition queried before build()");
+
+        int x_partition = partition.first;
+        int y_partition = partition.second;
+        if (x_partition < _min_x || x_partition >= _min_x + _num_x || y_partition < _min_y || y_partition >= _min_y + _num_y) {
+            return ElementSpan<T>();
         }
-        return _partition_pair_to_segs.at(partition);
+
+        long key = _binKey(x_partition, y_partition);
+        if (!_bin_keys.empty()) {
+            std::vector<long>::const_iterator it = std::lower_bound(_bin_keys.begin(), _bin_keys.end(), key);
+            if (it == _bin_keys.end() || *it != key) {
+                return ElementSpan<T>();
+            }
+            key = it - _bin_keys.begin();
+        }
+        return ElementSpan<T>(_elements.data() + _offsets[key], _elements.data() + _offsets[key + 1]);
     }
 
     template<typename T>
@@ -1097,14 +2126,193 @@ namespace phydb {
         int bottom_bound_idx = static_cast<int>(elt_rect.ll.y / _partition_size);
         int top_bound_idx = static_cast<int>(elt_rect.ur.y / _partition_size);
 
-        for (int horiz_partition = left_bound_idx; horiz_partition <= right_bound_idx; horiz_partition++) {
-            for (int vert_partition = bottom_bound_idx ; vert_partition <= top_bound_idx; vert_partition++) {
-                std::pair<int, int> partition_pair = { horiz_partition, vert_partition };
-                if (_partition_pair_to_segs.find(partition_pair) == _partition_pair_to_segs.end()) {
-                    _partition_pair_to_segs[partition_pair] = std::vector<T *>();
+        _staged.push_back({ elt, left_bound_idx, right_bound_idx, bottom_bound_idx, top_bound_idx });
+        _num_entries += static_cast<size_t>(right_bound_idx - left_bound_idx + 1) * (top_bound_idx - bottom_bound_idx + 1);
+        _built = false;
+    }
+
+    template<typename T>
+    void UniformPartition<T>::remove(std::vector<T *> elts) {
+        std::sort(elts.begin(), elts.end());
+        size_t num_staged = 0;
+        _num_entries = 0;
+        for (const StagedElement &staged : _staged) {
+            if (std::binary_search(elts.begin(), elts.end(), staged.elt)) continue;
+            _staged[num_staged++] = staged;
+            _num_entries += static_cast<size_t>(staged.right - staged.left + 1) * (staged.top - staged.bottom + 1);
+        }
+        _staged.resize(num_staged);
+        _built = false;
+    }
+
+    template<typename T>
+    void UniformPartition<T>::build() {
+        _offsets.clear();
+        _bin_keys.clear();
+        _elements.clear();
+        _num_x = 0;
+        _num_y = 0;
+        _built = true;
+        if (_staged.empty()) return;
+
+        int max_x = _staged[0].right, max_y = _staged[0].top;
+        _min_x = _staged[0].left;
+        _min_y = _staged[0].bottom;
+        for (const StagedElement &staged : _staged) {
+            _min_x = std::min(_min_x, staged.left);
+            _min_y = std::min(_min_y, staged.bottom);
+            max_x = std::max(max_x, staged.right);
+            max_y = std::max(max_y, staged.top);
+        }
+        _num_x = static_cast<long>(max_x) - _min_x + 1;
+        _num_y = static_cast<long>(max_y) - _min_y + 1;
+        _elements.resize(_num_entries);
+
+        if (static_cast<size_t>(_num_x * _num_y) <= 4 * _num_entries + 1024) {
+            // dense: count entries per bin, prefix sum into offsets, then scatter in insertion order
+            _offsets.assign(_num_x * _num_y + 1, 0);
+            for (const StagedElement &staged : _staged) {
+                for (int horiz_partition = staged.left; horiz_partition <= staged.right; horiz_partition++) {
+                    for (int vert_partition = staged.bottom; vert_partition <= staged.top; vert_partition++) {
+                        _offsets[_binKey(horiz_partition, vert_partition) + 1]++;
+                    }
+                }
+            }
+            for (size_t i = 1; i < _offsets.size(); i++) {
+                _offsets[i] += _offsets[i - 1];
+            }
+
+            std::vector<unsigned long> cursor(_offsets.begin(), _offsets.end() - 1);
+            for (const StagedElement &staged : _staged) {
+                for (int horiz_partition = staged.left; horiz_partition <= staged.right; horiz_partition++) {
+                    for (int vert_partition = staged.bottom; vert_partition <= staged.top; vert_partition++) {
+                        _elements[cursor[_binKey(horiz_partition, vert_partition)]++] = staged.elt;
+                    }
+                }
+            }
+        } else {
+            // sparse: stable sort (bin, element) entries so each bin keeps insertion order
+            std::vector<std::pair<long, T *>> entries;
+            entries.reserve(_num_entries);
+            for (const StagedElement &staged : _staged) {
+                for (int horiz_partition = staged.left; horiz_partition <= staged.right; horiz_partition++) {
+                    for (int vert_partition = staged.bottom; vert_partition <= staged.top; vert_partition++) {
+                        entries.emplace_back(_binKey(horiz_partition, vert_partition), staged.elt);
+                    }
                 }
-                _partition_pair_to_segs.at(partition_pair).push_back(elt);
             }
+            std::stable_sort(entries.begin(), entries.end(), [](const std::pair<long, T *> &a, const std::pair<long, T *> &b) { return a.first < b.first; });
+
+            for (size_t i = 0; i < entries.size(); i++) {
+                if (i == 0 || entries[i].first != entries[i - 1].first) {
+                    _bin_keys.push_back(entries[i].first);
+                    _offsets.push_back(i);
+                }
+                _elements[i] = entries[i].second;
+            }
+            _offsets.push_back(entries.size());
         }
     }
-}
\ No newline at end of file
+
+    template class UniformPartition<WireSegment>;
+
+    template<typename T>
+    void PackedRTree<T>::remove(std::vector<T *> elts) {
+        std::sort(elts.begin(), elts.end());
+        _staged.erase(std::remove_if(_staged.begin(), _staged.end(), [&elts](T *elt) {
+            return std::binary_search(elts.begin(), elts.end(), elt);
+        }), _staged.end());
+        _built = false;
+    }
+
+    template<typename T>
+    void PackedRTree<T>::build() {
+        _entries.clear();
+        _nodes.clear();
+        _root = 0;
+        _built = true;
+        if (_staged.empty()) return;
+
+        _entries.reserve(_staged.size());
+        for (size_t i = 0; i < _staged.size(); i++) {
+            _entries.push_back({ _staged[i]->getRect(), _staged[i], static_cast<unsigned>(i) });
+        }
+
+        // sort-tile-recursive: sort by x center, cut into sqrt(#parents) vertical slices, sort each slice by
+        // y center and pack runs of kNodeCapacity; the same tiling is applied to every level of nodes
+        auto tile = [](auto begin, auto end, auto rect_of) {
+            size_t count = end - begin;
+            size_t num_parents = (count + kNodeCapacity - 1) / kNodeCapacity;
+            size_t num_slices = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(num_parents))));
+            size_t slice_size = num_slices * kNodeCapacity;
+            std::sort(begin, end, [&](const auto &a, const auto &b) { return rect_of(a).ll.x + rect_of(a).ur.x < rect_of(b).ll.x + rect_of(b).ur.x; });
+            for (size_t slice = 0; slice < count; slice += slice_size) {
+                std::sort(begin + slice, begin + std::min(slice + slice_size, count), [&](const auto &a, const auto &b) { return rect_of(a).ll.y + rect_of(a).ur.y < rect_of(b).ll.y + rect_of(b).ur.y; });
+            }
+        };
+        auto enclose = [](Rect2D<double> &box, const Rect2D<double> &rect) {
+            box.ll.x = std::min(box.ll.x, rect.ll.x);
+            box.ll.y = std::min(box.ll.y, rect.ll.y);
+            box.ur.x = std::max(box.ur.x, rect.ur.x);
+            box.ur.y = std::max(box.ur.y, rect.ur.y);
+        };
+
+        tile(_entries.begin(), _entries.end(), [](const Entry &entry) -> const Rect2D<double> & { return entry.rect; });
+        for (size_t first = 0; first < _entries.size(); first += kNodeCapacity) {
+            Node leaf = { _entries[first].rect, static_cast<unsigned>(first), static_cast<unsigned>(std::min<size_t>(kNodeCapacity, _entries.size() - first)), true };
+            for (unsigned i = 1; i < leaf.num_children; i++) enclose(leaf.box, _entries[first + i].rect);
+            _nodes.push_back(leaf);
+        }
+
+        // a level is tiled in place before its parents are packed, nodes carry their child runs along when they move
+        size_t level_begin = 0;
+        while (_nodes.size() - level_begin > 1) {
+            size_t level_end = _nodes.size();
+            tile(_nodes.begin() + level_begin, _nodes.begin() + level_end, [](const Node &node) -> const Rect2D<double> & { return node.box; });
+            for (size_t first = level_begin; first < level_end; first += kNodeCapacity) {
+                Node parent = { _nodes[first].box, static_cast<unsigned>(first), static_cast<unsigned>(std::min<size_t>(kNodeCapacity, level_end - first)), false };
+                for (unsigned i = 1; i < parent.num_children; i++) enclose(parent.box, _nodes[first + i].box);
+                _nodes.push_back(parent);
+            }
+            level_begin = level_end;
+        }
+        _root = static_cast<unsigned>(_nodes.size() - 1);
+    }
+
+    template<typename T>
+    void PackedRTree<T>::queryWithin(Rect2D<double> rect, double max_distance, std::vector<T *> &result) const {
+        PhyDBExpects(_built, "PackedRTree queried before build()");
+        if (_nodes.empty()) return;
+
+        // squared edge to edge distance, 0 when the rectangles touch or overlap
+        auto distance2 = [&rect](const Rect2D<double> &other) {
+            double dx = std::max(0.0, std::max(other.ll.x - rect.ur.x, rect.ll.x - other.ur.x));
+            double dy = std::max(0.0, std::max(other.ll.y - rect.ur.y, rect.ll.y - other.ur.y));
+            return dx * dx + dy * dy;
+        };
+        double max_distance2 = max_distance * max_distance;
+
+        std::vector<std::pair<std::pair<double, unsigned>, T *>> hits;
+        std::vector<unsigned> stack(1, _root);
+        while (!stack.empty()) {
+            const Node &node = _nodes[stack.back()];
+            stack.pop_back();
+            if (distance2(node.box) > max_distance2) continue;
+            for (unsigned i = node.first_child; i < node.first_child + node.num_children; i++) {
+                if (node.is_leaf) {
+                    double d2 = distance2(_entries[i].rect);
+                    if (d2 <= max_distance2) hits.push_back({ { d2, _entries[i].order }, _entries[i].elt });
+                } else {
+                    stack.push_back(i);
+                }
+            }
+        }
+
+        std::sort(hits.begin(), hits.end(), [](const std::pair<std::pair<double, unsigned>, T *> &a, const std::pair<std::pair<double, unsigned>, T *> &b) { return a.first < b.first; });
+        for (const std::pair<std::pair<double, unsigned>, T *> &hit : hits) {
+            result.push_back(hit.second);
+        }
+    }
+
+    template class PackedRTree<WireSegment>;
+}
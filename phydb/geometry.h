@@ -24,7 +24,15 @@
 #define BIN_WIDTH 750
 #define NUM_BINS_NEIGHBORHOOD 2
 
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
 #include "datatype.h"
+#include "phydb/common/arena.h"
 
 namespace phydb {
 
@@ -38,71 +46,137 @@ namespace phydb {
 
     class Geometry;
 
+    class CapacitanceEngine;
+
+    class RCCache;
+
+    typedef uint32_t NodeId; // index of an RC node within its net, printed as net{id}
+
+    // limits Geometry::generateRCNetwork to some of the nets, the criteria that are set must all hold; other nets'
+    // segments next to selected ones still couple to them through the partitions, but they get no network of their
+    // own: the capacitor's node on their side is 0 and writers ground it, until they are extracted themselves
+    struct ExtractionScope {
+        std::vector<std::string> nets; // empty: no restriction by name list
+        std::function<bool(const std::string &)> net_filter; // unset: no restriction by predicate
+        bool use_region = false;
+        Rect2D<double> region; // when use_region, nets with a segment touching this DBU box
+    };
+
+    // RC node of a net where a cell pin or IO pin connects, instance_id is -1 for IO pins as in PhydbPin
+    struct PinNode {
+        int instance_id;
+        int pin_id;
+        NodeId node_id;
+    };
+
+    // interned names, ids are dense and handed out in the order names are first seen
+    class NameTable {
+        public:
+            int intern(const std::string &name);
+            int find(const std::string &name) const; // -1 if never interned
+            const std::string &getName(int id) const { return _names[id]; }
+            size_t size() const { return _names.size(); }
+
+        private:
+            std::unordered_map<std::string, int> _name_to_id;
+            std::vector<std::string> _names;
+    };
+
     class Resistor {
         public:
-            std::string getNodeId1() const { return _node_id1; }
-            void setNodeId1(std::string node_id1) { _node_id1 = node_id1; }
+            NodeId getNodeId1() const { return _node_id1; }
+            void setNodeId1(NodeId node_id1) { _node_id1 = node_id1; }
 
-            std::string getNodeId2() const { return _node_id2; }
-            void setNodeId2(std::string node_id2) { _node_id2 = node_id2; }
+            NodeId getNodeId2() const { return _node_id2; }
+            void setNodeId2(NodeId node_id2) { _node_id2 = node_id2; }
 
+            unsigned getNetId() const { return _net_id; }
             std::string getNetName();
 
-            std::string getMaterial() const { return _material; }
+            int getLayerId() const { return _layer_id; }
             double getLength() const { return _length; }
             void setLength(double l) { _length = l; }
 
             double getWidth() const { return _width; }
             double getArea() const { return _area; }
 
+            // wire capacitance to ground in fF, -1 until Geometry::annotateCapacitance
+            double getGroundCapacitance() const { return _ground_capacitance; }
+            void setGroundCapacitance(double c) { _ground_capacitance = c; }
+
             Point2D<double> getP1() const { return _p1; }
-            void setP1(Point2D<double> pt) { _p1 = pt; }
+            void setP1(Point2D<double> pt); // keeps the owner's endpoint lookup in step
             Point2D<double> getP2() const { return _p2; }
-            void setP2(Point2D<double> pt) { _p2 = pt; }
+            void setP2(Point2D<double> pt);
+            Rect2D<double> getFootprint() const; // the wire of a planar resistor, its centerline widened to its width
 
             WireSegment *getOwnerSegment() { return _owner_segment; }
-            void setOwnerSegment(WireSegment *seg);
+            void setOwnerSegment(WireSegment *seg); // O(1) move between owners, does not keep the old owner's order
 
-            Resistor(std::string node_id1, std::string node_id2, std::string material, double length = -1, double width = -1, double area = -1, Point2D<double> p1 = Point2D<double>(), Point2D<double> p2 = Point2D<double>(), WireSegment *owner_segment = nullptr);
+            Resistor(unsigned net_id, NodeId node_id1, NodeId node_id2, int layer_id, double length = -1, double width = -1, double area = -1, Point2D<double> p1 = Point2D<double>(), Point2D<double> p2 = Point2D<double>(), WireSegment *owner_segment = nullptr);
 
-            void print(std::ostream &s);
+            void print(std::ostream &s, const Geometry &geometry);
 
-            bool isVertical() { return _area > 0; }
+            bool isVertical() const { return _area > 0; }
 
         private:
-            std::string _node_id1;
-            std::string _node_id2;
-            std::string _material;
+            unsigned _net_id; // both nodes of a resistor belong to the same net
+            NodeId _node_id1;
+            NodeId _node_id2;
+            int _layer_id;
             double _length;
             double _width;
             double _area;
+            double _ground_capacitance;
             Point2D<double> _p1;
             Point2D<double> _p2;
             WireSegment *_owner_segment;
+            uint32_t _owner_slot; // position in the owner's resistor list
+
+            friend class WireSegment;
     };
 
     class Capacitor {
         public:
-            std::string getNodeId1() const { return _node_id1; }
-            std::string getNodeId2() const { return _node_id2; }
-            std::string getMaterial() const { return _material; }
+            unsigned getNetId1() const { return _net_id1; }
+            NodeId getNodeId1() const { return _node_id1; }
+            unsigned getNetId2() const { return _net_id2; }
+            NodeId getNodeId2() const { return _node_id2; }
+            int getLayerId() const { return _layer_id; }
             double getOverlapLength() const { return _overlap_length; }
             double getDistance() const { return _distance; }
-            void print(std::ostream &s);
+            double getWidth() const { return _width; }
+            Rect2D<double> getRegion() const { return _region; }
+
+            // coupling capacitance in fF, -1 until Geometry::annotateCapacitance
+            double getCapacitance() const { return _capacitance; }
+            void setCapacitance(double c) { _capacitance = c; }
+
+            void print(std::ostream &s, const Geometry &geometry);
 
-            Capacitor(std::string node_id1, std::string node_id2, std::string material, double overlap_length, double distance) :
+            Capacitor(unsigned net_id1, NodeId node_id1, unsigned net_id2, NodeId node_id2, int layer_id, double overlap_length, double distance, double width = -1, Rect2D<double> region = Rect2D<double>()) :
+                _net_id1(net_id1),
                 _node_id1(node_id1),
+                _net_id2(net_id2),
                 _node_id2(node_id2),
-                _material(material),
+                _layer_id(layer_id),
                 _overlap_length(overlap_length),
-                _distance(distance) {}
+                _distance(distance),
+                _width(width),
+                _region(region),
+                _capacitance(-1) {}
 
         private:
-            std::string _node_id1;
-            std::string _node_id2;
-            std::string _material;
+            unsigned _net_id1;
+            NodeId _node_id1;
+            unsigned _net_id2;
+            NodeId _node_id2;
+            int _layer_id;
             double _overlap_length;
             double _distance;
+            double _width; // of the wire on the first net's side
+            Rect2D<double> _region; // the gap between the two wires along their overlap
+            double _capacitance;
 
 
     };
@@ -112,119 +186,420 @@ namespace phydb {
             Rect2D<double> getRect() const { return _rect; }
             void setRectLL(Point2D<double> ll) { _rect.ll = ll; }
             void setRectUR(Point2D<double> ur) { _rect.ur = ur; }
-            std::string getNetName() const { return _net_name; }
-            std::string getLayerName() const { return _layer_name; }
+            unsigned getNetId() const { return _net_id; }
+            int getLayerId() const { return _layer_id; }
+            const std::string &getNetName() const; // looked up in the owning Geometry's name tables
+            const std::string &getLayerName() const;
             int getSegmentNumber() const { return _seg_num; }
+            uint32_t getGlobalId() const { return _global_id; }
+            void setGlobalId(uint32_t global_id) { _global_id = global_id; }
+
+            void setGeometry(const Geometry *geometry) { _geometry = geometry; }
 
             void addHorizontalConnection(WireSegment *seg_ptr) { _horizontal_connections.emplace_back(seg_ptr); }
             void addVerticalConnection(WireSegment *seg_ptr) { _vertical_connections.emplace_back(seg_ptr); }
-            void addResistor(Resistor *res) { _resistors.emplace_back(res); }
+            void addResistor(Resistor *res);
+            void removeResistor(Resistor *res); // swaps the last resistor into res's place
+            void clearResistors();
 
             std::vector<WireSegment *> &getHorizontalConnections() { return _horizontal_connections; }
             std::vector<WireSegment *> &getVerticalConnections() { return _vertical_connections; }
-            std::vector<Resistor *> &getResistors() { return _resistors; }
-            Resistor *getResistorByPoints(Point2D<double> p1, Point2D<double> p2);
+            const std::vector<Resistor *> &getResistors() const { return _resistors; }
+            Resistor *getResistorByPoints(Point2D<double> p1, Point2D<double> p2); // either orientation, nullptr if none
 
             Point2D<double> getP1() { return _p1; }
             Point2D<double> getP2() { return _p2; }
             void setP1(Point2D<double> p1) { _p1 = p1; }
             void setP2(Point2D<double> p2) { _p1 = p2; }
+            void setShape(Rect2D<double> rect, Point2D<double> p1, Point2D<double> p2) { _rect = rect; _p1 = p1; _p2 = p2; }
 
             bool hasVerticalConnections() { return _vertical_connections.size() > 0; }
             
 
-            WireSegment(Rect2D<double> rect, std::string net_name, std::string layer_name, int seg_num, Point2D<double> p1 = Point2D<double>(), Point2D<double> p2 = Point2D<double>()) :
+            // net and layer ids come from Geometry::internNet/internLayer
+            WireSegment(Rect2D<double> rect, unsigned net_id, int layer_id, int seg_num, Point2D<double> p1 = Point2D<double>(), Point2D<double> p2 = Point2D<double>()) :
                 _rect(rect),
-                _net_name(net_name),
-                _layer_name(layer_name),
+                _net_id(net_id),
+                _layer_id(layer_id),
+                _geometry(nullptr),
                 _seg_num(seg_num),
+                _global_id(0),
                 _horizontal_connections(std::vector<WireSegment *>()),
                 _vertical_connections(std::vector<WireSegment *>()),
                 _p1(p1),
                 _p2(p2),
                 _resistors(std::vector<Resistor *>()) {}
 
-            WireSegment(const WireSegment &w) = default;
+            // the endpoint index is not copied, the copy builds its own when it needs one
+            WireSegment(const WireSegment &w) :
+                _rect(w._rect),
+                _net_id(w._net_id),
+                _layer_id(w._layer_id),
+                _geometry(w._geometry),
+                _seg_num(w._seg_num),
+                _global_id(w._global_id),
+                _horizontal_connections(w._horizontal_connections),
+                _vertical_connections(w._vertical_connections),
+                _p1(w._p1),
+                _p2(w._p2),
+                _resistors(w._resistors) {}
 
 
 
         private:
             Rect2D<double> _rect; // rectangle defining shape of wire segment
-            std::string _net_name; // name of net wire segment is part of
-            std::string _layer_name; // name of layer wire segment is on
+            unsigned _net_id; // id of net wire segment is part of
+            int _layer_id; // id of layer wire segment is on
+            const Geometry *_geometry; // owner of the name tables, set when the segment is added
             int _seg_num; // unique integer identifier of segment within net, sequentially numbered
+            uint32_t _global_id; // unique across the Geometry, assigned in the order segments are added
             std::vector<WireSegment *> _horizontal_connections; // side to side rectangle connections, from partitioned wire segs
             std::vector<WireSegment *> _vertical_connections; // inter-layer/vertical connections from vias
             Point2D<double> _p1; // coordinates for resistance generation
             Point2D<double> _p2;
             std::vector<Resistor *> _resistors;
 
+            // endpoint -> resistors touching it, built once a segment has been split into more resistors than are
+            // worth scanning and kept up to date from then on
+            static constexpr size_t kResistorIndexThreshold = 16;
+            struct EndpointHash {
+                size_t operator()(const std::pair<double, double> &pt) const;
+            };
+            typedef std::unordered_multimap<std::pair<double, double>, Resistor *, EndpointHash> ResistorIndex;
+            std::unique_ptr<ResistorIndex> _resistor_index;
+
+            void _indexResistor(Resistor *res);
+            void _unindexResistor(Resistor *res);
+            void _moveResistorEndpoint(Resistor *res, Point2D<double> old_pt, Point2D<double> new_pt);
+
+            friend class Resistor;
+    };
+
+    // non-owning view over a contiguous run of element pointers
+    template<typename T>
+    class ElementSpan {
+        public:
+            ElementSpan() : _begin(nullptr), _end(nullptr) {}
+            ElementSpan(T *const *begin, T *const *end) : _begin(begin), _end(end) {}
+
+            T *const *begin() const { return _begin; }
+            T *const *end() const { return _end; }
+            size_t size() const { return static_cast<size_t>(_end - _begin); }
+            bool empty() const { return _begin == _end; }
+            T *operator[](size_t i) const { return _begin[i]; }
+
+        private:
+            T *const *_begin;
+            T *const *_end;
     };
 
     // type T must have getRect member functoin that returns Rect2D<double>
+    // elements are staged by add() and packed into a CSR bin store (offsets + element array) by build(),
+    // bins are laid out densely over the occupied bin range unless that would be much larger than the
+    // number of element entries, in which case only the occupied bins are stored (sorted by bin key)
     template<typename T>
     class UniformPartition {
         public:
             UniformPartition(double partition_size) :
-                _partition_pair_to_segs(std::map<std::pair<int, int>, std::vector<T *>>()),
-                _partition_size(partition_size) { }
+                _partition_size(partition_size),
+                _built(false),
+                _num_entries(0),
+                _min_x(0),
+                _min_y(0),
+                _num_x(0),
+                _num_y(0) { }
 
             void add(T *elt);
+            void remove(std::vector<T *> elts); // drops every staged entry of the given elements
+            void build();
+            bool isBuilt() const { return _built; }
             std::pair<int, int> getPartitionId(Point2D<double> pt) const { return std::pair<int, int>(static_cast<int>(pt.x / _partition_size), static_cast<int>(pt.y / _partition_size)); }
-            std::vector<T *> getElementsByPartition(std::pair<int, int> partition) const;
+            ElementSpan<T> getElementsByPartition(std::pair<int, int> partition) const;
+            // corners of the occupied bin range, bins outside it are empty
+            std::pair<int, int> getMinPartition() const { return std::pair<int, int>(_min_x, _min_y); }
+            std::pair<int, int> getMaxPartition() const { return std::pair<int, int>(static_cast<int>(_min_x + _num_x - 1), static_cast<int>(_min_y + _num_y - 1)); }
 
         private:
-            std::map<std::pair<int, int>, std::vector<T *>> _partition_pair_to_segs;
+            struct StagedElement {
+                T *elt;
+                int left;
+                int right;
+                int bottom;
+                int top;
+            };
+
             double _partition_size;
+            bool _built;
+            size_t _num_entries; // total number of (bin, element) entries
+            std::vector<StagedElement> _staged; // elements with the bin range computed when they were added
+            int _min_x; // occupied bin range
+            int _min_y;
+            long _num_x;
+            long _num_y;
+            std::vector<unsigned long> _offsets; // CSR row offsets, one per bin (+1)
+            std::vector<long> _bin_keys; // occupied bin keys when sparse, empty when dense
+            std::vector<T *> _elements; // packed elements, bin by bin
+
+            long _binKey(int x, int y) const { return static_cast<long>(x - _min_x) * _num_y + (y - _min_y); }
+    };
+
+    // type T must have getRect member function that returns Rect2D<double>
+    // elements are staged by add() and bulk loaded by build() into a Sort-Tile-Recursive packed R-tree, nodes of
+    // one level are contiguous so a node's children are a run of indices; each element is stored exactly once
+    template<typename T>
+    class PackedRTree {
+        public:
+            static const unsigned kNodeCapacity = 16;
+
+            PackedRTree() : _built(false), _root(0) { }
 
+            void add(T *elt) { _staged.push_back(elt); _built = false; }
+            void remove(std::vector<T *> elts); // drops the given elements
+            void build();
+            bool isBuilt() const { return _built; }
+            size_t size() const { return _staged.size(); }
+
+            // appends every element whose rect lies within max_distance (euclidean, edge to edge) of rect, nearest
+            // first, ties in the order the elements were added
+            void queryWithin(Rect2D<double> rect, double max_distance, std::vector<T *> &result) const;
+
+        private:
+            struct Node {
+                Rect2D<double> box;
+                unsigned first_child; // into _nodes, or into _entries for leaves
+                unsigned num_children;
+                bool is_leaf;
+            };
+
+            struct Entry {
+                Rect2D<double> rect;
+                T *elt;
+                unsigned order; // position in _staged, breaks distance ties
+            };
+
+            bool _built;
+            std::vector<T *> _staged;
+            std::vector<Entry> _entries; // leaf entries in packed order
+            std::vector<Node> _nodes; // leaves first, root last
+            unsigned _root;
+    };
+
+    // pairs (i < j) of rects on the same layer that intersect, touching included, sorted; a sweep along x keeps the
+    // rects it crosses ordered on their bottom edge, so only those overlapping in y are visited: O(n log n + k log n)
+    // for k pairs however many wires share an x range
+    std::vector<std::pair<unsigned long, unsigned long>> findOverlappingRectPairs(const std::vector<Rect2D<double>> &rects, const std::vector<int> &layer_ids);
+
+    enum class SpatialIndexType {
+        UNIFORM_GRID = 0, // fixed bins of the partition size, candidates from a fixed number of surrounding bins
+        RTREE = 1 // packed R-tree per layer, candidates within the neighbour distance
     };
 
     class Geometry {
         public:
             Geometry(double default_partition_size = BIN_WIDTH, int num_bins_neighborhood = NUM_BINS_NEIGHBORHOOD) :
-                _net_to_segs(std::map<std::string, std::vector<std::unique_ptr<WireSegment>>>()),
-                _layer_to_partitioned_segs(std::map<std::string, UniformPartition<WireSegment>>()),
+                _use_arena(false),
+                _use_huge_pages(false),
                 _default_partition_size(default_partition_size),
                 _num_bins_neighborhood(num_bins_neighborhood),
-                _net_to_num_nodes(std::map<std::string, unsigned long>()),
-                _resistor_network(std::vector<std::unique_ptr<Resistor>>()),
-                _capacitor_network(std::vector<std::unique_ptr<Capacitor>>())
+                _resistor_network(std::vector<ArenaPtr<Resistor>>()),
+                _capacitor_network(std::vector<ArenaPtr<Capacitor>>()),
+                _next_segment_id(0),
+                _num_threads(1),
+                _spatial_index(SpatialIndexType::UNIFORM_GRID),
+                _neighbour_distance(default_partition_size * num_bins_neighborhood),
+                _annotated_corner(-1),
+                _annotation_stale(false),
+                _check_connectivity(true),
+                _extracted(false)
                 {}
 
-            WireSegment *addSegmentToNet(std::string net,  WireSegment &seg);
-            WireSegment *addSegmentToLayer(std::string layer, WireSegment *seg_ptr);
+            WireSegment *addSegmentToNet(unsigned net_id, WireSegment &seg);
+            WireSegment *addSegmentToLayer(int layer_id, WireSegment *seg_ptr);
 
-            WireSegment *addWireSegment(WireSegment &seg) { return addSegmentToLayer(seg.getLayerName(), addSegmentToNet(seg.getNetName(), seg)); }
+            WireSegment *addWireSegment(WireSegment &seg) { return addSegmentToLayer(seg.getLayerId(), addSegmentToNet(seg.getNetId(), seg)); }
 
-            std::vector<std::unique_ptr<WireSegment>> &getSegmentsOfNet(std::string net);
+            std::vector<ArenaPtr<WireSegment>> &getSegmentsOfNet(std::string net);
 
+            // segments of other nets on the same layer; with the R-tree they come nearest first, the grid returns
+            // everything in the surrounding bins in global id order
             std::vector<WireSegment *> getOtherNetsNearbySegments(WireSegment *seg_ptr);
-
-            std::string generateNodeID(std::string net);
-
-            void generateAndPrintResistors(std::ostream &s) { _populateResistorNetwork(); printRCNetwork(s); }
-
-            void generateRCNetwork() { _populateResistorNetwork(); _populateCapacitanceNetwork(); }
+            void getOtherNetsNearbySegments(WireSegment *seg_ptr, std::vector<WireSegment *> &nbr_ptrs); // appends, nbr_ptrs can be reused across calls
+
+            void setSpatialIndex(SpatialIndexType type) { _spatial_index = type; }
+            SpatialIndexType getSpatialIndex() const { return _spatial_index; }
+            void setNeighbourDistance(double distance) { _neighbour_distance = distance; } // R-tree query bound
+            double getNeighbourDistance() const { return _neighbour_distance; }
+
+            NodeId generateNodeID(unsigned net_id);
+
+            // nets and layers are numbered in the order they are interned, PhyDB interns them as they are added to
+            // Design/Tech so layer ids match Tech's layer ids
+            unsigned internNet(const std::string &net);
+            int internLayer(const std::string &layer);
+            unsigned getNetId(const std::string &net) const;
+            const std::string &getNetName(unsigned net_id) const { return _net_names.getName(net_id); }
+            int getLayerId(const std::string &layer) const;
+            const std::string &getLayerName(int layer_id) const { return _layer_names.getName(layer_id); }
+            std::string getNodeName(unsigned net_id, NodeId node_id) const; // textual node name, only built for output
+
+            void generateAndPrintResistors(std::ostream &s) { clearRCNetwork(); _populateResistorNetwork(_netsInNameOrder()); printRCNetwork(s); clearRCNetwork(); }
+
+            // the first call extracts every net, later calls only re-extract nets whose segments were added or removed
+            // since the previous call and patch their resistors and capacitors into the network; couplings to clean
+            // neighbours (found through the partitions) are rebuilt, the neighbours themselves are not re-extracted;
+            // the network is that of a full extraction but for node numbering
+            void generateRCNetwork() { generateRCNetwork(ExtractionScope()); }
+            // same, restricted to the selected nets; with a name list or region the cost follows the selection
+            // rather than the design (a predicate alone is asked about every net), nets left out stay dirty
+            void generateRCNetwork(const ExtractionScope &scope);
+
+            void removeSegmentsOfNet(const std::string &net); // e.g. before adding a rerouted net's new segments
+
+            // worker threads used by generateRCNetwork, output is identical for any thread count
+            void setNumThreads(int num_threads) { _num_threads = num_threads > 0 ? num_threads : 1; }
+            int getNumThreads() const { return _num_threads; }
+
+            // allocate segments, resistors and capacitors from bump arenas owned by Geometry instead of one heap
+            // allocation each; addresses stay stable and network memory is handed back in bulk by clearRCNetwork(),
+            // set before segments are added (huge pages only apply to arenas created after the call)
+            void setArenaStorage(bool use_arena, bool use_huge_pages = false);
+            bool isArenaStorage() const { return _use_arena; }
+
+            void clearRCNetwork(); // drops every resistor and capacitor and restores segment shapes, next generation is a full one
 
             void printRCNetwork(std::ostream &stream);
 
+            // attaches fF values to every capacitor and planar resistor of the network for one corner, couplings from
+            // the engine's table for the metal layers found below and above the pair's gap (see findLayerContext),
+            // ground capacitance from the fringe at the largest distance of the table for the wire's own context;
+            // coordinates are converted with distance_microns DBU per micron. When the network was last annotated for
+            // the same corner only the elements of nets changed by generations since then are evaluated again
+            void annotateCapacitance(const CapacitanceEngine &engine, int corner_index, double distance_microns);
+            int getAnnotatedCorner() const { return _annotation_stale ? -1 : _annotated_corner; } // -1 if the current network is not annotated
+            void invalidateAnnotation() { _annotated_corner = -1; } // the engine's tables changed, the next annotation evaluates every element
+            // metal indices of the nearest routing layers below and above footprint on layer_id whose wires cover at
+            // least half of its longer side, -1 for none (the substrate below); picks the engine's table through
+            // CapacitanceEngine::ContextTable. Needs the partitions built, safe to call from several threads
+            void findLayerContext(const CapacitanceEngine &engine, int layer_id, const Rect2D<double> &footprint, int &under, int &over, std::vector<WireSegment *> &scratch) const;
+
+            // read-only views of the extracted network for writers, resistors of a net are not necessarily contiguous
+            const std::vector<ArenaPtr<Resistor>> &getResistorNetwork() const { return _resistor_network; }
+            const std::vector<ArenaPtr<Capacitor>> &getCapacitorNetwork() const { return _capacitor_network; }
+            size_t getNumNets() const { return _net_names.size(); }
+            size_t getNumLayers() const { return _layer_names.size(); }
+            const std::vector<ArenaPtr<WireSegment>> &getNetSegments(unsigned net_id) const { return _net_to_segs[net_id]; }
+            NodeId getNumNodes(unsigned net_id) const { return net_id < _net_num_nodes.size() ? _net_num_nodes[net_id] : 0; }
+            NodeId getNumWireNodes(unsigned net_id) const { return net_id < _net_wire_nodes.size() ? _net_wire_nodes[net_id] : 0; }
+            std::vector<unsigned> getNetsInScope(const ExtractionScope &scope) { return _selectNets(scope, false); } // extracted or not, in name order
+            std::vector<unsigned> getExtractedNets() const; // nets with an up to date network, in name order
+
+            // replaces the network with the one saved in a cache whose segments are those loaded here, nets are the
+            // ones the cache was extracted for and become clean; next generations patch it as if it had been extracted
+            // here. False, with the network left cleared, if the cache does not match the segments
+            bool loadRCNetwork(const RCCache &cache, const std::vector<unsigned> &nets);
+
+            // node of a net closest to the center of a pin shape, among the net's segments on layer_id overlapping
+            // the shape (a via's landing picks its bottom node); false if no segment of the net touches the shape.
+            // Candidates come from the layer's partitions once they are built, safe to call from several threads
+            bool findPinNode(unsigned net_id, int layer_id, const Rect2D<double> &shape, NodeId &node_id) const;
+            bool findPinNode(unsigned net_id, int layer_id, const Rect2D<double> &shape, NodeId &node_id, std::vector<WireSegment *> &candidates) const; // candidates is scratch, reused across calls
+            // pin nodes are filled in by PhyDB after each generation, every generation forgets those of the nets it
+            // changed
+            void setPinNodes(unsigned net_id, std::vector<PinNode> pin_nodes);
+            const std::vector<PinNode> &getPinNodes(unsigned net_id) const;
+            // the last generation re-extracted the net, or split or rejoined its resistors through couplings, so its
+            // node ids are not those of the generation before
+            bool hasNetChanged(unsigned net_id) const { return net_id < _changed_nets.size() && _changed_nets[net_id]; }
+
+            // every generation checks that each extracted net's shapes form one piece, joined through path
+            // continuations, vias and shapes touching on a layer (pin shapes are not looked at); nets that fall
+            // apart are reported with the bounding box of each piece, on by default
+            void setConnectivityCheck(bool enabled) { _check_connectivity = enabled; }
+            bool isConnectivityCheck() const { return _check_connectivity; }
+            std::vector<unsigned> getOpenNets() const; // nets found in more than one piece, in id order
+            const std::vector<Rect2D<double>> &getNetPieces(unsigned net_id) const; // empty unless the net is open
+
+            void buildPartitions(); // pack every layer's bins (or R-tree), called once all segments are loaded
+
         private:
-            std::map<std::string, std::vector<std::unique_ptr<WireSegment>>> _net_to_segs;
-            std::map<std::string, UniformPartition<WireSegment>> _layer_to_partitioned_segs;
+            // declared ahead of the containers below so arena memory outlives the objects placed in it
+            bool _use_arena;
+            bool _use_huge_pages;
+            std::unique_ptr<Arena> _segment_arena;
+            std::vector<std::unique_ptr<Arena>> _network_arenas; // one per worker thread
+
+            std::vector<std::vector<ArenaPtr<WireSegment>>> _net_to_segs; // indexed by net id
+            std::vector<UniformPartition<WireSegment>> _layer_to_partitioned_segs; // indexed by layer id
+            std::vector<PackedRTree<WireSegment>> _layer_to_rtree_segs; // indexed by layer id
             double _default_partition_size;
             double _num_bins_neighborhood;
-            std::map<std::string, unsigned long> _net_to_num_nodes; // for node id generation (format net{nodenum})
-            std::vector<std::unique_ptr<Resistor>> _resistor_network;
-            std::vector<std::unique_ptr<Capacitor>> _capacitor_network;
+            NameTable _net_names;
+            NameTable _layer_names;
+            std::vector<NodeId> _net_num_nodes; // next node id of each net
+            std::vector<NodeId> _net_wire_nodes; // nodes of each net made before couplings, the later ones are coupling splits
+            std::vector<ArenaPtr<Resistor>> _resistor_network;
+            std::vector<ArenaPtr<Capacitor>> _capacitor_network;
+            uint32_t _next_segment_id;
+            int _num_threads;
+            SpatialIndexType _spatial_index;
+            double _neighbour_distance;
+            int _annotated_corner; // of the last annotation
+            bool _annotation_stale; // generations since the last annotation changed some nets
+            std::vector<std::vector<PinNode>> _net_pin_nodes; // indexed by net id
+            bool _check_connectivity;
+            std::vector<std::vector<Rect2D<double>>> _net_open_pieces; // bounding box of each piece of an open net, by net id
+
+            // incremental extraction state
+            struct TrimmedShape {
+                WireSegment *seg;
+                Rect2D<double> rect;
+                Point2D<double> p1;
+                Point2D<double> p2;
+            };
+            bool _extracted; // a network exists, generateRCNetwork patches it instead of starting over
+            std::vector<bool> _dirty_nets; // nets whose segments changed since they were last extracted
+            std::vector<bool> _reshaped_nets; // nets given segments since the last generation
+            std::vector<bool> _changed_nets; // nets whose nodes the last generation changed
+            std::vector<bool> _unannotated_nets; // nets changed since the last annotation, or near shapes that changed on other layers
+            std::vector<std::vector<TrimmedShape>> _net_trimmed_shapes; // shapes of segments before overlap handling trimmed them
+            std::vector<ArenaPtr<WireSegment>> _removed_segs; // freed once their resistors are dropped
+
+            // scratch of _findCouplingSplit, couplings are made serially
+            struct SplitPiece {
+                double across; // coordinate of the resistor's line
+                double lo;
+                double hi;
+                bool split_at_lo; // the resistor starts at a coupling split, it continues the run before it
+                Resistor *res;
+            };
+            std::vector<SplitPiece> _split_pieces;
+
+            void _resetNet(unsigned net_id); // restores drawn shapes and forgets the net's resistors, node ids restart at 0
+            void _dropDirtyElements(const std::vector<bool> &dropped_nets); // removes those nets' resistors and capacitors, rejoins the others' resistors they split
+            std::vector<unsigned> _selectNets(const ExtractionScope &scope, bool dirty_only = true); // (dirty) nets in scope, in name order
+            void _purgeRemovedSegments();
+            void _markContextChanges(const std::vector<std::pair<int, Rect2D<double>>> &changed_shapes); // nets with wires over or under the shapes need annotating again
+            bool _segmentsAround(int layer_id, const Rect2D<double> &rect, std::vector<WireSegment *> &segs) const; // appends candidates touching rect from the layer's index, false if it cannot be used
+            bool _coversFootprint(int layer_id, const Rect2D<double> &footprint, std::vector<WireSegment *> &segs) const;
 
             //resistor/capacitor generation helper functions
-            void _populateResistorNetwork();
-            void _populateCapacitanceNetwork();
+            void _populateResistorNetwork(const std::vector<unsigned> &nets);
+            void _populateCapacitanceNetwork(const std::vector<unsigned> &nets); // dirty nets outside nets only couple, see ExtractionScope
+            void _parallelFor(size_t count, const std::function<void(size_t, int)> &body); // runs body(0..count-1, worker) on _num_threads threads
+            void _runNetStage(const std::vector<unsigned> &nets, const std::function<void(unsigned, std::vector<ArenaPtr<WireSegment>> &, std::vector<ArenaPtr<Resistor>> &, Arena *)> &stage); // per-net stage, new resistors merged in net order
+            std::vector<unsigned> _netsInNameOrder() const; // network is emitted net by net in name order
+            Arena *_networkArena(int worker); // arena for resistors/capacitors made by a worker, nullptr when arena storage is off
             // void _handleContains(WireSegment *super_seg, WireSegment *sub_seg); // helper function to handle total segment containment
             void _connectOverlappingViaSegments(WireSegment *seg1, WireSegment *seg2); // helper function to handle via segment overlap with planar segment
-            void _connectOverlappingPlanarSegs(WireSegment *seg1, WireSegment *seg2);
-
-            std::string _splitResistorAtPt(Resistor *res, Point2D<double> sub_seg_pt); // handles splitting resistor, returns new node id
+            void _connectOverlappingPlanarSegs(WireSegment *seg1, WireSegment *seg2, std::vector<ArenaPtr<Resistor>> &resistors, Arena *arena, std::vector<TrimmedShape> &trimmed_shapes);
+            bool _ownsCoupling(WireSegment *seg, WireSegment *nbr_ptr); // which side of a neighbouring pair creates the capacitor
+            void _coupleSegments(WireSegment *seg, WireSegment *nbr_ptr, Arena *arena, bool nbr_extracted = true); // splits both segments' resistors (only seg's when the neighbour has no network) and adds the coupling capacitor
+            Resistor *_findCouplingSplit(ElementSpan<Resistor> resistors, bool horizontal, double overlap_lo, double overlap_hi, Point2D<double> &split_pt); // resistor and point a coupling splits on one side, nullptr if the overlap misses the side's wires
+            std::vector<std::pair<unsigned long, unsigned long>> _findOverlappingSegPairs(std::vector<ArenaPtr<WireSegment>> &segs); // same-layer pairs (i < j) whose rects intersect, sorted
+            void _checkConnectivity(unsigned net_id, std::vector<ArenaPtr<WireSegment>> &segs, const std::vector<std::pair<unsigned long, unsigned long>> &overlapping_pairs); // union-find over the net's segments
+            void _reportOpenNets(const std::vector<unsigned> &nets) const;
+
+            NodeId _splitResistorAtPt(Resistor *res, Point2D<double> sub_seg_pt, std::vector<ArenaPtr<Resistor>> &resistors, Arena *arena); // handles splitting resistor, returns new node id
     };
 
 }
@@ -478,7 +478,7 @@ void Layer::SetCapacitanceUnitFromTechConfig() {
   unit_edge_cap_.assign(number_of_corners, 0);
 
   for (size_t i = 0; i < number_of_corners; ++i) {
-    auto corner = layer_tech_config_->CornersRef()[i];
+    auto &corner = layer_tech_config_->CornersRef()[i];
     double unit_cap = corner.GetOverSubstrateNoSurroundingWireCap();
     PhyDBExpects(unit_cap >= 0,
                  "Cannot find unit capacitance for corner: " + name_ + " "
@@ -562,6 +562,27 @@ double Layer::GetFringeCapacitance(
   return unit_edge_cap_[corner_index] * 2 * (width + length);
 }
 
+bool Layer::HasUnitRes(int corner_index) const {
+  return corner_index >= 0 && corner_index < (int) unit_res_.size();
+}
+
+bool Layer::HasUnitCap(int corner_index) const {
+  return corner_index >= 0 && corner_index < (int) unit_edge_cap_.size()
+      && corner_index < (int) unit_area_cap_.size();
+}
+
+std::vector<double> const &Layer::GetUnitResRef() const {
+  return unit_res_;
+}
+
+std::vector<double> const &Layer::GetUnitAreaCapRef() const {
+  return unit_area_cap_;
+}
+
+std::vector<double> const &Layer::GetUnitEdgeCapRef() const {
+  return unit_edge_cap_;
+}
+
 std::ostream &operator<<(std::ostream &os, const Layer &l) {
   os << l.name_ << " " << LayerTypeStr(l.type_) << " "
      << l.id_ << " " << MetalDirectionStr(l.direction_) << std::endl;
@@ -224,6 +224,12 @@ class Layer {
       double length,
       int corner_index
   );
+  bool HasUnitRes(int corner_index) const;
+  bool HasUnitCap(int corner_index) const; // area and edge capacitance units both set for the corner
+  // per-corner units behind GetResistance() and the capacitance getters, for batch evaluation
+  std::vector<double> const &GetUnitResRef() const;
+  std::vector<double> const &GetUnitAreaCapRef() const;
+  std::vector<double> const &GetUnitEdgeCapRef() const;
 
   friend std::ostream &operator<<(std::ostream &, const Layer &);
 
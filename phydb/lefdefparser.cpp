@@ -23,6 +23,9 @@
 #include <algorithm>
 
 #include "datatype.h"
+#include "defnativereader.h"
+#include "netroutingbuilder.h"
+#include "phydb/common/compressedfile.h"
 #include "phydb/common/logging.h"
 
 namespace phydb {
@@ -831,182 +834,62 @@ int getDefIOPins(defrCallbackType_e type, defiPin *pin, defiUserData data) {
 }
 
 void addNetGeometry(defiNet *net, PhyDB *phy_db_ptr, bool specialnet) {
-  #define BEN_DEBUG
-
-  double ext_length = specialnet ? 0 : -1;
-
-  
-  #ifdef BEN_DEBUG
-    std::cout << "START OF NET (" << net->name() << ")" << std::endl;
-  #endif
-  // iterate over the wires of the net, initialize net segment numberer
-
-  int net_segment_id = 0;
+  NetRoutingBuilder builder(phy_db_ptr, net->name(), specialnet);
   for (int i = 0; i < net->numWires(); i++) {
     defiWire *wire = net->wire(i);
-
-    #ifdef BEN_DEBUG
-      std::cout << "    START OF WIRE #" << i << std::endl;
-    #endif
-
-    // iterate over the paths of the wire
     for (int j = 0; j < wire->numPaths(); j++) {
-      #ifdef BEN_DEBUG
-        std::cout << "        START OF PATH #" << j << std::endl;
-      #endif
-
-      // initialize path traversal, centerline vector, layer tracker
       defiPath *path = wire->path(j);
       path->initTraverse();
-
-      const char *curr_layer = nullptr;
-      double curr_wire_width = -1;
-      std::vector<Point2D<double>> centerline;
-
-      // traverse path
       for (int t = path->next(); t != DEFIPATH_DONE; t = path->next()) {
-        switch(t) {
+        switch (t) {
           case DEFIPATH_LAYER: {
-
-            // if there was a previous layer in the path register that geometry
-            if (curr_layer != NULL) {
-              phy_db_ptr->AddWireSegmentGeometryFromCenterline(centerline, curr_layer, net_segment_id, net->name(), ext_length, curr_wire_width);
-              ext_length = specialnet ? 0 : -1; // reset ext_length
-              curr_wire_width = -1; // reset wire width
-            }
-            curr_layer = path->getLayer();
-            #ifdef BEN_DEBUG
-              std::cout << "            LAYER: " << curr_layer << std::endl;
-            #endif
+            builder.Layer(path->getLayer());
             break;
           }
           case DEFIPATH_VIA: {
-            const char *via_name = path->getVia();
-            LefVia *lef_via_ptr = phy_db_ptr->GetLefViaPtr(via_name);
-            DefVia *def_via_ptr = phy_db_ptr->GetDefViaPtr(via_name);
-            if (centerline.size() != 1) {
-              std::cout << "strange! expected one point in centerline prior to via..." << std::endl;
-            }
-            if (lef_via_ptr && def_via_ptr) {
-              std::cout << "problem! this should never happen: via defined in both lef and def, exiting" << std::endl;
-              exit(1);
-            }
-            else if (lef_via_ptr) {
-              phy_db_ptr->AddLefViaGeometry(lef_via_ptr, net_segment_id, net->name(), centerline[0]);
-            }
-            else if (def_via_ptr) {
-              phy_db_ptr->AddDefViaGeometry(def_via_ptr, net_segment_id, net->name(), centerline[0]);
-            } else {
-              std::cout << "problem! unrecognized via name: (" << via_name << ")" << std::endl;
-              exit(1);
-            }
-            centerline.clear();
-
-            #ifdef BEN_DEBUG 
-              std::cout << "            VIA: " << via_name << std::endl;
-            #endif
+            builder.Via(path->getVia());
             break;
           }
           case DEFIPATH_WIDTH: {
-            int w = path->getWidth();
-            curr_wire_width = w;
-            #ifdef BEN_DEBUG
-              std::cout << "            WIDTH: " << w << std::endl;
-            #endif
+            builder.Width(path->getWidth());
             break;
           }
           case DEFIPATH_POINT: {
             int x, y;
             path->getPoint(&x, &y);
-            #ifdef BEN_DEBUG
-              std::cout << "            POINT: (" << x << ", " << y << ")" << std::endl;
-            #endif
-            centerline.push_back(Point2D<double>(x, y));
-            
-            
+            builder.Point(x, y);
             break;
           }
-          case DEFIPATH_FLUSHPOINT:
-            #ifdef BEN_DEBUG
-              int x, y, e;
-              path->getFlushPoint(&x, &y, &e);
-              #ifdef BEN_DEBUG
-                std::cout << "            FLUSHPOINT: (" << x << ", " << y << ", " << e << ")" << std::endl;
-              #endif
-              ext_length = e;
-              centerline.push_back(Point2D<double>(x, y));
-            #endif
-            break;
-          case DEFIPATH_TAPER:
-            #ifdef BEN_DEBUG
-              std::cout << "            taper" << std::endl;
-            #endif
-            break;
-          case DEFIPATH_TAPERRULE:
-            #ifdef BEN_DEBUG
-              std::cout << "            taperrule" << std::endl;
-            #endif
-            break;
-          case DEFIPATH_SHAPE:
-            #ifdef BEN_DEBUG
-              std::cout << "            shape " << path->getShape() << std::endl;
-            #endif
-            break;
-          case DEFIPATH_STYLE:
-            #ifdef BEN_DEBUG  
-              std::cout << "            style" << std::endl;
-            #endif
-            break;
-          case DEFIPATH_VIAROTATION:
-            #ifdef BEN_DEBUG
-              std::cout << "            viarotation" << std::endl;
-            #endif
+          case DEFIPATH_FLUSHPOINT: {
+            int x, y, e;
+            path->getFlushPoint(&x, &y, &e);
+            builder.FlushPoint(x, y, e);
             break;
+          }
           case DEFIPATH_RECT: {
             int dx1, dy1, dx2, dy2;
             path->getViaRect(&dx1, &dy1, &dx2, &dy2);
-            if (centerline.size() != 1) {
-              std::cout << "strange! expected one point in centerline prior to rect..." << std::endl;
-            }
-
-            Rect2D<double> rect(centerline[0].x + dx1, centerline[0].y + dy1, centerline[0].x + dx2, centerline[0].y + dy2);
-            phy_db_ptr->AddRectGeometry(curr_layer, net_segment_id, net->name(), rect);
-            centerline.clear();
-            #ifdef BEN_DEBUG
-              std::cout << "            VIA RECT: (deltax1=" << dx1 << " deltay1=" << dy1 << " deltax2=" << dx2 << " deltay2=" << dy2 << ")" << std::endl;
-            #endif
+            builder.ViaRect(dx1, dy1, dx2, dy2);
             break;
           }
+          case DEFIPATH_TAPER:
+          case DEFIPATH_TAPERRULE:
+          case DEFIPATH_SHAPE:
+          case DEFIPATH_STYLE:
+          case DEFIPATH_VIAROTATION:
           case DEFIPATH_VIADATA:
-            break;
           case DEFIPATH_VIRTUALPOINT:
-            break;
           case DEFIPATH_MASK:
-            break;
           case DEFIPATH_VIAMASK:
             break;
           default: {
-            std::cout << "unrecognized path element type: " << t << ", exiting" << std::endl;
+            std::cout << "unrecognized path element type: " << t << ", ignoring" << std::endl;
           }
         }
       }
-      // at end of path register the geometry of current segment, clear layer
-      if (!centerline.empty()) phy_db_ptr->AddWireSegmentGeometryFromCenterline(centerline, curr_layer, net_segment_id, net->name(), ext_length, curr_wire_width);
-      ext_length = specialnet ? 0 : -1;
-      curr_wire_width = -1; // reseting wire width
-      curr_layer = nullptr;
-
-      #ifdef BEN_DEBUG
-        std::cout << "        END OF PATH #" << j << std::endl;
-      #endif
+      builder.EndPath();
     }
-    #ifdef BEN_DEBUG
-      std::cout << "    END OF WIRE #" << i << std::endl;
-    #endif
   }
-  #ifdef BEN_DEBUG
-    std::cout << "END OF NET" << std::endl;
-  #endif
 }
 
 int getDefNets(defrCallbackType_e type, defiNet *net, defiUserData data) {
@@ -1029,7 +912,9 @@ int getDefNets(defrCallbackType_e type, defiNet *net, defiUserData data) {
     }
   }
 
-  addNetGeometry(net, phy_db_ptr, false);
+  if (phy_db_ptr->IsNetGeometryLoaded(net_name)) {
+    addNetGeometry(net, phy_db_ptr, false);
+  }
 
   return 0;
 }
@@ -1042,6 +927,9 @@ int getDefSNets(defrCallbackType_e type, defiNet *net, defiUserData data) {
   }
   auto *phy_db_ptr = (PhyDB *) data;
   std::string name = net->name();
+  if (phy_db_ptr->GetDefLoadMode() == DefLoadMode::CONNECTIVITY && !phy_db_ptr->IsNetGeometryLoaded(name)) {
+    return 0;
+  }
   std::string use_str = net->use();
   SignalUse use = StrToSignalUse(use_str);
 
@@ -1130,7 +1018,9 @@ int getDefSNets(defrCallbackType_e type, defiNet *net, defiUserData data) {
     } // end_ path
   } // end_ wire
 
-  addNetGeometry(net, phy_db_ptr, true);
+  if (phy_db_ptr->IsNetGeometryLoaded(name)) {
+    addNetGeometry(net, phy_db_ptr, true);
+  }
 
 
   return 0;
@@ -1408,7 +1298,7 @@ void Si2ReadLef(PhyDB *phy_db_ptr, std::string const &lef_file_name) {
   lefrSetViaCbk(getLefVias);
   lefrSetViaRuleCbk(getLefViaRuleGenerates);
 
-  if ((f = fopen(lef_file_name.c_str(), "r")) == nullptr) {
+  if ((f = OpenInputFile(lef_file_name)) == nullptr) {
     std::cout << "Couldn't open lef file" << std::endl;
     exit(2);
   }
@@ -1423,10 +1313,61 @@ void Si2ReadLef(PhyDB *phy_db_ptr, std::string const &lef_file_name) {
   lefrClear();
 }
 
-void Si2ReadDef(PhyDB *phy_db_ptr, std::string const &def_file_name) {
+// sections parsed by the native reader during the current Si2ReadDef(), if any
+static DefNativeReader *native_def_reader = nullptr;
+
+/**
+ * Section start callback used when the native reader has parsed COMPONENTS,
+ * PINS and NETS. Si2 sees these sections with no records and a count of 0,
+ * the declared count and the records come from the native reader.
+ */
+int applyNativeDefSection(defrCallbackType_e type, int num, defiUserData data) {
+  auto *phy_db_ptr = (PhyDB *) data;
+  switch (type) {
+    case defrComponentStartCbkType : {
+      getDefCountNumber(type, native_def_reader->DeclaredCount(DefNativeReader::COMPONENTS), data);
+      native_def_reader->ApplyComponents(phy_db_ptr);
+      break;
+    }
+    case defrStartPinsCbkType : {
+      getDefCountNumber(type, native_def_reader->DeclaredCount(DefNativeReader::PINS), data);
+      native_def_reader->ApplyIoPins(phy_db_ptr);
+      break;
+    }
+    case defrNetStartCbkType : {
+      getDefCountNumber(type, native_def_reader->DeclaredCount(DefNativeReader::NETS), data);
+      native_def_reader->ApplyNets(phy_db_ptr);
+      break;
+    }
+    default : {
+      getDefCountNumber(type, num, data);
+    }
+  }
+  return 0;
+}
+
+/**
+ * Read a DEF file. With native_sections, COMPONENTS, PINS and NETS are parsed
+ * by DefNativeReader on num_threads threads and the rest of the file by Si2;
+ * if the native reader cannot handle the file, all of it is parsed by Si2.
+ */
+void Si2ReadDef(
+    PhyDB *phy_db_ptr,
+    std::string const &def_file_name,
+    bool native_sections,
+    int num_threads
+) {
   FILE *f;
   int res;
 
+  DefNativeReader native_reader;
+  std::string remainder;
+  bool keep_routing = phy_db_ptr->IsAnyNetGeometryLoaded();
+  if (native_sections && native_reader.Read(def_file_name, num_threads, keep_routing)) {
+    native_def_reader = &native_reader;
+    remainder = native_reader.RemainderText();
+  }
+
   defrInit();
   defrReset();
 
@@ -1455,15 +1396,27 @@ void Si2ReadDef(PhyDB *phy_db_ptr, std::string const &def_file_name) {
   defrSetBlockageCbk(getDefBlockage);
 
   defrSetNetStartCbk(getDefCountNumber);
-  defrSetSNetCbk(getDefSNets);
-  defrSetAddPathToNet();
+  DefLoadMode load_mode = phy_db_ptr->GetDefLoadMode();
+  // in CONNECTIVITY mode getDefSNets keeps only the special nets whose geometry is loaded
+  if (load_mode != DefLoadMode::CONNECTIVITY || phy_db_ptr->IsAnyNetGeometryLoaded()) {
+    defrSetSNetCbk(getDefSNets);
+    // without this, Si2 drops the routing of nets instead of storing it in defiNet
+    defrSetAddPathToNet();
+  }
   defrSetNetCbk(getDefNets);
 
   defrSetViaCbk(getDefVias);
   defrSetGcellGridCbk(getDefGcellGrid);
 
-
-  if ((f = fopen(def_file_name.c_str(), "r")) == 0) {
+  if (native_def_reader != nullptr) {
+    defrSetComponentStartCbk(applyNativeDefSection);
+    defrSetStartPinsCbk(applyNativeDefSection);
+    defrSetNetStartCbk(applyNativeDefSection);
+    f = fmemopen(&remainder[0], remainder.size(), "r");
+  } else {
+    f = OpenInputFile(def_file_name);
+  }
+  if (f == nullptr) {
     std::cout << "Couldn't open def file" << std::endl;
     exit(2);
   }
@@ -1473,6 +1426,7 @@ void Si2ReadDef(PhyDB *phy_db_ptr, std::string const &def_file_name) {
     exit(2);
   }
   fclose(f);
+  native_def_reader = nullptr;
 
   defrClear();
 }
@@ -1580,7 +1534,7 @@ void Si2LoadPlacedDef(PhyDB *phy_db_ptr, std::string const &def_file_name) {
   defrSetComponentStartCbk(getDefCountNumber);
   defrSetComponentCbk(LoadDefComponentLoc);
 
-  if ((f = fopen(def_file_name.c_str(), "r")) == nullptr) {
+  if ((f = OpenInputFile(def_file_name)) == nullptr) {
     std::cout << "Couldn't open def file" << std::endl;
     exit(2);
   }
@@ -62,7 +62,12 @@ int getDefGcellGrid(defrCallbackType_e, defiGcellGrid *, defiUserData);
 int getDefRow(defrCallbackType_e, defiRow *, defiUserData);
 
 void Si2ReadLef(PhyDB *phy_db_ptr, std::string const &lef_file_name);
-void Si2ReadDef(PhyDB *phy_db_ptr, std::string const &def_file_name);
+void Si2ReadDef(
+    PhyDB *phy_db_ptr,
+    std::string const &def_file_name,
+    bool native_sections = false,
+    int num_threads = 1
+);
 void Si2LoadPlacedDef(PhyDB *phy_db_ptr, std::string const &def_file_name);
 
 }
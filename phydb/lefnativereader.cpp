@@ -0,0 +1,370 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+#include "lefnativereader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <sstream>
+#include <vector>
+
+#include "phydb/common/compressedfile.h"
+#include "phydb/common/lefdeftokenizer.h"
+#include "phydb/common/logging.h"
+
+namespace phydb {
+
+namespace {
+
+bool ParseDouble(std::string_view token, double &value) {
+  if (token.empty()) return false;
+  const char *first = token.data();
+  if (*first == '+') ++first;
+  auto res = std::from_chars(first, token.data() + token.size(), value);
+  return res.ec == std::errc() && res.ptr == token.data() + token.size();
+}
+
+std::string Unsupported(std::string_view what, std::string_view token) {
+  return std::string(what) + " " + std::string(token) + " is not supported";
+}
+
+// skips the rest of a statement, including its ';'
+bool SkipStatement(LefDefTokenizer &tok) {
+  for (std::string_view token = tok.Next(); token != ";"; token = tok.Next()) {
+    if (token.empty()) return false;
+  }
+  return true;
+}
+
+// the words up to ';' joined by single spaces, as Si2 reports "CORE TIEHIGH" or "OUTPUT TRISTATE"
+bool ReadWords(LefDefTokenizer &tok, std::string &words) {
+  words.clear();
+  for (std::string_view token = tok.Next(); token != ";"; token = tok.Next()) {
+    if (token.empty()) return false;
+    if (!words.empty()) words += ' ';
+    words.append(token);
+  }
+  return true;
+}
+
+// macro statements with no counterpart in Macro
+bool IsIgnoredMacroStatement(std::string_view token) {
+  return token == "FOREIGN" || token == "EEQ" || token == "LEQ" || token == "SOURCE"
+      || token == "POWER" || token == "FIXEDMASK" || token == "PROPERTY";
+}
+
+// pin statements with no counterpart in Pin
+bool IsIgnoredPinStatement(std::string_view token) {
+  return token == "TAPERRULE" || token == "SHAPE" || token == "MUSTJOIN" || token == "NETEXPR"
+      || token == "SUPPLYSENSITIVITY" || token == "GROUNDSENSITIVITY" || token == "PROPERTY"
+      || token == "CAPACITANCE" || token.substr(0, 7) == "ANTENNA";
+}
+
+/****
+ * The LAYER and RECT statements of a PORT or an OBS, up to its END, added to
+ * owner (a Pin or the OBS of a macro) the way getLefPins() and getLefObs()
+ * add them: every LAYER starts a new LayerRect holding the RECTs after it.
+ */
+template<typename T>
+bool ParseLayerGeometries(LefDefTokenizer &tok, T *owner, std::string &error) {
+  LayerRect *layer_rect_ptr = nullptr;
+  for (std::string_view token = tok.Next(); token != "END"; token = tok.Next()) {
+    if (token == "LAYER") {
+      std::string layer_name(tok.Next());
+      if (layer_name.empty() || tok.Next() != ";") {
+        error = "LAYER with options is not supported";
+        return false;
+      }
+      layer_rect_ptr = owner->AddLayerRect(layer_name);
+    } else if (token == "RECT") {
+      std::string_view first = tok.Next();
+      if (first == "MASK") {
+        tok.Next();
+        first = tok.Next();
+      }
+      double x1, y1, x2, y2;
+      if (!ParseDouble(first, x1) || !ParseDouble(tok.Next(), y1) || !ParseDouble(tok.Next(), x2)
+          || !ParseDouble(tok.Next(), y2) || tok.Next() != ";") {
+        error = "malformed RECT";
+        return false;
+      }
+      if (layer_rect_ptr == nullptr) {
+        error = "RECT without a LAYER";
+        return false;
+      }
+      layer_rect_ptr->AddRect(
+          std::min(x1, x2),
+          std::min(y1, y2),
+          std::max(x1, x2),
+          std::max(y1, y2)
+      );
+    } else if (token == "CLASS") {
+      if (!SkipStatement(tok)) {
+        error = "unexpected end of file";
+        return false;
+      }
+    } else {
+      error = token.empty() ? "unexpected end of file" : Unsupported("geometry", token);
+      return false;
+    }
+  }
+  return true;
+}
+
+}
+
+/**
+ * @brief Read the macros of a cell library LEF file into this reader.
+ *
+ * @param lef_file_name: the LEF file
+ * @return true if the whole file was read, false if it cannot be opened or
+ * has a statement this reader does not handle
+ */
+bool LefNativeReader::Read(std::string const &lef_file_name) {
+  has_version_ = false;
+  has_units_ = false;
+  macros_.clear();
+
+  if (!ReadWholeFile(lef_file_name, text_)) return false;
+
+  LefDefTokenizer tok(text_.data(), text_.data(), text_.data() + text_.size());
+  std::string error;
+  if (!ParseLibrary(tok, error)) {
+    size_t line = 1 + std::count(text_.begin(), text_.begin() + std::min(tok.LastOffset(), text_.size()), '\n');
+    PhyDBWarns(
+        true,
+        "Native LEF reader: " << error << " (" << lef_file_name << ":" << line
+                              << "), reading the file with the Si2 parser instead"
+    );
+    macros_.clear();
+    return false;
+  }
+  return true;
+}
+
+bool LefNativeReader::ParseLibrary(LefDefTokenizer &tok, std::string &error) {
+  for (std::string_view token = tok.Next(); !token.empty(); token = tok.Next()) {
+    if (token == "MACRO") {
+      if (!ParseMacro(tok, error)) return false;
+    } else if (token == "VERSION") {
+      if (!ParseDouble(tok.Next(), version_) || tok.Next() != ";") {
+        error = "malformed VERSION";
+        return false;
+      }
+      has_version_ = true;
+    } else if (token == "UNITS") {
+      if (!ParseUnits(tok, error)) return false;
+    } else if (token == "BUSBITCHARS" || token == "DIVIDERCHAR" || token == "NAMESCASESENSITIVE"
+        || token == "NOWIREEXTENSIONATPIN") {
+      if (!SkipStatement(tok)) {
+        error = "unexpected end of file";
+        return false;
+      }
+    } else if (token == "PROPERTYDEFINITIONS") {
+      do {
+        token = tok.Next();
+      } while (!token.empty() && !(token == "END" && tok.Peek() == "PROPERTYDEFINITIONS"));
+      if (token.empty()) {
+        error = "unexpected end of file in PROPERTYDEFINITIONS";
+        return false;
+      }
+      tok.Next();
+    } else if (token == "END") {
+      if (tok.Next() != "LIBRARY") {
+        error = "unexpected END";
+        return false;
+      }
+      return true;
+    } else {
+      error = Unsupported("statement", token);
+      return false;
+    }
+  }
+  // END LIBRARY is optional
+  return true;
+}
+
+bool LefNativeReader::ParseUnits(LefDefTokenizer &tok, std::string &error) {
+  has_units_ = true;
+  for (std::string_view token = tok.Next(); token != "END"; token = tok.Next()) {
+    if (token.empty()) {
+      error = "unexpected end of file in UNITS";
+      return false;
+    }
+    if (token == "DATABASE") {
+      double database_micron;
+      if (tok.Next() != "MICRONS" || !ParseDouble(tok.Next(), database_micron) || tok.Next() != ";") {
+        error = "malformed DATABASE MICRONS";
+        return false;
+      }
+      database_micron_ = (int) database_micron;
+    } else if (!SkipStatement(tok)) {
+      error = "unexpected end of file in UNITS";
+      return false;
+    }
+  }
+  if (tok.Next() != "UNITS") {
+    error = "malformed END UNITS";
+    return false;
+  }
+  return true;
+}
+
+/****
+ * MACRO name ... END name. Origin, size, class, symmetry and site are set
+ * once the whole macro is read, as getLefMacros() sets them; a macro without
+ * CLASS or with a nonzero ORIGIN, which getLefMacros() rejects, is left to
+ * Si2 so that the error is reported the usual way.
+ */
+bool LefNativeReader::ParseMacro(LefDefTokenizer &tok, std::string &error) {
+  std::string macro_name(tok.Next());
+  macros_.emplace_back(macro_name);
+  Macro &macro = macros_.back();
+
+  std::string macro_class;
+  bool has_class = false;
+  double origin_x = 0, origin_y = 0;
+  double size_x = 0, size_y = 0;
+  bool x_symmetry = false, y_symmetry = false, r90_symmetry = false;
+  std::string site_name;
+  for (std::string_view token = tok.Next(); token != "END"; token = tok.Next()) {
+    bool valid = true;
+    if (token == "PIN") {
+      if (!ParsePin(tok, macro, error)) return false;
+    } else if (token == "OBS") {
+      if (!ParseLayerGeometries(tok, macro.GetObs(), error)) return false;
+    } else if (token == "CLASS") {
+      valid = ReadWords(tok, macro_class);
+      has_class = true;
+    } else if (token == "ORIGIN") {
+      valid = ParseDouble(tok.Next(), origin_x) && ParseDouble(tok.Next(), origin_y) && tok.Next() == ";";
+    } else if (token == "SIZE") {
+      valid = ParseDouble(tok.Next(), size_x) && tok.Next() == "BY" && ParseDouble(tok.Next(), size_y)
+          && tok.Next() == ";";
+    } else if (token == "SYMMETRY") {
+      std::string symmetry;
+      valid = ReadWords(tok, symmetry);
+      std::istringstream words(symmetry);
+      for (std::string word; valid && words >> word;) {
+        if (word == "X") {
+          x_symmetry = true;
+        } else if (word == "Y") {
+          y_symmetry = true;
+        } else if (word == "R90") {
+          r90_symmetry = true;
+        } else {
+          valid = false;
+        }
+      }
+    } else if (token == "SITE") {
+      site_name = std::string(tok.Next());
+      valid = !site_name.empty() && tok.Next() == ";";
+    } else if (IsIgnoredMacroStatement(token)) {
+      valid = SkipStatement(tok);
+    } else if (token.empty()) {
+      error = "unexpected end of file in MACRO " + macro_name;
+      return false;
+    } else {
+      error = Unsupported("macro statement", token);
+      return false;
+    }
+    if (!valid) {
+      error = "malformed " + std::string(token) + " in MACRO " + macro_name;
+      return false;
+    }
+  }
+  if (tok.Next() != macro_name) {
+    error = "MACRO " + macro_name + " is not closed by END " + macro_name;
+    return false;
+  }
+  if (!has_class) {
+    error = "MACRO " + macro_name + " has no CLASS";
+    return false;
+  }
+  if (origin_x != 0 || origin_y != 0) {
+    error = "MACRO " + macro_name + " has a nonzero ORIGIN";
+    return false;
+  }
+
+  macro.SetOrigin(origin_x, origin_y);
+  macro.SetSize(size_x, size_y);
+  macro.SetClass(StrToMacroClass(macro_class));
+  macro.SetSymmetry(x_symmetry, y_symmetry, r90_symmetry);
+  macro.SetSite(site_name);
+  return true;
+}
+
+/****
+ * PIN name ... END name. The pin is added once its DIRECTION and USE are
+ * known, which LEF allows after the PORTs, so PORTs are skipped on the first
+ * pass and read afterwards.
+ */
+bool LefNativeReader::ParsePin(LefDefTokenizer &tok, Macro &macro, std::string &error) {
+  std::string pin_name(tok.Next());
+  std::string direction, use;
+  std::vector<size_t> ports;
+  for (std::string_view token = tok.Next(); token != "END"; token = tok.Next()) {
+    bool valid = true;
+    if (token == "PORT") {
+      ports.push_back(tok.Offset());
+      for (token = tok.Next(); !token.empty() && token != "END"; token = tok.Next()) {}
+      valid = !token.empty();
+    } else if (token == "DIRECTION") {
+      valid = ReadWords(tok, direction);
+    } else if (token == "USE") {
+      valid = ReadWords(tok, use);
+    } else if (IsIgnoredPinStatement(token)) {
+      valid = SkipStatement(tok);
+    } else if (token.empty()) {
+      error = "unexpected end of file in PIN " + pin_name;
+      return false;
+    } else {
+      error = Unsupported("pin statement", token);
+      return false;
+    }
+    if (!valid) {
+      error = "malformed " + std::string(token) + " in PIN " + pin_name;
+      return false;
+    }
+  }
+  if (tok.Next() != pin_name) {
+    error = "PIN " + pin_name + " is not closed by END " + pin_name;
+    return false;
+  }
+  if (direction.empty() || use.empty() || ports.empty()) {
+    error = "PIN " + pin_name + " without DIRECTION, USE or PORT";
+    return false;
+  }
+
+  Pin *pin_ptr = macro.AddPin(
+      pin_name,
+      StrToSignalDirection(direction),
+      StrToSignalUse(use)
+  );
+  size_t pin_end = tok.Offset();
+  for (size_t port : ports) {
+    tok.Seek(port);
+    if (!ParseLayerGeometries(tok, pin_ptr, error)) return false;
+  }
+  tok.Seek(pin_end);
+  return true;
+}
+
+}
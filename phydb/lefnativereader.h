@@ -0,0 +1,72 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+#ifndef PHYDB_LEFNATIVEREADER_H_
+#define PHYDB_LEFNATIVEREADER_H_
+
+#include <list>
+#include <string>
+
+#include "macro.h"
+
+namespace phydb {
+
+class LefDefTokenizer;
+
+/****
+ * Reads a cell library LEF file, i.e. one that holds only MACROs and the
+ * VERSION, UNITS and name-syntax statements around them, into a macro table
+ * of its own. Nothing is shared with PhyDB or with other readers, so several
+ * files can be read on different threads, which the Si2 LEF parser, being a
+ * single global session, does not allow. PhyDB::ReadLefs() merges the tables
+ * afterwards.
+ *
+ * Macros are filled in as the Si2 callbacks in lefdefparser.cpp fill them.
+ * When the file has a statement this reader does not model (layers, vias,
+ * sites, pin geometry other than LAYER and RECT, ...), Read() returns false
+ * and the caller reads the file with Si2 instead.
+ */
+class LefNativeReader {
+ public:
+  bool Read(std::string const &lef_file_name);
+
+  bool HasVersion() const { return has_version_; }
+  double Version() const { return version_; }
+  bool HasUnits() const { return has_units_; }
+  int DatabaseMicron() const { return database_micron_; }
+  std::list<Macro> &MacrosRef() { return macros_; }
+
+ private:
+  std::string text_;
+  bool has_version_ = false;
+  double version_ = 0;
+  bool has_units_ = false;
+  int database_micron_ = 0;
+  std::list<Macro> macros_;
+
+  bool ParseLibrary(LefDefTokenizer &tok, std::string &error);
+  bool ParseUnits(LefDefTokenizer &tok, std::string &error);
+  bool ParseMacro(LefDefTokenizer &tok, std::string &error);
+  bool ParsePin(LefDefTokenizer &tok, Macro &macro, std::string &error);
+};
+
+}
+
+#endif //PHYDB_LEFNATIVEREADER_H_
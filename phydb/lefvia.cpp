@@ -42,6 +42,7 @@ void LefVia::SetLayerRect(
   layer_rects_[0] = LayerRect(layer_name0, rects0);
   layer_rects_[1] = LayerRect(layer_name1, rects1);
   layer_rects_[2] = LayerRect(layer_name2, rects2);
+  geometry_template_.clear();
 }
 
 std::string LefVia::GetName() const {
@@ -52,6 +53,10 @@ std::vector<LayerRect> &LefVia::GetLayerRectsRef() {
   return layer_rects_;
 }
 
+std::vector<ViaShape> &LefVia::GetGeometryTemplateRef() {
+  return geometry_template_;
+}
+
 void LefVia::Report() {
   std::cout << "LefVia name: " << name_ << "\n";
   for (auto &layer_rect : layer_rects_) {
@@ -46,12 +46,14 @@ class LefVia {
   );
 
   std::vector<LayerRect> &GetLayerRectsRef();
+  std::vector<ViaShape> &GetGeometryTemplateRef();
 
   void Report();
  private:
   std::string name_;
   bool is_default_;
   std::vector<LayerRect> layer_rects_;
+  std::vector<ViaShape> geometry_template_; // empty until the via is first placed
 };
 
 }
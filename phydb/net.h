@@ -57,6 +57,10 @@ class Net {
   bool IsDriverIoPin() const { return is_driver_io_pin_; }
   int GetDriverPinId() const { return driver_pin_id_; }
 
+  // id of the net's wires and RC elements in Geometry, set by PhyDB::AddNet()
+  void SetGeometryId(unsigned geometry_id) { geometry_id_ = geometry_id; }
+  unsigned GetGeometryId() const { return geometry_id_; }
+
   void Report();
  private:
   std::string name_;
@@ -73,6 +77,7 @@ class Net {
   // cached info
   bool is_driver_io_pin_ = false;
   int driver_pin_id_ = -1;
+  unsigned geometry_id_ = 0;
 };
 
 std::ostream &operator<<(std::ostream &, const Net &);
@@ -0,0 +1,107 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include "netroutingbuilder.h"
+
+#include "phydb.h"
+#include "phydb/common/logging.h"
+
+namespace phydb {
+
+// special wires end flush with their last point, regular wires extend half their width past it
+NetRoutingBuilder::NetRoutingBuilder(PhyDB *phy_db_ptr, std::string const &net_name, bool special_net) :
+    phy_db_ptr_(phy_db_ptr),
+    net_name_(net_name),
+    default_ext_length_(special_net ? 0 : -1),
+    ext_length_(default_ext_length_) {}
+
+void NetRoutingBuilder::Layer(std::string const &layer_name) {
+  // the wire on the previous layer of the path ends here
+  if (!curr_layer_.empty()) {
+    AddCenterline();
+    ext_length_ = default_ext_length_;
+    curr_wire_width_ = -1;
+  }
+  curr_layer_ = layer_name;
+}
+
+void NetRoutingBuilder::Via(std::string const &via_name) {
+  Point2D<double> location = ViaPoint("via " + via_name);
+  LefVia *lef_via_ptr = phy_db_ptr_->GetLefViaPtr(via_name);
+  DefVia *def_via_ptr = phy_db_ptr_->GetDefViaPtr(via_name);
+  PhyDBExpects(
+      lef_via_ptr == nullptr || def_via_ptr == nullptr,
+      "Via " << via_name << " in net " << net_name_ << " is defined in both LEF and DEF"
+  );
+  if (lef_via_ptr != nullptr) {
+    phy_db_ptr_->AddLefViaGeometry(lef_via_ptr, net_segment_id_, net_name_, location);
+  } else {
+    PhyDBExpects(def_via_ptr != nullptr, "Unknown via " << via_name << " in net " << net_name_);
+    phy_db_ptr_->AddDefViaGeometry(def_via_ptr, net_segment_id_, net_name_, location);
+  }
+  centerline_.clear();
+}
+
+void NetRoutingBuilder::Width(double width) {
+  curr_wire_width_ = width;
+}
+
+void NetRoutingBuilder::Point(double x, double y) {
+  centerline_.emplace_back(x, y);
+}
+
+void NetRoutingBuilder::FlushPoint(double x, double y, double ext_length) {
+  ext_length_ = ext_length;
+  centerline_.emplace_back(x, y);
+}
+
+void NetRoutingBuilder::ViaRect(double dx1, double dy1, double dx2, double dy2) {
+  Point2D<double> location = ViaPoint("rect");
+  Rect2D<double> rect(location.x + dx1, location.y + dy1, location.x + dx2, location.y + dy2);
+  phy_db_ptr_->AddRectGeometry(curr_layer_, net_segment_id_, net_name_, rect);
+  centerline_.clear();
+}
+
+void NetRoutingBuilder::EndPath() {
+  if (!centerline_.empty()) AddCenterline();
+  ext_length_ = default_ext_length_;
+  curr_wire_width_ = -1;
+  curr_layer_.clear();
+  centerline_.clear();
+}
+
+void NetRoutingBuilder::AddCenterline() {
+  phy_db_ptr_->AddWireSegmentGeometryFromCenterline(
+      centerline_, curr_layer_, net_segment_id_, net_name_, ext_length_, curr_wire_width_
+  );
+}
+
+// a via or a rect sits on the single point written before it
+Point2D<double> const &NetRoutingBuilder::ViaPoint(std::string const &what) {
+  PhyDBExpects(!centerline_.empty(), "No point before " << what << " in net " << net_name_);
+  PhyDBWarns(
+      centerline_.size() != 1,
+      "Expected one point before " << what << " in net " << net_name_ << ", found " << centerline_.size()
+  );
+  return centerline_[0];
+}
+
+}
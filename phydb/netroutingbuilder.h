@@ -0,0 +1,70 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+#ifndef PHYDB_NETROUTINGBUILDER_H_
+#define PHYDB_NETROUTINGBUILDER_H_
+
+#include <string>
+#include <vector>
+
+#include "datatype.h"
+
+namespace phydb {
+
+class PhyDB;
+
+/****
+ * Turns the routing of one DEF net or special net into wire segments. The
+ * readers feed it the elements of each routing path in file order (the Si2
+ * callbacks from defiPath, DefNativeReader from its records) and call
+ * EndPath() after each path. Wire segments are numbered per net, so one
+ * builder is used for all paths of a net.
+ */
+class NetRoutingBuilder {
+ public:
+  NetRoutingBuilder(PhyDB *phy_db_ptr, std::string const &net_name, bool special_net);
+
+  void Layer(std::string const &layer_name);
+  void Via(std::string const &via_name);
+  void Width(double width);
+  void Point(double x, double y);
+  void FlushPoint(double x, double y, double ext_length);
+  // a RECT statement, offsets from the last point
+  void ViaRect(double dx1, double dy1, double dx2, double dy2);
+  void EndPath();
+
+ private:
+  PhyDB *phy_db_ptr_;
+  std::string net_name_;
+  double default_ext_length_;
+
+  int net_segment_id_ = 0;
+  std::string curr_layer_;
+  double ext_length_;
+  double curr_wire_width_ = -1;
+  std::vector<Point2D<double>> centerline_;
+
+  void AddCenterline();
+  Point2D<double> const &ViaPoint(std::string const &what);
+};
+
+}
+
+#endif //PHYDB_NETROUTINGBUILDER_H_
@@ -20,14 +20,22 @@
  ******************************************************************************/
 #include "phydb.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <sstream>
+#include <thread>
 
 #include <fstream>
 
 #include "defwriter.h"
+#include "spefwriter.h"
+#include "phydb/common/compressedfile.h"
 #include "phydb/common/helper.h"
+#include "phydb/timing/netgroups.h"
 #include "phydb/timing/techconfigparser.h"
 #include "lefdefparser.h"
+#include "lefnativereader.h"
 
 #include "geometry.h"
 
@@ -59,6 +67,14 @@ Geometry &PhyDB::geometry() {
   return geometry_;
 }
 
+RCCache &PhyDB::rc_cache() {
+  return rc_cache_;
+}
+
+CapacitanceEngine &PhyDB::capacitance_engine() {
+  return capacitance_engine_;
+}
+
 void PhyDB::SetLefVersion(double version) {
   tech_.SetVersion(version);
 }
@@ -104,7 +120,9 @@ Layer *PhyDB::AddLayer(
     LayerType type,
     MetalDirection direction
 ) {
-  return tech_.AddLayer(layer_name, type, direction);
+  Layer *layer_ptr = tech_.AddLayer(layer_name, type, direction);
+  geometry_.internLayer(layer_name); // keeps geometry layer ids equal to tech layer ids
+  return layer_ptr;
 }
 
 Layer *PhyDB::GetLayerPtr(std::string const &layer_name) {
@@ -355,6 +373,7 @@ Net *PhyDB::AddNet(
     void *act_net_ptr
 ) {
   auto *ret = design_.AddNet(net_name, weight);
+  ret->SetGeometryId(geometry_.internNet(net_name));
 
   if (act_net_ptr != nullptr) {
     if (timing_api_.IsActNetPtrExisting(act_net_ptr)) {
@@ -473,7 +492,9 @@ void PhyDB::AddCompPinToNet(
 }
 
 SNet *PhyDB::AddSNet(std::string const &net_name, SignalUse use) {
-  return design_.AddSNet(net_name, use);
+  SNet *snet_ptr = design_.AddSNet(net_name, use);
+  geometry_.internNet(net_name);
+  return snet_ptr;
 }
 
 SNet *PhyDB::GetSNet(std::string const &net_name) {
@@ -484,105 +505,86 @@ std::vector<SNet> &PhyDB::GetSNetRef() {
   return design_.GetSNetRef();
 }
 
-void PhyDB::AddLefViaGeometry(LefVia *via_ptr, int &segment_id, std::string net_name, Point2D<double> offset) {
-  std::vector<LayerRect> &layer_rects = via_ptr->GetLayerRectsRef();
-  WireSegment *prev = nullptr;
-  for (LayerRect layer_rect : layer_rects) {
-    std::string layer_name = layer_rect.layer_name_;
-    std::vector<Rect2D<double>> rects = layer_rect.GetRects();
-    for (Rect2D<double> rect : rects) {
-      rect.ll.x *= tech_.GetDatabaseMicron();
-      rect.ll.y *= tech_.GetDatabaseMicron();
-      rect.ur.x *= tech_.GetDatabaseMicron();
-      rect.ur.y *= tech_.GetDatabaseMicron();
-      rect.ll.x += offset.x;
-      rect.ll.y += offset.y;
-      rect.ur.x += offset.x;
-      rect.ur.y += offset.y;
-      Point2D<double> center((rect.ll.x + rect.ur.x) / 2, (rect.ll.y + rect.ur.y) / 2); 
-
-      // std::cout << net_name << "- LEFVIA RECT: LL=(" << via_rect.ll.x << ", " << via_rect.ll.y << ") ; UR=(" << via_rect.ur.x << ", " << via_rect.ur.y << ")" << std::endl;
-      
-      WireSegment w(rect, net_name, layer_name, segment_id++, center, center);
-      if (prev) {
-        w.addVerticalConnection(prev);
+void PhyDB::AddLefViaGeometry(LefVia *via_ptr, int &segment_id, std::string const &net_name, Point2D<double> offset) {
+  std::vector<ViaShape> &shapes = via_ptr->GetGeometryTemplateRef();
+  if (shapes.empty()) {
+    double dbu = tech_.GetDatabaseMicron();
+    for (LayerRect &layer_rect : via_ptr->GetLayerRectsRef()) {
+      int layer_id = geometry_.internLayer(layer_rect.layer_name_);
+      for (Rect2D<double> const &rect : layer_rect.GetRects()) {
+        Rect2D<double> dbu_rect(rect.ll.x * dbu, rect.ll.y * dbu, rect.ur.x * dbu, rect.ur.y * dbu);
+        Point2D<double> center((dbu_rect.ll.x + dbu_rect.ur.x) / 2, (dbu_rect.ll.y + dbu_rect.ur.y) / 2);
+        shapes.push_back(ViaShape{layer_id, dbu_rect, center});
       }
-      prev = AddWireSegment(w);
     }
   }
+  AddViaShapes(shapes, segment_id, geometry_.internNet(net_name), offset);
+}
+
+void PhyDB::AddDefViaGeometry(DefVia *via_ptr, int &segment_id, std::string const &net_name, Point2D<double> offset) {
+  std::vector<ViaShape> &shapes = via_ptr->geometry_template_;
+  if (shapes.empty()) {
+    if (via_ptr->rect2d_layers.size() > 0) {
+      for (Rect2DLayer<int> const &rect_layer : via_ptr->rect2d_layers) {
+        Rect2D<double> via_rect(static_cast<double>(rect_layer.ll.x),
+                                static_cast<double>(rect_layer.ll.y),
+                                static_cast<double>(rect_layer.ur.x),
+                                static_cast<double>(rect_layer.ur.y));
+        Point2D<double> center((via_rect.ll.x + via_rect.ur.x) / 2, (via_rect.ll.y + via_rect.ur.y) / 2);
+        shapes.push_back(ViaShape{geometry_.internLayer(rect_layer.layer), via_rect, center});
+      }
+    } else {
+      int bot_layer = geometry_.internLayer(via_ptr->layers_[0]);
+      int top_layer = geometry_.internLayer(via_ptr->layers_[2]);
+
+      Rect2D<double> cut_rect(-static_cast<double>(via_ptr->cut_size_.x) / 2,
+                              -static_cast<double>(via_ptr->cut_size_.y) / 2,
+                              static_cast<double>(via_ptr->cut_size_.x) / 2,
+                              static_cast<double>(via_ptr->cut_size_.y) / 2);
+
+      Rect2D<double> bot_rect(cut_rect);
+      bot_rect.ll.x += static_cast<double>(via_ptr->bot_offset_.x) - static_cast<double>(via_ptr->bot_enc_.x);
+      bot_rect.ur.x += static_cast<double>(via_ptr->bot_offset_.x) + static_cast<double>(via_ptr->bot_enc_.x);
+      bot_rect.ll.y += static_cast<double>(via_ptr->bot_offset_.y) - static_cast<double>(via_ptr->bot_enc_.y);
+      bot_rect.ur.y += static_cast<double>(via_ptr->bot_offset_.y) + static_cast<double>(via_ptr->bot_enc_.y);
+
+      Rect2D<double> top_rect(cut_rect);
+      top_rect.ll.x += static_cast<double>(via_ptr->top_offset_.x) - static_cast<double>(via_ptr->top_enc_.x);
+      top_rect.ur.x += static_cast<double>(via_ptr->top_offset_.x) + static_cast<double>(via_ptr->top_enc_.x);
+      top_rect.ll.y += static_cast<double>(via_ptr->top_offset_.y) - static_cast<double>(via_ptr->top_enc_.y);
+      top_rect.ur.y += static_cast<double>(via_ptr->top_offset_.y) + static_cast<double>(via_ptr->top_enc_.y);
+
+      Point2D<double> bot_center((bot_rect.ll.x + bot_rect.ur.x) / 2, (bot_rect.ll.y + bot_rect.ur.y) / 2);
+      Point2D<double> cut_center((cut_rect.ll.x + cut_rect.ur.x) / 2, (cut_rect.ll.y + bot_rect.ur.y) / 2);
+      Point2D<double> top_center((top_rect.ll.x + top_rect.ur.x) / 2, (top_rect.ll.y + top_rect.ur.y) / 2);
+
+      shapes.push_back(ViaShape{bot_layer, bot_rect, bot_center});
+      shapes.push_back(ViaShape{bot_layer, cut_rect, cut_center});
+      shapes.push_back(ViaShape{top_layer, top_rect, top_center});
+    }
+  }
+  AddViaShapes(shapes, segment_id, geometry_.internNet(net_name), offset);
 }
 
-void PhyDB::AddDefViaGeometry(DefVia *via_ptr, int &segment_id, std::string net_name, Point2D<double> offset) {
+void PhyDB::AddViaShapes(std::vector<ViaShape> const &shapes, int &segment_id, unsigned net_id, Point2D<double> offset) {
   WireSegment *prev = nullptr;
-  if (via_ptr->rect2d_layers.size() > 0) {
-    for (Rect2DLayer<int> rect_layer : via_ptr->rect2d_layers) {
-        std::string layer_name = rect_layer.layer;
-
-        Rect2D<double> via_rect(static_cast<double>(rect_layer.ll.x) + offset.x,
-                              static_cast<double>(rect_layer.ll.y) + offset.y,
-                              static_cast<double>(rect_layer.ur.x) + offset.x,
-                              static_cast<double>(rect_layer.ur.y) + offset.y);
-
-        // std::cout << net_name << "- VIA RECT: LL=(" << via_rect.ll.x << ", " << via_rect.ll.y << ") ; UR=(" << via_rect.ur.x << ", " << via_rect.ur.y << ")" << std::endl;
-        Point2D<double> center((via_rect.ll.x + via_rect.ur.x) / 2, (via_rect.ll.y + via_rect.ur.y) / 2); 
-        WireSegment w(via_rect, net_name, layer_name, segment_id++, center, center);
-        if (prev) {
-          w.addVerticalConnection(prev);
-        }
-        prev = AddWireSegment(w);
-    }
-  } else {
-    std::string bot_layer = via_ptr->layers_[0];
-    std::string cut_layer = via_ptr->layers_[1];
-    std::string top_layer = via_ptr->layers_[2];
-
-    std::cout << via_ptr->name_ << " | " << via_ptr->cut_size_.x << " | " << via_ptr->cut_size_.y<< std::endl;
-
-    Rect2D<double> cut_rect(-static_cast<double>(via_ptr->cut_size_.x) / 2 + offset.x,
-                            -static_cast<double>(via_ptr->cut_size_.y) / 2 + offset.y,
-                            static_cast<double>(via_ptr->cut_size_.x) / 2 + offset.x,
-                            static_cast<double>(via_ptr->cut_size_.y) / 2 + offset.y);
-
-    Rect2D<double> bot_rect(cut_rect);
-    bot_rect.ll.x += static_cast<double>(via_ptr->bot_offset_.x) - static_cast<double>(via_ptr->bot_enc_.x);
-    bot_rect.ur.x += static_cast<double>(via_ptr->bot_offset_.x) + static_cast<double>(via_ptr->bot_enc_.x);
-    bot_rect.ll.y += static_cast<double>(via_ptr->bot_offset_.y) - static_cast<double>(via_ptr->bot_enc_.y);
-    bot_rect.ur.y += static_cast<double>(via_ptr->bot_offset_.y) + static_cast<double>(via_ptr->bot_enc_.y);
-
-    Rect2D<double> top_rect(cut_rect);
-    top_rect.ll.x += static_cast<double>(via_ptr->top_offset_.x) - static_cast<double>(via_ptr->top_enc_.x);
-    top_rect.ur.x += static_cast<double>(via_ptr->top_offset_.x) + static_cast<double>(via_ptr->top_enc_.x);
-    top_rect.ll.y += static_cast<double>(via_ptr->top_offset_.y) - static_cast<double>(via_ptr->top_enc_.y);
-    top_rect.ur.y += static_cast<double>(via_ptr->top_offset_.y) + static_cast<double>(via_ptr->top_enc_.y);
-
-    Point2D<double> bot_center((bot_rect.ll.x + bot_rect.ur.x) / 2, (bot_rect.ll.y + bot_rect.ur.y) / 2); 
-    Point2D<double> cut_center((cut_rect.ll.x + cut_rect.ur.x) / 2, (cut_rect.ll.y + bot_rect.ur.y) / 2); 
-    Point2D<double> top_center((top_rect.ll.x + top_rect.ur.x) / 2, (top_rect.ll.y + top_rect.ur.y) / 2); 
-
-    WireSegment w1(bot_rect, net_name, bot_layer, segment_id++, bot_center, bot_center);
+  for (ViaShape const &shape : shapes) {
+    Rect2D<double> rect(shape.rect.ll.x + offset.x,
+                        shape.rect.ll.y + offset.y,
+                        shape.rect.ur.x + offset.x,
+                        shape.rect.ur.y + offset.y);
+    Point2D<double> center(shape.center.x + offset.x, shape.center.y + offset.y);
+    WireSegment w(rect, net_id, shape.layer_id, segment_id++, center, center);
     if (prev) {
-      w1.addVerticalConnection(prev);
+      w.addVerticalConnection(prev);
     }
-    prev = AddWireSegment(w1);
-
-    WireSegment w2(cut_rect, net_name, bot_layer, segment_id++, cut_center, cut_center);
-    if (prev) {
-      w2.addVerticalConnection(prev);
-    }
-    prev = AddWireSegment(w2);
-
-    WireSegment w3(top_rect, net_name, top_layer, segment_id++, top_center, top_center);
-    if (prev) {
-      w3.addVerticalConnection(prev);
-    }
-    prev = AddWireSegment(w3);
+    prev = AddWireSegment(w);
   }
-  return;
 }
 
 void PhyDB::AddRectGeometry(std::string layer_name, int &net_segment_id, std::string net_name, Rect2D<double> rect) {
     Point2D<double> center((rect.ll.x + rect.ur.x) / 2, (rect.ll.y + rect.ur.y) / 2); 
-    WireSegment w(rect, net_name, layer_name, net_segment_id++, center, center);
+    WireSegment w(rect, geometry_.internNet(net_name), geometry_.internLayer(layer_name), net_segment_id++, center, center);
     AddWireSegment(w);
 }
 
@@ -604,6 +606,9 @@ void PhyDB::AddWireSegmentGeometryFromCenterline(std::vector<Point2D<double>> &c
   // start overshoot length is overshoot length for start of centerline, depends on snet vs net
   double overshoot_length = ext_length >= 0 ? ext_length : wire_width / 2;
 
+  unsigned net_id = geometry_.internNet(net_name);
+  int layer_id = geometry_.internLayer(layer_name);
+
   for (unsigned long i = 0; i < centerline.size() - 1; i++) {
 
     // get relevant point pair
@@ -698,7 +703,7 @@ void PhyDB::AddWireSegmentGeometryFromCenterline(std::vector<Point2D<double>> &c
     }
 
     // at this point in the code ur and ll are correct, create + register wire segment
-    WireSegment w(Rect2D<double>(ll, ur), net_name, layer_name, segment_id++, starting_coordinate, p2);
+    WireSegment w(Rect2D<double>(ll, ur), net_id, layer_id, segment_id++, starting_coordinate, p2);
     if (prev) {
       w.addHorizontalConnection(prev);
     }
@@ -1082,12 +1087,88 @@ void PhyDB::AddNetsAndCompPinsToSpefManager() {
 
 void PhyDB::ReadLef(std::string const &lef_file_name) {
   tech_.SetLefName(lef_file_name);
+  source_files_.push_back(lef_file_name);
   Si2ReadLef(this, lef_file_name);
 }
 
+/**
+ * @brief Read a technology LEF followed by cell library LEFs.
+ *
+ * The technology LEF is read with Si2 on the calling thread while the cell
+ * LEFs are read by LefNativeReader on num_threads threads, each into a macro
+ * table of its own. The tables are merged in list order afterwards, so macros
+ * are stored in the same order as with one ReadLef() per file, and a macro
+ * name defined twice is an error, as it is with ReadLef(). A cell LEF the
+ * native reader cannot handle is read by ReadLef() at its place in the list.
+ *
+ * @param lef_file_names: the technology LEF, then the cell LEFs
+ * @param num_threads: threads reading the cell LEFs
+ */
+void PhyDB::ReadLefs(std::vector<std::string> const &lef_file_names, int num_threads) {
+  if (lef_file_names.empty()) return;
+  size_t num_cell_lefs = lef_file_names.size() - 1;
+  std::vector<LefNativeReader> readers(num_cell_lefs);
+  std::vector<char> is_native(num_cell_lefs, 0);
+  std::atomic<size_t> next_file(0);
+  auto read_cell_lefs = [&]() {
+    for (size_t i = next_file++; i < num_cell_lefs; i = next_file++) {
+      is_native[i] = readers[i].Read(lef_file_names[i + 1]);
+    }
+  };
+  std::vector<std::thread> workers;
+  int num_workers = std::min(std::max(num_threads, 1), (int) num_cell_lefs);
+  for (int i = 0; i < num_workers; ++i) {
+    workers.emplace_back(read_cell_lefs);
+  }
+  ReadLef(lef_file_names[0]);
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  for (size_t i = 0; i < num_cell_lefs; ++i) {
+    std::string const &lef_file_name = lef_file_names[i + 1];
+    if (!is_native[i]) {
+      ReadLef(lef_file_name);
+      continue;
+    }
+    tech_.SetLefName(lef_file_name);
+    source_files_.push_back(lef_file_name);
+    LefNativeReader &reader = readers[i];
+    if (reader.HasVersion()) SetLefVersion(reader.Version());
+    if (reader.HasUnits()) SetDatabaseMicron(reader.DatabaseMicron());
+    tech_.AddMacros(reader.MacrosRef());
+  }
+}
+
 void PhyDB::ReadDef(std::string const &def_file_name) {
   design_.SetDefName(def_file_name);
-  Si2ReadDef(this, def_file_name);
+  source_files_.push_back(def_file_name);
+  Si2ReadDef(this, def_file_name, native_def_reader_, native_def_reader_threads_);
+}
+
+/**
+ * @brief Choose what the following ReadDef() calls load.
+ *
+ * Placement flows, which never call GenerateRCNetwork(), can skip the wire
+ * segments built for every wire and via, and the SPECIALNETS too. Nets are
+ * always loaded with their connectivity.
+ *
+ * @param mode: CONNECTIVITY, CONNECTIVITY_AND_SNETS or FULL_GEOMETRY
+ * @param geometry_nets: when not empty, wire segments are built for these
+ * nets and special nets only, whatever the mode; in CONNECTIVITY mode the
+ * special nets among them are also the only ones loaded
+ */
+void PhyDB::SetDefLoadMode(DefLoadMode mode, std::vector<std::string> const &geometry_nets) {
+  def_load_mode_ = mode;
+  def_geometry_nets_.clear();
+  def_geometry_nets_.insert(geometry_nets.begin(), geometry_nets.end());
+}
+
+bool PhyDB::IsNetGeometryLoaded(std::string const &net_name) const {
+  if (!def_geometry_nets_.empty()) {
+    return def_geometry_nets_.find(net_name) != def_geometry_nets_.end();
+  }
+  return def_load_mode_ == DefLoadMode::FULL_GEOMETRY;
 }
 
 /**
@@ -1318,12 +1399,15 @@ bool PhyDB::ReadTechConfigFile(std::string const &tech_config_file_name) {
   );
 
   ReadTechnologyConfigurationFile(this, tech_config_file_name);
+  tech_config_files_.push_back(tech_config_file_name);
 
   // fix the last entry in the resistance over table
   // and use this technology configuration table to set r/c units
   tech_.FixResOverTable();
   tech_.SetResistanceUnit(true, false);
   tech_.SetCapacitanceUnit(true, false);
+  capacitance_engine_.Build(tech_);
+  geometry_.invalidateAnnotation();
 
   return true;
 }
@@ -1361,6 +1445,232 @@ void PhyDB::WriteDef(std::string const &def_file_name) {
   Si2WriteDef(this, def_file_name);
 }
 
+void PhyDB::GenerateRCNetwork(int num_threads) {
+  GenerateRCNetwork(ExtractionScope(), num_threads);
+}
+
+void PhyDB::GenerateRCNetwork(ExtractionScope const &scope, int num_threads) {
+  geometry_.setNumThreads(num_threads);
+  geometry_.generateRCNetwork(scope);
+  FindPinNodes();
+  timing_api_.elmore_engine_.Clear();
+  if (!capacitance_engine_.IsEmpty()) {
+    AnnotateCapacitance(0);
+  }
+}
+
+/****
+ * @brief Records for every net the RC node each placed cell pin and IO pin
+ * connects to, see Geometry::findPinNode(). Pins whose shapes no wire of the
+ * net touches get no node. Only nets the last generation changed are matched
+ * again, on the extraction's threads.
+ */
+void PhyDB::FindPinNodes() {
+  // orientations as in OpenDB: FW mirrors about the x axis then rotates by 90, FE mirrors about the y axis
+  auto orient_rect = [](Rect2D<double> const &rect, CompOrient orient) {
+    auto transform = [orient](double x, double y) {
+      switch (orient) {
+        case CompOrient::S:return Point2D<double>(-x, -y);
+        case CompOrient::W:return Point2D<double>(-y, x);
+        case CompOrient::E:return Point2D<double>(y, -x);
+        case CompOrient::FN:return Point2D<double>(-x, y);
+        case CompOrient::FS:return Point2D<double>(x, -y);
+        case CompOrient::FW:return Point2D<double>(y, x);
+        case CompOrient::FE:return Point2D<double>(-y, -x);
+        default:return Point2D<double>(x, y);
+      }
+    };
+    Point2D<double> p1 = transform(rect.ll.x, rect.ll.y);
+    Point2D<double> p2 = transform(rect.ur.x, rect.ur.y);
+    return Rect2D<double>(std::min(p1.x, p2.x), std::min(p1.y, p2.y), std::max(p1.x, p2.x), std::max(p1.y, p2.y));
+  };
+
+  double distance_microns = tech_.GetDatabaseMicron();
+  std::vector<Component> &components = design_.GetComponentsRef();
+  std::vector<IOPin> &iopins = design_.GetIoPinsRef();
+  std::vector<Net> &nets = design_.GetNetsRef();
+  // nets the last generation left alone keep their pin nodes
+  std::vector<Net *> changed_nets;
+  for (Net &net : nets) {
+    unsigned net_id = net.GetGeometryId();
+    if (!geometry_.hasNetChanged(net_id)) continue;
+    if (geometry_.getNumNodes(net_id) == 0) continue; // no wires, or left out of the last extraction
+    changed_nets.push_back(&net);
+  }
+
+  std::vector<std::vector<PinNode>> net_pin_nodes(changed_nets.size());
+  auto find_net_pin_nodes = [&](size_t i, std::vector<WireSegment *> &candidates) {
+    Net &net = *changed_nets[i];
+    unsigned net_id = net.GetGeometryId();
+    std::vector<PinNode> &pin_nodes = net_pin_nodes[i];
+    NodeId node_id;
+    for (PhydbPin &pin : net.GetPinsRef()) {
+      if (!pin.IsComponentPin()) continue;
+      Component &component = components[pin.InstanceId()];
+      if (component.GetPlacementStatus() == PlaceStatus::UNPLACED) continue;
+      Macro *macro = component.GetMacro();
+      // placed shapes keep the cell's lower-left corner at its location whatever the orientation
+      Rect2D<double> outline = orient_rect(Rect2D<double>(0, 0, macro->GetWidth(), macro->GetHeight()), component.GetOrientation());
+      Point2D<int> location = component.GetLocation();
+      bool found = false;
+      for (LayerRect &layer_rect : macro->GetPinsRef()[pin.PinId()].GetLayerRectRef()) {
+        int layer_id = geometry_.getLayerId(layer_rect.layer_name_);
+        for (Rect2D<double> &rect : layer_rect.rects_) {
+          Rect2D<double> shape = orient_rect(rect, component.GetOrientation());
+          shape.ll.x = (shape.ll.x - outline.ll.x) * distance_microns + location.x;
+          shape.ll.y = (shape.ll.y - outline.ll.y) * distance_microns + location.y;
+          shape.ur.x = (shape.ur.x - outline.ll.x) * distance_microns + location.x;
+          shape.ur.y = (shape.ur.y - outline.ll.y) * distance_microns + location.y;
+          if (geometry_.findPinNode(net_id, layer_id, shape, node_id, candidates)) {
+            pin_nodes.push_back(PinNode{pin.InstanceId(), pin.PinId(), node_id});
+            found = true;
+            break;
+          }
+        }
+        if (found) break;
+      }
+    }
+    for (int iopin_id : net.GetIoPinIdsRef()) {
+      IOPin &iopin = iopins[iopin_id];
+      if (iopin.GetPlacementStatus() == PlaceStatus::UNPLACED || iopin.GetLayerName().empty()) continue;
+      Rect2D<int> rect = iopin.GetRect();
+      Rect2D<double> shape = orient_rect(Rect2D<double>(rect.ll.x, rect.ll.y, rect.ur.x, rect.ur.y), iopin.GetOrientation());
+      Point2D<int> location = iopin.GetLocation();
+      shape.ll.x += location.x;
+      shape.ll.y += location.y;
+      shape.ur.x += location.x;
+      shape.ur.y += location.y;
+      if (geometry_.findPinNode(net_id, geometry_.getLayerId(iopin.GetLayerName()), shape, node_id, candidates)) {
+        pin_nodes.push_back(PinNode{-1, iopin_id, node_id});
+      }
+    }
+  };
+  ForEachNet<std::vector<WireSegment *>>(changed_nets.size(), geometry_.getNumThreads(), find_net_pin_nodes);
+
+  for (size_t i = 0; i < changed_nets.size(); ++i) {
+    geometry_.setPinNodes(changed_nets[i]->GetGeometryId(), std::move(net_pin_nodes[i]));
+  }
+}
+
+void PhyDB::AnnotateCapacitance(int corner_index) {
+  PhyDBExpects(corner_index >= 0 && corner_index < capacitance_engine_.NumCorners(),
+               "No capacitance tables for corner " + std::to_string(corner_index)
+                   + ", read a technology configuration file first");
+  geometry_.annotateCapacitance(capacitance_engine_, corner_index, tech_.GetDatabaseMicron());
+}
+
+void PhyDB::EvaluateRCCorners(MultiCornerRC &rc_values, int corner_index) {
+  rc_values.Evaluate(tech_, geometry_, capacitance_engine_, corner_index);
+}
+
+/****
+ * @brief Fills the timing API's Elmore engine for one corner. The driver of a
+ * net is the pin set by Net::SetDriverPin() when there is one, otherwise the
+ * first output cell pin or input IO pin among the net's pin nodes.
+ */
+void PhyDB::ComputeElmoreDelays(int corner_index, int num_threads) {
+  PhyDBWarns(geometry_.getResistorNetwork().empty(),
+             "RC network is empty, call GenerateRCNetwork() before computing delays");
+  MultiCornerRC rc_values;
+  EvaluateRCCorners(rc_values, corner_index);
+
+  std::vector<IOPin> &iopins = design_.GetIoPinsRef();
+  std::vector<ElmoreNet> nets;
+  nets.reserve(design_.GetNetsRef().size());
+  for (Net &net : design_.GetNetsRef()) {
+    unsigned net_id = net.GetGeometryId();
+    const std::vector<PinNode> &pin_nodes = geometry_.getPinNodes(net_id);
+    PhydbPin driver;
+    if (net.GetDriverPinId() >= 0) {
+      driver = net.IsDriverIoPin() ? PhydbPin(-1, net.GetDriverPinId()) : net.GetPinsRef()[net.GetDriverPinId()];
+    }
+    int driver_index = -1;
+    for (size_t i = 0; i < pin_nodes.size() && driver_index < 0; ++i) {
+      PhydbPin pin(pin_nodes[i].instance_id, pin_nodes[i].pin_id);
+      bool is_driver;
+      if (driver.IsValid()) {
+        is_driver = pin == driver;
+      } else if (pin.IsComponentPin()) {
+        is_driver = IsDriverPin(pin);
+      } else {
+        is_driver = iopins[pin.PinId()].GetDirection() == SignalDirection::INPUT;
+      }
+      if (is_driver) driver_index = static_cast<int>(i);
+    }
+    nets.push_back(ElmoreNet{net_id, driver_index});
+  }
+  timing_api_.elmore_engine_.Compute(geometry_, rc_values, corner_index, nets, num_threads);
+}
+
+void PhyDB::AssembleRCMatrices(RCMatrices &matrices, int corner_index, bool contiguous, int num_threads) {
+  MultiCornerRC rc_values;
+  EvaluateRCCorners(rc_values, corner_index);
+  std::vector<unsigned> net_ids;
+  net_ids.reserve(design_.GetNetsRef().size());
+  for (Net &net : design_.GetNetsRef()) {
+    net_ids.push_back(net.GetGeometryId());
+  }
+  matrices.Assemble(geometry_, rc_values, corner_index, net_ids, contiguous, num_threads);
+}
+
+void PhyDB::SaveRCCache(std::string const &cache_file_name) {
+  RCCache::Write(
+      geometry_,
+      cache_file_name,
+      RCCacheHash(geometry_.getExtractedNets(), geometry_.getAnnotatedCorner())
+  );
+}
+
+bool PhyDB::OpenRCCache(std::string const &cache_file_name, ExtractionScope const &scope, int corner_index) {
+  std::vector<unsigned> net_ids = geometry_.getNetsInScope(scope);
+  int annotated_corner = capacitance_engine_.IsEmpty() ? -1 : corner_index;
+  if (!rc_cache_.Open(cache_file_name, RCCacheHash(net_ids, annotated_corner))) {
+    return false;
+  }
+  if (!geometry_.loadRCNetwork(rc_cache_, net_ids)) {
+    PhyDBWarns(true, "RC cache " + cache_file_name + " does not match the wire segments loaded, ignoring it");
+    rc_cache_.Close();
+    return false;
+  }
+  FindPinNodes();
+  timing_api_.elmore_engine_.Clear();
+  return true;
+}
+
+/****
+ * @brief Hash an RC cache is keyed on: the LEF/DEF and technology configuration
+ * file contents, then the settings a network depends on and the names of the
+ * nets extracted, so a network is only reused where extracting would rebuild it.
+ */
+uint64_t PhyDB::RCCacheHash(std::vector<unsigned> const &net_ids, int annotated_corner) {
+  std::vector<std::string> file_names = source_files_;
+  file_names.insert(file_names.end(), tech_config_files_.begin(), tech_config_files_.end());
+  std::ostringstream settings;
+  settings.precision(17);
+  settings << "spatial_index " << static_cast<int>(geometry_.getSpatialIndex()) << "\n"
+           << "neighbour_distance " << geometry_.getNeighbourDistance() << "\n"
+           << "annotated_corner " << annotated_corner << "\n";
+  std::vector<std::string> net_names;
+  net_names.reserve(net_ids.size());
+  for (unsigned net_id : net_ids) {
+    net_names.push_back(geometry_.getNetName(net_id));
+  }
+  std::sort(net_names.begin(), net_names.end());
+  for (std::string const &net_name : net_names) {
+    settings << "net " << net_name << "\n";
+  }
+  return HashFileContents(file_names, settings.str());
+}
+
+void PhyDB::WriteSpef(
+    std::string const &spef_file_name,
+    int corner_index,
+    int num_threads,
+    RCReductionOptions const &reduction
+) {
+  phydb::WriteSpef(this, spef_file_name, corner_index, num_threads, reduction);
+}
+
 void PhyDB::WriteCluster(std::string const &cluster_file_name) {
   std::ofstream outfile(cluster_file_name.c_str());
   if (outfile.is_open()) {
@@ -1388,12 +1698,14 @@ void PhyDB::WriteCluster(std::string const &cluster_file_name) {
 }
 
 void PhyDB::WriteGuide(std::string const &guide_file_name) {
-  std::ofstream outfile(guide_file_name.c_str());
-  if (outfile.is_open()) {
+  FILE *file = OpenOutputFile(guide_file_name);
+  if (file != nullptr) {
     std::cout << "writing guide file: " << guide_file_name << "\n";
   } else {
     PhyDBExpects(false, "Cannot open output guide file " + guide_file_name);
   }
+  FileStreamBuf file_buf(file);
+  std::ostream outfile(&file_buf);
 
   auto design_p = this->GetDesignPtr();
   auto tech_p = this->GetTechPtr();
@@ -1414,6 +1726,7 @@ void PhyDB::WriteGuide(std::string const &guide_file_name) {
     }
     outfile << ")" << std::endl;
   }
+  fclose(file);
 }
 
 #if PHYDB_USE_GALOIS
@@ -22,12 +22,18 @@
 #define PHYDB_PHYDB_H_
 
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include "datatype.h"
 #include "design.h"
 #include "geometry.h"
+#include "rccache.h"
+#include "rcreduction.h"
 #include "phydb/timing/actphydbtimingapi.h"
+#include "phydb/timing/capacitanceengine.h"
+#include "phydb/timing/multicornerrc.h"
+#include "phydb/timing/rcmatrices.h"
 #include "tech.h"
 
 namespace phydb {
@@ -43,6 +49,8 @@ class PhyDB {
   Design &design();
   Geometry *GetGeometryPtr();
   Geometry &geometry();
+  RCCache &rc_cache();
+  CapacitanceEngine &capacitance_engine();
 
 
   /************************************************
@@ -205,14 +213,40 @@ class PhyDB {
 
   WireSegment *AddWireSegment(WireSegment &seg);
 
-  void AddLefViaGeometry(LefVia *via_ptr, int &segment_id, std::string net_name, Point2D<double> offset);
+  // the via's shapes are converted to DBU once, later instances only move them to offset
+  void AddLefViaGeometry(LefVia *via_ptr, int &segment_id, std::string const &net_name, Point2D<double> offset);
 
-  void AddDefViaGeometry(DefVia *via_ptr, int &segment_id, std::string net_name, Point2D<double> offset);
+  void AddDefViaGeometry(DefVia *via_ptr, int &segment_id, std::string const &net_name, Point2D<double> offset);
 
   void AddRectGeometry(std::string layer_name, int &net_segment_id, std::string net_name, Rect2D<double> rect);
 
-  void GenerateRCNetwork() { geometry_.generateRCNetwork(); }
+  // after the first call only nets whose geometry changed since the last one are re-extracted
+  // capacitors get fF values for corner 0 when a technology configuration file has been read
+  void GenerateRCNetwork(int num_threads = 1);
+  // only nets in scope (a net list, a name predicate and/or a DBU window) are extracted, their neighbours couple
+  // to them without being extracted and SPEF reports those couplings as ground capacitance
+  void GenerateRCNetwork(ExtractionScope const &scope, int num_threads = 1);
+  void AnnotateCapacitance(int corner_index);
+  // resistance and capacitance of every RC element for all corners at once, or for corner_index only
+  void EvaluateRCCorners(MultiCornerRC &rc_values, int corner_index = -1);
+  // Elmore delay and slew from every net's driver to its loads, read back through GetTimingApi()
+  void ComputeElmoreDelays(int corner_index = 0, int num_threads = 1);
+  // sparse G and C of every net, indexed like the design's nets
+  void AssembleRCMatrices(RCMatrices &matrices, int corner_index = 0, bool contiguous = true, int num_threads = 1);
+  void RemoveNetGeometry(std::string const &net_name) { geometry_.removeSegmentsOfNet(net_name); }
   void PrintRCNetwork(std::ostream &s) { geometry_.printRCNetwork(s); }
+  // the cache is tied to the contents of every LEF/DEF and technology configuration
+  // file read so far and to the extraction settings: spatial index, neighbour
+  // distance, the nets extracted and the corner annotated. OpenRCCache() rejects a
+  // cache built otherwise and returns false; a matching one replaces the RC network
+  // as GenerateRCNetwork(scope) followed by AnnotateCapacitance(corner_index) would
+  // (the corner is ignored without capacitance tables)
+  void SaveRCCache(std::string const &cache_file_name);
+  bool OpenRCCache(
+      std::string const &cache_file_name,
+      ExtractionScope const &scope = ExtractionScope(),
+      int corner_index = 0
+  );
 
   /************************************************
   * The following APIs are for setting up callback functions for timing-driven flow
@@ -341,7 +375,21 @@ class PhyDB {
   * ************************************************/
 
   void ReadLef(std::string const &lef_file_name);
+  void ReadLefs(std::vector<std::string> const &lef_file_names, int num_threads = 1);
   void ReadDef(std::string const &def_file_name);
+  // ReadDef() parses COMPONENTS, PINS and NETS with DefNativeReader, on num_threads threads, and the rest with Si2
+  void UseNativeDefReader(bool use_native = true, int num_threads = 1) {
+    native_def_reader_ = use_native;
+    native_def_reader_threads_ = num_threads;
+  }
+  // what ReadDef() loads; with geometry_nets, wire segments are built for these (special) nets only, in any mode,
+  // and in CONNECTIVITY mode the special nets listed are loaded as well
+  void SetDefLoadMode(DefLoadMode mode, std::vector<std::string> const &geometry_nets = {});
+  DefLoadMode GetDefLoadMode() const { return def_load_mode_; }
+  bool IsNetGeometryLoaded(std::string const &net_name) const;
+  bool IsAnyNetGeometryLoaded() const {
+    return def_load_mode_ == DefLoadMode::FULL_GEOMETRY || !def_geometry_nets_.empty();
+  }
   void OverrideComponentLocsFromDef(std::string const &def_file_name);
   void ReadCell(std::string const &cell_file_name);
   void ReadCluster(std::string const &cluster_file_name);
@@ -351,12 +399,31 @@ class PhyDB {
   void WriteDef(std::string const &def_file_name);
   void WriteCluster(std::string const &cluster_file_name);
   void WriteGuide(std::string const &guide_file_name);
+  // parasitics of the last GenerateRCNetwork(), formatted on num_threads threads, optionally reduced first
+  void WriteSpef(
+      std::string const &spef_file_name,
+      int corner_index = 0,
+      int num_threads = 1,
+      RCReductionOptions const &reduction = RCReductionOptions()
+  );
 
  private:
   Tech tech_;
   Design design_;
   Geometry geometry_;
   ActPhyDBTimingAPI timing_api_;
+  std::vector<std::string> source_files_; // LEF/DEF files in the order they were read
+  std::vector<std::string> tech_config_files_; // technology configuration files in the order they were read
+  RCCache rc_cache_;
+  CapacitanceEngine capacitance_engine_; // built from the technology configuration tables
+  bool native_def_reader_ = false;
+  int native_def_reader_threads_ = 1;
+  DefLoadMode def_load_mode_ = DefLoadMode::FULL_GEOMETRY;
+  std::unordered_set<std::string> def_geometry_nets_; // empty: decided by def_load_mode_
+
+  void FindPinNodes();
+  uint64_t RCCacheHash(std::vector<unsigned> const &net_ids, int annotated_corner);
+  void AddViaShapes(std::vector<ViaShape> const &shapes, int &segment_id, unsigned net_id, Point2D<double> offset);
 
 #if PHYDB_USE_GALOIS
   void BindPhydbPinToActPin_(PhydbPin &phydb_pin);
@@ -0,0 +1,373 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+#include "rccache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "phydb/common/logging.h"
+
+namespace phydb {
+
+namespace {
+
+const char kMagic[8] = {'P', 'H', 'Y', 'D', 'B', 'R', 'C', '\0'};
+const uint32_t kByteOrderMark = 0x01020304;
+
+uint64_t AlignUp(uint64_t offset) {
+  return (offset + 7) & ~static_cast<uint64_t>(7);
+}
+
+// appends sections at 8 byte aligned offsets
+class SectionWriter {
+ public:
+  explicit SectionWriter(std::ofstream &out) : out_(out), offset_(0) {}
+
+  uint64_t Offset() const { return offset_; }
+
+  void Write(const void *data, size_t size) {
+    out_.write(static_cast<const char *>(data), size);
+    offset_ += size;
+  }
+
+  void Pad() {
+    static const char zeros[8] = {};
+    Write(zeros, AlignUp(offset_) - offset_);
+  }
+
+ private:
+  std::ofstream &out_;
+  uint64_t offset_;
+};
+
+}
+
+struct RCCache::Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t source_hash;
+  uint64_t file_size;
+  int32_t annotated_corner;
+  uint32_t reserved;
+
+  uint64_t num_nets;
+  uint64_t num_layers;
+  uint64_t num_segments;
+  uint64_t num_resistors;
+  uint64_t num_capacitors;
+
+  // byte offsets of the sections from the start of the file
+  uint64_t net_name_offsets; // num_nets + 1 uint64_t into net_name_chars
+  uint64_t net_name_chars;
+  uint64_t layer_name_offsets; // num_layers + 1 uint64_t into layer_name_chars
+  uint64_t layer_name_chars;
+  uint64_t net_num_nodes; // num_nets NodeId
+  uint64_t net_wire_nodes; // num_nets NodeId
+  uint64_t net_segment_offsets; // num_nets + 1 uint64_t into segments
+  uint64_t segments;
+  uint64_t resistors;
+  uint64_t capacitors;
+};
+
+RCCache::~RCCache() {
+  Close();
+}
+
+void RCCache::Write(Geometry const &geometry, std::string const &file_name, uint64_t source_hash) {
+  size_t num_nets = geometry.getNumNets();
+  size_t num_layers = geometry.getNumLayers();
+
+  // flatten the names and segments first, every section size is known before anything is written
+  std::vector<uint64_t> net_name_offsets(1, 0), layer_name_offsets(1, 0);
+  std::string net_name_chars, layer_name_chars;
+  std::vector<NodeId> net_num_nodes(num_nets), net_wire_nodes(num_nets);
+  std::vector<uint64_t> net_segment_offsets(1, 0);
+  std::vector<CachedSegment> segments;
+  std::unordered_map<const WireSegment *, uint64_t> segment_index;
+  for (unsigned net_id = 0; net_id < num_nets; ++net_id) {
+    net_name_chars.append(geometry.getNetName(net_id));
+    net_name_offsets.push_back(net_name_chars.size());
+    net_num_nodes[net_id] = geometry.getNumNodes(net_id);
+    net_wire_nodes[net_id] = geometry.getNumWireNodes(net_id);
+    for (ArenaPtr<WireSegment> const &seg : geometry.getNetSegments(net_id)) {
+      Rect2D<double> rect = seg->getRect();
+      Point2D<double> p1 = seg->getP1(), p2 = seg->getP2();
+      segment_index.emplace(seg.get(), segments.size());
+      segments.push_back(CachedSegment{
+          rect.ll.x, rect.ll.y, rect.ur.x, rect.ur.y,
+          p1.x, p1.y, p2.x, p2.y,
+          seg->getNetId(), seg->getLayerId(), seg->getSegmentNumber(), 0
+      });
+    }
+    net_segment_offsets.push_back(segments.size());
+  }
+  for (int layer_id = 0; layer_id < static_cast<int>(num_layers); ++layer_id) {
+    layer_name_chars.append(geometry.getLayerName(layer_id));
+    layer_name_offsets.push_back(layer_name_chars.size());
+  }
+
+  const std::vector<ArenaPtr<Resistor>> &resistor_network = geometry.getResistorNetwork();
+  const std::vector<ArenaPtr<Capacitor>> &capacitor_network = geometry.getCapacitorNetwork();
+
+  Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.byte_order = kByteOrderMark;
+  header.source_hash = source_hash;
+  header.annotated_corner = geometry.getAnnotatedCorner();
+  header.num_nets = num_nets;
+  header.num_layers = num_layers;
+  header.num_segments = segments.size();
+  header.num_resistors = resistor_network.size();
+  header.num_capacitors = capacitor_network.size();
+
+  uint64_t offset = AlignUp(sizeof(Header));
+  auto place = [&offset](uint64_t &section, uint64_t size) {
+    section = offset;
+    offset = AlignUp(offset + size);
+  };
+  place(header.net_name_offsets, net_name_offsets.size() * sizeof(uint64_t));
+  place(header.net_name_chars, net_name_chars.size());
+  place(header.layer_name_offsets, layer_name_offsets.size() * sizeof(uint64_t));
+  place(header.layer_name_chars, layer_name_chars.size());
+  place(header.net_num_nodes, net_num_nodes.size() * sizeof(NodeId));
+  place(header.net_wire_nodes, net_wire_nodes.size() * sizeof(NodeId));
+  place(header.net_segment_offsets, net_segment_offsets.size() * sizeof(uint64_t));
+  place(header.segments, segments.size() * sizeof(CachedSegment));
+  place(header.resistors, resistor_network.size() * sizeof(CachedResistor));
+  place(header.capacitors, capacitor_network.size() * sizeof(CachedCapacitor));
+  header.file_size = offset;
+
+  // written next to the target and renamed, readers never map a partial cache
+  std::string tmp_file_name = file_name + ".tmp";
+  std::ofstream out(tmp_file_name, std::ios::binary | std::ios::trunc);
+  PhyDBExpects(out.is_open(), "Cannot open output RC cache file " + tmp_file_name);
+  SectionWriter writer(out);
+  writer.Write(&header, sizeof(header));
+  writer.Pad();
+  writer.Write(net_name_offsets.data(), net_name_offsets.size() * sizeof(uint64_t));
+  writer.Pad();
+  writer.Write(net_name_chars.data(), net_name_chars.size());
+  writer.Pad();
+  writer.Write(layer_name_offsets.data(), layer_name_offsets.size() * sizeof(uint64_t));
+  writer.Pad();
+  writer.Write(layer_name_chars.data(), layer_name_chars.size());
+  writer.Pad();
+  writer.Write(net_num_nodes.data(), net_num_nodes.size() * sizeof(NodeId));
+  writer.Pad();
+  writer.Write(net_wire_nodes.data(), net_wire_nodes.size() * sizeof(NodeId));
+  writer.Pad();
+  writer.Write(net_segment_offsets.data(), net_segment_offsets.size() * sizeof(uint64_t));
+  writer.Pad();
+  writer.Write(segments.data(), segments.size() * sizeof(CachedSegment));
+  writer.Pad();
+
+  // resistors and capacitors go out in batches to keep the staging buffer small
+  const size_t batch_size = 4096;
+  std::vector<CachedResistor> resistors;
+  resistors.reserve(batch_size);
+  for (size_t i = 0; i < resistor_network.size(); ++i) {
+    Resistor *res = resistor_network[i].get();
+    std::unordered_map<const WireSegment *, uint64_t>::const_iterator owner = segment_index.find(res->getOwnerSegment());
+    resistors.push_back(CachedResistor{
+        res->getLength(), res->getWidth(), res->getArea(), res->getGroundCapacitance(),
+        res->getP1().x, res->getP1().y, res->getP2().x, res->getP2().y,
+        res->getNetId(), res->getNodeId1(), res->getNodeId2(), res->getLayerId(),
+        owner == segment_index.end() ? ~static_cast<uint64_t>(0) : owner->second
+    });
+    if (resistors.size() == batch_size || i + 1 == resistor_network.size()) {
+      writer.Write(resistors.data(), resistors.size() * sizeof(CachedResistor));
+      resistors.clear();
+    }
+  }
+  writer.Pad();
+  std::vector<CachedCapacitor> capacitors;
+  capacitors.reserve(batch_size);
+  for (size_t i = 0; i < capacitor_network.size(); ++i) {
+    Capacitor *cap = capacitor_network[i].get();
+    capacitors.push_back(CachedCapacitor{
+        cap->getOverlapLength(), cap->getDistance(), cap->getWidth(), cap->getCapacitance(),
+        cap->getRegion().ll.x, cap->getRegion().ll.y, cap->getRegion().ur.x, cap->getRegion().ur.y,
+        cap->getNetId1(), cap->getNodeId1(), cap->getNetId2(), cap->getNodeId2(), cap->getLayerId(), 0
+    });
+    if (capacitors.size() == batch_size || i + 1 == capacitor_network.size()) {
+      writer.Write(capacitors.data(), capacitors.size() * sizeof(CachedCapacitor));
+      capacitors.clear();
+    }
+  }
+  writer.Pad();
+  out.close();
+  PhyDBExpects(out.good() && writer.Offset() == header.file_size, "Cannot write RC cache file " + tmp_file_name);
+  PhyDBExpects(std::rename(tmp_file_name.c_str(), file_name.c_str()) == 0, "Cannot move RC cache file to " + file_name);
+}
+
+/****
+ * @brief Maps an RC cache file read-only.
+ *
+ * @param file_name: the cache file
+ * @param source_hash: hash of the LEF/DEF and technology configuration files
+ * the current design was loaded from and of the extraction settings expected
+ * @return true if the cache is usable, false if it is missing, truncated, of a
+ * different version or byte order, or was built from different sources or
+ * settings
+ */
+bool RCCache::Open(std::string const &file_name, uint64_t source_hash) {
+  Close();
+  int fd = open(file_name.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+    close(fd);
+    PhyDBWarns(true, "RC cache " + file_name + " is truncated, ignoring it");
+    return false;
+  }
+  void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) return false;
+  data_ = static_cast<const char *>(data);
+  size_ = st.st_size;
+
+  const Header &h = header();
+  std::string reason;
+  if (memcmp(h.magic, kMagic, sizeof(kMagic)) != 0) {
+    reason = "is not an RC cache";
+  } else if (h.version != kVersion || h.byte_order != kByteOrderMark) {
+    reason = "was written by a different version or on a different byte order";
+  } else if (h.file_size != size_) {
+    reason = "is truncated";
+  } else if (h.source_hash != source_hash) {
+    reason = "was built from different LEF/DEF or technology files or extraction settings";
+  } else if (h.capacitors + h.num_capacitors * sizeof(CachedCapacitor) > size_) {
+    reason = "is corrupted";
+  }
+  if (!reason.empty()) {
+    PhyDBWarns(true, "RC cache " + file_name + " " + reason + ", ignoring it");
+    Close();
+    return false;
+  }
+  return true;
+}
+
+void RCCache::Close() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char *>(data_), size_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+}
+
+size_t RCCache::NumNets() const {
+  return header().num_nets;
+}
+
+size_t RCCache::NumLayers() const {
+  return header().num_layers;
+}
+
+std::string_view RCCache::NetName(unsigned net_id) const {
+  const uint64_t *offsets = Section<uint64_t>(header().net_name_offsets);
+  return std::string_view(Section<char>(header().net_name_chars) + offsets[net_id], offsets[net_id + 1] - offsets[net_id]);
+}
+
+std::string_view RCCache::LayerName(int layer_id) const {
+  const uint64_t *offsets = Section<uint64_t>(header().layer_name_offsets);
+  return std::string_view(Section<char>(header().layer_name_chars) + offsets[layer_id], offsets[layer_id + 1] - offsets[layer_id]);
+}
+
+NodeId RCCache::NumNodes(unsigned net_id) const {
+  return Section<NodeId>(header().net_num_nodes)[net_id];
+}
+
+NodeId RCCache::NumWireNodes(unsigned net_id) const {
+  return Section<NodeId>(header().net_wire_nodes)[net_id];
+}
+
+int RCCache::AnnotatedCorner() const {
+  return header().annotated_corner;
+}
+
+const CachedSegment *RCCache::NetSegmentsBegin(unsigned net_id) const {
+  return Segments() + Section<uint64_t>(header().net_segment_offsets)[net_id];
+}
+
+const CachedSegment *RCCache::NetSegmentsEnd(unsigned net_id) const {
+  return Segments() + Section<uint64_t>(header().net_segment_offsets)[net_id + 1];
+}
+
+const CachedSegment *RCCache::Segments() const {
+  return Section<CachedSegment>(header().segments);
+}
+
+size_t RCCache::NumSegments() const {
+  return header().num_segments;
+}
+
+const CachedResistor *RCCache::Resistors() const {
+  return Section<CachedResistor>(header().resistors);
+}
+
+size_t RCCache::NumResistors() const {
+  return header().num_resistors;
+}
+
+const CachedCapacitor *RCCache::Capacitors() const {
+  return Section<CachedCapacitor>(header().capacitors);
+}
+
+size_t RCCache::NumCapacitors() const {
+  return header().num_capacitors;
+}
+
+uint64_t HashFileContents(std::vector<std::string> const &file_names, std::string const &settings) {
+  uint64_t hash = 14695981039346656037ULL;
+  std::vector<char> buffer(1 << 20);
+  for (std::string const &file_name : file_names) {
+    std::ifstream in(file_name, std::ios::binary);
+    PhyDBExpects(in.is_open(), "Cannot open " + file_name + " to hash it");
+    while (in) {
+      in.read(buffer.data(), buffer.size());
+      std::streamsize count = in.gcount();
+      for (std::streamsize i = 0; i < count; ++i) {
+        hash ^= static_cast<unsigned char>(buffer[i]);
+        hash *= 1099511628211ULL;
+      }
+    }
+    // files are separated so moving bytes from one file to the next changes the hash
+    hash ^= 0xff;
+    hash *= 1099511628211ULL;
+  }
+  for (char c : settings) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+}
@@ -0,0 +1,127 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+#ifndef PHYDB_RCCACHE_H_
+#define PHYDB_RCCACHE_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "geometry.h"
+
+namespace phydb {
+
+/****
+ * On-disk records of the RC cache. They are plain fixed-width structs so a
+ * mapped cache file is used in place, nothing is deserialized. Wire segments
+ * are stored net by net, resistors and capacitors in network order.
+ */
+struct CachedSegment {
+  double llx, lly, urx, ury; // rectangle as extracted, after overlap trimming
+  double p1x, p1y, p2x, p2y;
+  uint32_t net_id;
+  int32_t layer_id;
+  int32_t seg_num;
+  uint32_t reserved;
+};
+
+struct CachedResistor {
+  double length, width, area;
+  double ground_capacitance; // -1 unless annotated
+  double p1x, p1y, p2x, p2y;
+  uint32_t net_id;
+  NodeId node_id1;
+  NodeId node_id2;
+  int32_t layer_id;
+  uint64_t owner_segment; // index into the segment records, ~0 if none
+};
+
+struct CachedCapacitor {
+  double overlap_length, distance, width;
+  double capacitance; // -1 unless annotated
+  double region_llx, region_lly, region_urx, region_ury; // gap between the wires
+  uint32_t net_id1;
+  NodeId node_id1;
+  uint32_t net_id2;
+  NodeId node_id2;
+  int32_t layer_id;
+  uint32_t reserved;
+};
+
+/****
+ * A read-only, memory-mapped snapshot of Geometry's segments and RC network.
+ * Write() stores the current network with a hash of the LEF/DEF and technology
+ * configuration contents and of the extraction settings it was built with.
+ * Open() maps a cache and rejects it when the version, the byte order or the
+ * source hash does not match, so stale caches are never used; Geometry::
+ * loadRCNetwork() then takes the network over. Net and layer ids are the ids
+ * Geometry handed out when it was saved.
+ */
+class RCCache {
+ public:
+  static const uint32_t kVersion = 4;
+
+  RCCache() = default;
+  ~RCCache();
+  RCCache(const RCCache &) = delete;
+  RCCache &operator=(const RCCache &) = delete;
+
+  static void Write(Geometry const &geometry, std::string const &file_name, uint64_t source_hash);
+  bool Open(std::string const &file_name, uint64_t source_hash);
+  void Close();
+  bool IsOpen() const { return data_ != nullptr; }
+
+  size_t NumNets() const;
+  size_t NumLayers() const;
+  std::string_view NetName(unsigned net_id) const;
+  std::string_view LayerName(int layer_id) const;
+  NodeId NumNodes(unsigned net_id) const;
+  NodeId NumWireNodes(unsigned net_id) const; // nodes made before couplings split the net's resistors
+  int AnnotatedCorner() const; // corner the capacitance values are for, -1 if not annotated
+
+  // segments of one net, and of every net
+  const CachedSegment *NetSegmentsBegin(unsigned net_id) const;
+  const CachedSegment *NetSegmentsEnd(unsigned net_id) const;
+  const CachedSegment *Segments() const;
+  size_t NumSegments() const;
+  const CachedResistor *Resistors() const;
+  size_t NumResistors() const;
+  const CachedCapacitor *Capacitors() const;
+  size_t NumCapacitors() const;
+
+ private:
+  struct Header;
+
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+
+  const Header &header() const { return *reinterpret_cast<const Header *>(data_); }
+  template<typename T>
+  const T *Section(uint64_t offset) const { return reinterpret_cast<const T *>(data_ + offset); }
+};
+
+// FNV-1a over the contents of the files in order, then over settings, for RCCache source hashes
+uint64_t HashFileContents(std::vector<std::string> const &file_names, std::string const &settings = std::string());
+
+}
+
+#endif //PHYDB_RCCACHE_H_
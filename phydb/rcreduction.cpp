@@ -0,0 +1,217 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+#include "rcreduction.h"
+
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+
+namespace phydb {
+
+namespace {
+
+NodeId Resolve(std::vector<NodeId> &node_map, NodeId node_id) {
+  NodeId root = node_id;
+  while (node_map[root] != root) root = node_map[root];
+  while (node_map[node_id] != root) {
+    NodeId next = node_map[node_id];
+    node_map[node_id] = root;
+    node_id = next;
+  }
+  return root;
+}
+
+// nodes that carry a resistor, a ground capacitor or a coupling
+size_t CountNodes(NetRC const &net) {
+  std::vector<bool> used(net.ground_caps.size(), false);
+  for (RCBranch const &res : net.resistors) {
+    used[res.node1] = true;
+    used[res.node2] = true;
+  }
+  for (NodeId node_id = 0; node_id < net.ground_caps.size(); ++node_id) {
+    if (net.ground_caps[node_id] > 0) used[node_id] = true;
+  }
+  for (RCCoupling const &coupling : net.couplings) {
+    used[coupling.node] = true;
+  }
+  return std::count(used.begin(), used.end(), true);
+}
+
+size_t CountGroundCaps(NetRC const &net) {
+  return std::count_if(net.ground_caps.begin(), net.ground_caps.end(), [](double cap) { return cap > 0; });
+}
+
+}
+
+bool RCReductionOptions::IsEnabled() const {
+  return merge_series || min_resistance > 0 || min_capacitance > 0 || coupling_ratio > 0;
+}
+
+void RCReductionStats::Add(RCReductionStats const &other) {
+  nodes_before += other.nodes_before;
+  nodes_after += other.nodes_after;
+  resistors_before += other.resistors_before;
+  resistors_after += other.resistors_after;
+  ground_caps_before += other.ground_caps_before;
+  ground_caps_after += other.ground_caps_after;
+  couplings_before += other.couplings_before;
+  couplings_after += other.couplings_after;
+}
+
+void RCReductionStats::Report() const {
+  std::cout << "RC reduction:\n"
+            << "  nodes        " << nodes_before << " -> " << nodes_after << "\n"
+            << "  resistors    " << resistors_before << " -> " << resistors_after << "\n"
+            << "  ground caps  " << ground_caps_before << " -> " << ground_caps_after << "\n"
+            << "  couplings    " << couplings_before << " -> " << couplings_after << "\n";
+}
+
+void NetRC::Reset(NodeId num_nodes) {
+  resistors.clear();
+  ground_caps.assign(num_nodes, 0);
+  couplings.clear();
+  node_map.resize(num_nodes);
+  std::iota(node_map.begin(), node_map.end(), 0);
+}
+
+double NetRC::TotalCapacitance() const {
+  double total = 0;
+  for (RCCoupling const &coupling : couplings) {
+    total += coupling.capacitance;
+  }
+  for (double cap : ground_caps) {
+    total += cap;
+  }
+  return total;
+}
+
+void ReduceNet(
+    NetRC &net,
+    size_t net_index,
+    std::vector<NodeId> const &pin_nodes,
+    std::vector<double> const &net_totals,
+    RCReductionOptions const &options,
+    RCReductionStats &stats
+) {
+  NodeId num_nodes = static_cast<NodeId>(net.ground_caps.size());
+  stats.nodes_before += CountNodes(net);
+  stats.resistors_before += net.resistors.size();
+  stats.ground_caps_before += CountGroundCaps(net);
+  stats.couplings_before += net.couplings.size();
+
+  std::vector<bool> is_pin(num_nodes, false);
+  for (NodeId node_id : pin_nodes) {
+    if (node_id < num_nodes) is_pin[node_id] = true;
+  }
+
+  // (1) small couplings go to ground, tiny ones are dropped
+  size_t num_kept = 0;
+  for (RCCoupling &coupling : net.couplings) {
+    double total = std::min(net_totals[net_index], net_totals[coupling.other_net]);
+    if (coupling.capacitance < options.coupling_ratio * total) {
+      net.ground_caps[coupling.node] += coupling.capacitance;
+    } else if (coupling.capacitance >= options.min_capacitance) {
+      net.couplings[num_kept++] = coupling;
+    }
+  }
+  net.couplings.resize(num_kept);
+
+  // (2) short small resistors, a merged group is named after its pin node if it has one
+  std::vector<bool> is_dead(net.resistors.size(), false);
+  if (options.min_resistance > 0) {
+    for (size_t i = 0; i < net.resistors.size(); ++i) {
+      RCBranch &res = net.resistors[i];
+      if (res.resistance >= options.min_resistance) continue;
+      NodeId root1 = Resolve(net.node_map, res.node1);
+      NodeId root2 = Resolve(net.node_map, res.node2);
+      if (root1 != root2) {
+        if (is_pin[root1] && is_pin[root2]) continue;
+        if (is_pin[root2]) std::swap(root1, root2);
+        net.node_map[root2] = root1;
+        net.ground_caps[root1] += net.ground_caps[root2];
+        net.ground_caps[root2] = 0;
+      }
+      is_dead[i] = true;
+    }
+    for (size_t i = 0; i < net.resistors.size(); ++i) {
+      if (is_dead[i]) continue;
+      RCBranch &res = net.resistors[i];
+      res.node1 = Resolve(net.node_map, res.node1);
+      res.node2 = Resolve(net.node_map, res.node2);
+      if (res.node1 == res.node2) is_dead[i] = true;
+    }
+  }
+
+  // (3) merge the two resistors of every internal node that has exactly two, in node order
+  if (options.merge_series) {
+    std::vector<std::vector<size_t>> adjacent(num_nodes);
+    for (size_t i = 0; i < net.resistors.size(); ++i) {
+      if (is_dead[i]) continue;
+      adjacent[net.resistors[i].node1].push_back(i);
+      adjacent[net.resistors[i].node2].push_back(i);
+    }
+    for (NodeId node_id = 0; node_id < num_nodes; ++node_id) {
+      if (is_pin[node_id] || adjacent[node_id].size() != 2) continue;
+      RCBranch &res1 = net.resistors[adjacent[node_id][0]];
+      RCBranch &res2 = net.resistors[adjacent[node_id][1]];
+      NodeId end1 = res1.node1 == node_id ? res1.node2 : res1.node1;
+      NodeId end2 = res2.node1 == node_id ? res2.node2 : res2.node1;
+      if (end1 == end2) continue; // parallel resistors
+
+      double resistance = res1.resistance + res2.resistance;
+      double fraction = resistance > 0 ? res1.resistance / resistance : 0.5;
+      net.ground_caps[end1] += net.ground_caps[node_id] * (1 - fraction);
+      net.ground_caps[end2] += net.ground_caps[node_id] * fraction;
+      net.ground_caps[node_id] = 0;
+      net.node_map[node_id] = fraction <= 0.5 ? end1 : end2;
+
+      res1 = RCBranch{end1, end2, resistance};
+      size_t merged = adjacent[node_id][1];
+      is_dead[merged] = true;
+      std::replace(adjacent[end2].begin(), adjacent[end2].end(), merged, adjacent[node_id][0]);
+      adjacent[node_id].clear();
+    }
+  }
+
+  size_t num_alive = 0;
+  for (size_t i = 0; i < net.resistors.size(); ++i) {
+    if (!is_dead[i]) net.resistors[num_alive++] = net.resistors[i];
+  }
+  net.resistors.resize(num_alive);
+  for (NodeId node_id = 0; node_id < num_nodes; ++node_id) {
+    Resolve(net.node_map, node_id);
+  }
+  for (RCCoupling &coupling : net.couplings) {
+    coupling.node = net.node_map[coupling.node];
+  }
+
+  // (4) capacitors too small to matter
+  for (double &cap : net.ground_caps) {
+    if (cap < options.min_capacitance) cap = 0;
+  }
+
+  stats.nodes_after += CountNodes(net);
+  stats.resistors_after += net.resistors.size();
+  stats.ground_caps_after += CountGroundCaps(net);
+  stats.couplings_after += net.couplings.size();
+}
+
+}
@@ -0,0 +1,109 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+#ifndef PHYDB_RCREDUCTION_H_
+#define PHYDB_RCREDUCTION_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "geometry.h"
+
+namespace phydb {
+
+/****
+ * Thresholds of the optional reduction applied to the RC network before it is
+ * exported. The defaults reduce nothing. Capacitances are in the unit of the
+ * exported corner (fF with technology configuration tables).
+ */
+struct RCReductionOptions {
+  bool merge_series = false; // merge the two resistors of internal nodes that have exactly two
+  double min_resistance = 0; // resistors below this many ohms are shorted
+  double min_capacitance = 0; // ground and coupling capacitors below this are dropped
+  double coupling_ratio = 0; // couplings below this fraction of either net's total capacitance are grounded
+
+  bool IsEnabled() const;
+};
+
+struct RCReductionStats {
+  size_t nodes_before = 0;
+  size_t nodes_after = 0;
+  size_t resistors_before = 0;
+  size_t resistors_after = 0;
+  size_t ground_caps_before = 0;
+  size_t ground_caps_after = 0;
+  size_t couplings_before = 0;
+  size_t couplings_after = 0;
+
+  void Add(RCReductionStats const &other);
+  void Report() const;
+};
+
+struct RCBranch {
+  NodeId node1;
+  NodeId node2;
+  double resistance;
+};
+
+struct RCCoupling {
+  NodeId node;
+  size_t other_net; // the exporter's index of the other net
+  NodeId other_node;
+  double capacitance;
+};
+
+/****
+ * Electrical view of one net: resistances, ground capacitance per node and
+ * couplings to other nets. node_map sends every node to the node it has been
+ * merged into (itself if it was kept), so couplings seen from the other net
+ * can be renamed consistently.
+ */
+struct NetRC {
+  std::vector<RCBranch> resistors;
+  std::vector<double> ground_caps; // indexed by node id
+  std::vector<RCCoupling> couplings;
+  std::vector<NodeId> node_map;
+
+  void Reset(NodeId num_nodes);
+  double TotalCapacitance() const;
+};
+
+/****
+ * Reduces one net in place. Couplings below options.coupling_ratio of the
+ * smaller of the two nets' totals are moved to ground first; net_totals holds
+ * every net's total capacitance before any reduction, indexed like
+ * RCCoupling::other_net, so both sides of a coupling decide the same way.
+ * Then sub-threshold resistors are shorted, series resistors merged (ground
+ * capacitance of the removed node is split in proportion to the resistances,
+ * couplings move to the nearer end) and sub-threshold capacitors dropped.
+ * Pin nodes are never merged away.
+ */
+void ReduceNet(
+    NetRC &net,
+    size_t net_index,
+    std::vector<NodeId> const &pin_nodes,
+    std::vector<double> const &net_totals,
+    RCReductionOptions const &options,
+    RCReductionStats &stats
+);
+
+}
+
+#endif //PHYDB_RCREDUCTION_H_
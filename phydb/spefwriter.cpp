@@ -0,0 +1,483 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+#include "spefwriter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <thread>
+
+#include "phydb/common/logging.h"
+
+namespace phydb {
+
+namespace {
+
+const size_t kNetsPerChunk = 256;
+const size_t kFlushBytes = 1 << 22;
+
+// characters other than these have to be escaped in SPEF names
+bool IsSpefNameChar(char c) {
+  return isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '[' || c == ']' || c == '/';
+}
+
+void AppendName(std::string &out, std::string const &name) {
+  for (char c : name) {
+    if (!IsSpefNameChar(c)) out.push_back('\\');
+    out.push_back(c);
+  }
+}
+
+void AppendNumber(std::string &out, double value) {
+  char buf[32];
+  int len = snprintf(buf, sizeof(buf), "%.6g", value);
+  out.append(buf, len);
+}
+
+void AppendNode(std::string &out, size_t net_index, NodeId node_id) {
+  out.push_back('*');
+  out.append(std::to_string(net_index));
+  out.push_back(':');
+  out.append(std::to_string(node_id));
+}
+
+char DirectionChar(SignalDirection direction) {
+  switch (direction) {
+    case SignalDirection::INPUT:return 'I';
+    case SignalDirection::OUTPUT:
+    case SignalDirection::OUTPUT_TRISTATE:return 'O';
+    default:return 'B';
+  }
+}
+
+// everything the per-net formatting reads, shared by all threads
+struct SpefContext {
+  Design *design;
+  Geometry *geometry;
+  double distance_microns;
+  int corner_index;
+  bool annotated; // the RC network carries capacitances evaluated for corner_index
+  std::vector<Layer *> layers; // indexed by geometry layer id
+  std::vector<Net *> nets; // written nets, *NAME_MAP index - 1
+  std::vector<unsigned> geometry_net_ids;
+  std::vector<size_t> name_map_index; // indexed by geometry net id, 0 if the net is not written
+  std::vector<size_t> res_offsets; // per geometry net id, into res_indices
+  std::vector<size_t> res_indices;
+  std::vector<size_t> cap_offsets; // per geometry net id, into cap_indices, a capacitor is listed under both nets
+  std::vector<size_t> cap_indices;
+  std::vector<NetRC> reduced_nets; // by *NAME_MAP index - 1, only when reducing
+  std::vector<std::vector<std::pair<NodeId, std::string>>> pin_names; // by *NAME_MAP index - 1, sorted by node
+};
+
+// SPEF name of a pin, instance:pin for a cell pin and the port name for an IO pin
+std::string PinName(SpefContext const &ctx, PinNode const &pin_node) {
+  std::string name;
+  if (pin_node.instance_id < 0) {
+    AppendName(name, ctx.design->GetIoPinsRef()[pin_node.pin_id].GetName());
+    return name;
+  }
+  Component &component = ctx.design->GetComponentsRef()[pin_node.instance_id];
+  AppendName(name, component.GetName());
+  name.push_back(':');
+  AppendName(name, component.GetMacro()->GetPinsRef()[pin_node.pin_id].GetName());
+  return name;
+}
+
+// the node a pin connects to is written under the pin's name, other nodes as *net:node
+void AppendNodeName(SpefContext const &ctx, size_t net_index, NodeId node_id, std::string &out) {
+  std::vector<std::pair<NodeId, std::string>> const &names = ctx.pin_names[net_index - 1];
+  std::vector<std::pair<NodeId, std::string>>::const_iterator it = std::lower_bound(
+      names.begin(), names.end(), node_id,
+      [](std::pair<NodeId, std::string> const &name, NodeId node) { return name.first < node; }
+  );
+  if (it != names.end() && it->first == node_id) {
+    out.append(it->second);
+  } else {
+    AppendNode(out, net_index, node_id);
+  }
+}
+
+// electrical view of one net at the context's corner, couplings to nets that are not written (e.g. power nets) are grounded
+void BuildNet(SpefContext const &ctx, size_t net_index, NetRC &rc) {
+  unsigned net_id = ctx.geometry_net_ids[net_index - 1];
+  const std::vector<ArenaPtr<Resistor>> &resistors = ctx.geometry->getResistorNetwork();
+  const std::vector<ArenaPtr<Capacitor>> &capacitors = ctx.geometry->getCapacitorNetwork();
+
+  NodeId num_nodes = 0;
+  for (size_t i = ctx.res_offsets[net_id]; i < ctx.res_offsets[net_id + 1]; ++i) {
+    Resistor *res = resistors[ctx.res_indices[i]].get();
+    num_nodes = std::max(num_nodes, std::max(res->getNodeId1(), res->getNodeId2()) + 1);
+  }
+  rc.Reset(num_nodes);
+
+  // wire capacitance to ground is split evenly between the two ends of each wire
+  for (size_t i = ctx.res_offsets[net_id]; i < ctx.res_offsets[net_id + 1]; ++i) {
+    Resistor *res = resistors[ctx.res_indices[i]].get();
+    Layer *layer = ctx.layers[res->getLayerId()];
+    double resistance = 0;
+    if (res->isVertical()) {
+      // one square of the layer, cut layers carry no resistance data
+      double side = std::sqrt(res->getArea());
+      if (layer != nullptr && layer->HasUnitRes(ctx.corner_index)) {
+        resistance = layer->GetResistance(side, side, ctx.corner_index);
+      }
+    } else if (layer != nullptr) {
+      if (layer->HasUnitRes(ctx.corner_index)) {
+        resistance = layer->GetResistance(res->getWidth(), res->getLength(), ctx.corner_index);
+      }
+      if (ctx.annotated) {
+        rc.ground_caps[res->getNodeId1()] += res->getGroundCapacitance() / 2;
+        rc.ground_caps[res->getNodeId2()] += res->getGroundCapacitance() / 2;
+      } else if (layer->HasUnitCap(ctx.corner_index)) {
+        double width = res->getWidth() / ctx.distance_microns;
+        double length = res->getLength() / ctx.distance_microns;
+        double cap = layer->GetAreaCapacitance(width, length, ctx.corner_index)
+            + layer->GetFringeCapacitance(width, length, ctx.corner_index);
+        rc.ground_caps[res->getNodeId1()] += cap / 2;
+        rc.ground_caps[res->getNodeId2()] += cap / 2;
+      }
+    }
+    rc.resistors.push_back(RCBranch{res->getNodeId1(), res->getNodeId2(), resistance});
+  }
+
+  // without tech-config tables there is no coupling capacitance to report
+  if (!ctx.annotated) return;
+  for (size_t i = ctx.cap_offsets[net_id]; i < ctx.cap_offsets[net_id + 1]; ++i) {
+    Capacitor *cap = capacitors[ctx.cap_indices[i]].get();
+    double value = cap->getCapacitance();
+    if (value <= 0) continue;
+
+    bool is_first = cap->getNetId1() == net_id;
+    NodeId own_node = is_first ? cap->getNodeId1() : cap->getNodeId2();
+    unsigned other_net = is_first ? cap->getNetId2() : cap->getNetId1();
+    NodeId other_node = is_first ? cap->getNodeId2() : cap->getNodeId1();
+    if (ctx.name_map_index[other_net] == 0) {
+      rc.ground_caps[own_node] += value;
+      continue;
+    }
+    rc.couplings.push_back(RCCoupling{own_node, ctx.name_map_index[other_net], other_node, value});
+  }
+}
+
+void FormatNet(SpefContext const &ctx, size_t net_index, NetRC const &rc, std::string &out) {
+  out.append("*D_NET *");
+  out.append(std::to_string(net_index));
+  out.push_back(' ');
+  AppendNumber(out, rc.TotalCapacitance());
+  out.append("\n*CONN\n");
+  Net *net = ctx.nets[net_index - 1];
+  std::vector<IOPin> &iopins = ctx.design->GetIoPinsRef();
+  for (int iopin_id : net->GetIoPinIdsRef()) {
+    out.append("*P ");
+    AppendName(out, iopins[iopin_id].GetName());
+    out.push_back(' ');
+    out.push_back(DirectionChar(iopins[iopin_id].GetDirection()));
+    out.push_back('\n');
+  }
+  std::vector<Component> &components = ctx.design->GetComponentsRef();
+  for (PhydbPin &pin : net->GetPinsRef()) {
+    if (!pin.IsComponentPin()) continue;
+    Component &component = components[pin.InstanceId()];
+    Pin &macro_pin = component.GetMacro()->GetPinsRef()[pin.PinId()];
+    out.append("*I ");
+    AppendName(out, component.GetName());
+    out.push_back(':');
+    AppendName(out, macro_pin.GetName());
+    out.push_back(' ');
+    out.push_back(DirectionChar(macro_pin.GetDirection()));
+    out.push_back('\n');
+  }
+  out.append("*CAP\n");
+  size_t cap_count = 0;
+  for (NodeId node_id = 0; node_id < rc.ground_caps.size(); ++node_id) {
+    if (rc.ground_caps[node_id] <= 0) continue;
+    out.append(std::to_string(++cap_count));
+    out.push_back(' ');
+    AppendNodeName(ctx, net_index, node_id, out);
+    out.push_back(' ');
+    AppendNumber(out, rc.ground_caps[node_id]);
+    out.push_back('\n');
+  }
+  for (RCCoupling const &coupling : rc.couplings) {
+    // the other net may have merged its end of the coupling into another node
+    NodeId other_node = coupling.other_node;
+    if (!ctx.reduced_nets.empty()) other_node = ctx.reduced_nets[coupling.other_net - 1].node_map[other_node];
+    out.append(std::to_string(++cap_count));
+    out.push_back(' ');
+    AppendNodeName(ctx, net_index, coupling.node, out);
+    out.push_back(' ');
+    AppendNodeName(ctx, coupling.other_net, other_node, out);
+    out.push_back(' ');
+    AppendNumber(out, coupling.capacitance);
+    out.push_back('\n');
+  }
+  out.append("*RES\n");
+  size_t res_count = 0;
+  for (RCBranch const &res : rc.resistors) {
+    out.append(std::to_string(++res_count));
+    out.push_back(' ');
+    AppendNodeName(ctx, net_index, res.node1, out);
+    out.push_back(' ');
+    AppendNodeName(ctx, net_index, res.node2, out);
+    out.push_back(' ');
+    AppendNumber(out, res.resistance);
+    out.push_back('\n');
+  }
+  // a node reached by several pins is named after the first one, the others are shorted to it
+  std::vector<std::pair<NodeId, std::string>> const &pin_names = ctx.pin_names[net_index - 1];
+  for (size_t i = 1; i < pin_names.size(); ++i) {
+    if (pin_names[i].first != pin_names[i - 1].first) continue;
+    out.append(std::to_string(++res_count));
+    out.push_back(' ');
+    out.append(pin_names[i].second);
+    out.push_back(' ');
+    AppendNodeName(ctx, net_index, pin_names[i].first, out);
+    out.append(" 0\n");
+  }
+  out.append("*END\n\n");
+}
+
+// runs body(first_net, last_net, worker) on chunks of nets, worker w takes every num_workers-th chunk
+template<typename Body>
+void ForEachChunk(size_t num_nets, int num_threads, Body body) {
+  size_t num_chunks = (num_nets + kNetsPerChunk - 1) / kNetsPerChunk;
+  size_t num_workers = std::min(static_cast<size_t>(std::max(num_threads, 1)), std::max(num_chunks, static_cast<size_t>(1)));
+  auto work = [&](size_t worker) {
+    for (size_t chunk = worker; chunk < num_chunks; chunk += num_workers) {
+      body(chunk * kNetsPerChunk + 1, std::min((chunk + 1) * kNetsPerChunk, num_nets) + 1, worker);
+    }
+  };
+  if (num_workers == 1) {
+    work(0);
+    return;
+  }
+  std::vector<std::thread> workers;
+  for (size_t worker = 0; worker < num_workers; ++worker) {
+    workers.emplace_back(work, worker);
+  }
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+}
+
+// groups element indices by net id, an element listed under two nets appears in both groups
+template<typename Element, typename NetsOf>
+void GroupByNet(
+    std::vector<ArenaPtr<Element>> const &elements,
+    size_t num_nets,
+    NetsOf nets_of,
+    std::vector<size_t> &offsets,
+    std::vector<size_t> &indices
+) {
+  offsets.assign(num_nets + 1, 0);
+  for (size_t i = 0; i < elements.size(); ++i) {
+    std::pair<unsigned, unsigned> nets = nets_of(*elements[i]);
+    ++offsets[nets.first + 1];
+    if (nets.second != nets.first) ++offsets[nets.second + 1];
+  }
+  for (size_t i = 0; i < num_nets; ++i) {
+    offsets[i + 1] += offsets[i];
+  }
+  indices.assign(offsets[num_nets], 0);
+  std::vector<size_t> cursor(offsets.begin(), offsets.end() - 1);
+  for (size_t i = 0; i < elements.size(); ++i) {
+    std::pair<unsigned, unsigned> nets = nets_of(*elements[i]);
+    indices[cursor[nets.first]++] = i;
+    if (nets.second != nets.first) indices[cursor[nets.second]++] = i;
+  }
+}
+
+}
+
+void WriteSpef(
+    PhyDB *phy_db_ptr,
+    std::string const &spef_file_name,
+    int corner_index,
+    int num_threads,
+    RCReductionOptions const &reduction
+) {
+  std::ofstream outfile(spef_file_name.c_str());
+  if (outfile.is_open()) {
+    std::cout << "writing SPEF file: " << spef_file_name << "\n";
+  } else {
+    PhyDBExpects(false, "Cannot open output SPEF file " + spef_file_name);
+  }
+
+  SpefContext ctx;
+  ctx.design = phy_db_ptr->GetDesignPtr();
+  ctx.geometry = phy_db_ptr->GetGeometryPtr();
+  ctx.distance_microns = phy_db_ptr->GetTechPtr()->GetDatabaseMicron();
+  ctx.corner_index = corner_index;
+  CapacitanceEngine const &engine = phy_db_ptr->capacitance_engine();
+  if (!engine.IsEmpty() && ctx.geometry->getAnnotatedCorner() != corner_index) {
+    phy_db_ptr->AnnotateCapacitance(corner_index);
+  }
+  ctx.annotated = ctx.geometry->getAnnotatedCorner() == corner_index;
+  PhyDBWarns(ctx.geometry->getResistorNetwork().empty(),
+             "RC network is empty, call GenerateRCNetwork() before writing SPEF");
+
+  for (size_t layer_id = 0; layer_id < ctx.geometry->getNumLayers(); ++layer_id) {
+    ctx.layers.push_back(phy_db_ptr->GetTechPtr()->GetLayerPtr(ctx.geometry->getLayerName(layer_id)));
+  }
+
+  size_t num_nets = ctx.geometry->getNumNets();
+  GroupByNet(ctx.geometry->getResistorNetwork(), num_nets, [](Resistor const &res) {
+    return std::make_pair(res.getNetId(), res.getNetId());
+  }, ctx.res_offsets, ctx.res_indices);
+  GroupByNet(ctx.geometry->getCapacitorNetwork(), num_nets, [](Capacitor const &cap) {
+    return std::make_pair(cap.getNetId1(), cap.getNetId2());
+  }, ctx.cap_offsets, ctx.cap_indices);
+
+  // signal nets in design order, power nets and nets without wires are left out
+  ctx.name_map_index.assign(num_nets, 0);
+  for (Net &net : ctx.design->GetNetsRef()) {
+    unsigned net_id = net.GetGeometryId();
+    if (ctx.res_offsets[net_id] == ctx.res_offsets[net_id + 1]) continue;
+    ctx.nets.push_back(&net);
+    ctx.geometry_net_ids.push_back(net_id);
+    ctx.name_map_index[net_id] = ctx.nets.size();
+  }
+
+  // reducing needs every net built first: coupling folds compare both nets' totals and couplings are
+  // renamed through the other net's node map
+  if (reduction.IsEnabled()) {
+    ctx.reduced_nets.resize(ctx.nets.size());
+    ForEachChunk(ctx.nets.size(), num_threads, [&ctx](size_t first_net, size_t last_net, size_t) {
+      for (size_t net_index = first_net; net_index < last_net; ++net_index) {
+        BuildNet(ctx, net_index, ctx.reduced_nets[net_index - 1]);
+      }
+    });
+    std::vector<double> net_totals(ctx.nets.size() + 1, 0);
+    for (size_t net_index = 1; net_index <= ctx.nets.size(); ++net_index) {
+      net_totals[net_index] = ctx.reduced_nets[net_index - 1].TotalCapacitance();
+    }
+    std::vector<RCReductionStats> stats(static_cast<size_t>(std::max(num_threads, 1)));
+    ForEachChunk(ctx.nets.size(), num_threads, [&](size_t first_net, size_t last_net, size_t worker) {
+      std::vector<NodeId> pin_nodes;
+      for (size_t net_index = first_net; net_index < last_net; ++net_index) {
+        pin_nodes.clear();
+        for (PinNode const &pin_node : ctx.geometry->getPinNodes(ctx.geometry_net_ids[net_index - 1])) {
+          pin_nodes.push_back(pin_node.node_id);
+        }
+        ReduceNet(ctx.reduced_nets[net_index - 1], net_index, pin_nodes, net_totals, reduction, stats[worker]);
+      }
+    });
+    for (size_t worker = 1; worker < stats.size(); ++worker) {
+      stats[0].Add(stats[worker]);
+    }
+    stats[0].Report();
+  }
+
+  // pin names go in place of node names, through the reduced nets' node maps since pin nodes are never removed
+  ctx.pin_names.resize(ctx.nets.size());
+  ForEachChunk(ctx.nets.size(), num_threads, [&ctx](size_t first_net, size_t last_net, size_t) {
+    for (size_t net_index = first_net; net_index < last_net; ++net_index) {
+      std::vector<std::pair<NodeId, std::string>> &names = ctx.pin_names[net_index - 1];
+      for (PinNode const &pin_node : ctx.geometry->getPinNodes(ctx.geometry_net_ids[net_index - 1])) {
+        NodeId node_id = pin_node.node_id;
+        if (!ctx.reduced_nets.empty()) node_id = ctx.reduced_nets[net_index - 1].node_map[node_id];
+        names.emplace_back(node_id, PinName(ctx, pin_node));
+      }
+      std::stable_sort(names.begin(), names.end(), [](std::pair<NodeId, std::string> const &a, std::pair<NodeId, std::string> const &b) {
+        return a.first < b.first;
+      });
+    }
+  });
+
+  std::string buffer;
+  time_t now = time(nullptr);
+  std::string date(ctime(&now));
+  date.pop_back();
+  buffer.append("*SPEF \"IEEE 1481-1998\"\n*DESIGN \"");
+  buffer.append(ctx.design->GetName());
+  buffer.append("\"\n*DATE \"" + date + "\"\n");
+  buffer.append("*VENDOR \"PhyDB\"\n*PROGRAM \"PhyDB\"\n*VERSION \"1.0\"\n");
+  buffer.append("*DESIGN_FLOW \"PIN_CAP NONE\"\n*DIVIDER /\n*DELIMITER :\n*BUS_DELIMITER [ ]\n");
+  // table values are in fF, unit capacitances from LEF (or set by hand) in pF
+  bool in_ff = ctx.annotated || phy_db_ptr->GetTechPtr()->IsUnitCapFromTechConfig();
+  buffer.append("*T_UNIT 1 NS\n*C_UNIT 1 ");
+  buffer.append(in_ff ? "FF" : "PF");
+  buffer.append("\n*R_UNIT 1 OHM\n*L_UNIT 1 HENRY\n\n");
+
+  buffer.append("*NAME_MAP\n");
+  for (size_t i = 0; i < ctx.nets.size(); ++i) {
+    buffer.push_back('*');
+    buffer.append(std::to_string(i + 1));
+    buffer.push_back(' ');
+    AppendName(buffer, ctx.nets[i]->GetName());
+    buffer.push_back('\n');
+  }
+  buffer.append("\n*PORTS\n");
+  for (IOPin &iopin : ctx.design->GetIoPinsRef()) {
+    AppendName(buffer, iopin.GetName());
+    buffer.push_back(' ');
+    buffer.push_back(DirectionChar(iopin.GetDirection()));
+    buffer.push_back('\n');
+  }
+  buffer.push_back('\n');
+
+  // a round formats one chunk of nets per thread into its own buffer, then the chunks are written in order
+  size_t num_chunks = (ctx.nets.size() + kNetsPerChunk - 1) / kNetsPerChunk;
+  size_t chunks_per_round = static_cast<size_t>(std::max(num_threads, 1));
+  std::vector<std::string> chunks(chunks_per_round);
+  std::vector<NetRC> scratch_nets(chunks_per_round);
+  for (size_t round_begin = 0; round_begin < num_chunks; round_begin += chunks_per_round) {
+    size_t round_size = std::min(chunks_per_round, num_chunks - round_begin);
+    auto format_chunk = [&](size_t slot) {
+      size_t first_net = (round_begin + slot) * kNetsPerChunk + 1;
+      size_t last_net = std::min(first_net + kNetsPerChunk, ctx.nets.size() + 1);
+      chunks[slot].clear();
+      for (size_t net_index = first_net; net_index < last_net; ++net_index) {
+        if (ctx.reduced_nets.empty()) {
+          BuildNet(ctx, net_index, scratch_nets[slot]);
+          FormatNet(ctx, net_index, scratch_nets[slot], chunks[slot]);
+        } else {
+          FormatNet(ctx, net_index, ctx.reduced_nets[net_index - 1], chunks[slot]);
+        }
+      }
+    };
+    if (round_size == 1) {
+      format_chunk(0);
+    } else {
+      std::vector<std::thread> workers;
+      for (size_t slot = 0; slot < round_size; ++slot) {
+        workers.emplace_back(format_chunk, slot);
+      }
+      for (std::thread &worker : workers) {
+        worker.join();
+      }
+    }
+
+    for (size_t slot = 0; slot < round_size; ++slot) {
+      buffer.append(chunks[slot]);
+      if (buffer.size() >= kFlushBytes) {
+        outfile.write(buffer.data(), buffer.size());
+        buffer.clear();
+      }
+    }
+  }
+  outfile.write(buffer.data(), buffer.size());
+}
+
+}
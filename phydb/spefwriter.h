@@ -0,0 +1,54 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+#ifndef PHYDB_SPEFWRITER_H_
+#define PHYDB_SPEFWRITER_H_
+
+#include "phydb.h"
+#include "rcreduction.h"
+
+namespace phydb {
+
+/****
+ * Writes the RC network extracted by PhyDB::GenerateRCNetwork() as SPEF.
+ * Every signal net with resistors gets a *D_NET section. Resistances and
+ * capacitances come from the layers' RC units of the given corner, *C_UNIT
+ * is FF for tech-config values and PF for LEF ones, as MultiCornerRC. Nets are
+ * formatted in chunks, on num_threads threads when asked, and written in
+ * net order, so the output does not depend on the thread count. The RC node
+ * a pin connects to (see Geometry::getPinNodes()) is written under the pin's
+ * name, instance:pin or the port name, so *CAP and *RES reach the pins listed
+ * in *CONN; further pins on the same node are tied to it by 0 ohm resistors.
+ *
+ * With reduction thresholds set, every net is first reduced (see ReduceNet()),
+ * pin nodes found by PhyDB::GenerateRCNetwork() are kept, and the node and
+ * element counts before and after are reported.
+ */
+void WriteSpef(
+    PhyDB *phy_db_ptr,
+    std::string const &spef_file_name,
+    int corner_index = 0,
+    int num_threads = 1,
+    RCReductionOptions const &reduction = RCReductionOptions()
+);
+
+}
+
+#endif //PHYDB_SPEFWRITER_H_
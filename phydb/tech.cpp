@@ -187,6 +187,23 @@ Macro *Tech::AddMacro(std::string const &macro_name) {
   return &(macros_.back());
 }
 
+/****
+ * Moves macros read elsewhere, e.g. by LefNativeReader, to the end of the
+ * macro list, in order. A macro name which is already taken is an error, as
+ * it is for AddMacro().
+ */
+void Tech::AddMacros(std::list<Macro> &macros) {
+  while (!macros.empty()) {
+    std::string const &macro_name = macros.front().GetName();
+    PhyDBExpects(
+        !IsMacroExisting(macro_name),
+        "Macro name_ exists, cannot use it again: " << macro_name
+    );
+    macros_.splice(macros_.end(), macros, macros.begin());
+    macro_2_ptr_[macro_name] = &macros_.back();
+  }
+}
+
 Macro *Tech::GetMacroPtr(std::string const &macro_name) {
   if (!IsMacroExisting(macro_name)) {
     return nullptr;
@@ -420,6 +437,7 @@ void Tech::SetResistanceUnit(bool from_tech_config, bool is_report) {
 }
 
 void Tech::SetCapacitanceUnit(bool from_tech_config, bool is_report) {
+  unit_cap_from_tech_config_ = from_tech_config;
   if (from_tech_config) {
     for (auto &metal_ptr : metal_layers_) {
       metal_ptr->SetCapacitanceUnitFromTechConfig();
@@ -472,6 +490,7 @@ void Tech::SetUnitResAndCap(
   PhyDBExpects(unit_res > 0, "Non positive resistance?");
   PhyDBExpects(unit_fringe_cap >= 0, "Negative fringe capacitance?");
   PhyDBExpects(unit_area_cap >= 0, "Negative area capacitance?");
+  unit_cap_from_tech_config_ = false;
   for (auto &metal_ptr : metal_layers_) {
     metal_ptr->unit_res_.assign(1, unit_res);
     metal_ptr->unit_edge_cap_.assign(1, unit_fringe_cap);
@@ -79,6 +79,7 @@ class Tech {
 
   bool IsMacroExisting(std::string const &macro_name);
   Macro *AddMacro(std::string const &macro_name);
+  void AddMacros(std::list<Macro> &macros);
   Macro *GetMacroPtr(std::string const &macro_name);
   std::list<Macro> &GetMacrosRef();
 
@@ -133,6 +134,9 @@ class Tech {
   void FixResOverTable();
   void SetResistanceUnit(bool from_tech_config, bool is_report);
   void SetCapacitanceUnit(bool from_tech_config, bool is_report);
+  // unit capacitances of metal layers are in fF when set from the technology
+  // configuration file, otherwise (LEF or SetUnitResAndCap) in the LEF unit, pF
+  bool IsUnitCapFromTechConfig() const { return unit_cap_from_tech_config_; }
   void ReportLayersTechConfig();
   void SetUnitResAndCap(
       double unit_res,
@@ -192,6 +196,7 @@ class Tech {
 
   /****technology configuration file****/
   TechConfig tech_config_;
+  bool unit_cap_from_tech_config_ = false;
   std::vector<Layer *> metal_layers_;
 };
 
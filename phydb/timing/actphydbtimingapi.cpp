@@ -322,6 +322,24 @@ void ActPhyDBTimingAPI::GetViolatedTimingConstraints(std::vector<int> &violated_
   GetViolatedTimingConstraintsCB(violated_tc_nums);
 }
 
+bool ActPhyDBTimingAPI::IsElmoreReady() const {
+  return !elmore_engine_.IsEmpty();
+}
+
+double ActPhyDBTimingAPI::GetElmoreDelay(int net_id, PhydbPin load_pin) const {
+  ElmoreLoad const *load = elmore_engine_.FindLoad(net_id, load_pin.InstanceId(), load_pin.PinId());
+  return load == nullptr ? -1 : load->delay;
+}
+
+double ActPhyDBTimingAPI::GetElmoreSlew(int net_id, PhydbPin load_pin) const {
+  ElmoreLoad const *load = elmore_engine_.FindLoad(net_id, load_pin.InstanceId(), load_pin.PinId());
+  return load == nullptr ? -1 : load->slew;
+}
+
+ElmoreEngine const &ActPhyDBTimingAPI::GetElmoreEngine() const {
+  return elmore_engine_;
+}
+
 #if PHYDB_USE_GALOIS
 void ActPhyDBTimingAPI::SetParaManager(galois::eda::parasitics::Manager *manager) {
   para_manager_ = manager;
@@ -27,6 +27,7 @@
 #include <boost/functional/hash.hpp>
 
 #include "config.h"
+#include "elmoreengine.h"
 
 #if PHYDB_USE_GALOIS
 #include <galois/eda/liberty/CellLib.h>
@@ -235,6 +236,13 @@ class ActPhyDBTimingAPI {
   double GetSlack(int tc_num);
   void GetViolatedTimingConstraints(std::vector<int> &violated_tc_nums);
 
+  // net-level delays of the last PhyDB::ComputeElmoreDelays(), no external timer needed;
+  // -1 if the pin is not a load of the net or no wire reaches it from the driver
+  bool IsElmoreReady() const;
+  double GetElmoreDelay(int net_id, PhydbPin load_pin) const;
+  double GetElmoreSlew(int net_id, PhydbPin load_pin) const;
+  ElmoreEngine const &GetElmoreEngine() const;
+
 #if PHYDB_USE_GALOIS
   void SetParaManager(galois::eda::parasitics::Manager *manager);
   void AddCellLib(galois::eda::liberty::CellLib *lib);
@@ -311,6 +319,8 @@ class ActPhyDBTimingAPI {
   // act component-pin pointer <=> phydb component-pin index
   std::unordered_map<void *, PhydbPin> component_pin_act_2_id_;
   std::unordered_map<PhydbPin, void *, PhydbPinHasher> component_pin_id_2_act_;
+
+  ElmoreEngine elmore_engine_;
 #if PHYDB_USE_GALOIS
   galois::eda::parasitics::Manager *para_manager_;
   std::vector<galois::eda::liberty::CellLib *> libs_;
@@ -0,0 +1,217 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+#include "capacitanceengine.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "phydb/tech.h"
+
+namespace phydb {
+
+void CapacitanceEngine::Build(Tech &tech) {
+  Clear();
+  std::vector<Layer> &layers = tech.GetLayersRef();
+  layer_to_metal_.assign(layers.size(), -1);
+  int metal_index = 0;
+  for (size_t layer_id = 0; layer_id < layers.size(); ++layer_id) {
+    Layer &layer = layers[layer_id];
+    if (layer.GetType() != LayerType::ROUTING) continue;
+    layer_to_metal_[layer_id] = metal_index++;
+    LayerTechConfig *layer_tech_config = layer.GetLayerTechConfig();
+    if (layer_tech_config == nullptr) continue;
+
+    std::vector<LayerTechConfigCorner> &corners = layer_tech_config->CornersRef();
+    num_corners_ = std::max(num_corners_, static_cast<int>(corners.size()));
+    for (size_t corner_index = 0; corner_index < corners.size(); ++corner_index) {
+      LayerTechConfigCorner &corner = corners[corner_index];
+      for (auto *config_tables : {&corner.GetCapOverRef(), &corner.GetCapUnderRef(),
+                                  &corner.GetCapDiagUnderRef(), &corner.GetCapOverUnderRef()}) {
+        for (ConfigTable &config_table : *config_tables) {
+          std::vector<TableEntry> &entries = config_table.GetTable();
+          if (entries.empty()) continue;
+
+          std::vector<size_t> order(entries.size());
+          std::iota(order.begin(), order.end(), 0);
+          std::stable_sort(order.begin(), order.end(), [&entries](size_t a, size_t b) {
+            return entries[a].distance_ < entries[b].distance_;
+          });
+          Table table;
+          table.width = config_table.Width();
+          for (size_t i : order) {
+            table.distance.push_back(entries[i].distance_);
+            table.coupling.push_back(entries[i].coupling_cap_);
+            table.fringe.push_back(entries[i].fringe_cap_);
+          }
+          // only CAP_OVERUNDER tables have a second context layer, the others leave index1 at 0
+          int index1 = config_table.Type() == CAP_OVERUNDER ? config_table.Index1() : -1;
+          tables_[Key(config_table.Type(), config_table.LayerIndex(), config_table.Index0(),
+                      index1, static_cast<int>(corner_index))].push_back(std::move(table));
+        }
+      }
+    }
+  }
+
+  for (auto &key_tables : tables_) {
+    std::stable_sort(key_tables.second.begin(), key_tables.second.end(), [](const Table &a, const Table &b) {
+      return a.width < b.width;
+    });
+  }
+}
+
+void CapacitanceEngine::Clear() {
+  tables_.clear();
+  layer_to_metal_.clear();
+  num_corners_ = 0;
+}
+
+int CapacitanceEngine::MetalIndex(int layer_id) const {
+  if (layer_id < 0 || layer_id >= static_cast<int>(layer_to_metal_.size())) return -1;
+  return layer_to_metal_[layer_id];
+}
+
+TableType CapacitanceEngine::ContextTable(
+    int metal_index,
+    int under,
+    int over,
+    int corner_index,
+    int &index0,
+    int &index1
+) const {
+  auto has_table = [&](TableType type, int i0, int i1) {
+    return tables_.find(Key(type, metal_index, i0, i1, corner_index)) != tables_.end();
+  };
+  index1 = -1;
+  if (under >= 0 && over >= 0 && has_table(CAP_OVERUNDER, under, over)) {
+    index0 = under;
+    index1 = over;
+    return CAP_OVERUNDER;
+  }
+  if (under >= 0 && has_table(CAP_OVER, under, -1)) {
+    index0 = under;
+    return CAP_OVER;
+  }
+  if (over >= 0 && has_table(CAP_UNDER, over, -1)) {
+    index0 = over;
+    return CAP_UNDER;
+  }
+  index0 = -1;
+  return CAP_OVER;
+}
+
+uint64_t CapacitanceEngine::Key(TableType type, int metal_index, int index0, int index1, int corner_index) {
+  // indices are at least -1, shifted by one so each fits a byte; corners get the upper bits
+  return static_cast<uint64_t>(type)
+      | (static_cast<uint64_t>(metal_index + 1) & 0xff) << 8
+      | (static_cast<uint64_t>(index0 + 1) & 0xff) << 16
+      | (static_cast<uint64_t>(index1 + 1) & 0xff) << 24
+      | static_cast<uint64_t>(corner_index) << 32;
+}
+
+const CapacitanceEngine::Table *CapacitanceEngine::FindTable(
+    TableType type,
+    int metal_index,
+    int index0,
+    int index1,
+    int corner_index,
+    double width
+) const {
+  auto it = tables_.find(Key(type, metal_index, index0, index1, corner_index));
+  if (it == tables_.end()) return nullptr;
+  const std::vector<Table> &tables = it->second;
+  auto closest = std::lower_bound(tables.begin(), tables.end(), width, [](const Table &table, double w) {
+    return table.width < w;
+  });
+  if (closest == tables.end()) return &tables.back();
+  if (closest != tables.begin() && width - (closest - 1)->width < closest->width - width) --closest;
+  return &*closest;
+}
+
+// hi is the first entry with a distance above the given one
+void CapacitanceEngine::Interpolate(
+    const Table &table,
+    size_t hi,
+    double distance,
+    double &coupling,
+    double &fringe
+) {
+  if (hi == 0) {
+    coupling = table.coupling.front();
+    fringe = table.fringe.front();
+  } else if (hi == table.distance.size()) {
+    coupling = table.coupling.back();
+    fringe = table.fringe.back();
+  } else {
+    size_t lo = hi - 1;
+    double t = (distance - table.distance[lo]) / (table.distance[hi] - table.distance[lo]);
+    coupling = table.coupling[lo] + t * (table.coupling[hi] - table.coupling[lo]);
+    fringe = table.fringe[lo] + t * (table.fringe[hi] - table.fringe[lo]);
+  }
+}
+
+bool CapacitanceEngine::Evaluate(
+    TableType type,
+    int metal_index,
+    int index0,
+    int index1,
+    int corner_index,
+    double width,
+    double distance,
+    double &coupling,
+    double &fringe
+) const {
+  const Table *table = FindTable(type, metal_index, index0, index1, corner_index, width);
+  if (table == nullptr) return false;
+  size_t hi = std::upper_bound(table->distance.begin(), table->distance.end(), distance) - table->distance.begin();
+  Interpolate(*table, hi, distance, coupling, fringe);
+  return true;
+}
+
+bool CapacitanceEngine::EvaluateBatch(
+    TableType type,
+    int metal_index,
+    int index0,
+    int index1,
+    int corner_index,
+    double width,
+    size_t count,
+    const double *distances,
+    double *coupling,
+    double *fringe
+) const {
+  const Table *table = FindTable(type, metal_index, index0, index1, corner_index, width);
+  if (table == nullptr) return false;
+
+  const std::vector<double> &table_distance = table->distance;
+  bool is_sorted = std::is_sorted(distances, distances + count);
+  size_t hi = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (is_sorted) {
+      while (hi < table_distance.size() && table_distance[hi] <= distances[i]) ++hi;
+    } else {
+      hi = std::upper_bound(table_distance.begin(), table_distance.end(), distances[i]) - table_distance.begin();
+    }
+    Interpolate(*table, hi, distances[i], coupling[i], fringe[i]);
+  }
+  return true;
+}
+
+}
@@ -0,0 +1,112 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+#ifndef PHYDB_TIMING_CAPACITANCEENGINE_H_
+#define PHYDB_TIMING_CAPACITANCEENGINE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "techconfig.h"
+
+namespace phydb {
+
+class Tech;
+
+/****
+ * @brief Evaluates capacitance per unit length from the CAP_OVER, CAP_UNDER,
+ * CAP_DIAGUNDER and CAP_OVERUNDER tables of an OpenRCX technology
+ * configuration file.
+ *
+ * Build() copies every table into flat arrays sorted by distance, keyed by
+ * (type, metal layer, over/under metal layer, corner). A lookup picks the
+ * table whose wire width is closest to the given width, finds the bracketing
+ * entries by binary search and interpolates linearly between them. Distances
+ * below the first entry or beyond the last one take that entry's values.
+ *
+ * Metal layers are numbered like in the configuration file minus one: 0 is the
+ * lowest routing layer, -1 is the substrate (for index0) or nothing (index1).
+ * Distances and widths are in microns, results in the table's unit (fF/um).
+ */
+class CapacitanceEngine {
+ public:
+  void Build(Tech &tech);
+  void Clear();
+  bool IsEmpty() const { return tables_.empty(); }
+  int NumCorners() const { return num_corners_; }
+
+  // metal index of a tech layer id, -1 for layers that are not routing layers
+  int MetalIndex(int layer_id) const;
+
+  // the table for a wire of metal_index between under, the nearest metal below
+  // it (-1 for the substrate), and over, the nearest metal above (-1 for none):
+  // CAP_OVERUNDER with both, CAP_OVER or CAP_UNDER with one. A context layer
+  // the file has no table for is dropped, down to CAP_OVER the substrate.
+  TableType ContextTable(int metal_index, int under, int over, int corner_index, int &index0, int &index1) const;
+
+  bool Evaluate(
+      TableType type,
+      int metal_index,
+      int index0,
+      int index1,
+      int corner_index,
+      double width,
+      double distance,
+      double &coupling,
+      double &fringe
+  ) const;
+
+  // same lookup for count distances, non-decreasing distances are walked in
+  // one pass instead of one binary search each; false if there is no table
+  bool EvaluateBatch(
+      TableType type,
+      int metal_index,
+      int index0,
+      int index1,
+      int corner_index,
+      double width,
+      size_t count,
+      const double *distances,
+      double *coupling,
+      double *fringe
+  ) const;
+
+ private:
+  struct Table {
+    double width;
+    std::vector<double> distance;
+    std::vector<double> coupling;
+    std::vector<double> fringe;
+  };
+
+  std::unordered_map<uint64_t, std::vector<Table>> tables_; // tables of one key sorted by width
+  std::vector<int> layer_to_metal_;
+  int num_corners_ = 0;
+
+  static uint64_t Key(TableType type, int metal_index, int index0, int index1, int corner_index);
+  const Table *FindTable(TableType type, int metal_index, int index0, int index1, int corner_index, double width) const;
+  static void Interpolate(const Table &table, size_t hi, double distance, double &coupling, double &fringe);
+};
+
+}
+
+#endif //PHYDB_TIMING_CAPACITANCEENGINE_H_
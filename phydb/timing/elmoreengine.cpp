@@ -0,0 +1,195 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+#include "elmoreengine.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "phydb/common/logging.h"
+#include "multicornerrc.h"
+#include "netgroups.h"
+
+namespace phydb {
+
+namespace {
+
+const NodeId kNoParent = static_cast<NodeId>(-1);
+
+// per-thread buffers, sized to the largest net seen so far
+struct TreeScratch {
+  std::vector<size_t> adj_offsets;
+  std::vector<std::pair<NodeId, double>> adj; // neighbour and resistance
+  std::vector<size_t> cursor;
+  std::vector<double> cap;
+  std::vector<NodeId> order; // breadth-first from the driver
+  std::vector<NodeId> parent;
+  std::vector<double> parent_res;
+  std::vector<double> down; // downstream capacitance, then downstream sum of C * m1
+  std::vector<double> m1;
+  std::vector<double> m2;
+};
+
+}
+
+void ElmoreEngine::Compute(
+    Geometry const &geometry,
+    MultiCornerRC const &rc_values,
+    int corner_index,
+    std::vector<ElmoreNet> const &nets,
+    int num_threads
+) {
+  PhyDBExpects(rc_values.IsEvaluated(corner_index),
+               "No RC values for corner " + std::to_string(corner_index));
+  const std::vector<ArenaPtr<Resistor>> &resistors = geometry.getResistorNetwork();
+  const std::vector<ArenaPtr<Capacitor>> &capacitors = geometry.getCapacitorNetwork();
+  PhyDBExpects(rc_values.NumResistors() == resistors.size() && rc_values.NumCapacitors() == capacitors.size(),
+               "RC values were evaluated for another RC network");
+  const double *resistance = rc_values.Resistances(corner_index);
+  const double *ground_cap = rc_values.GroundCapacitances(corner_index);
+  const double *coupling_cap = rc_values.CouplingCapacitances(corner_index);
+
+  NetElementIndex index;
+  index.Build(geometry);
+  const std::vector<size_t> &res_offsets = index.res_offsets, &res_indices = index.res_indices;
+  const std::vector<size_t> &cap_offsets = index.cap_offsets, &cap_indices = index.cap_indices;
+
+  // every pin node but the driver's is a load, slots are laid out before the nets are spread over threads
+  load_offsets_.assign(nets.size() + 1, 0);
+  for (size_t i = 0; i < nets.size(); ++i) {
+    size_t num_pins = geometry.getPinNodes(nets[i].geometry_net_id).size();
+    load_offsets_[i + 1] = load_offsets_[i] + (nets[i].driver >= 0 ? num_pins - 1 : 0);
+  }
+  loads_.assign(load_offsets_.back(), ElmoreLoad{PinNode{-1, -1, 0}, -1, -1});
+
+  auto compute_net = [&](size_t net_index, TreeScratch &s) {
+    ElmoreNet const &net = nets[net_index];
+    if (net.driver < 0) return;
+    unsigned net_id = net.geometry_net_id;
+    const std::vector<PinNode> &pin_nodes = geometry.getPinNodes(net_id);
+    NodeId num_nodes = geometry.getNumNodes(net_id);
+
+    // adjacency of the net's resistors and the capacitance seen at every node
+    s.adj_offsets.assign(num_nodes + 1, 0);
+    s.cap.assign(num_nodes, 0);
+    for (size_t k = res_offsets[net_id]; k < res_offsets[net_id + 1]; ++k) {
+      Resistor const &res = *resistors[res_indices[k]];
+      ++s.adj_offsets[res.getNodeId1() + 1];
+      ++s.adj_offsets[res.getNodeId2() + 1];
+      s.cap[res.getNodeId1()] += ground_cap[res_indices[k]] / 2;
+      s.cap[res.getNodeId2()] += ground_cap[res_indices[k]] / 2;
+    }
+    for (NodeId n = 0; n < num_nodes; ++n) {
+      s.adj_offsets[n + 1] += s.adj_offsets[n];
+    }
+    s.adj.resize(s.adj_offsets[num_nodes]);
+    s.cursor.assign(s.adj_offsets.begin(), s.adj_offsets.end() - 1);
+    for (size_t k = res_offsets[net_id]; k < res_offsets[net_id + 1]; ++k) {
+      Resistor const &res = *resistors[res_indices[k]];
+      double r = resistance[res_indices[k]];
+      s.adj[s.cursor[res.getNodeId1()]++] = std::make_pair(res.getNodeId2(), r);
+      s.adj[s.cursor[res.getNodeId2()]++] = std::make_pair(res.getNodeId1(), r);
+    }
+    for (size_t k = cap_offsets[net_id]; k < cap_offsets[net_id + 1]; ++k) {
+      Capacitor const &cap = *capacitors[cap_indices[k]];
+      NodeId node = cap.getNetId1() == net_id ? cap.getNodeId1() : cap.getNodeId2();
+      s.cap[node] += coupling_cap[cap_indices[k]];
+    }
+
+    // breadth-first tree from the driver, nodes it does not reach are not loaded by the driver
+    NodeId root = pin_nodes[net.driver].node_id;
+    s.parent.assign(num_nodes, kNoParent);
+    s.parent_res.assign(num_nodes, 0);
+    s.order.clear();
+    s.order.push_back(root);
+    s.parent[root] = root;
+    for (size_t head = 0; head < s.order.size(); ++head) {
+      NodeId node = s.order[head];
+      for (size_t k = s.adj_offsets[node]; k < s.adj_offsets[node + 1]; ++k) {
+        NodeId next = s.adj[k].first;
+        if (s.parent[next] != kNoParent) continue;
+        s.parent[next] = node;
+        s.parent_res[next] = s.adj[k].second;
+        s.order.push_back(next);
+      }
+    }
+
+    s.down.assign(num_nodes, 0);
+    s.m1.assign(num_nodes, 0);
+    s.m2.assign(num_nodes, 0);
+    for (size_t i = s.order.size(); i-- > 1;) {
+      NodeId node = s.order[i];
+      s.down[node] += s.cap[node];
+      s.down[s.parent[node]] += s.down[node];
+    }
+    for (size_t i = 1; i < s.order.size(); ++i) {
+      NodeId node = s.order[i];
+      s.m1[node] = s.m1[s.parent[node]] + s.parent_res[node] * s.down[node];
+    }
+    std::fill(s.down.begin(), s.down.end(), 0);
+    for (size_t i = s.order.size(); i-- > 1;) {
+      NodeId node = s.order[i];
+      s.down[node] += s.cap[node] * s.m1[node];
+      s.down[s.parent[node]] += s.down[node];
+    }
+    for (size_t i = 1; i < s.order.size(); ++i) {
+      NodeId node = s.order[i];
+      s.m2[node] = s.m2[s.parent[node]] + s.parent_res[node] * s.down[node];
+    }
+
+    size_t slot = load_offsets_[net_index];
+    for (size_t i = 0; i < pin_nodes.size(); ++i) {
+      if (static_cast<int>(i) == net.driver) continue;
+      ElmoreLoad &load = loads_[slot++];
+      load.pin = pin_nodes[i];
+      NodeId node = pin_nodes[i].node_id;
+      if (s.parent[node] == kNoParent) continue;
+      load.delay = s.m1[node];
+      load.slew = std::log(9.0) * std::sqrt(std::max(2 * s.m2[node] - s.m1[node] * s.m1[node], 0.0));
+    }
+  };
+
+  ForEachNet<TreeScratch>(nets.size(), num_threads, compute_net);
+}
+
+void ElmoreEngine::Clear() {
+  load_offsets_.clear();
+  loads_.clear();
+}
+
+size_t ElmoreEngine::NumLoads(int net_id) const {
+  if (net_id < 0 || static_cast<size_t>(net_id) >= NumNets()) return 0;
+  return load_offsets_[net_id + 1] - load_offsets_[net_id];
+}
+
+ElmoreLoad const &ElmoreEngine::Load(int net_id, size_t index) const {
+  PhyDBExpects(index < NumLoads(net_id), "Load index out of range for net " + std::to_string(net_id));
+  return loads_[load_offsets_[net_id] + index];
+}
+
+ElmoreLoad const *ElmoreEngine::FindLoad(int net_id, int instance_id, int pin_id) const {
+  if (net_id < 0 || static_cast<size_t>(net_id) >= NumNets()) return nullptr;
+  for (size_t i = load_offsets_[net_id]; i < load_offsets_[net_id + 1]; ++i) {
+    if (loads_[i].pin.instance_id == instance_id && loads_[i].pin.pin_id == pin_id) return &loads_[i];
+  }
+  return nullptr;
+}
+
+}
@@ -0,0 +1,86 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+#ifndef PHYDB_TIMING_ELMOREENGINE_H_
+#define PHYDB_TIMING_ELMOREENGINE_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "phydb/geometry.h"
+
+namespace phydb {
+
+class MultiCornerRC;
+
+struct ElmoreNet {
+  unsigned geometry_net_id;
+  int driver; // index of the driver in Geometry::getPinNodes(), -1 if the net has no driver node
+};
+
+struct ElmoreLoad {
+  PinNode pin;
+  double delay; // -1 if no wire connects the load to the driver
+  double slew;
+};
+
+/****
+ * @brief Elmore delay and slew from the driver of every net to each of its
+ * loads, computed from the extracted RC network.
+ *
+ * The resistors of a net are turned into a tree rooted at the driver's pin
+ * node by a breadth-first walk (the first path found to a node is kept when
+ * wires form loops). Each node carries half the ground capacitance of the
+ * resistors it ends and the coupling capacitance at it, taken to ground. Two
+ * passes over the tree give the downstream capacitance and the first and
+ * second moments, so a net costs O(nodes). The slew is the step-response
+ * 10-90% estimate ln(9) * sqrt(2 * m2 - m1 * m1).
+ *
+ * Delays are in ohm times the capacitance unit of MultiCornerRC, i.e. fs when
+ * a technology configuration file has been read. Nets are independent and
+ * are spread over num_threads threads.
+ */
+class ElmoreEngine {
+ public:
+  // nets are indexed like the design's nets
+  void Compute(
+      Geometry const &geometry,
+      MultiCornerRC const &rc_values,
+      int corner_index,
+      std::vector<ElmoreNet> const &nets,
+      int num_threads = 1
+  );
+  void Clear();
+
+  bool IsEmpty() const { return load_offsets_.empty(); }
+  size_t NumNets() const { return load_offsets_.empty() ? 0 : load_offsets_.size() - 1; }
+  size_t NumLoads(int net_id) const;
+  ElmoreLoad const &Load(int net_id, size_t index) const;
+  // nullptr if the pin is not a load of the net with an RC node
+  ElmoreLoad const *FindLoad(int net_id, int instance_id, int pin_id) const;
+
+ private:
+  std::vector<size_t> load_offsets_; // per net, into loads_
+  std::vector<ElmoreLoad> loads_;
+};
+
+}
+
+#endif //PHYDB_TIMING_ELMOREENGINE_H_
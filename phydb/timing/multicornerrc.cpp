@@ -0,0 +1,272 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+#include "multicornerrc.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <tuple>
+
+#include "phydb/common/logging.h"
+#include "phydb/geometry.h"
+#include "phydb/tech.h"
+#include "capacitanceengine.h"
+#include "netgroups.h"
+
+// runtime dispatch between AVX-512, AVX2 and the baseline ISA, the loops below are written for auto-vectorization
+#if defined(__x86_64__) && defined(__linux__) && (!defined(__clang__) || __clang_major__ >= 14)
+#define PHYDB_SIMD_CLONES __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define PHYDB_SIMD_CLONES
+#endif
+
+namespace phydb {
+
+namespace {
+
+// layer id, width (-1 for vertical resistors), metal below and metal above
+typedef std::tuple<int, double, int, int> UnitClass;
+
+// per-class units of one corner, a class is one (layer, vertical, width, context) combination
+struct ResistorUnits {
+  std::vector<double> res; // times length / width
+  std::vector<double> area_cap; // times width * length
+  std::vector<double> edge_cap; // times 2 * (width + length)
+  std::vector<double> fringe_cap; // times length
+};
+
+PHYDB_SIMD_CLONES
+void ResistorKernel(
+    size_t count,
+    const double *__restrict length,
+    const double *__restrict width,
+    const uint32_t *__restrict unit_class,
+    const double *__restrict unit_res,
+    const double *__restrict unit_area_cap,
+    const double *__restrict unit_edge_cap,
+    const double *__restrict unit_fringe_cap,
+    double *__restrict res,
+    double *__restrict ground_cap
+) {
+  for (size_t i = 0; i < count; ++i) {
+    uint32_t c = unit_class[i];
+    double l = length[i];
+    double w = width[i];
+    res[i] = unit_res[c] * l / w;
+    ground_cap[i] = unit_area_cap[c] * w * l + unit_edge_cap[c] * 2 * (w + l) + unit_fringe_cap[c] * l;
+  }
+}
+
+PHYDB_SIMD_CLONES
+void ScaleKernel(
+    size_t count,
+    const double *__restrict unit,
+    const double *__restrict length,
+    double *__restrict out
+) {
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = unit[i] * length[i];
+  }
+}
+
+}
+
+void MultiCornerRC::Evaluate(Tech &tech, Geometry const &geometry, CapacitanceEngine const &engine, int evaluated_corner) {
+  Clear();
+  double distance_microns = tech.GetDatabaseMicron();
+  std::vector<ArenaPtr<Resistor>> const &resistors = geometry.getResistorNetwork();
+  std::vector<ArenaPtr<Capacitor>> const &capacitors = geometry.getCapacitorNetwork();
+  num_resistors_ = resistors.size();
+  num_capacitors_ = capacitors.size();
+
+  std::vector<Layer *> layers;
+  for (size_t layer_id = 0; layer_id < geometry.getNumLayers(); ++layer_id) {
+    Layer *layer = tech.GetLayerPtr(geometry.getLayerName(layer_id));
+    layers.push_back(layer);
+    if (layer != nullptr) {
+      num_corners_ = std::max(num_corners_, static_cast<int>(layer->GetUnitResRef().size()));
+      num_corners_ = std::max(num_corners_, static_cast<int>(layer->GetUnitEdgeCapRef().size()));
+    }
+  }
+  num_corners_ = std::max(num_corners_, engine.NumCorners());
+  if (num_corners_ == 0) return;
+  PhyDBExpects(evaluated_corner < num_corners_, "No RC values for corner " + std::to_string(evaluated_corner));
+  first_corner_ = evaluated_corner < 0 ? 0 : evaluated_corner;
+  num_evaluated_corners_ = evaluated_corner < 0 ? num_corners_ : 1;
+
+  // the metal below and above each wire and each coupling's gap picks its table, as in
+  // Geometry::annotateCapacitance; only looked for when some evaluated corner reads the tables
+  std::vector<std::pair<int, int>> res_contexts(num_resistors_, std::pair<int, int>(-1, -1));
+  std::vector<std::pair<int, int>> cap_contexts(num_capacitors_, std::pair<int, int>(-1, -1));
+  if (first_corner_ < engine.NumCorners()) {
+    ForEachNet<std::vector<WireSegment *>>(num_resistors_, geometry.getNumThreads(),
+                                           [&](size_t i, std::vector<WireSegment *> &segs) {
+      Resistor *res = resistors[i].get();
+      if (res->isVertical() || engine.MetalIndex(res->getLayerId()) < 0) return;
+      geometry.findLayerContext(engine, res->getLayerId(), res->getFootprint(), res_contexts[i].first,
+                                res_contexts[i].second, segs);
+    });
+    ForEachNet<std::vector<WireSegment *>>(num_capacitors_, geometry.getNumThreads(),
+                                           [&](size_t i, std::vector<WireSegment *> &segs) {
+      Capacitor *cap = capacitors[i].get();
+      if (engine.MetalIndex(cap->getLayerId()) < 0) return;
+      geometry.findLayerContext(engine, cap->getLayerId(), cap->getRegion(), cap_contexts[i].first,
+                                cap_contexts[i].second, segs);
+    });
+  }
+
+  // gather the resistors once, vertical ones are a single square without ground capacitance
+  std::vector<double> res_length(num_resistors_), res_width(num_resistors_);
+  std::vector<uint32_t> res_class(num_resistors_);
+  std::map<UnitClass, uint32_t> class_ids;
+  std::vector<UnitClass> classes;
+  for (size_t i = 0; i < num_resistors_; ++i) {
+    Resistor *res = resistors[i].get();
+    UnitClass key(res->getLayerId(), res->isVertical() ? -1 : res->getWidth(), res_contexts[i].first,
+                  res_contexts[i].second);
+    std::pair<std::map<UnitClass, uint32_t>::iterator, bool> inserted =
+        class_ids.emplace(key, static_cast<uint32_t>(classes.size()));
+    if (inserted.second) classes.push_back(key);
+    res_class[i] = inserted.first->second;
+    res_length[i] = res->isVertical() ? 1 : res->getLength() / distance_microns;
+    res_width[i] = res->isVertical() ? 1 : res->getWidth() / distance_microns;
+  }
+
+  // gather the capacitors sorted by (layer, width, context, distance), so every table is walked once per corner
+  auto cap_class = [&capacitors, &cap_contexts](size_t i) {
+    Capacitor *cap = capacitors[i].get();
+    return UnitClass(cap->getLayerId(), cap->getWidth(), cap_contexts[i].first, cap_contexts[i].second);
+  };
+  std::vector<size_t> cap_order(num_capacitors_);
+  std::iota(cap_order.begin(), cap_order.end(), 0);
+  std::sort(cap_order.begin(), cap_order.end(), [&capacitors, &cap_class](size_t a, size_t b) {
+    UnitClass class_a = cap_class(a), class_b = cap_class(b);
+    if (class_a != class_b) return class_a < class_b;
+    return capacitors[a]->getDistance() < capacitors[b]->getDistance();
+  });
+  std::vector<double> cap_distance(num_capacitors_), cap_overlap(num_capacitors_);
+  std::vector<size_t> cap_runs; // start of each (layer, width, context) run, plus the end
+  for (size_t k = 0; k < num_capacitors_; ++k) {
+    Capacitor *cap = capacitors[cap_order[k]].get();
+    cap_distance[k] = cap->getDistance() / distance_microns;
+    cap_overlap[k] = cap->getOverlapLength() / distance_microns;
+    if (k == 0 || cap_class(cap_order[k]) != cap_class(cap_order[k - 1])) {
+      cap_runs.push_back(k);
+    }
+  }
+  cap_runs.push_back(num_capacitors_);
+
+  resistance_.assign(num_evaluated_corners_ * num_resistors_, 0);
+  ground_capacitance_.assign(num_evaluated_corners_ * num_resistors_, 0);
+  coupling_capacitance_.assign(num_evaluated_corners_ * num_capacitors_, 0);
+  ResistorUnits units;
+  std::vector<double> unit_coupling(num_capacitors_), unit_fringe(num_capacitors_), sorted_coupling(num_capacitors_);
+  for (int corner_index = first_corner_; corner_index < first_corner_ + num_evaluated_corners_; ++corner_index) {
+    size_t slot = corner_index - first_corner_;
+    bool use_engine = corner_index < engine.NumCorners();
+    units.res.assign(classes.size(), 0);
+    units.area_cap.assign(classes.size(), 0);
+    units.edge_cap.assign(classes.size(), 0);
+    units.fringe_cap.assign(classes.size(), 0);
+    for (size_t c = 0; c < classes.size(); ++c) {
+      int layer_id = std::get<0>(classes[c]);
+      bool is_vertical = std::get<1>(classes[c]) < 0;
+      Layer *layer = layers[layer_id];
+      if (layer == nullptr) continue;
+      if (layer->HasUnitRes(corner_index)) {
+        units.res[c] = layer->GetUnitResRef()[corner_index];
+      }
+      if (is_vertical) continue;
+      if (use_engine) {
+        // same isolated-wire fringe Geometry::annotateCapacitance uses
+        double coupling = 0, fringe = 0;
+        int metal_index = engine.MetalIndex(layer_id);
+        int index0 = -1, index1 = -1;
+        TableType type = metal_index < 0 ? CAP_OVER : engine.ContextTable(metal_index, std::get<2>(classes[c]),
+                                                                          std::get<3>(classes[c]), corner_index,
+                                                                          index0, index1);
+        if (metal_index >= 0 && engine.Evaluate(type, metal_index, index0, index1, corner_index,
+                                                std::get<1>(classes[c]) / distance_microns,
+                                                std::numeric_limits<double>::infinity(), coupling, fringe)) {
+          units.fringe_cap[c] = fringe;
+        }
+      } else if (layer->HasUnitCap(corner_index)) {
+        units.area_cap[c] = layer->GetUnitAreaCapRef()[corner_index];
+        units.edge_cap[c] = layer->GetUnitEdgeCapRef()[corner_index];
+      }
+    }
+    ResistorKernel(num_resistors_, res_length.data(), res_width.data(), res_class.data(),
+                   units.res.data(), units.area_cap.data(), units.edge_cap.data(), units.fringe_cap.data(),
+                   &resistance_[slot * num_resistors_], &ground_capacitance_[slot * num_resistors_]);
+
+    if (!use_engine || num_capacitors_ == 0) continue;
+    std::fill(unit_coupling.begin(), unit_coupling.end(), 0);
+    for (size_t r = 0; r + 1 < cap_runs.size(); ++r) {
+      size_t begin = cap_runs[r];
+      Capacitor *cap = capacitors[cap_order[begin]].get();
+      int metal_index = engine.MetalIndex(cap->getLayerId());
+      if (metal_index < 0) continue;
+      int index0 = -1, index1 = -1;
+      TableType type = engine.ContextTable(metal_index, cap_contexts[cap_order[begin]].first,
+                                           cap_contexts[cap_order[begin]].second, corner_index, index0, index1);
+      engine.EvaluateBatch(type, metal_index, index0, index1, corner_index, cap->getWidth() / distance_microns,
+                           cap_runs[r + 1] - begin, &cap_distance[begin], &unit_coupling[begin], &unit_fringe[begin]);
+    }
+    ScaleKernel(num_capacitors_, unit_coupling.data(), cap_overlap.data(), sorted_coupling.data());
+    double *coupling = &coupling_capacitance_[slot * num_capacitors_];
+    for (size_t k = 0; k < num_capacitors_; ++k) {
+      coupling[cap_order[k]] = sorted_coupling[k];
+    }
+  }
+}
+
+void MultiCornerRC::Clear() {
+  num_corners_ = 0;
+  first_corner_ = 0;
+  num_evaluated_corners_ = 0;
+  num_resistors_ = 0;
+  num_capacitors_ = 0;
+  resistance_.clear();
+  ground_capacitance_.clear();
+  coupling_capacitance_.clear();
+}
+
+size_t MultiCornerRC::Offset(int corner_index, size_t count) const {
+  PhyDBExpects(IsEvaluated(corner_index), "No RC values for corner " + std::to_string(corner_index));
+  return (corner_index - first_corner_) * count;
+}
+
+const double *MultiCornerRC::Resistances(int corner_index) const {
+  return resistance_.data() + Offset(corner_index, num_resistors_);
+}
+
+const double *MultiCornerRC::GroundCapacitances(int corner_index) const {
+  return ground_capacitance_.data() + Offset(corner_index, num_resistors_);
+}
+
+const double *MultiCornerRC::CouplingCapacitances(int corner_index) const {
+  return coupling_capacitance_.data() + Offset(corner_index, num_capacitors_);
+}
+
+}
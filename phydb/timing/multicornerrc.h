@@ -0,0 +1,86 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+#ifndef PHYDB_TIMING_MULTICORNERRC_H_
+#define PHYDB_TIMING_MULTICORNERRC_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace phydb {
+
+class CapacitanceEngine;
+class Geometry;
+class Tech;
+
+/****
+ * @brief Resistance and capacitance of every element of the RC network for
+ * all corners, evaluated in one pass.
+ *
+ * Evaluate() gathers the element geometry once into structure-of-arrays
+ * inputs (lengths and widths in microns, one unit class per layer, width and
+ * the metal found below and above, see Geometry::findLayerContext) and then
+ * runs a branch-free kernel per corner over contiguous arrays, so the cost of
+ * walking the network is paid once instead of once per corner. On
+ * x86-64 the kernels are compiled for AVX-512, AVX2 and the baseline ISA and
+ * the best one is picked at load time.
+ *
+ * Results are stored corner-major: the value of element i at corner c is
+ * Resistances(c)[i], i indexing Geometry::getResistorNetwork() (or
+ * getCapacitorNetwork() for couplings). Values match what the SPEF writer
+ * reports for the same corner: resistances in ohm, capacitances in fF when a
+ * technology configuration file has been read, otherwise in the LEF units.
+ * Passing a corner_index to Evaluate() evaluates that corner only, for a
+ * caller that needs one corner.
+ */
+class MultiCornerRC {
+ public:
+  // all corners with corner_index -1, otherwise that corner only
+  void Evaluate(Tech &tech, Geometry const &geometry, CapacitanceEngine const &engine, int corner_index = -1);
+  void Clear();
+
+  // corners the technology defines, IsEvaluated() tells which ones have values
+  int NumCorners() const { return num_corners_; }
+  bool IsEvaluated(int corner_index) const {
+    return corner_index >= first_corner_ && corner_index < first_corner_ + num_evaluated_corners_;
+  }
+  size_t NumResistors() const { return num_resistors_; }
+  size_t NumCapacitors() const { return num_capacitors_; }
+
+  const double *Resistances(int corner_index) const;
+  const double *GroundCapacitances(int corner_index) const;
+  const double *CouplingCapacitances(int corner_index) const;
+
+ private:
+  int num_corners_ = 0;
+  int first_corner_ = 0;
+  int num_evaluated_corners_ = 0;
+  size_t num_resistors_ = 0;
+  size_t num_capacitors_ = 0;
+  std::vector<double> resistance_; // num_evaluated_corners_ x num_resistors_
+  std::vector<double> ground_capacitance_; // num_evaluated_corners_ x num_resistors_
+  std::vector<double> coupling_capacitance_; // num_evaluated_corners_ x num_capacitors_
+
+  size_t Offset(int corner_index, size_t count) const;
+};
+
+}
+
+#endif //PHYDB_TIMING_MULTICORNERRC_H_
@@ -0,0 +1,60 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+#include "netgroups.h"
+
+namespace phydb {
+
+namespace {
+
+template<typename NetsOf>
+void GroupByNet(size_t num_elements, size_t num_nets, NetsOf nets_of, std::vector<size_t> &offsets, std::vector<size_t> &indices) {
+  offsets.assign(num_nets + 1, 0);
+  for (size_t i = 0; i < num_elements; ++i) {
+    std::pair<unsigned, unsigned> nets = nets_of(i);
+    ++offsets[nets.first + 1];
+    if (nets.second != nets.first) ++offsets[nets.second + 1];
+  }
+  for (size_t i = 0; i < num_nets; ++i) {
+    offsets[i + 1] += offsets[i];
+  }
+  indices.assign(offsets[num_nets], 0);
+  std::vector<size_t> cursor(offsets.begin(), offsets.end() - 1);
+  for (size_t i = 0; i < num_elements; ++i) {
+    std::pair<unsigned, unsigned> nets = nets_of(i);
+    indices[cursor[nets.first]++] = i;
+    if (nets.second != nets.first) indices[cursor[nets.second]++] = i;
+  }
+}
+
+}
+
+void NetElementIndex::Build(Geometry const &geometry) {
+  const std::vector<ArenaPtr<Resistor>> &resistors = geometry.getResistorNetwork();
+  const std::vector<ArenaPtr<Capacitor>> &capacitors = geometry.getCapacitorNetwork();
+  GroupByNet(resistors.size(), geometry.getNumNets(), [&resistors](size_t i) {
+    return std::make_pair(resistors[i]->getNetId(), resistors[i]->getNetId());
+  }, res_offsets, res_indices);
+  GroupByNet(capacitors.size(), geometry.getNumNets(), [&capacitors](size_t i) {
+    return std::make_pair(capacitors[i]->getNetId1(), capacitors[i]->getNetId2());
+  }, cap_offsets, cap_indices);
+}
+
+}
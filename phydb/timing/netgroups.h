@@ -0,0 +1,77 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+#ifndef PHYDB_TIMING_NETGROUPS_H_
+#define PHYDB_TIMING_NETGROUPS_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include "phydb/geometry.h"
+
+namespace phydb {
+
+/****
+ * Indices into Geometry::getResistorNetwork() and getCapacitorNetwork()
+ * grouped by geometry net id, built with one counting sort. A capacitor is
+ * listed under both of its nets.
+ */
+struct NetElementIndex {
+  std::vector<size_t> res_offsets; // per net id, into res_indices
+  std::vector<size_t> res_indices;
+  std::vector<size_t> cap_offsets; // per net id, into cap_indices
+  std::vector<size_t> cap_indices;
+
+  void Build(Geometry const &geometry);
+};
+
+/****
+ * Runs body(i, scratch) for every i in [0, count) on up to num_threads
+ * threads. Indices are handed out in chunks and every thread owns one
+ * Scratch for all the indices it runs, so per-item buffers are reused.
+ */
+template<typename Scratch, typename Body>
+void ForEachNet(size_t count, int num_threads, Body body) {
+  std::atomic<size_t> next(0);
+  const size_t chunk_size = 64;
+  auto worker = [&]() {
+    Scratch scratch;
+    for (size_t begin = next.fetch_add(chunk_size); begin < count; begin = next.fetch_add(chunk_size)) {
+      for (size_t i = begin; i < std::min(begin + chunk_size, count); ++i) {
+        body(i, scratch);
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 1; i < num_threads && static_cast<size_t>(i) * chunk_size < count; ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+}
+
+}
+
+#endif //PHYDB_TIMING_NETGROUPS_H_
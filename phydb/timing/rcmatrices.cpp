@@ -0,0 +1,266 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+#include "rcmatrices.h"
+
+#include <algorithm>
+
+#include "phydb/common/logging.h"
+#include "multicornerrc.h"
+#include "netgroups.h"
+
+namespace phydb {
+
+namespace {
+
+struct Entry {
+  uint32_t row;
+  uint32_t column;
+  double value;
+};
+
+// per-thread buffers, the net is assembled here and then copied to its storage
+struct MatrixScratch {
+  std::vector<NodeId> parent; // union-find over nodes joined by zero resistance
+  std::vector<char> used;
+  std::vector<uint32_t> root_rows;
+  std::vector<uint32_t> node_rows;
+  std::vector<uint32_t> pin_rows;
+  std::vector<double> g_diagonal;
+  std::vector<Entry> g_off_diagonal;
+  std::vector<size_t> g_row_offsets;
+  std::vector<uint32_t> g_columns;
+  std::vector<double> g_values;
+  std::vector<double> c_diagonal;
+};
+
+NodeId FindRoot(std::vector<NodeId> &parent, NodeId node) {
+  while (parent[node] != node) {
+    parent[node] = parent[parent[node]];
+    node = parent[node];
+  }
+  return node;
+}
+
+}
+
+void RCMatrices::Assemble(
+    Geometry const &geometry,
+    MultiCornerRC const &rc_values,
+    int corner_index,
+    std::vector<unsigned> const &geometry_net_ids,
+    bool contiguous,
+    int num_threads
+) {
+  PhyDBExpects(rc_values.IsEvaluated(corner_index),
+               "No RC values for corner " + std::to_string(corner_index));
+  const std::vector<ArenaPtr<Resistor>> &resistors = geometry.getResistorNetwork();
+  const std::vector<ArenaPtr<Capacitor>> &capacitors = geometry.getCapacitorNetwork();
+  PhyDBExpects(rc_values.NumResistors() == resistors.size() && rc_values.NumCapacitors() == capacitors.size(),
+               "RC values were evaluated for another RC network");
+  const double *resistance = rc_values.Resistances(corner_index);
+  const double *ground_cap = rc_values.GroundCapacitances(corner_index);
+  const double *coupling_cap = rc_values.CouplingCapacitances(corner_index);
+
+  Clear();
+  contiguous_ = contiguous;
+  NetElementIndex index;
+  index.Build(geometry);
+
+  // reserve every net's slots up front, a net has at most one row per node and two entries per resistor
+  extents_.resize(geometry_net_ids.size());
+  Extent bound;
+  for (size_t i = 0; i < geometry_net_ids.size(); ++i) {
+    unsigned net_id = geometry_net_ids[i];
+    Extent &extent = extents_[i];
+    extent.geometry_net_id = net_id;
+    extent.num_nodes = geometry.getNumNodes(net_id);
+    extent.num_pins = geometry.getPinNodes(net_id).size();
+    if (!contiguous) continue;
+    extent.node_begin = bound.node_begin;
+    extent.pin_begin = bound.pin_begin;
+    extent.row_begin = bound.row_begin;
+    extent.g_begin = bound.g_begin;
+    extent.c_begin = bound.c_begin;
+    bound.node_begin += extent.num_nodes;
+    bound.pin_begin += extent.num_pins;
+    bound.row_begin += extent.num_nodes + 1;
+    bound.g_begin += extent.num_nodes + 2 * (index.res_offsets[net_id + 1] - index.res_offsets[net_id]);
+    bound.c_begin += extent.num_nodes;
+  }
+  if (contiguous) {
+    shared_.node_rows.resize(bound.node_begin);
+    shared_.pin_rows.resize(bound.pin_begin);
+    shared_.g_row_offsets.resize(bound.row_begin);
+    shared_.g_columns.resize(bound.g_begin);
+    shared_.g_values.resize(bound.g_begin);
+    shared_.c_row_offsets.resize(bound.row_begin);
+    shared_.c_columns.resize(bound.c_begin);
+    shared_.c_values.resize(bound.c_begin);
+  } else {
+    per_net_.resize(geometry_net_ids.size());
+  }
+
+  auto assemble_net = [&](size_t net_index, MatrixScratch &s) {
+    Extent &extent = extents_[net_index];
+    unsigned net_id = extent.geometry_net_id;
+    NodeId num_nodes = extent.num_nodes;
+    size_t res_begin = index.res_offsets[net_id], res_end = index.res_offsets[net_id + 1];
+    size_t cap_begin = index.cap_offsets[net_id], cap_end = index.cap_offsets[net_id + 1];
+
+    // nodes joined without resistance are one electrical node
+    s.parent.resize(num_nodes);
+    for (NodeId n = 0; n < num_nodes; ++n) {
+      s.parent[n] = n;
+    }
+    s.used.assign(num_nodes, 0);
+    for (size_t k = res_begin; k < res_end; ++k) {
+      Resistor const &res = *resistors[index.res_indices[k]];
+      s.used[res.getNodeId1()] = 1;
+      s.used[res.getNodeId2()] = 1;
+      if (resistance[index.res_indices[k]] > 0) continue;
+      NodeId root1 = FindRoot(s.parent, res.getNodeId1());
+      NodeId root2 = FindRoot(s.parent, res.getNodeId2());
+      if (root1 != root2) s.parent[std::max(root1, root2)] = std::min(root1, root2);
+    }
+    for (size_t k = cap_begin; k < cap_end; ++k) {
+      Capacitor const &cap = *capacitors[index.cap_indices[k]];
+      s.used[cap.getNetId1() == net_id ? cap.getNodeId1() : cap.getNodeId2()] = 1;
+    }
+
+    // roots are the lowest node of their group, so visiting nodes in order numbers rows by lowest node id
+    s.root_rows.assign(num_nodes, kNoRow);
+    s.node_rows.assign(num_nodes, kNoRow);
+    uint32_t num_rows = 0;
+    for (NodeId n = 0; n < num_nodes; ++n) {
+      if (!s.used[n]) continue;
+      NodeId root = FindRoot(s.parent, n);
+      if (s.root_rows[root] == kNoRow) s.root_rows[root] = num_rows++;
+      s.node_rows[n] = s.root_rows[root];
+    }
+    extent.num_rows = num_rows;
+    s.pin_rows.clear();
+    for (PinNode const &pin_node : geometry.getPinNodes(net_id)) {
+      s.pin_rows.push_back(pin_node.node_id < num_nodes ? s.node_rows[pin_node.node_id] : kNoRow);
+    }
+
+    s.g_diagonal.assign(num_rows, 0);
+    s.c_diagonal.assign(num_rows, 0);
+    s.g_off_diagonal.clear();
+    for (size_t k = res_begin; k < res_end; ++k) {
+      size_t res_index = index.res_indices[k];
+      Resistor const &res = *resistors[res_index];
+      uint32_t row1 = s.node_rows[res.getNodeId1()];
+      uint32_t row2 = s.node_rows[res.getNodeId2()];
+      s.c_diagonal[row1] += ground_cap[res_index] / 2;
+      s.c_diagonal[row2] += ground_cap[res_index] / 2;
+      if (row1 == row2) continue;
+      double conductance = 1 / resistance[res_index];
+      s.g_diagonal[row1] += conductance;
+      s.g_diagonal[row2] += conductance;
+      s.g_off_diagonal.push_back(Entry{row1, row2, -conductance});
+      s.g_off_diagonal.push_back(Entry{row2, row1, -conductance});
+    }
+    for (size_t k = cap_begin; k < cap_end; ++k) {
+      Capacitor const &cap = *capacitors[index.cap_indices[k]];
+      NodeId node = cap.getNetId1() == net_id ? cap.getNodeId1() : cap.getNodeId2();
+      s.c_diagonal[s.node_rows[node]] += coupling_cap[index.cap_indices[k]];
+    }
+
+    // rows of G: sorted off-diagonal entries with parallel resistors summed, the diagonal put in column order
+    std::sort(s.g_off_diagonal.begin(), s.g_off_diagonal.end(), [](Entry const &a, Entry const &b) {
+      return a.row != b.row ? a.row < b.row : a.column < b.column;
+    });
+    s.g_row_offsets.assign(num_rows + 1, 0);
+    s.g_columns.clear();
+    s.g_values.clear();
+    size_t next = 0;
+    for (uint32_t row = 0; row < num_rows; ++row) {
+      bool diagonal_done = false;
+      while (next < s.g_off_diagonal.size() && s.g_off_diagonal[next].row == row) {
+        Entry const &entry = s.g_off_diagonal[next++];
+        if (!diagonal_done && entry.column > row) {
+          s.g_columns.push_back(row);
+          s.g_values.push_back(s.g_diagonal[row]);
+          diagonal_done = true;
+        }
+        if (s.g_columns.size() > s.g_row_offsets[row] && s.g_columns.back() == entry.column) {
+          s.g_values.back() += entry.value;
+        } else {
+          s.g_columns.push_back(entry.column);
+          s.g_values.push_back(entry.value);
+        }
+      }
+      if (!diagonal_done) {
+        s.g_columns.push_back(row);
+        s.g_values.push_back(s.g_diagonal[row]);
+      }
+      s.g_row_offsets[row + 1] = s.g_columns.size();
+    }
+
+    Storage &storage = contiguous_ ? shared_ : per_net_[net_index];
+    if (!contiguous_) {
+      storage.node_rows.resize(num_nodes);
+      storage.pin_rows.resize(s.pin_rows.size());
+      storage.g_row_offsets.resize(num_rows + 1);
+      storage.g_columns.resize(s.g_columns.size());
+      storage.g_values.resize(s.g_values.size());
+      storage.c_row_offsets.resize(num_rows + 1);
+      storage.c_columns.resize(num_rows);
+      storage.c_values.resize(num_rows);
+    }
+    std::copy(s.node_rows.begin(), s.node_rows.end(), storage.node_rows.begin() + extent.node_begin);
+    std::copy(s.pin_rows.begin(), s.pin_rows.end(), storage.pin_rows.begin() + extent.pin_begin);
+    std::copy(s.g_row_offsets.begin(), s.g_row_offsets.end(), storage.g_row_offsets.begin() + extent.row_begin);
+    std::copy(s.g_columns.begin(), s.g_columns.end(), storage.g_columns.begin() + extent.g_begin);
+    std::copy(s.g_values.begin(), s.g_values.end(), storage.g_values.begin() + extent.g_begin);
+    std::copy(s.c_diagonal.begin(), s.c_diagonal.end(), storage.c_values.begin() + extent.c_begin);
+    for (uint32_t row = 0; row <= num_rows; ++row) {
+      storage.c_row_offsets[extent.row_begin + row] = row;
+      if (row < num_rows) storage.c_columns[extent.c_begin + row] = row;
+    }
+  };
+  ForEachNet<MatrixScratch>(geometry_net_ids.size(), num_threads, assemble_net);
+}
+
+void RCMatrices::Clear() {
+  extents_.clear();
+  shared_ = Storage();
+  per_net_.clear();
+}
+
+NetMatricesView RCMatrices::Net(size_t net_index) const {
+  PhyDBExpects(net_index < extents_.size(), "No matrices for net " + std::to_string(net_index));
+  Extent const &extent = extents_[net_index];
+  Storage const &storage = contiguous_ ? shared_ : per_net_[net_index];
+  NetMatricesView view;
+  view.geometry_net_id = extent.geometry_net_id;
+  view.num_nodes = extent.num_nodes;
+  view.node_rows = storage.node_rows.data() + extent.node_begin;
+  view.num_pins = extent.num_pins;
+  view.pin_rows = storage.pin_rows.data() + extent.pin_begin;
+  view.g = CsrMatrixView{extent.num_rows, storage.g_row_offsets.data() + extent.row_begin,
+                         storage.g_columns.data() + extent.g_begin, storage.g_values.data() + extent.g_begin};
+  view.c = CsrMatrixView{extent.num_rows, storage.c_row_offsets.data() + extent.row_begin,
+                         storage.c_columns.data() + extent.c_begin, storage.c_values.data() + extent.c_begin};
+  return view;
+}
+
+}
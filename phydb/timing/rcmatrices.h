@@ -0,0 +1,120 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+#ifndef PHYDB_TIMING_RCMATRICES_H_
+#define PHYDB_TIMING_RCMATRICES_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "phydb/geometry.h"
+
+namespace phydb {
+
+class MultiCornerRC;
+
+// a square sparse matrix in compressed sparse row form, columns are sorted within a row
+struct CsrMatrixView {
+  uint32_t num_rows;
+  const size_t *row_offsets; // num_rows + 1 entries, row_offsets[0] is 0
+  const uint32_t *columns;
+  const double *values;
+};
+
+struct NetMatricesView {
+  unsigned geometry_net_id;
+  NodeId num_nodes;
+  const uint32_t *node_rows; // row of every node id, RCMatrices::kNoRow if nothing connects to the node
+  size_t num_pins;
+  const uint32_t *pin_rows; // row of every entry of Geometry::getPinNodes(), kNoRow if the pin has none
+  CsrMatrixView g; // conductance, S
+  CsrMatrixView c; // capacitance to ground, in the unit of MultiCornerRC
+};
+
+/****
+ * @brief Conductance and capacitance matrices of every net, for moment
+ * matching and other tools working on the MNA form of the RC network.
+ *
+ * A row stands for one electrical node: nodes joined by resistors without
+ * resistance (e.g. vias of cut layers that have no resistance data) share a
+ * row, so G stays finite. Rows are numbered in the order of their lowest
+ * node id. G is the weighted Laplacian of the net's resistors, parallel
+ * resistors summed. C is diagonal: half of each resistor's ground
+ * capacitance goes to either end, and coupling capacitance is taken to
+ * ground at its node.
+ *
+ * Nets are assembled on num_threads threads. With contiguous storage every
+ * net is written into one set of shared arrays at offsets reserved from
+ * per-net upper bounds (nodes, resistors), which avoids one allocation per
+ * net but may leave unused slots where resistors were merged; otherwise each
+ * net owns exactly sized arrays.
+ */
+class RCMatrices {
+ public:
+  static constexpr uint32_t kNoRow = static_cast<uint32_t>(-1);
+
+  void Assemble(
+      Geometry const &geometry,
+      MultiCornerRC const &rc_values,
+      int corner_index,
+      std::vector<unsigned> const &geometry_net_ids,
+      bool contiguous = true,
+      int num_threads = 1
+  );
+  void Clear();
+
+  size_t NumNets() const { return extents_.size(); }
+  // views stay valid until the next Assemble() or Clear()
+  NetMatricesView Net(size_t net_index) const;
+
+ private:
+  struct Storage {
+    std::vector<uint32_t> node_rows;
+    std::vector<uint32_t> pin_rows;
+    std::vector<size_t> g_row_offsets;
+    std::vector<uint32_t> g_columns;
+    std::vector<double> g_values;
+    std::vector<size_t> c_row_offsets;
+    std::vector<uint32_t> c_columns;
+    std::vector<double> c_values;
+  };
+  // where a net lives in its storage, all zero in per-net storage
+  struct Extent {
+    unsigned geometry_net_id = 0;
+    NodeId num_nodes = 0;
+    uint32_t num_rows = 0;
+    size_t num_pins = 0;
+    size_t node_begin = 0;
+    size_t pin_begin = 0;
+    size_t row_begin = 0; // into both row offset arrays, num_rows + 1 slots reserved
+    size_t g_begin = 0;
+    size_t c_begin = 0;
+  };
+
+  bool contiguous_ = true;
+  std::vector<Extent> extents_;
+  Storage shared_; // contiguous storage
+  std::vector<Storage> per_net_;
+};
+
+}
+
+#endif //PHYDB_TIMING_RCMATRICES_H_
@@ -232,7 +232,7 @@ void ReadDensityModel(PhyDB *phy_db_ptr, std::ifstream &ist) {
         layer_index = std::stoi(words[1]) - 1;
         index0 = std::stoi(words[3]) - 1;
         if (words.size() == 6) {
-          index0 = std::stoi(words[5]) - 1;
+          index1 = std::stoi(words[5]) - 1;
         }
       } catch (...) {
         PhyDBExpects(false,
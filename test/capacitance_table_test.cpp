@@ -0,0 +1,127 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include <cmath>
+#include <iostream>
+#include <memory>
+
+#include "test_helpers.h"
+
+using namespace phydb;
+
+bool Near(double a, double b) {
+  return std::fabs(a - b) <= 1e-9;
+}
+
+void ExpectContext(
+    CapacitanceEngine const &engine,
+    int under,
+    int over,
+    int corner_index,
+    TableType expected_type,
+    int expected_index0,
+    int expected_index1
+) {
+  int index0, index1;
+  TableType type = engine.ContextTable(2, under, over, corner_index, index0, index1);
+  PhyDBExpects(
+      type == expected_type && index0 == expected_index0 && index1 == expected_index1,
+      "metal 2 between " << under << " and " << over << " in corner " << corner_index << " takes table "
+                         << type << " " << index0 << " " << index1
+  );
+}
+
+void ExpectValues(
+    CapacitanceEngine const &engine,
+    TableType type,
+    int index0,
+    int index1,
+    int corner_index,
+    double width,
+    double distance,
+    double expected_coupling,
+    double expected_fringe
+) {
+  double coupling = 0, fringe = 0;
+  PhyDBExpects(
+      engine.Evaluate(type, 2, index0, index1, corner_index, width, distance, coupling, fringe),
+      "no table " << type << " " << index0 << " " << index1 << " for metal 2 in corner " << corner_index
+  );
+  PhyDBExpects(
+      Near(coupling, expected_coupling) && Near(fringe, expected_fringe),
+      "table " << type << " " << index0 << " " << index1 << " at width " << width << " and distance " << distance
+               << " gives " << coupling << " and " << fringe << " instead of " << expected_coupling << " and "
+               << expected_fringe
+  );
+}
+
+// test/tech_config.txt has CAP_OVER tables over the substrate for every metal in both corners,
+// and, for Metal 3 in the first corner only, CAP_OVER 1, CAP_UNDER 4 and CAP_OVERUNDER 1 4 tables
+int main(int argc, char **argv) {
+  std::string lef_file_name, def_file_name, tech_config_file_name;
+  GetDesignFiles(argc, argv, lef_file_name, def_file_name, &tech_config_file_name);
+
+  std::unique_ptr<PhyDB> phy_db = LoadDesign(lef_file_name, def_file_name);
+  phy_db->ReadTechConfigFile(tech_config_file_name);
+  CapacitanceEngine const &engine = phy_db->capacitance_engine();
+  PhyDBExpects(engine.NumCorners() == 2, "the technology configuration has 2 corners, not " << engine.NumCorners());
+  PhyDBExpects(engine.MetalIndex(phy_db->GetTechPtr()->GetLayerId("met2")) == 2, "met2 is not metal 2");
+
+  // the closest context the file has a table for
+  ExpectContext(engine, 0, 3, 0, CAP_OVERUNDER, 0, 3);
+  ExpectContext(engine, 0, 4, 0, CAP_OVER, 0, -1);
+  ExpectContext(engine, 1, 3, 0, CAP_UNDER, 3, -1);
+  ExpectContext(engine, -1, 3, 0, CAP_UNDER, 3, -1);
+  ExpectContext(engine, 1, 4, 0, CAP_OVER, -1, -1);
+  ExpectContext(engine, 0, 3, 1, CAP_OVER, -1, -1);
+  std::cout << "context tables fall back to the closest one in the file" << std::endl;
+
+  // entries of the closest width, interpolated between distances and clamped outside them
+  ExpectValues(engine, CAP_OVERUNDER, 0, 3, 0, 0.15, 0.3, 0.04070, 0.04800);
+  ExpectValues(engine, CAP_OVERUNDER, 0, 3, 0, 0.28, 0.3, 0.04363, 0.05100);
+  ExpectValues(engine, CAP_OVERUNDER, 0, 3, 0, 0.15, 0.55, (0.04070 + 0.01628) / 2, 0.04800);
+  ExpectValues(engine, CAP_OVERUNDER, 0, 3, 0, 0.15, 0.05, 0.06512, 0.04800);
+  ExpectValues(engine, CAP_OVERUNDER, 0, 3, 0, 0.15, 3.0, 0.00407, 0.04800);
+  ExpectValues(engine, CAP_OVER, 0, -1, 0, 0.15, 0.8, 0.02220, 0.03300);
+  ExpectValues(engine, CAP_OVER, -1, -1, 1, 0.15, 0.1, 0.09600, 0.02760);
+  double coupling, fringe;
+  PhyDBExpects(
+      !engine.Evaluate(CAP_OVERUNDER, 2, 0, 3, 1, 0.15, 0.3, coupling, fringe),
+      "metal 2 has a CAP_OVERUNDER table in the second corner"
+  );
+  std::cout << "tables are interpolated between their entries" << std::endl;
+
+  // and the extracted network is annotated from them
+  phy_db->GenerateRCNetwork();
+  phy_db->AnnotateCapacitance(0);
+  Geometry &geometry = *phy_db->GetGeometryPtr();
+  PhyDBExpects(geometry.getAnnotatedCorner() == 0, "the network is not annotated");
+  size_t num_couplings = 0;
+  for (auto const &cap : geometry.getCapacitorNetwork()) {
+    PhyDBExpects(cap->getCapacitance() >= 0, "negative coupling capacitance");
+    if (cap->getCapacitance() > 0) ++num_couplings;
+  }
+  PhyDBExpects(num_couplings > 0, "no coupling capacitance is annotated");
+  std::cout << num_couplings << " couplings are annotated" << std::endl;
+
+  std::cout << "Capacitance table test passes!" << std::endl;
+  return 0;
+}
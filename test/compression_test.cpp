@@ -0,0 +1,88 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include <cstdio>
+#include <iostream>
+
+#include "phydb/common/compressedfile.h"
+#include "test_helpers.h"
+
+using namespace phydb;
+
+// round trips a DEF and a guide file through every compression PhyDB is built with
+int main(int argc, char **argv) {
+  std::string lef_file_name, def_file_name;
+  GetDesignFiles(argc, argv, lef_file_name, def_file_name);
+
+  PhyDB phy_db;
+  phy_db.ReadLef(lef_file_name);
+  phy_db.ReadDef(def_file_name);
+  phy_db.WriteDef("roundtrip.def");
+  phy_db.WriteGuide("roundtrip.guide");
+
+  // what a plain DEF reads back as, to compare the compressed read path against
+  std::string plain_def;
+  {
+    PhyDB plain_db;
+    plain_db.ReadLef(lef_file_name);
+    plain_db.ReadDef("roundtrip.def");
+    plain_db.WriteDef("roundtrip_plain.def");
+    PhyDBExpects(ReadWholeFile("roundtrip_plain.def", plain_def), "Cannot read roundtrip_plain.def");
+  }
+
+  std::string expected_def, expected_guide;
+  PhyDBExpects(ReadWholeFile("roundtrip.def", expected_def), "Cannot read roundtrip.def");
+  PhyDBExpects(ReadWholeFile("roundtrip.guide", expected_guide), "Cannot read roundtrip.guide");
+
+  for (std::string const &suffix : {std::string(".gz"), std::string(".zst")}) {
+    if (!IsCompressionSupported(CompressionOf(suffix))) {
+      std::cout << "PhyDB is built without " << suffix << " support, skipping" << std::endl;
+      continue;
+    }
+
+    // write path: the decompressed text equals what is written to a plain file
+    std::string def_text, guide_text;
+    phy_db.WriteDef("roundtrip.def" + suffix);
+    phy_db.WriteGuide("roundtrip.guide" + suffix);
+    PhyDBExpects(ReadWholeFile("roundtrip.def" + suffix, def_text), "Cannot read roundtrip.def" + suffix);
+    PhyDBExpects(ReadWholeFile("roundtrip.guide" + suffix, guide_text), "Cannot read roundtrip.guide" + suffix);
+    PhyDBExpects(def_text == expected_def, "roundtrip.def" + suffix + " differs from roundtrip.def");
+    PhyDBExpects(guide_text == expected_guide, "roundtrip.guide" + suffix + " differs from roundtrip.guide");
+
+    // read path: the compressed DEF loads as the plain one does
+    PhyDB compressed_db;
+    compressed_db.ReadLef(lef_file_name);
+    compressed_db.ReadDef("roundtrip.def" + suffix);
+    compressed_db.WriteDef("roundtrip_compressed.def");
+    PhyDBExpects(ReadWholeFile("roundtrip_compressed.def", def_text), "Cannot read roundtrip_compressed.def");
+    PhyDBExpects(def_text == plain_def, "roundtrip.def" + suffix + " reads back differently from roundtrip.def");
+
+    std::remove(("roundtrip.def" + suffix).c_str());
+    std::remove(("roundtrip.guide" + suffix).c_str());
+    std::remove("roundtrip_compressed.def");
+    std::cout << suffix << " round trip test passes!" << std::endl;
+  }
+
+  std::remove("roundtrip.def");
+  std::remove("roundtrip.guide");
+  std::remove("roundtrip_plain.def");
+  return 0;
+}
@@ -0,0 +1,80 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "phydb/common/logging.h"
+#include "phydb/phydb.h"
+
+using namespace phydb;
+
+void AddWire(PhyDB &phy_db, std::string const &net_name, double x1, double y1, double x2, double y2) {
+  static std::map<std::string, int> segment_ids; // numbered per net, as the DEF reader does
+  std::vector<Point2D<double>> centerline = {Point2D<double>(x1, y1), Point2D<double>(x2, y2)};
+  phy_db.AddWireSegmentGeometryFromCenterline(centerline, "met1", segment_ids[net_name], net_name);
+}
+
+bool SameRect(Rect2D<double> const &a, Rect2D<double> const &b) {
+  return a.ll.x == b.ll.x && a.ll.y == b.ll.y && a.ur.x == b.ur.x && a.ur.y == b.ur.y;
+}
+
+int main() {
+  PhyDB phy_db;
+  phy_db.SetDatabaseMicron(1000);
+  phy_db.SetDieArea(0, 0, 100000, 100000);
+  phy_db.AddLayer("met1", LayerType::ROUTING)->SetWidth(0.1);
+
+  // two wires with a gap, two overlapping in line, and two overlapping at a corner
+  phy_db.AddNet("open");
+  AddWire(phy_db, "open", 0, 0, 10000, 0);
+  AddWire(phy_db, "open", 20000, 0, 30000, 0);
+  phy_db.AddNet("straight");
+  AddWire(phy_db, "straight", 0, 5000, 10000, 5000);
+  AddWire(phy_db, "straight", 10000, 5000, 20000, 5000);
+  phy_db.AddNet("bent");
+  AddWire(phy_db, "bent", 0, 10000, 10000, 10000);
+  AddWire(phy_db, "bent", 10000, 10000, 10000, 20000);
+
+  Geometry &geometry = *phy_db.GetGeometryPtr();
+  geometry.setConnectivityCheck(true);
+  phy_db.GenerateRCNetwork();
+  unsigned open_id = geometry.getNetId("open");
+  std::vector<unsigned> open_nets = geometry.getOpenNets();
+  PhyDBExpects(open_nets.size() == 1 && open_nets[0] == open_id, open_nets.size() << " nets are reported open");
+  std::vector<Rect2D<double>> const &pieces = geometry.getNetPieces(open_id);
+  PhyDBExpects(
+      pieces.size() == 2 && SameRect(pieces[0], Rect2D<double>(-50, -50, 10050, 50))
+          && SameRect(pieces[1], Rect2D<double>(19950, -50, 30050, 50)),
+      "net open is found in " << pieces.size() << " pieces, not the two wires"
+  );
+  std::cout << "the net with a gap is found in two pieces" << std::endl;
+
+  // closing the gap closes the net at the next extraction
+  AddWire(phy_db, "open", 10000, 0, 20000, 0);
+  phy_db.GenerateRCNetwork();
+  PhyDBExpects(geometry.getOpenNets().empty(), "net open is still open after closing its gap");
+  std::cout << "the net is closed once its gap is" << std::endl;
+
+  std::cout << "Connectivity check test passes!" << std::endl;
+  return 0;
+}
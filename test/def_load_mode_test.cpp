@@ -0,0 +1,113 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include <iostream>
+#include <memory>
+
+#include "test_helpers.h"
+
+using namespace phydb;
+
+std::unique_ptr<PhyDB> LoadDesign(
+    std::string const &lef_file_name,
+    std::string const &def_file_name,
+    DefLoadMode mode,
+    std::vector<std::string> const &geometry_nets,
+    bool use_native
+) {
+  return LoadDesign(lef_file_name, def_file_name, [&](PhyDB &phy_db) {
+    phy_db.SetDefLoadMode(mode, geometry_nets);
+    phy_db.UseNativeDefReader(use_native);
+  });
+}
+
+size_t NumSegments(PhyDB &phy_db, std::string const &net_name) {
+  return phy_db.GetGeometryPtr()->getSegmentsOfNet(net_name).size();
+}
+
+// every mode loads the same nets, only their wire segments and the special nets differ
+void CheckConnectivity(PhyDB &full_db, PhyDB &db, std::string const &label) {
+  std::vector<Net> &full_nets = full_db.GetDesignPtr()->GetNetsRef();
+  std::vector<Net> &nets = db.GetDesignPtr()->GetNetsRef();
+  PhyDBExpects(nets.size() == full_nets.size(), label << ": net count differs");
+  for (size_t i = 0; i < nets.size(); ++i) {
+    PhyDBExpects(
+        nets[i].GetName() == full_nets[i].GetName() && nets[i].GetPinsRef() == full_nets[i].GetPinsRef()
+            && nets[i].GetIoPinIdsRef() == full_nets[i].GetIoPinIdsRef(),
+        label << ": net " << nets[i].GetName() << " differs"
+    );
+  }
+}
+
+int main(int argc, char **argv) {
+  std::string lef_file_name, def_file_name;
+  GetDesignFiles(argc, argv, lef_file_name, def_file_name);
+
+  for (bool use_native : {false, true}) {
+    std::string reader = use_native ? "native reader" : "Si2 reader";
+    std::unique_ptr<PhyDB> full_db = LoadDesign(lef_file_name, def_file_name, DefLoadMode::FULL_GEOMETRY, {}, use_native);
+    std::vector<SNet> &full_snets = full_db->GetSNetRef();
+    PhyDBExpects(!full_snets.empty(), reader << ": FULL_GEOMETRY loads no special net");
+    std::vector<Net> &full_nets = full_db->GetDesignPtr()->GetNetsRef();
+    size_t routed_net = 0;
+    while (routed_net < full_nets.size() && NumSegments(*full_db, full_nets[routed_net].GetName()) == 0) ++routed_net;
+    PhyDBExpects(routed_net + 1 < full_nets.size(), reader << ": FULL_GEOMETRY loads no wire segment");
+    std::string routed_net_name = full_nets[routed_net].GetName();
+    std::string other_net_name = full_nets[routed_net + 1].GetName();
+    std::string snet_name = full_snets[0].GetName();
+
+    std::unique_ptr<PhyDB> snets_db = LoadDesign(lef_file_name, def_file_name, DefLoadMode::CONNECTIVITY_AND_SNETS, {}, use_native);
+    CheckConnectivity(*full_db, *snets_db, reader + " in CONNECTIVITY_AND_SNETS mode");
+    PhyDBExpects(
+        snets_db->GetSNetRef().size() == full_snets.size() && NumSegments(*snets_db, routed_net_name) == 0,
+        reader << ": CONNECTIVITY_AND_SNETS mode loads other special nets or wire segments"
+    );
+
+    std::unique_ptr<PhyDB> connectivity_db = LoadDesign(lef_file_name, def_file_name, DefLoadMode::CONNECTIVITY, {}, use_native);
+    CheckConnectivity(*full_db, *connectivity_db, reader + " in CONNECTIVITY mode");
+    PhyDBExpects(
+        connectivity_db->GetSNetRef().empty() && NumSegments(*connectivity_db, routed_net_name) == 0,
+        reader << ": CONNECTIVITY mode loads special nets or wire segments"
+    );
+
+    // the nets given geometry are loaded as in FULL_GEOMETRY mode, special ones included
+    std::unique_ptr<PhyDB> listed_db = LoadDesign(
+        lef_file_name, def_file_name, DefLoadMode::CONNECTIVITY, {snet_name, routed_net_name}, use_native
+    );
+    CheckConnectivity(*full_db, *listed_db, reader + " in CONNECTIVITY mode with geometry nets");
+    std::vector<SNet> &listed_snets = listed_db->GetSNetRef();
+    PhyDBExpects(
+        listed_snets.size() == 1 && listed_snets[0].GetName() == snet_name
+            && listed_snets[0].GetPathsRef().size() == full_snets[0].GetPathsRef().size()
+            && listed_snets[0].GetPolygonsRef().size() == full_snets[0].GetPolygonsRef().size(),
+        reader << ": CONNECTIVITY mode does not load special net " << snet_name << " alone"
+    );
+    PhyDBExpects(
+        NumSegments(*listed_db, routed_net_name) == NumSegments(*full_db, routed_net_name)
+            && NumSegments(*listed_db, other_net_name) == 0,
+        reader << ": CONNECTIVITY mode does not load the wire segments of " << routed_net_name << " alone"
+    );
+    std::cout << reader << " loads what each mode asks for" << std::endl;
+  }
+
+  std::cout << "DEF load mode test passes!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,123 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "test_helpers.h"
+
+using namespace phydb;
+
+std::unique_ptr<PhyDB> LoadDesign(
+    std::string const &lef_file_name,
+    std::string const &def_file_name,
+    bool use_native,
+    int num_threads
+) {
+  return LoadDesign(lef_file_name, def_file_name, [&](PhyDB &phy_db) {
+    phy_db.UseNativeDefReader(use_native, num_threads);
+  });
+}
+
+bool SameRect(Rect2D<double> const &a, Rect2D<double> const &b) {
+  return a.ll.x == b.ll.x && a.ll.y == b.ll.y && a.ur.x == b.ur.x && a.ur.y == b.ur.y;
+}
+
+// the Si2 load is the reference, ids, connections and wire segments have to match it
+void CompareDesigns(PhyDB &expected_db, PhyDB &db, std::string const &label) {
+  std::vector<Component> &expected_comps = expected_db.GetDesignPtr()->GetComponentsRef();
+  std::vector<Component> &comps = db.GetDesignPtr()->GetComponentsRef();
+  PhyDBExpects(comps.size() == expected_comps.size(), label << ": component count differs");
+  for (size_t i = 0; i < comps.size(); ++i) {
+    PhyDBExpects(
+        comps[i].GetName() == expected_comps[i].GetName()
+            && comps[i].GetMacro()->GetName() == expected_comps[i].GetMacro()->GetName()
+            && comps[i].GetLocation().x == expected_comps[i].GetLocation().x
+            && comps[i].GetLocation().y == expected_comps[i].GetLocation().y
+            && comps[i].GetOrientation() == expected_comps[i].GetOrientation(),
+        label << ": component " << i << " differs, " << comps[i].GetName()
+              << " instead of " << expected_comps[i].GetName()
+    );
+  }
+
+  std::vector<IOPin> &expected_iopins = expected_db.GetDesignPtr()->GetIoPinsRef();
+  std::vector<IOPin> &iopins = db.GetDesignPtr()->GetIoPinsRef();
+  PhyDBExpects(iopins.size() == expected_iopins.size(), label << ": IO pin count differs");
+  for (size_t i = 0; i < iopins.size(); ++i) {
+    PhyDBExpects(
+        iopins[i].GetName() == expected_iopins[i].GetName(),
+        label << ": IO pin " << i << " differs, " << iopins[i].GetName()
+              << " instead of " << expected_iopins[i].GetName()
+    );
+  }
+
+  std::vector<Net> &expected_nets = expected_db.GetDesignPtr()->GetNetsRef();
+  std::vector<Net> &nets = db.GetDesignPtr()->GetNetsRef();
+  PhyDBExpects(nets.size() == expected_nets.size(), label << ": net count differs");
+  for (size_t i = 0; i < nets.size(); ++i) {
+    std::string const &net_name = nets[i].GetName();
+    PhyDBExpects(
+        net_name == expected_nets[i].GetName(),
+        label << ": net " << i << " differs, " << net_name << " instead of " << expected_nets[i].GetName()
+    );
+    PhyDBExpects(
+        nets[i].GetPinsRef() == expected_nets[i].GetPinsRef()
+            && nets[i].GetIoPinIdsRef() == expected_nets[i].GetIoPinIdsRef(),
+        label << ": connections of net " << net_name << " differ"
+    );
+
+    auto &expected_segs = expected_db.GetGeometryPtr()->getSegmentsOfNet(net_name);
+    auto &segs = db.GetGeometryPtr()->getSegmentsOfNet(net_name);
+    PhyDBExpects(
+        segs.size() == expected_segs.size(),
+        label << ": net " << net_name << " has " << segs.size() << " wire segments instead of "
+              << expected_segs.size()
+    );
+    for (size_t j = 0; j < segs.size(); ++j) {
+      PhyDBExpects(
+          SameRect(segs[j]->getRect(), expected_segs[j]->getRect())
+              && segs[j]->getLayerName() == expected_segs[j]->getLayerName(),
+          label << ": wire segment " << j << " of net " << net_name << " differs"
+      );
+    }
+  }
+  std::cout << label << " matches the Si2 load: " << comps.size() << " components, "
+            << nets.size() << " nets" << std::endl;
+}
+
+int main(int argc, char **argv) {
+  std::string lef_file_name, def_file_name;
+  GetDesignFiles(argc, argv, lef_file_name, def_file_name);
+
+  std::unique_ptr<PhyDB> si2_db = LoadDesign(lef_file_name, def_file_name, false, 1);
+  std::unique_ptr<PhyDB> native_db = LoadDesign(lef_file_name, def_file_name, true, 1);
+  CompareDesigns(*si2_db, *native_db, "native reader");
+  native_db.reset();
+  // odd counts leave uneven chunks, more threads than the sections have chunks leaves some idle
+  for (int num_threads : {2, 3, 4, 8, 1024}) {
+    std::unique_ptr<PhyDB> threaded_db = LoadDesign(lef_file_name, def_file_name, true, num_threads);
+    CompareDesigns(*si2_db, *threaded_db, "native reader on " + std::to_string(num_threads) + " threads");
+  }
+
+  std::cout << "DEF reader test passes!" << std::endl;
+  return 0;
+}
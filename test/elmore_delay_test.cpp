@@ -0,0 +1,124 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "phydb/common/logging.h"
+#include "phydb/phydb.h"
+
+using namespace phydb;
+
+bool Near(double a, double b) {
+  return std::fabs(a - b) <= 1e-9 * std::max(std::fabs(a), std::fabs(b));
+}
+
+void AddIoPin(PhyDB &phy_db, std::string const &name, SignalDirection direction, int x) {
+  IOPin *iopin = phy_db.AddIoPin(name, direction, SignalUse::SIGNAL);
+  iopin->SetShape("met1", -50, -50, 50, 50);
+  iopin->SetPlacement(PlaceStatus::PLACED, x, 0, CompOrient::N);
+  phy_db.AddIoPinToNet(name, "line");
+}
+
+// a 100 um wire on met1 driven from its left end, with loads in the middle and at the right end;
+// it is routed as two 50 um wires, as a DEF would have it
+void BuildLine(PhyDB &phy_db) {
+  phy_db.SetDatabaseMicron(1000);
+  phy_db.SetDieArea(0, 0, 200000, 200000);
+  phy_db.AddLayer("met1", LayerType::ROUTING)->SetWidth(0.1);
+  Tech &tech = *phy_db.GetTechPtr();
+  tech.FindAllMetalLayers();
+  tech.SetUnitResAndCap(0.1, 0.00003, 0.00004);
+
+  phy_db.AddNet("line");
+  AddIoPin(phy_db, "in", SignalDirection::INPUT, 0);
+  AddIoPin(phy_db, "mid", SignalDirection::OUTPUT, 50000);
+  AddIoPin(phy_db, "out", SignalDirection::OUTPUT, 100000);
+  int segment_id = 0;
+  for (double x : {0.0, 50000.0}) {
+    std::vector<Point2D<double>> centerline = {Point2D<double>(x, 0), Point2D<double>(x + 50000, 0)};
+    phy_db.AddWireSegmentGeometryFromCenterline(centerline, "met1", segment_id, "line");
+  }
+}
+
+// the line's resistors form a chain from left to right, so the delay to x is the sum over the
+// resistors left of x of their resistance times the capacitance right of them, half their own
+double ExpectedDelay(PhyDB &phy_db, MultiCornerRC const &rc_values, double x) {
+  auto const &resistors = phy_db.GetGeometryPtr()->getResistorNetwork();
+  std::vector<size_t> order(resistors.size());
+  for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+  auto left = [&](size_t i) { return std::min(resistors[i]->getP1().x, resistors[i]->getP2().x); };
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return left(a) < left(b); });
+
+  double delay = 0;
+  for (size_t k = 0; k < order.size() && left(order[k]) < x; ++k) {
+    double downstream = rc_values.GroundCapacitances(0)[order[k]] / 2;
+    for (size_t j = k + 1; j < order.size(); ++j) downstream += rc_values.GroundCapacitances(0)[order[j]];
+    delay += rc_values.Resistances(0)[order[k]] * downstream;
+  }
+  return delay;
+}
+
+int main() {
+  PhyDB phy_db;
+  BuildLine(phy_db);
+  phy_db.GenerateRCNetwork();
+  MultiCornerRC rc_values;
+  phy_db.EvaluateRCCorners(rc_values, 0);
+
+  phy_db.ComputeElmoreDelays(0);
+  ActPhyDBTimingAPI &timing_api = phy_db.GetTimingApi();
+  PhyDBExpects(timing_api.IsElmoreReady(), "Elmore delays are not ready");
+  ElmoreEngine const &engine = timing_api.GetElmoreEngine();
+  PhyDBExpects(engine.NumLoads(0) == 2, "the line has " << engine.NumLoads(0) << " loads instead of 2");
+
+  std::vector<double> delays, slews;
+  for (std::string const &name : {std::string("mid"), std::string("out")}) {
+    PhydbPin pin(-1, phy_db.GetIoPinId(name));
+    double delay = timing_api.GetElmoreDelay(0, pin);
+    double expected_delay = ExpectedDelay(phy_db, rc_values, name == "mid" ? 50000 : 100000);
+    PhyDBExpects(
+        expected_delay > 0 && Near(delay, expected_delay),
+        "Elmore delay to " << name << " is " << delay << " instead of " << expected_delay
+    );
+    delays.push_back(delay);
+    slews.push_back(timing_api.GetElmoreSlew(0, pin));
+  }
+  PhyDBExpects(slews[0] > 0 && slews[1] > slews[0], "slews do not grow along the line");
+  std::cout << "Elmore delays along the line: " << delays[0] << " and " << delays[1] << std::endl;
+
+  // the driver is no load, and threads do not change the result
+  PhyDBExpects(
+      timing_api.GetElmoreDelay(0, PhydbPin(-1, phy_db.GetIoPinId("in"))) == -1,
+      "the driver is reported as a load"
+  );
+  phy_db.ComputeElmoreDelays(0, 4);
+  for (size_t i = 0; i < engine.NumLoads(0); ++i) {
+    ElmoreLoad const &load = engine.Load(0, i);
+    size_t k = load.pin.pin_id == phy_db.GetIoPinId("mid") ? 0 : 1;
+    PhyDBExpects(load.delay == delays[k] && load.slew == slews[k], "Elmore delays differ on 4 threads");
+  }
+
+  std::cout << "Elmore delay test passes!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,104 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+
+#include "test_helpers.h"
+
+using namespace phydb;
+
+std::string NetworkText(PhyDB &phy_db) {
+  std::ostringstream s;
+  phy_db.PrintRCNetwork(s);
+  return s.str();
+}
+
+// overlap length of the couplings between two nets on a layer at a distance, for the couplings up to
+// max_distance; splitting resistors changes how many capacitors a coupling takes, but not this
+std::map<std::string, double> CouplingSummary(PhyDB &phy_db, double max_distance) {
+  Geometry &geometry = *phy_db.GetGeometryPtr();
+  std::map<std::string, double> summary;
+  for (auto const &cap : geometry.getCapacitorNetwork()) {
+    if (cap->getDistance() > max_distance) continue;
+    std::string net1 = geometry.getNetName(cap->getNetId1());
+    std::string net2 = geometry.getNetName(cap->getNetId2());
+    if (net2 < net1) std::swap(net1, net2);
+    std::ostringstream key;
+    key << net1 << " " << net2 << " " << geometry.getLayerName(cap->getLayerId()) << " " << cap->getDistance();
+    summary[key.str()] += cap->getOverlapLength();
+  }
+  return summary;
+}
+
+// the settings that change how the network is built, but not the network
+void CompareSettings(std::string const &expected_text, PhyDB &db, int num_threads, std::string const &label) {
+  db.GenerateRCNetwork(num_threads);
+  PhyDBExpects(NetworkText(db) == expected_text, label << ": network differs from a serial extraction");
+  std::cout << label << " matches a serial extraction" << std::endl;
+}
+
+int main(int argc, char **argv) {
+  std::string lef_file_name, def_file_name;
+  GetDesignFiles(argc, argv, lef_file_name, def_file_name);
+
+  std::unique_ptr<PhyDB> serial_db = LoadDesign(lef_file_name, def_file_name);
+  serial_db->GenerateRCNetwork();
+  std::string expected_text = NetworkText(*serial_db);
+  PhyDBExpects(!serial_db->GetGeometryPtr()->getResistorNetwork().empty(), "serial extraction builds no resistor");
+
+  for (int num_threads : {2, 4, 7}) {
+    std::unique_ptr<PhyDB> db = LoadDesign(lef_file_name, def_file_name);
+    CompareSettings(expected_text, *db, num_threads, "extraction on " + std::to_string(num_threads) + " threads");
+  }
+
+  // arena storage, with a second extraction that releases the first one's arenas
+  for (int num_threads : {1, 4}) {
+    std::unique_ptr<PhyDB> db = LoadDesign(lef_file_name, def_file_name);
+    db->GetGeometryPtr()->setArenaStorage(true);
+    std::string label = "arena storage on " + std::to_string(num_threads) + (num_threads == 1 ? " thread" : " threads");
+    CompareSettings(expected_text, *db, num_threads, label);
+    db->GetGeometryPtr()->clearRCNetwork();
+    CompareSettings(expected_text, *db, num_threads, label + " after clearing the network");
+  }
+
+  // the R-tree finds the couplings the bin grid finds up to the neighbour distance, the grid
+  // reaches a little further
+  std::unique_ptr<PhyDB> rtree_db = LoadDesign(lef_file_name, def_file_name);
+  Geometry &rtree_geometry = *rtree_db->GetGeometryPtr();
+  rtree_geometry.setSpatialIndex(SpatialIndexType::RTREE);
+  rtree_db->GenerateRCNetwork();
+  double neighbour_distance = rtree_geometry.getNeighbourDistance();
+  std::map<std::string, double> rtree_couplings = CouplingSummary(*rtree_db, neighbour_distance);
+  PhyDBExpects(
+      !rtree_couplings.empty() && rtree_couplings == CouplingSummary(*serial_db, neighbour_distance),
+      "R-tree index finds other couplings than the bin grid"
+  );
+  std::cout << "R-tree index finds the " << rtree_couplings.size() << " couplings of the bin grid" << std::endl;
+  std::unique_ptr<PhyDB> threaded_rtree_db = LoadDesign(lef_file_name, def_file_name);
+  threaded_rtree_db->GetGeometryPtr()->setSpatialIndex(SpatialIndexType::RTREE);
+  CompareSettings(NetworkText(*rtree_db), *threaded_rtree_db, 4, "R-tree index on 4 threads");
+
+  std::cout << "Extraction settings test passes!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,119 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include <iostream>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "test_helpers.h"
+
+using namespace phydb;
+
+// the nets with an up to date network are exactly the expected ones, in name order
+void CheckExtractedNets(PhyDB &phy_db, std::set<std::string> const &expected, std::string const &label) {
+  Geometry &geometry = *phy_db.GetGeometryPtr();
+  std::vector<std::string> extracted;
+  for (unsigned net_id : geometry.getExtractedNets()) {
+    extracted.push_back(geometry.getNetName(net_id));
+  }
+  PhyDBExpects(
+      extracted == std::vector<std::string>(expected.begin(), expected.end()),
+      label << " extracts " << extracted.size() << " nets instead of the " << expected.size() << " in scope"
+  );
+}
+
+// nets with a segment touching region, found without the spatial index
+std::set<std::string> NetsTouching(PhyDB &phy_db, Rect2D<double> const &region) {
+  Geometry &geometry = *phy_db.GetGeometryPtr();
+  std::set<std::string> nets;
+  for (unsigned net_id = 0; net_id < geometry.getNumNets(); ++net_id) {
+    for (auto const &seg : geometry.getNetSegments(net_id)) {
+      Rect2D<double> rect = seg->getRect();
+      if (rect.ur.x >= region.ll.x && rect.ll.x <= region.ur.x && rect.ur.y >= region.ll.y && rect.ll.y <= region.ur.y) {
+        nets.insert(geometry.getNetName(net_id));
+        break;
+      }
+    }
+  }
+  return nets;
+}
+
+int main(int argc, char **argv) {
+  std::string lef_file_name, def_file_name;
+  GetDesignFiles(argc, argv, lef_file_name, def_file_name);
+
+  std::unique_ptr<PhyDB> full_db = LoadDesign(lef_file_name, def_file_name);
+  full_db->GenerateRCNetwork();
+
+  // the left half of the die first, then every other net, then nets with a name of even length, then the rest
+  std::unique_ptr<PhyDB> scoped_db = LoadDesign(lef_file_name, def_file_name);
+  Rect2D<int> die_area = scoped_db->GetDieArea();
+  ExtractionScope region_scope;
+  region_scope.use_region = true;
+  region_scope.region = Rect2D<double>(die_area.LLX(), die_area.LLY(), (die_area.LLX() + die_area.URX()) / 2, die_area.URY());
+  scoped_db->GenerateRCNetwork(region_scope);
+  std::set<std::string> in_scope = NetsTouching(*scoped_db, region_scope.region);
+  PhyDBExpects(!in_scope.empty(), "no net touches the left half of the die");
+  CheckExtractedNets(*scoped_db, in_scope, "the region scope");
+  ExtractionScope net_scope;
+  std::vector<Net> &nets = scoped_db->GetDesignPtr()->GetNetsRef();
+  for (size_t i = 0; i < nets.size(); i += 2) {
+    net_scope.nets.push_back(nets[i].GetName());
+  }
+  scoped_db->GenerateRCNetwork(net_scope);
+  in_scope.insert(net_scope.nets.begin(), net_scope.nets.end());
+  CheckExtractedNets(*scoped_db, in_scope, "the net list scope");
+  ExtractionScope filter_scope;
+  filter_scope.net_filter = [](std::string const &net_name) { return net_name.size() % 2 == 0; };
+  scoped_db->GenerateRCNetwork(filter_scope);
+  Geometry &scoped_geometry = *scoped_db->GetGeometryPtr();
+  for (unsigned net_id = 0; net_id < scoped_geometry.getNumNets(); ++net_id) {
+    if (filter_scope.net_filter(scoped_geometry.getNetName(net_id))) in_scope.insert(scoped_geometry.getNetName(net_id));
+  }
+  CheckExtractedNets(*scoped_db, in_scope, "the net filter scope");
+  scoped_db->GenerateRCNetwork();
+  for (unsigned net_id = 0; net_id < scoped_geometry.getNumNets(); ++net_id) {
+    in_scope.insert(scoped_geometry.getNetName(net_id)); // nets without wires too
+  }
+  CheckExtractedNets(*scoped_db, in_scope, "the whole design");
+  std::cout << "each scope extracts exactly the nets in it" << std::endl;
+  CompareNetworks(*full_db, *scoped_db, "extraction in four scopes");
+
+  // nets removed after extraction leave their neighbours as a full extraction without them would
+  std::unique_ptr<PhyDB> removed_db = LoadDesign(lef_file_name, def_file_name);
+  std::unique_ptr<PhyDB> expected_db = LoadDesign(lef_file_name, def_file_name);
+  removed_db->GenerateRCNetwork();
+  for (size_t i = 0; i < nets.size(); i += 3) {
+    removed_db->RemoveNetGeometry(nets[i].GetName());
+    expected_db->RemoveNetGeometry(nets[i].GetName());
+  }
+  removed_db->GenerateRCNetwork();
+  expected_db->GenerateRCNetwork();
+  CompareNetworks(*expected_db, *removed_db, "re-extraction after removing nets");
+
+  // and extracting the whole design again changes nothing
+  removed_db->GenerateRCNetwork();
+  CompareNetworks(*expected_db, *removed_db, "repeated extraction");
+
+  std::cout << "Incremental extraction test passes!" << std::endl;
+  return 0;
+}
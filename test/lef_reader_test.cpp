@@ -0,0 +1,174 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "phydb/lefnativereader.h"
+#include "test_helpers.h"
+
+using namespace phydb;
+
+void WriteFile(std::string const &file_name, std::string const &text) {
+  std::ofstream out(file_name);
+  PhyDBExpects(out.is_open(), "Cannot write " + file_name);
+  out << text;
+}
+
+// a technology LEF with everything before the first MACRO, and cell LEFs each with half of
+// the macros under the VERSION, name-syntax and UNITS statements of the original
+std::vector<std::string> SplitLef(std::string const &lef_file_name) {
+  std::ifstream in(lef_file_name);
+  PhyDBExpects(in.is_open(), "Cannot read " + lef_file_name);
+  std::string tech, header, line;
+  std::vector<std::string> macros;
+  bool in_units = false;
+  while (std::getline(in, line)) {
+    std::istringstream words(line);
+    std::string first;
+    words >> first;
+    if (first == "MACRO") macros.emplace_back();
+    if (first == "END" && line.find("LIBRARY") != std::string::npos) continue;
+    if (!macros.empty()) {
+      macros.back() += line + "\n";
+      continue;
+    }
+    tech += line + "\n";
+    if (first == "UNITS") in_units = true;
+    if (in_units || first == "VERSION" || first == "BUSBITCHARS" || first == "DIVIDERCHAR") {
+      header += line + "\n";
+    }
+    if (first == "END" && line.find("UNITS") != std::string::npos) in_units = false;
+  }
+  PhyDBExpects(macros.size() >= 2, lef_file_name << " has " << macros.size() << " macros, at least two are needed");
+
+  std::vector<std::string> file_names = {"lef_reader_test_tech.lef"};
+  WriteFile(file_names[0], tech + "END LIBRARY\n");
+  size_t half = macros.size() / 2;
+  for (size_t begin : {size_t(0), half}) {
+    std::string cells = header;
+    for (size_t i = begin; i < (begin == 0 ? half : macros.size()); ++i) cells += macros[i];
+    file_names.push_back("lef_reader_test_cells" + std::to_string(file_names.size()) + ".lef");
+    WriteFile(file_names.back(), cells + "END LIBRARY\n");
+  }
+  return file_names;
+}
+
+bool SameLayerRects(std::vector<LayerRect> &expected, std::vector<LayerRect> &layer_rects) {
+  if (layer_rects.size() != expected.size()) return false;
+  for (size_t i = 0; i < layer_rects.size(); ++i) {
+    std::vector<Rect2D<double>> &rects = layer_rects[i].GetRects();
+    std::vector<Rect2D<double>> &expected_rects = expected[i].GetRects();
+    if (layer_rects[i].layer_name_ != expected[i].layer_name_ || rects.size() != expected_rects.size()) return false;
+    for (size_t j = 0; j < rects.size(); ++j) {
+      if (rects[j].ll.x != expected_rects[j].ll.x || rects[j].ll.y != expected_rects[j].ll.y
+          || rects[j].ur.x != expected_rects[j].ur.x || rects[j].ur.y != expected_rects[j].ur.y) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// macros in the same order with the same class, size, site, pins and shapes
+void CompareMacros(std::list<Macro> &expected_macros, std::list<Macro> &macros, std::string const &label) {
+  PhyDBExpects(
+      macros.size() == expected_macros.size(),
+      label << " has " << macros.size() << " macros instead of " << expected_macros.size()
+  );
+  auto expected_it = expected_macros.begin();
+  for (Macro &macro : macros) {
+    Macro &expected = *expected_it++;
+    std::string const &name = macro.GetName();
+    PhyDBExpects(name == expected.GetName(), label << ": macro " << name << " instead of " << expected.GetName());
+    PhyDBExpects(
+        macro.GetClass() == expected.GetClass() && macro.GetSite() == expected.GetSite()
+            && macro.GetOriginX() == expected.GetOriginX() && macro.GetOriginY() == expected.GetOriginY()
+            && macro.GetWidth() == expected.GetWidth() && macro.GetHeight() == expected.GetHeight()
+            && macro.GetSymmetry().Str() == expected.GetSymmetry().Str(),
+        label << ": class, site, origin, size or symmetry of macro " << name << " differs"
+    );
+    std::vector<Pin> &pins = macro.GetPinsRef();
+    std::vector<Pin> &expected_pins = expected.GetPinsRef();
+    PhyDBExpects(pins.size() == expected_pins.size(), label << ": pin count of macro " << name << " differs");
+    for (size_t i = 0; i < pins.size(); ++i) {
+      PhyDBExpects(
+          pins[i].GetName() == expected_pins[i].GetName()
+              && pins[i].GetDirection() == expected_pins[i].GetDirection()
+              && pins[i].GetUse() == expected_pins[i].GetUse()
+              && SameLayerRects(expected_pins[i].GetLayerRectRef(), pins[i].GetLayerRectRef()),
+          label << ": pin " << i << " of macro " << name << " differs"
+      );
+    }
+    PhyDBExpects(
+        SameLayerRects(expected.GetObs()->GetLayerRectsRef(), macro.GetObs()->GetLayerRectsRef()),
+        label << ": OBS of macro " << name << " differs"
+    );
+  }
+  std::cout << label << " matches one LEF read by Si2: " << macros.size() << " macros" << std::endl;
+}
+
+int main(int argc, char **argv) {
+  std::string lef_file_name, def_file_name;
+  GetDesignFiles(argc, argv, lef_file_name, def_file_name);
+  std::vector<std::string> lef_file_names = SplitLef(lef_file_name);
+
+  PhyDB expected_db;
+  expected_db.ReadLef(lef_file_name);
+  expected_db.ReadDef(def_file_name);
+
+  // the cell LEFs are ones the native reader handles, each on its own
+  std::list<Macro> native_macros;
+  for (size_t i = 1; i < lef_file_names.size(); ++i) {
+    LefNativeReader reader;
+    PhyDBExpects(reader.Read(lef_file_names[i]), "the native reader falls back to Si2 on " << lef_file_names[i]);
+    PhyDBExpects(
+        reader.HasUnits() && reader.DatabaseMicron() == expected_db.GetTechPtr()->GetDatabaseMicron(),
+        "the native reader misses the UNITS of " << lef_file_names[i]
+    );
+    native_macros.splice(native_macros.end(), reader.MacrosRef());
+  }
+  CompareMacros(expected_db.GetTechPtr()->GetMacrosRef(), native_macros, "native reader");
+
+  // ReadLefs() merges them in list order on any thread count, and the design loads on top
+  for (int num_threads : {1, 2, 4}) {
+    PhyDB phy_db;
+    phy_db.ReadLefs(lef_file_names, num_threads);
+    phy_db.ReadDef(def_file_name);
+    std::string label = "ReadLefs on " + std::to_string(num_threads) + " threads";
+    CompareMacros(expected_db.GetTechPtr()->GetMacrosRef(), phy_db.GetTechPtr()->GetMacrosRef(), label);
+    PhyDBExpects(
+        phy_db.GetDesignPtr()->GetComponentsRef().size() == expected_db.GetDesignPtr()->GetComponentsRef().size(),
+        label << ": the design loads " << phy_db.GetDesignPtr()->GetComponentsRef().size() << " components"
+    );
+  }
+
+  for (std::string const &file_name : lef_file_names) {
+    std::remove(file_name.c_str());
+  }
+  std::cout << "LEF reader test passes!" << std::endl;
+  return 0;
+}
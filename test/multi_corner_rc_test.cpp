@@ -0,0 +1,107 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include <cmath>
+#include <iostream>
+#include <memory>
+
+#include "test_helpers.h"
+
+using namespace phydb;
+
+bool Near(double a, double b) {
+  return std::fabs(a - b) <= 1e-9 * std::max(std::fabs(a), std::fabs(b)) + 1e-15;
+}
+
+void ExpectSameValues(double const *values, double const *expected_values, size_t count, std::string const &label) {
+  for (size_t i = 0; i < count; ++i) {
+    PhyDBExpects(
+        Near(values[i], expected_values[i]),
+        label << " of element " << i << " is " << values[i] << " instead of " << expected_values[i]
+    );
+  }
+}
+
+int main(int argc, char **argv) {
+  std::string lef_file_name, def_file_name, tech_config_file_name;
+  GetDesignFiles(argc, argv, lef_file_name, def_file_name, &tech_config_file_name);
+
+  std::unique_ptr<PhyDB> phy_db = LoadDesign(lef_file_name, def_file_name);
+  phy_db->ReadTechConfigFile(tech_config_file_name);
+  phy_db->GenerateRCNetwork();
+  Geometry &geometry = *phy_db->GetGeometryPtr();
+  size_t num_resistors = geometry.getResistorNetwork().size();
+  size_t num_capacitors = geometry.getCapacitorNetwork().size();
+
+  MultiCornerRC all_corners;
+  phy_db->EvaluateRCCorners(all_corners);
+  PhyDBExpects(all_corners.NumCorners() == 2, "the technology configuration has 2 corners, not " << all_corners.NumCorners());
+  PhyDBExpects(
+      all_corners.NumResistors() == num_resistors && all_corners.NumCapacitors() == num_capacitors,
+      "RC values are not evaluated for every element of the network"
+  );
+
+  bool corners_differ = false;
+  for (int corner = 0; corner < all_corners.NumCorners(); ++corner) {
+    std::string label = "corner " + std::to_string(corner);
+    PhyDBExpects(all_corners.IsEvaluated(corner), label << " is not evaluated");
+
+    // one corner alone gives the values of the pass over all of them
+    MultiCornerRC one_corner;
+    phy_db->EvaluateRCCorners(one_corner, corner);
+    PhyDBExpects(
+        one_corner.IsEvaluated(corner) && !one_corner.IsEvaluated(1 - corner),
+        label << " is not evaluated alone"
+    );
+    ExpectSameValues(one_corner.Resistances(corner), all_corners.Resistances(corner), num_resistors, label + " resistance");
+    ExpectSameValues(
+        one_corner.GroundCapacitances(corner), all_corners.GroundCapacitances(corner), num_resistors,
+        label + " ground capacitance"
+    );
+    ExpectSameValues(
+        one_corner.CouplingCapacitances(corner), all_corners.CouplingCapacitances(corner), num_capacitors,
+        label + " coupling capacitance"
+    );
+
+    // and the values the network is annotated with for that corner
+    phy_db->AnnotateCapacitance(corner);
+    std::vector<double> ground_caps, coupling_caps;
+    for (auto const &res : geometry.getResistorNetwork()) ground_caps.push_back(res->getGroundCapacitance());
+    for (auto const &cap : geometry.getCapacitorNetwork()) coupling_caps.push_back(cap->getCapacitance());
+    ExpectSameValues(
+        ground_caps.data(), all_corners.GroundCapacitances(corner), num_resistors,
+        label + " annotated ground capacitance"
+    );
+    ExpectSameValues(
+        coupling_caps.data(), all_corners.CouplingCapacitances(corner), num_capacitors,
+        label + " annotated coupling capacitance"
+    );
+    std::cout << label << " evaluated alone and annotated matches the pass over all corners" << std::endl;
+
+    for (size_t i = 0; i < num_capacitors && corner > 0; ++i) {
+      corners_differ |= !Near(all_corners.CouplingCapacitances(corner)[i], all_corners.CouplingCapacitances(0)[i]);
+    }
+  }
+  PhyDBExpects(corners_differ, "both corners have the same coupling capacitances");
+
+  std::cout << "Multi-corner RC test passes!" << std::endl;
+  return 0;
+}
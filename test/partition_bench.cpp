@@ -0,0 +1,235 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+
+#include "phydb/geometry.h"
+
+using namespace phydb;
+
+// the std::map-backed partition UniformPartition used to be, kept here as the baseline
+class MapPartition {
+ public:
+  explicit MapPartition(double partition_size) : partition_size_(partition_size) {}
+
+  void add(WireSegment *elt) {
+    Rect2D<double> elt_rect = elt->getRect();
+    int left_bound_idx = static_cast<int>(elt_rect.ll.x / partition_size_);
+    int right_bound_idx = static_cast<int>(elt_rect.ur.x / partition_size_);
+    int bottom_bound_idx = static_cast<int>(elt_rect.ll.y / partition_size_);
+    int top_bound_idx = static_cast<int>(elt_rect.ur.y / partition_size_);
+    for (int x = left_bound_idx; x <= right_bound_idx; x++) {
+      for (int y = bottom_bound_idx; y <= top_bound_idx; y++) {
+        partition_pair_to_segs_[{x, y}].push_back(elt);
+      }
+    }
+  }
+
+  std::vector<WireSegment *> getElementsByPartition(std::pair<int, int> partition) const {
+    if (partition_pair_to_segs_.find(partition) == partition_pair_to_segs_.end()) {
+      return std::vector<WireSegment *>();
+    }
+    return partition_pair_to_segs_.at(partition);
+  }
+
+ private:
+  std::map<std::pair<int, int>, std::vector<WireSegment *>> partition_pair_to_segs_;
+  double partition_size_;
+};
+
+// horizontal wires on a track grid, density controls how many tracks are occupied
+std::vector<std::unique_ptr<WireSegment>> MakeLayer(int num_segs, double die, double density, unsigned seed) {
+  std::mt19937 gen(seed);
+  double pitch = 150 / density;
+  std::uniform_real_distribution<double> pos(0, die);
+  std::uniform_real_distribution<double> len(300, 6000);
+  std::vector<std::unique_ptr<WireSegment>> segs;
+  for (int i = 0; i < num_segs; i++) {
+    double y = static_cast<int>(pos(gen) / pitch) * pitch;
+    double x = pos(gen);
+    Rect2D<double> rect(x, y, x + len(gen), y + 150);
+    segs.emplace_back(new WireSegment(rect, i % 1000, 0, i));
+  }
+  return segs;
+}
+
+template<typename Partition, typename Visit>
+double ProbeAll(Partition &partition, std::vector<std::unique_ptr<WireSegment>> &segs, Visit visit) {
+  auto start = std::chrono::steady_clock::now();
+  for (auto &seg : segs) {
+    std::pair<int, int> ll(static_cast<int>(seg->getRect().ll.x / BIN_WIDTH), static_cast<int>(seg->getRect().ll.y / BIN_WIDTH));
+    std::pair<int, int> ur(static_cast<int>(seg->getRect().ur.x / BIN_WIDTH), static_cast<int>(seg->getRect().ur.y / BIN_WIDTH));
+    for (int x = ll.first - NUM_BINS_NEIGHBORHOOD; x <= ur.first + NUM_BINS_NEIGHBORHOOD; x++) {
+      for (int y = ll.second - NUM_BINS_NEIGHBORHOOD; y <= ur.second + NUM_BINS_NEIGHBORHOOD; y++) {
+        for (WireSegment *elt : partition.getElementsByPartition(std::pair<int, int>(x, y))) {
+          visit(elt);
+        }
+      }
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void BenchLayer(std::string const &label, int num_segs, double die, double density) {
+  std::vector<std::unique_ptr<WireSegment>> segs = MakeLayer(num_segs, die, density, 7);
+
+  MapPartition map_partition(BIN_WIDTH);
+  UniformPartition<WireSegment> flat_partition(BIN_WIDTH);
+  auto start = std::chrono::steady_clock::now();
+  for (auto &seg : segs) map_partition.add(seg.get());
+  auto mid = std::chrono::steady_clock::now();
+  for (auto &seg : segs) flat_partition.add(seg.get());
+  flat_partition.build();
+  auto end = std::chrono::steady_clock::now();
+
+  unsigned long map_hits = 0, flat_hits = 0, map_sum = 0, flat_sum = 0;
+  double map_ms = ProbeAll(map_partition, segs, [&](WireSegment *s) { map_hits++; map_sum += s->getSegmentNumber(); });
+  double flat_ms = ProbeAll(flat_partition, segs, [&](WireSegment *s) { flat_hits++; flat_sum += s->getSegmentNumber(); });
+
+  std::cout << label << ": " << num_segs << " segments\n"
+            << "  map  build " << std::chrono::duration<double, std::milli>(mid - start).count() << " ms, query " << map_ms << " ms\n"
+            << "  flat build " << std::chrono::duration<double, std::milli>(end - mid).count() << " ms, query " << flat_ms << " ms\n"
+            << "  speedup " << map_ms / flat_ms << "x" << std::endl;
+  PhyDBExpects(map_hits == flat_hits && map_sum == flat_sum, "bin stores disagree on " + label);
+}
+
+// grid neighbourhood (deduped the way getOtherNetsNearbySegments does) against the R-tree's distance-bounded
+// query over the same distance the neighbourhood is guaranteed to cover
+void BenchIndex(std::string const &label, int num_segs, double die, double density) {
+  std::vector<std::unique_ptr<WireSegment>> segs = MakeLayer(num_segs, die, density, 7);
+  double distance = NUM_BINS_NEIGHBORHOOD * BIN_WIDTH;
+
+  UniformPartition<WireSegment> grid(BIN_WIDTH);
+  PackedRTree<WireSegment> rtree;
+  auto start = std::chrono::steady_clock::now();
+  for (auto &seg : segs) grid.add(seg.get());
+  grid.build();
+  auto mid = std::chrono::steady_clock::now();
+  for (auto &seg : segs) rtree.add(seg.get());
+  rtree.build();
+  auto end = std::chrono::steady_clock::now();
+
+  unsigned long grid_hits = 0, rtree_hits = 0;
+  std::vector<WireSegment *> grid_nbrs, rtree_nbrs;
+  double grid_ms = 0, rtree_ms = 0;
+  for (auto &seg : segs) {
+    auto t0 = std::chrono::steady_clock::now();
+    grid_nbrs.clear();
+    std::pair<int, int> ll = grid.getPartitionId(seg->getRect().ll);
+    std::pair<int, int> ur = grid.getPartitionId(seg->getRect().ur);
+    for (int x = ll.first - NUM_BINS_NEIGHBORHOOD; x <= ur.first + NUM_BINS_NEIGHBORHOOD; x++) {
+      for (int y = ll.second - NUM_BINS_NEIGHBORHOOD; y <= ur.second + NUM_BINS_NEIGHBORHOOD; y++) {
+        for (WireSegment *elt : grid.getElementsByPartition(std::pair<int, int>(x, y))) {
+          grid_nbrs.push_back(elt);
+        }
+      }
+    }
+    std::sort(grid_nbrs.begin(), grid_nbrs.end());
+    grid_nbrs.erase(std::unique(grid_nbrs.begin(), grid_nbrs.end()), grid_nbrs.end());
+    auto t1 = std::chrono::steady_clock::now();
+    rtree_nbrs.clear();
+    rtree.queryWithin(seg->getRect(), distance, rtree_nbrs);
+    auto t2 = std::chrono::steady_clock::now();
+    grid_ms += std::chrono::duration<double, std::milli>(t1 - t0).count();
+    rtree_ms += std::chrono::duration<double, std::milli>(t2 - t1).count();
+    grid_hits += grid_nbrs.size();
+    rtree_hits += rtree_nbrs.size();
+
+    for (WireSegment *nbr : rtree_nbrs) {
+      PhyDBExpects(std::binary_search(grid_nbrs.begin(), grid_nbrs.end(), nbr), "R-tree returned a segment outside the grid neighbourhood on " + label);
+    }
+  }
+
+  std::cout << label << ": " << num_segs << " segments, neighbours within " << distance << "\n"
+            << "  grid  build " << std::chrono::duration<double, std::milli>(mid - start).count() << " ms, query " << grid_ms << " ms, "
+            << static_cast<double>(grid_hits) / num_segs << " candidates per segment\n"
+            << "  rtree build " << std::chrono::duration<double, std::milli>(end - mid).count() << " ms, query " << rtree_ms << " ms, "
+            << static_cast<double>(rtree_hits) / num_segs << " candidates per segment" << std::endl;
+}
+
+// the overlap sweep _findOverlappingSegPairs used to run, every new rect checked against every rect the sweep
+// still crosses, kept here as the baseline
+std::vector<std::pair<unsigned long, unsigned long>> ScanActivePairs(std::vector<Rect2D<double>> const &rects) {
+  std::vector<unsigned long> idxs(rects.size());
+  for (unsigned long i = 0; i < idxs.size(); i++) idxs[i] = i;
+  std::sort(idxs.begin(), idxs.end(), [&rects](unsigned long a, unsigned long b) { return rects[a].ll.x < rects[b].ll.x; });
+  std::vector<std::pair<unsigned long, unsigned long>> pairs;
+  std::vector<unsigned long> active;
+  for (unsigned long idx : idxs) {
+    unsigned long num_active = 0;
+    for (unsigned long active_idx : active) {
+      if (rects[active_idx].ur.x < rects[idx].ll.x) continue;
+      active[num_active++] = active_idx;
+      if (rects[active_idx].ll.y <= rects[idx].ur.y && rects[idx].ll.y <= rects[active_idx].ur.y) {
+        pairs.emplace_back(std::min(idx, active_idx), std::max(idx, active_idx));
+      }
+    }
+    active.resize(num_active);
+    active.push_back(idx);
+  }
+  std::sort(pairs.begin(), pairs.end());
+  return pairs;
+}
+
+// long wires on neighbouring tracks sharing one x range, as a bus or power straps, every track split in a few
+// pieces that overlap end to end: the sweep crosses nearly every wire at once but few of them touch
+void BenchOverlaps(std::string const &label, int num_tracks, int pieces_per_track) {
+  std::vector<Rect2D<double>> rects;
+  double length = 400000.0 / pieces_per_track;
+  for (int track = 0; track < num_tracks; track++) {
+    double y = track * 300.0;
+    for (int piece = 0; piece < pieces_per_track; piece++) {
+      double x = piece * length + (track % 7) * 10;
+      rects.emplace_back(x, y, x + length + 100, y + 150);
+    }
+  }
+  std::vector<int> layer_ids(rects.size(), 0);
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::pair<unsigned long, unsigned long>> scan_pairs = ScanActivePairs(rects);
+  auto mid = std::chrono::steady_clock::now();
+  std::vector<std::pair<unsigned long, unsigned long>> sweep_pairs = findOverlappingRectPairs(rects, layer_ids);
+  auto end = std::chrono::steady_clock::now();
+
+  double scan_ms = std::chrono::duration<double, std::milli>(mid - start).count();
+  double sweep_ms = std::chrono::duration<double, std::milli>(end - mid).count();
+  std::cout << label << ": " << rects.size() << " segments, " << sweep_pairs.size() << " overlapping pairs\n"
+            << "  active list scan " << scan_ms << " ms\n"
+            << "  ordered sweep    " << sweep_ms << " ms\n"
+            << "  speedup " << scan_ms / sweep_ms << "x" << std::endl;
+  PhyDBExpects(scan_pairs == sweep_pairs, "overlap sweeps disagree on " + label);
+}
+
+int main() {
+  BenchLayer("dense layer", 200000, 400000, 0.9);
+  BenchLayer("sparse layer", 20000, 2000000, 0.05);
+  BenchIndex("dense layer", 200000, 400000, 0.9);
+  BenchIndex("sparse layer", 20000, 2000000, 0.05);
+  BenchOverlaps("co-linear bus", 5000, 4);
+  BenchOverlaps("co-linear bus", 10000, 4);
+  return 0;
+}
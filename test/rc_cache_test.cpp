@@ -0,0 +1,70 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include <cstdio>
+#include <iostream>
+#include <memory>
+
+#include "test_helpers.h"
+
+using namespace phydb;
+
+int main(int argc, char **argv) {
+  std::string lef_file_name, def_file_name;
+  GetDesignFiles(argc, argv, lef_file_name, def_file_name);
+
+  std::unique_ptr<PhyDB> extracted_db = LoadDesign(lef_file_name, def_file_name);
+  extracted_db->GenerateRCNetwork();
+  extracted_db->SaveRCCache("rc_cache_test.rc");
+  std::string expected_spef = SpefText(*extracted_db, "rc_cache_test.spef");
+
+  // a design loaded from the same files takes the network over without extracting it
+  std::unique_ptr<PhyDB> cached_db = LoadDesign(lef_file_name, def_file_name);
+  PhyDBExpects(cached_db->OpenRCCache("rc_cache_test.rc"), "RC cache of the same design is rejected");
+  PhyDBExpects(SpefText(*cached_db, "rc_cache_test.spef") == expected_spef, "SPEF from the RC cache differs");
+  std::cout << "RC cache loads the extracted network" << std::endl;
+
+  // and patches it as the extracted one is patched
+  std::vector<Net> &nets = extracted_db->GetDesignPtr()->GetNetsRef();
+  for (size_t i = 0; i < nets.size(); i += 3) {
+    extracted_db->RemoveNetGeometry(nets[i].GetName());
+    cached_db->RemoveNetGeometry(nets[i].GetName());
+  }
+  extracted_db->GenerateRCNetwork();
+  cached_db->GenerateRCNetwork();
+  PhyDBExpects(
+      SpefText(*cached_db, "rc_cache_test.spef") == SpefText(*extracted_db, "rc_cache_test.spef"),
+      "re-extraction after loading the RC cache differs"
+  );
+  std::cout << "RC cache re-extracts as the extracted network" << std::endl;
+
+  // other extraction settings do not reuse it
+  std::unique_ptr<PhyDB> rtree_db = LoadDesign(lef_file_name, def_file_name);
+  rtree_db->GetGeometryPtr()->setSpatialIndex(SpatialIndexType::RTREE);
+  PhyDBExpects(!rtree_db->OpenRCCache("rc_cache_test.rc"), "RC cache is reused with another spatial index");
+  ExtractionScope scope;
+  scope.nets.push_back(nets[0].GetName());
+  PhyDBExpects(!rtree_db->OpenRCCache("rc_cache_test.rc", scope), "RC cache is reused for another scope");
+  std::remove("rc_cache_test.rc");
+
+  std::cout << "RC cache test passes!" << std::endl;
+  return 0;
+}
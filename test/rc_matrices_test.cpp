@@ -0,0 +1,154 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <memory>
+
+#include "test_helpers.h"
+
+using namespace phydb;
+
+bool Near(double a, double b, double scale) {
+  return std::fabs(a - b) <= 1e-9 * scale;
+}
+
+std::map<std::pair<uint32_t, uint32_t>, double> Entries(CsrMatrixView const &m) {
+  PhyDBExpects(m.row_offsets[0] == 0, "a matrix does not start at offset 0");
+  std::map<std::pair<uint32_t, uint32_t>, double> entries;
+  for (uint32_t row = 0; row < m.num_rows; ++row) {
+    for (size_t k = m.row_offsets[row]; k < m.row_offsets[row + 1]; ++k) {
+      PhyDBExpects(m.columns[k] < m.num_rows, "column " << m.columns[k] << " is out of the matrix");
+      PhyDBExpects(k == m.row_offsets[row] || m.columns[k - 1] < m.columns[k], "columns of row " << row << " are not sorted");
+      entries[std::make_pair(row, m.columns[k])] = m.values[k];
+    }
+  }
+  return entries;
+}
+
+// G is a symmetric Laplacian of the net's resistors, C a diagonal holding all of the net's
+// capacitance, and nodes share a row exactly when a resistor without resistance joins them
+void CheckNet(
+    NetMatricesView const &net,
+    Geometry &geometry,
+    MultiCornerRC const &rc_values,
+    std::vector<double> const &net_caps
+) {
+  std::string const &net_name = geometry.getNetName(net.geometry_net_id);
+  PhyDBExpects(net.g.num_rows == net.c.num_rows, net_name << ": G and C differ in size");
+  auto g = Entries(net.g);
+  std::vector<double> row_sums(net.g.num_rows, 0);
+  double scale = 0;
+  for (auto const &entry : g) {
+    auto mirror = g.find(std::make_pair(entry.first.second, entry.first.first));
+    PhyDBExpects(mirror != g.end() && mirror->second == entry.second, net_name << ": G is not symmetric");
+    row_sums[entry.first.first] += entry.second;
+    scale = std::max(scale, std::fabs(entry.second));
+  }
+  for (double row_sum : row_sums) {
+    PhyDBExpects(Near(row_sum, 0, scale), net_name << ": a row of G sums to " << row_sum);
+  }
+
+  double total_cap = 0;
+  for (auto const &entry : Entries(net.c)) {
+    PhyDBExpects(entry.first.first == entry.first.second, net_name << ": C is not diagonal");
+    total_cap += entry.second;
+  }
+  PhyDBExpects(
+      Near(total_cap, net_caps[net.geometry_net_id], net_caps[net.geometry_net_id]),
+      net_name << ": C holds " << total_cap << " instead of " << net_caps[net.geometry_net_id]
+  );
+
+  auto const &resistors = geometry.getResistorNetwork();
+  for (size_t i = 0; i < resistors.size(); ++i) {
+    if (resistors[i]->getNetId() != net.geometry_net_id) continue;
+    uint32_t row1 = net.node_rows[resistors[i]->getNodeId1()];
+    uint32_t row2 = net.node_rows[resistors[i]->getNodeId2()];
+    PhyDBExpects(row1 != RCMatrices::kNoRow && row2 != RCMatrices::kNoRow, net_name << ": a resistor end has no row");
+    PhyDBExpects(
+        (rc_values.Resistances(0)[i] == 0) == (row1 == row2),
+        net_name << ": a resistor of " << rc_values.Resistances(0)[i] << " ohm joins rows " << row1 << " and " << row2
+    );
+  }
+  std::vector<PinNode> const &pin_nodes = geometry.getPinNodes(net.geometry_net_id);
+  PhyDBExpects(net.num_pins == pin_nodes.size(), net_name << ": pin rows do not match the pin nodes");
+  for (size_t i = 0; i < pin_nodes.size(); ++i) {
+    PhyDBExpects(net.pin_rows[i] == net.node_rows[pin_nodes[i].node_id], net_name << ": pin " << i << " is on another row");
+  }
+}
+
+bool SameMatrix(CsrMatrixView const &a, CsrMatrixView const &b) {
+  return a.num_rows == b.num_rows && Entries(a) == Entries(b);
+}
+
+int main(int argc, char **argv) {
+  std::string lef_file_name, def_file_name, tech_config_file_name;
+  GetDesignFiles(argc, argv, lef_file_name, def_file_name, &tech_config_file_name);
+
+  std::unique_ptr<PhyDB> phy_db = LoadDesign(lef_file_name, def_file_name);
+  phy_db->ReadTechConfigFile(tech_config_file_name);
+  phy_db->GenerateRCNetwork();
+  Geometry &geometry = *phy_db->GetGeometryPtr();
+  MultiCornerRC rc_values;
+  phy_db->EvaluateRCCorners(rc_values, 0);
+
+  // the capacitance of a net: its wires' and every coupling it takes part in
+  std::vector<double> net_caps(geometry.getNumNets(), 0);
+  auto const &resistors = geometry.getResistorNetwork();
+  for (size_t i = 0; i < resistors.size(); ++i) {
+    net_caps[resistors[i]->getNetId()] += rc_values.GroundCapacitances(0)[i];
+  }
+  auto const &capacitors = geometry.getCapacitorNetwork();
+  for (size_t i = 0; i < capacitors.size(); ++i) {
+    net_caps[capacitors[i]->getNetId1()] += rc_values.CouplingCapacitances(0)[i];
+    net_caps[capacitors[i]->getNetId2()] += rc_values.CouplingCapacitances(0)[i];
+  }
+
+  RCMatrices matrices;
+  phy_db->AssembleRCMatrices(matrices);
+  std::vector<Net> &nets = phy_db->GetDesignPtr()->GetNetsRef();
+  PhyDBExpects(matrices.NumNets() == nets.size(), "matrices are assembled for " << matrices.NumNets() << " nets");
+  size_t num_rows = 0;
+  for (size_t i = 0; i < matrices.NumNets(); ++i) {
+    NetMatricesView net = matrices.Net(i);
+    PhyDBExpects(net.geometry_net_id == nets[i].GetGeometryId(), "matrices of net " << i << " belong to another net");
+    CheckNet(net, geometry, rc_values, net_caps);
+    num_rows += net.g.num_rows;
+  }
+  PhyDBExpects(num_rows > 0, "the matrices have no row");
+  std::cout << "matrices of " << matrices.NumNets() << " nets have " << num_rows << " rows" << std::endl;
+
+  // per-net storage and threads do not change them
+  RCMatrices per_net_matrices;
+  phy_db->AssembleRCMatrices(per_net_matrices, 0, false, 4);
+  for (size_t i = 0; i < matrices.NumNets(); ++i) {
+    NetMatricesView net = matrices.Net(i), per_net = per_net_matrices.Net(i);
+    PhyDBExpects(
+        SameMatrix(net.g, per_net.g) && SameMatrix(net.c, per_net.c),
+        "matrices of net " << nets[i].GetName() << " differ in per-net storage on 4 threads"
+    );
+  }
+  std::cout << "per-net storage on 4 threads gives the same matrices" << std::endl;
+
+  std::cout << "RC matrices test passes!" << std::endl;
+  return 0;
+}
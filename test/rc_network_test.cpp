@@ -0,0 +1,178 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <tuple>
+#include <vector>
+
+#include "test_helpers.h"
+
+using namespace phydb;
+
+// node ids are local to a net and below its node count, and the nodes capacitors and pins
+// hang on are ends of resistors
+void CheckNodeIds(PhyDB &phy_db) {
+  Geometry &geometry = *phy_db.GetGeometryPtr();
+  std::vector<std::vector<bool>> used(geometry.getNumNets());
+  for (unsigned net_id = 0; net_id < geometry.getNumNets(); ++net_id) {
+    used[net_id].assign(geometry.getNumNodes(net_id), false);
+  }
+  auto use_node = [&](unsigned net_id, NodeId node_id, char const *element) {
+    PhyDBExpects(
+        net_id < used.size() && node_id < used[net_id].size(),
+        element << " node " << node_id << " is out of the range of net " << net_id
+    );
+    used[net_id][node_id] = true;
+  };
+  for (auto const &res : geometry.getResistorNetwork()) {
+    PhyDBExpects(res->getNodeId1() != res->getNodeId2(), "resistor connects node " << res->getNodeId1() << " to itself");
+    use_node(res->getNetId(), res->getNodeId1(), "resistor");
+    use_node(res->getNetId(), res->getNodeId2(), "resistor");
+  }
+  for (auto const &cap : geometry.getCapacitorNetwork()) {
+    PhyDBExpects(
+        cap->getNetId1() < used.size() && cap->getNodeId1() < used[cap->getNetId1()].size()
+            && cap->getNetId2() < used.size() && cap->getNodeId2() < used[cap->getNetId2()].size(),
+        "capacitor node is out of the range of its net"
+    );
+    PhyDBExpects(
+        used[cap->getNetId1()][cap->getNodeId1()] && used[cap->getNetId2()][cap->getNodeId2()],
+        "capacitor hangs on a node no resistor ends at"
+    );
+  }
+  size_t num_nodes = 0;
+  for (unsigned net_id = 0; net_id < geometry.getNumNets(); ++net_id) {
+    for (PinNode const &pin_node : geometry.getPinNodes(net_id)) {
+      PhyDBExpects(
+          pin_node.node_id < used[net_id].size() && used[net_id][pin_node.node_id],
+          "pin node " << pin_node.node_id << " of net " << geometry.getNetName(net_id) << " is on no resistor"
+      );
+    }
+    num_nodes += used[net_id].size();
+  }
+  PhyDBExpects(num_nodes > 0, "extraction builds no node");
+  std::cout << num_nodes << " node ids are in range" << std::endl;
+}
+
+// Tech layer ids and Net geometry ids are the ids Geometry interns the names as, and every
+// wire segment carries the ids of the net and layer it was added under
+void CheckInternedIds(PhyDB &phy_db) {
+  Geometry &geometry = *phy_db.GetGeometryPtr();
+  std::vector<Layer> &layers = phy_db.GetTechPtr()->GetLayersRef();
+  for (size_t i = 0; i < layers.size(); ++i) {
+    PhyDBExpects(
+        geometry.getLayerId(layers[i].GetName()) == (int) i && geometry.getLayerName(i) == layers[i].GetName(),
+        "layer " << layers[i].GetName() << " is interned as " << geometry.getLayerId(layers[i].GetName())
+                 << " instead of its Tech id " << i
+    );
+  }
+  size_t num_segments = 0;
+  for (Net &net : phy_db.GetDesignPtr()->GetNetsRef()) {
+    unsigned net_id = net.GetGeometryId();
+    PhyDBExpects(
+        geometry.getNetId(net.GetName()) == net_id && geometry.getNetName(net_id) == net.GetName(),
+        "net " << net.GetName() << " is interned as " << geometry.getNetId(net.GetName())
+               << " instead of its geometry id " << net_id
+    );
+    for (auto const &seg : geometry.getNetSegments(net_id)) {
+      PhyDBExpects(
+          seg->getNetId() == net_id && seg->getNetName() == net.GetName()
+              && seg->getLayerName() == geometry.getLayerName(seg->getLayerId()),
+          "a wire segment of net " << net.GetName() << " carries the ids of net " << seg->getNetName()
+                                   << " and layer " << seg->getLayerName()
+      );
+      ++num_segments;
+    }
+  }
+  PhyDBExpects(num_segments > 0, "the design has no wire segment");
+  std::cout << num_segments << " wire segments carry the ids of their net and layer" << std::endl;
+}
+
+// each pair of neighbouring wires couples once, whichever of the two is visited first
+void CheckCouplingPairs(PhyDB &phy_db) {
+  Geometry &geometry = *phy_db.GetGeometryPtr();
+  std::set<std::tuple<unsigned, NodeId, unsigned, NodeId, int>> pairs;
+  for (auto const &cap : geometry.getCapacitorNetwork()) {
+    auto end1 = std::make_pair(cap->getNetId1(), cap->getNodeId1());
+    auto end2 = std::make_pair(cap->getNetId2(), cap->getNodeId2());
+    PhyDBExpects(end1.first != end2.first, "net " << geometry.getNetName(end1.first) << " couples to itself");
+    if (end2 < end1) std::swap(end1, end2);
+    PhyDBExpects(
+        pairs.emplace(end1.first, end1.second, end2.first, end2.second, cap->getLayerId()).second,
+        "nodes " << end1.second << " of " << geometry.getNetName(end1.first) << " and " << end2.second << " of "
+                 << geometry.getNetName(end2.first) << " couple twice on " << geometry.getLayerName(cap->getLayerId())
+    );
+  }
+  PhyDBExpects(!pairs.empty(), "extraction builds no coupling");
+  std::cout << pairs.size() << " couplings join distinct node pairs" << std::endl;
+}
+
+// a segment's resistors are owned by it and found by their end points, in either order; segments
+// split into many resistors look them up through an index, the others by a scan
+void CheckSegmentResistors(PhyDB &phy_db) {
+  Geometry &geometry = *phy_db.GetGeometryPtr();
+  auto ends = [](Resistor *res) {
+    std::pair<double, double> p1(res->getP1().x, res->getP1().y), p2(res->getP2().x, res->getP2().y);
+    return p1 < p2 ? std::make_pair(p1, p2) : std::make_pair(p2, p1);
+  };
+  size_t num_resistors = 0, max_resistors = 0;
+  for (unsigned net_id = 0; net_id < geometry.getNumNets(); ++net_id) {
+    for (auto const &seg : geometry.getNetSegments(net_id)) {
+      // several resistors can share their end points, e.g. zero-length ones, any of them may be found
+      std::map<std::pair<std::pair<double, double>, std::pair<double, double>>, int> num_sharing;
+      for (Resistor *res : seg->getResistors()) ++num_sharing[ends(res)];
+      for (Resistor *res : seg->getResistors()) {
+        PhyDBExpects(res->getOwnerSegment() == seg.get(), "a resistor of a segment is owned by another one");
+        for (Resistor *found : {seg->getResistorByPoints(res->getP1(), res->getP2()),
+                                seg->getResistorByPoints(res->getP2(), res->getP1())}) {
+          PhyDBExpects(
+              found == res || (found != nullptr && num_sharing[ends(res)] > 1 && ends(found) == ends(res)),
+              "a resistor of net " << geometry.getNetName(net_id) << " is not found by its end points"
+          );
+        }
+      }
+      num_resistors += seg->getResistors().size();
+      max_resistors = std::max(max_resistors, seg->getResistors().size());
+    }
+  }
+  PhyDBExpects(num_resistors == geometry.getResistorNetwork().size(), "some resistors belong to no segment");
+  std::cout << num_resistors << " resistors are found by their end points, up to " << max_resistors
+            << " on one segment" << std::endl;
+}
+
+int main(int argc, char **argv) {
+  std::string lef_file_name, def_file_name;
+  GetDesignFiles(argc, argv, lef_file_name, def_file_name);
+
+  std::unique_ptr<PhyDB> phy_db = LoadDesign(lef_file_name, def_file_name);
+  CheckInternedIds(*phy_db);
+  phy_db->GenerateRCNetwork();
+  CheckNodeIds(*phy_db);
+  CheckCouplingPairs(*phy_db);
+  CheckSegmentResistors(*phy_db);
+
+  std::cout << "RC network test passes!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,130 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include <cmath>
+#include <iostream>
+
+#include "phydb/common/logging.h"
+#include "phydb/rcreduction.h"
+
+using namespace phydb;
+
+bool Near(double a, double b) {
+  return std::fabs(a - b) <= 1e-9 * std::max(std::fabs(a), std::fabs(b));
+}
+
+// net 1 of a two-net export: pins 0, 4 and 5 on the chain 0-1-2-3-4 with a branch 2-5, the
+// resistor 2-3 is almost a short; node 1 couples to net 2 strongly, node 3 weakly
+NetRC BuildNet() {
+  NetRC net;
+  net.Reset(6);
+  net.resistors = {{0, 1, 10}, {1, 2, 20}, {2, 3, 0.001}, {3, 4, 30}, {2, 5, 40}};
+  net.ground_caps = {1, 2, 3, 4, 5, 6};
+  net.couplings = {{1, 2, 0, 0.5}, {3, 2, 1, 0.01}};
+  return net;
+}
+
+double TotalResistance(NetRC const &net) {
+  double total = 0;
+  for (RCBranch const &res : net.resistors) total += res.resistance;
+  return total;
+}
+
+NetRC Reduce(RCReductionOptions const &options, std::string const &label) {
+  NetRC net = BuildNet();
+  std::vector<NodeId> pin_nodes = {0, 4, 5};
+  std::vector<double> net_totals = {0, net.TotalCapacitance(), 100};
+  RCReductionStats stats;
+  ReduceNet(net, 1, pin_nodes, net_totals, options, stats);
+  for (NodeId pin_node : pin_nodes) {
+    PhyDBExpects(net.node_map[pin_node] == pin_node, label << ": pin node " << pin_node << " is merged away");
+  }
+  for (RCBranch const &res : net.resistors) {
+    PhyDBExpects(
+        net.node_map[res.node1] == res.node1 && net.node_map[res.node2] == res.node2,
+        label << ": a resistor ends at a merged node"
+    );
+  }
+  for (RCCoupling const &coupling : net.couplings) {
+    PhyDBExpects(net.node_map[coupling.node] == coupling.node, label << ": a coupling hangs on a merged node");
+  }
+  PhyDBExpects(
+      stats.resistors_before == 5 && stats.resistors_after == net.resistors.size()
+          && stats.couplings_after == net.couplings.size(),
+      label << ": reduction statistics do not count the net"
+  );
+  return net;
+}
+
+int main() {
+  double total_cap = BuildNet().TotalCapacitance();
+  PhyDBExpects(Near(total_cap, 21.51), "the hand-built net has " << total_cap << " of capacitance");
+
+  // the default options reduce nothing
+  NetRC net = Reduce(RCReductionOptions(), "no reduction");
+  PhyDBExpects(net.resistors.size() == 5 && net.couplings.size() == 2, "the default options reduce the net");
+
+  // nodes 1 and 3 have two resistors each, the series resistance and the capacitance stay
+  RCReductionOptions series;
+  series.merge_series = true;
+  net = Reduce(series, "series merging");
+  PhyDBExpects(net.resistors.size() == 3, "series merging leaves " << net.resistors.size() << " resistors");
+  PhyDBExpects(Near(TotalResistance(net), 100.001), "series merging changes the resistance");
+  PhyDBExpects(Near(net.TotalCapacitance(), total_cap), "series merging changes the capacitance");
+  PhyDBExpects(
+      Near(net.ground_caps[0], 1 + 2 * 2.0 / 3) && Near(net.ground_caps[2], 3 + 2 * 1.0 / 3 + 4 * 30 / 30.001),
+      "series merging splits the removed nodes' capacitance unevenly"
+  );
+  std::cout << "series resistors are merged" << std::endl;
+
+  // the 0.001 ohm resistor is shorted, node 3 joins node 2
+  RCReductionOptions shorts;
+  shorts.min_resistance = 0.01;
+  net = Reduce(shorts, "shorting");
+  PhyDBExpects(net.resistors.size() == 4 && Near(TotalResistance(net), 100), "shorting leaves the wrong resistors");
+  PhyDBExpects(net.node_map[3] == 2 && Near(net.ground_caps[2], 7), "shorting does not move node 3 into node 2");
+  PhyDBExpects(Near(net.TotalCapacitance(), total_cap), "shorting changes the capacitance");
+  std::cout << "small resistors are shorted" << std::endl;
+
+  // the weak coupling goes to ground, the strong one stays
+  RCReductionOptions ratio;
+  ratio.coupling_ratio = 0.01;
+  net = Reduce(ratio, "grounding couplings");
+  PhyDBExpects(
+      net.couplings.size() == 1 && net.couplings[0].node == 1 && Near(net.ground_caps[3], 4.01),
+      "grounding couplings keeps the wrong ones"
+  );
+  PhyDBExpects(Near(net.TotalCapacitance(), total_cap), "grounding couplings changes the capacitance");
+  std::cout << "weak couplings are grounded" << std::endl;
+
+  // capacitors below 1.5 are dropped, both couplings and the ground capacitance of node 0
+  RCReductionOptions small_caps;
+  small_caps.min_capacitance = 1.5;
+  net = Reduce(small_caps, "dropping capacitors");
+  PhyDBExpects(
+      net.couplings.empty() && net.ground_caps[0] == 0 && Near(net.TotalCapacitance(), 20),
+      "dropping capacitors keeps the wrong ones"
+  );
+  std::cout << "small capacitors are dropped" << std::endl;
+
+  std::cout << "RC reduction test passes!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,141 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include "test_helpers.h"
+
+using namespace phydb;
+
+struct SpefNet {
+  double total = 0;
+  double sum_of_caps = 0;
+  size_t num_res = 0;
+  bool ended = false;
+};
+
+// the *D_NET sections of a SPEF, with the units it declares
+std::vector<SpefNet> ParseSpef(std::string const &text, std::string &c_unit) {
+  std::vector<SpefNet> nets;
+  std::istringstream in(text);
+  std::string line, section;
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    std::string first;
+    fields >> first;
+    if (first == "*C_UNIT") {
+      double scale;
+      fields >> scale >> c_unit;
+    } else if (first == "*D_NET") {
+      std::string name;
+      nets.emplace_back();
+      fields >> name >> nets.back().total;
+      section = first;
+    } else if (first == "*CONN" || first == "*CAP" || first == "*RES") {
+      section = first;
+    } else if (first == "*END") {
+      PhyDBExpects(!nets.empty(), "*END outside of a *D_NET");
+      nets.back().ended = true;
+      section.clear();
+    } else if (!first.empty() && section == "*CAP") {
+      // ground capacitances name one node, couplings two
+      std::vector<std::string> rest;
+      std::string field;
+      while (fields >> field) rest.push_back(field);
+      PhyDBExpects(rest.size() == 2 || rest.size() == 3, "malformed *CAP line " << line);
+      nets.back().sum_of_caps += std::stod(rest.back());
+    } else if (!first.empty() && section == "*RES") {
+      ++nets.back().num_res;
+    }
+  }
+  return nets;
+}
+
+bool Near(double a, double b) {
+  return std::fabs(a - b) <= 1e-4 * std::max(std::fabs(a), std::fabs(b)) + 1e-12;
+}
+
+int main(int argc, char **argv) {
+  std::string lef_file_name, def_file_name;
+  GetDesignFiles(argc, argv, lef_file_name, def_file_name);
+
+  std::unique_ptr<PhyDB> phy_db = LoadDesign(lef_file_name, def_file_name);
+  Tech &tech = *phy_db->GetTechPtr();
+  tech.FindAllMetalLayers();
+  tech.SetUnitResAndCap(0.125, 0.00004, 0.00003);
+  phy_db->GenerateRCNetwork();
+  std::string text = SpefText(*phy_db, "spef_writer_test.spef");
+
+  std::string c_unit;
+  std::vector<SpefNet> spef_nets = ParseSpef(text, c_unit);
+  PhyDBExpects(c_unit == "PF", "capacitances in LEF units are written under *C_UNIT 1 " << c_unit);
+
+  // the nets with wires, in design order, each with the ground capacitance of its wires
+  Geometry &geometry = *phy_db->GetGeometryPtr();
+  double distance_microns = tech.GetDatabaseMicron();
+  std::vector<double> net_caps(geometry.getNumNets(), 0);
+  std::vector<bool> has_wires(geometry.getNumNets(), false);
+  for (auto const &res : geometry.getResistorNetwork()) {
+    has_wires[res->getNetId()] = true;
+    Layer *layer = tech.GetLayerPtr(geometry.getLayerName(res->getLayerId()));
+    if (res->isVertical() || layer == nullptr || !layer->HasUnitCap(0)) continue;
+    double width = res->getWidth() / distance_microns;
+    double length = res->getLength() / distance_microns;
+    net_caps[res->getNetId()] += layer->GetAreaCapacitance(width, length, 0)
+        + layer->GetFringeCapacitance(width, length, 0);
+  }
+  std::vector<double> expected_totals;
+  double design_cap = 0;
+  for (Net &net : phy_db->GetDesignPtr()->GetNetsRef()) {
+    if (!has_wires[net.GetGeometryId()]) continue;
+    expected_totals.push_back(net_caps[net.GetGeometryId()]);
+    design_cap += net_caps[net.GetGeometryId()];
+  }
+  PhyDBExpects(design_cap > 0, "the wires of the design have no capacitance");
+
+  PhyDBExpects(
+      spef_nets.size() == expected_totals.size(),
+      spef_nets.size() << " *D_NET sections for " << expected_totals.size() << " nets with wires"
+  );
+  for (size_t i = 0; i < spef_nets.size(); ++i) {
+    PhyDBExpects(spef_nets[i].ended && spef_nets[i].num_res > 0, "*D_NET *" << i + 1 << " is incomplete");
+    PhyDBExpects(
+        Near(spef_nets[i].total, spef_nets[i].sum_of_caps),
+        "*D_NET *" << i + 1 << " total " << spef_nets[i].total << " is not the sum of its caps "
+                   << spef_nets[i].sum_of_caps
+    );
+    PhyDBExpects(
+        Near(spef_nets[i].total, expected_totals[i]),
+        "*D_NET *" << i + 1 << " total " << spef_nets[i].total << " instead of " << expected_totals[i]
+    );
+  }
+  std::cout << spef_nets.size() << " nets are written with the capacitance of their wires" << std::endl;
+
+  PhyDBExpects(SpefText(*phy_db, "spef_writer_test.spef", 4) == text, "SPEF written on 4 threads differs");
+  std::cout << "SPEF written on 4 threads is the same" << std::endl;
+
+  std::cout << "SPEF writer test passes!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,159 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+#ifndef PHYDB_TEST_TEST_HELPERS_H_
+#define PHYDB_TEST_TEST_HELPERS_H_
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "phydb/common/logging.h"
+#include "phydb/phydb.h"
+
+namespace phydb {
+
+// the LEF file and the DEF file every design test is run with, and the technology
+// configuration file after them for the tests that need one
+inline void GetDesignFiles(
+    int argc,
+    char **argv,
+    std::string &lef_file_name,
+    std::string &def_file_name,
+    std::string *tech_config_file_name = nullptr
+) {
+  if (tech_config_file_name == nullptr) {
+    PhyDBExpects(argc == 3, "Please provide a LEF file and a DEF file");
+  } else {
+    PhyDBExpects(argc == 4, "Please provide a LEF file, a DEF file and a technology configuration file");
+    *tech_config_file_name = argv[3];
+  }
+  lef_file_name = argv[1];
+  def_file_name = argv[2];
+}
+
+// configure runs between the LEF and the DEF, for the settings that change how the DEF is read
+inline std::unique_ptr<PhyDB> LoadDesign(
+    std::string const &lef_file_name,
+    std::string const &def_file_name,
+    std::function<void(PhyDB &)> const &configure = nullptr
+) {
+  std::unique_ptr<PhyDB> phy_db(new PhyDB);
+  phy_db->ReadLef(lef_file_name);
+  if (configure) configure(*phy_db);
+  phy_db->ReadDef(def_file_name);
+  return phy_db;
+}
+
+// the SPEF of the network without its *DATE line, the file is removed after reading it
+inline std::string SpefText(
+    PhyDB &phy_db,
+    std::string const &spef_file_name,
+    int num_threads = 1,
+    RCReductionOptions const &reduction = RCReductionOptions()
+) {
+  phy_db.WriteSpef(spef_file_name, 0, num_threads, reduction);
+  std::ifstream in(spef_file_name);
+  PhyDBExpects(in.is_open(), "Cannot read " + spef_file_name);
+  std::string text, line;
+  while (std::getline(in, line)) {
+    if (line.rfind("*DATE", 0) != 0) text += line + "\n";
+  }
+  std::remove(spef_file_name.c_str());
+  return text;
+}
+
+// node ids depend on the order nodes are made in, so every element is written with
+// the locations of its nodes instead, one line each, sorted
+inline std::vector<std::string> CanonicalNetwork(PhyDB &phy_db) {
+  Geometry &geometry = *phy_db.GetGeometryPtr();
+  std::map<std::pair<unsigned, NodeId>, Point2D<double>> node_points;
+  auto add_node_point = [&](unsigned net_id, NodeId node_id, Point2D<double> const &pt) {
+    auto it = node_points.emplace(std::make_pair(net_id, node_id), pt).first;
+    if (pt.x < it->second.x || (pt.x == it->second.x && pt.y < it->second.y)) it->second = pt;
+  };
+  for (auto const &res : geometry.getResistorNetwork()) {
+    add_node_point(res->getNetId(), res->getNodeId1(), res->getP1());
+    add_node_point(res->getNetId(), res->getNodeId2(), res->getP2());
+  }
+  auto node_point = [&](unsigned net_id, NodeId node_id) {
+    std::ostringstream s;
+    auto it = node_points.find(std::make_pair(net_id, node_id));
+    if (it == node_points.end()) {
+      s << "(none)";
+    } else {
+      s << "(" << it->second.x << "," << it->second.y << ")";
+    }
+    return s.str();
+  };
+
+  std::vector<std::string> lines;
+  for (auto const &res : geometry.getResistorNetwork()) {
+    std::ostringstream s;
+    Point2D<double> p1 = res->getP1(), p2 = res->getP2();
+    if (p2.x < p1.x || (p2.x == p1.x && p2.y < p1.y)) std::swap(p1, p2);
+    s << "R " << geometry.getNetName(res->getNetId()) << " " << geometry.getLayerName(res->getLayerId())
+      << " (" << p1.x << "," << p1.y << ") (" << p2.x << "," << p2.y << ") " << res->getLength() << " "
+      << res->getWidth() << " " << res->getArea();
+    lines.push_back(s.str());
+  }
+  for (auto const &cap : geometry.getCapacitorNetwork()) {
+    std::ostringstream s;
+    s << "C " << geometry.getNetName(cap->getNetId1()) << " " << node_point(cap->getNetId1(), cap->getNodeId1())
+      << " " << geometry.getNetName(cap->getNetId2()) << " " << node_point(cap->getNetId2(), cap->getNodeId2())
+      << " " << geometry.getLayerName(cap->getLayerId()) << " " << cap->getOverlapLength() << " "
+      << cap->getDistance() << " " << cap->getWidth();
+    lines.push_back(s.str());
+  }
+  for (unsigned net_id = 0; net_id < geometry.getNumNets(); ++net_id) {
+    for (PinNode const &pin_node : geometry.getPinNodes(net_id)) {
+      std::ostringstream s;
+      s << "P " << geometry.getNetName(net_id) << " " << pin_node.instance_id << " " << pin_node.pin_id << " "
+        << node_point(net_id, pin_node.node_id);
+      lines.push_back(s.str());
+    }
+  }
+  std::sort(lines.begin(), lines.end());
+  return lines;
+}
+
+inline void CompareNetworks(PhyDB &expected_db, PhyDB &db, std::string const &label) {
+  std::vector<std::string> expected_lines = CanonicalNetwork(expected_db);
+  std::vector<std::string> lines = CanonicalNetwork(db);
+  auto mismatch = std::mismatch(lines.begin(), lines.end(), expected_lines.begin(), expected_lines.end());
+  PhyDBExpects(
+      mismatch.first == lines.end() && mismatch.second == expected_lines.end(),
+      label << ": network differs from the reference extraction, "
+            << (mismatch.first == lines.end() ? std::string("(end)") : *mismatch.first) << " instead of "
+            << (mismatch.second == expected_lines.end() ? std::string("(end)") : *mismatch.second)
+  );
+  std::cout << label << " matches the reference extraction: " << lines.size() << " elements" << std::endl;
+}
+
+}
+
+#endif //PHYDB_TEST_TEST_HELPERS_H_
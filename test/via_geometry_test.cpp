@@ -0,0 +1,148 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Benjamin Goldstein
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ******************************************************************************/
+
+#include <iostream>
+#include <vector>
+
+#include "phydb/common/logging.h"
+#include "phydb/phydb.h"
+
+using namespace phydb;
+
+bool SameRect(Rect2D<double> const &a, Rect2D<double> const &b) {
+  return a.ll.x == b.ll.x && a.ll.y == b.ll.y && a.ur.x == b.ur.x && a.ur.y == b.ur.y;
+}
+
+// the segments of a via placed at offset are its shapes moved there, each one stacked on the previous
+void CheckViaInstance(
+    Geometry &geometry,
+    std::string const &net_name,
+    size_t first_segment,
+    std::vector<std::pair<std::string, Rect2D<double>>> const &shapes,
+    Point2D<double> offset
+) {
+  auto const &segments = geometry.getNetSegments(geometry.getNetId(net_name));
+  PhyDBExpects(segments.size() >= first_segment + shapes.size(), "net " << net_name << " misses via segments");
+  for (size_t i = 0; i < shapes.size(); ++i) {
+    WireSegment *seg = segments[first_segment + i].get();
+    Rect2D<double> const &rect = shapes[i].second;
+    Rect2D<double> expected(rect.ll.x + offset.x, rect.ll.y + offset.y, rect.ur.x + offset.x, rect.ur.y + offset.y);
+    PhyDBExpects(
+        seg->getLayerName() == shapes[i].first && SameRect(seg->getRect(), expected),
+        "shape " << i << " of a via of net " << net_name << " is not placed at (" << offset.x << ", " << offset.y << ")"
+    );
+    bool stacked = (i == 0) ? seg->getVerticalConnections().empty()
+                            : seg->getVerticalConnections().size() == 1
+                                  && seg->getVerticalConnections()[0] == segments[first_segment + i - 1].get();
+    PhyDBExpects(stacked, "shape " << i << " of a via of net " << net_name << " is not stacked on the previous one");
+  }
+}
+
+int main() {
+  PhyDB phy_db;
+  phy_db.SetDatabaseMicron(1000);
+  phy_db.SetDieArea(0, 0, 100000, 100000);
+  phy_db.AddLayer("met1", LayerType::ROUTING)->SetWidth(0.1);
+  phy_db.AddLayer("via1", LayerType::CUT);
+  phy_db.AddLayer("met2", LayerType::ROUTING)->SetWidth(0.1);
+  Geometry &geometry = *phy_db.GetGeometryPtr();
+
+  // a LEF via, in microns, is converted to DBU once and moved to every instance
+  LefVia *lef_via = phy_db.AddLefVia("M1M2_PR");
+  lef_via->SetLayerRect(
+      "met1", {Rect2D<double>(-0.1, -0.05, 0.1, 0.05)},
+      "via1", {Rect2D<double>(-0.05, -0.05, 0.05, 0.05)},
+      "met2", {Rect2D<double>(-0.05, -0.1, 0.05, 0.1)}
+  );
+  std::vector<std::pair<std::string, Rect2D<double>>> lef_shapes = {
+      {"met1", Rect2D<double>(-100, -50, 100, 50)},
+      {"via1", Rect2D<double>(-50, -50, 50, 50)},
+      {"met2", Rect2D<double>(-50, -100, 50, 100)}
+  };
+  phy_db.AddNet("lef");
+  int segment_id = 0;
+  phy_db.AddLefViaGeometry(lef_via, segment_id, "lef", Point2D<double>(1000, 2000));
+  phy_db.AddLefViaGeometry(lef_via, segment_id, "lef", Point2D<double>(-3000, 500));
+  CheckViaInstance(geometry, "lef", 0, lef_shapes, Point2D<double>(1000, 2000));
+  CheckViaInstance(geometry, "lef", 3, lef_shapes, Point2D<double>(-3000, 500));
+  PhyDBExpects(segment_id == 6, "two instances of a three-shape via number " << segment_id << " segments");
+
+  // new shapes replace the converted ones
+  lef_via->SetLayerRect(
+      "met1", {Rect2D<double>(-0.2, -0.05, 0.2, 0.05)},
+      "via1", {Rect2D<double>(-0.05, -0.05, 0.05, 0.05)},
+      "met2", {Rect2D<double>(-0.05, -0.2, 0.05, 0.2)}
+  );
+  phy_db.AddLefViaGeometry(lef_via, segment_id, "lef", Point2D<double>(0, 0));
+  CheckViaInstance(
+      geometry, "lef", 6, {
+          {"met1", Rect2D<double>(-200, -50, 200, 50)},
+          {"via1", Rect2D<double>(-50, -50, 50, 50)},
+          {"met2", Rect2D<double>(-50, -200, 50, 200)}
+      }, Point2D<double>(0, 0)
+  );
+  std::cout << "LEF via instances are its shapes moved to their offsets" << std::endl;
+
+  // a DEF via given by its rectangles, already in DBU
+  DefVia *rect_via = phy_db.AddDefVia("rect_via");
+  std::vector<std::pair<std::string, Rect2D<double>>> rect_shapes = {
+      {"met1", Rect2D<double>(-150, -70, 150, 70)},
+      {"via1", Rect2D<double>(-85, -85, 85, 85)},
+      {"met2", Rect2D<double>(-70, -150, 70, 150)}
+  };
+  for (auto const &shape : rect_shapes) {
+    Rect2DLayer<int> rect_layer;
+    rect_layer.layer = shape.first;
+    rect_layer.ll = Point2D<int>(static_cast<int>(shape.second.ll.x), static_cast<int>(shape.second.ll.y));
+    rect_layer.ur = Point2D<int>(static_cast<int>(shape.second.ur.x), static_cast<int>(shape.second.ur.y));
+    rect_via->rect2d_layers.push_back(rect_layer);
+  }
+  phy_db.AddNet("def");
+  segment_id = 0;
+  phy_db.AddDefViaGeometry(rect_via, segment_id, "def", Point2D<double>(4000, 4000));
+  phy_db.AddDefViaGeometry(rect_via, segment_id, "def", Point2D<double>(6000, 1000));
+  CheckViaInstance(geometry, "def", 0, rect_shapes, Point2D<double>(4000, 4000));
+  CheckViaInstance(geometry, "def", 3, rect_shapes, Point2D<double>(6000, 1000));
+
+  // a DEF via generated from a rule: the enclosures around the cut, moved by the layer offsets
+  DefVia *rule_via = phy_db.AddDefVia("rule_via");
+  rule_via->cut_size_ = Size2D<int>(100, 100);
+  rule_via->layers_[0] = "met1";
+  rule_via->layers_[1] = "via1";
+  rule_via->layers_[2] = "met2";
+  rule_via->bot_enc_ = Size2D<int>(50, 10);
+  rule_via->top_enc_ = Size2D<int>(10, 50);
+  rule_via->bot_offset_ = Size2D<int>(20, 0);
+  rule_via->top_offset_ = Size2D<int>(0, -20);
+  std::vector<std::pair<std::string, Rect2D<double>>> rule_shapes = {
+      {"met1", Rect2D<double>(-80, -60, 120, 60)},
+      {"met1", Rect2D<double>(-50, -50, 50, 50)},
+      {"met2", Rect2D<double>(-60, -120, 60, 80)}
+  };
+  phy_db.AddDefViaGeometry(rule_via, segment_id, "def", Point2D<double>(500, 500));
+  phy_db.AddDefViaGeometry(rule_via, segment_id, "def", Point2D<double>(2500, 7500));
+  CheckViaInstance(geometry, "def", 6, rule_shapes, Point2D<double>(500, 500));
+  CheckViaInstance(geometry, "def", 9, rule_shapes, Point2D<double>(2500, 7500));
+  std::cout << "DEF via instances are their shapes moved to their offsets" << std::endl;
+
+  std::cout << "Via geometry test passes!" << std::endl;
+  return 0;
+}